@@ -0,0 +1,304 @@
+/*
+ * Copyright 2011-2013 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+/* CPU kernel benchmark: renders the same scene once with every kernel variant
+ * this build and CPU support (none, sse2, sse3, avx, avx2), so the speedup of
+ * each instruction set can be measured on real scenes. Every kernel is run
+ * with the regular path tracing integrator and with the wavefront one.
+ *
+ * Usage: cycles_bench [--samples N] [--threads N] [--kernels avx2,sse3] file.xml */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "buffers.h"
+#include "camera.h"
+#include "device.h"
+#include "scene.h"
+#include "session.h"
+
+#include "util_args.h"
+#include "util_foreach.h"
+#include "util_path.h"
+#include "util_string.h"
+#include "util_system.h"
+#include "util_time.h"
+#include "util_vector.h"
+
+#include "cycles_xml.h"
+
+CCL_NAMESPACE_BEGIN
+
+struct BenchOptions {
+	string filepath;
+	string kernels;
+	bool no_wavefront;
+	int samples;
+	int threads;
+	int repeat;
+} bench;
+
+struct BenchKernel {
+	const char *name;
+	bool (*supported)();
+};
+
+static bool bench_kernel_always_supported()
+{
+	return true;
+}
+
+/* same names and order as the kernel variants in device_cpu.cpp */
+static const BenchKernel bench_kernels[] = {
+#ifdef WITH_CYCLES_OPTIMIZED_KERNEL_AVX2
+	{"avx2", system_cpu_support_avx2},
+#endif
+#ifdef WITH_CYCLES_OPTIMIZED_KERNEL_AVX
+	{"avx", system_cpu_support_avx},
+#endif
+#ifdef WITH_OPTIMIZED_KERNEL
+	{"sse3", system_cpu_support_sse3},
+	{"sse2", system_cpu_support_sse2},
+#endif
+	{"none", bench_kernel_always_supported},
+};
+
+static void bench_setenv(const char *name, const char *value)
+{
+#ifdef _WIN32
+	_putenv_s(name, value);
+#else
+	setenv(name, value, 1);
+#endif
+}
+
+static bool bench_kernel_requested(const char *name)
+{
+	if(bench.kernels == "")
+		return true;
+
+	vector<string> tokens;
+	string_split(tokens, bench.kernels, ", ");
+
+	foreach(string& token, tokens)
+		if(token == name)
+			return true;
+
+	return false;
+}
+
+static bool bench_find_cpu_device(DeviceInfo& info)
+{
+	vector<DeviceInfo>& devices = Device::available_devices();
+
+	foreach(DeviceInfo& device, devices) {
+		if(device.type == DEVICE_CPU) {
+			info = device;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+struct BenchResult {
+	double time;
+	uint64_t num_rays;
+	int width, height;
+};
+
+/* render the scene once with the kernel selected through the environment,
+ * returns the wall clock time including scene synchronization */
+static BenchResult bench_render(DeviceInfo& device_info, int samples, bool wavefront)
+{
+	SceneParams scene_params;
+	SessionParams session_params;
+	BenchResult result;
+
+	session_params.device = device_info;
+	session_params.background = true;
+	session_params.samples = samples;
+	session_params.threads = bench.threads;
+	session_params.wavefront = wavefront;
+
+	Scene *scene = new Scene(scene_params, session_params.device);
+	xml_read_file(scene, bench.filepath.c_str());
+
+	BufferParams buffer_params;
+	buffer_params.width = scene->camera->width;
+	buffer_params.height = scene->camera->height;
+	buffer_params.full_width = scene->camera->width;
+	buffer_params.full_height = scene->camera->height;
+
+	result.width = buffer_params.width;
+	result.height = buffer_params.height;
+
+	double start_time = time_dt();
+
+	Session *session = new Session(session_params);
+	session->reset(buffer_params, session_params.samples);
+	session->scene = scene;
+
+	session->start();
+	session->wait();
+
+	result.time = time_dt() - start_time;
+	result.num_rays = session->stats.get_num_rays();
+
+	/* also frees the scene */
+	delete session;
+
+	return result;
+}
+
+/* time of bench.samples samples only: scene synchronization and BVH build
+ * do not depend on the kernel, so they are measured with a single sample
+ * render and subtracted */
+static BenchResult bench_kernel_time(DeviceInfo& device_info, bool wavefront)
+{
+	BenchResult sync = bench_render(device_info, 1, wavefront);
+	BenchResult full = bench_render(device_info, bench.samples + 1, wavefront);
+
+	full.time = max(full.time - sync.time, 0.0);
+	full.num_rays = (full.num_rays > sync.num_rays)? full.num_rays - sync.num_rays: 0;
+
+	return full;
+}
+
+static void bench_print(const char *kernel_name, const char *integrator, BenchResult& result, double base_time)
+{
+	double pixel_samples = (double)result.width * (double)result.height * (double)bench.samples;
+	double time = result.time;
+
+	printf("%-8s %-10s %12.3f %12.0f %10.2f %9.2fx\n", kernel_name, integrator, time,
+		(time > 0.0)? pixel_samples / time: 0.0,
+		(time > 0.0)? (double)result.num_rays / time * 1e-6: 0.0,
+		(time > 0.0)? base_time / time: 0.0);
+	fflush(stdout);
+}
+
+static void bench_run()
+{
+	DeviceInfo device_info;
+
+	if(!bench_find_cpu_device(device_info)) {
+		fprintf(stderr, "No CPU device available\n");
+		exit(EXIT_FAILURE);
+	}
+
+	printf("CPU: %s\n", system_cpu_brand_string().c_str());
+	printf("Scene: %s, %d samples\n", path_filename(bench.filepath).c_str(), bench.samples);
+	printf("Rays: camera and bounce rays, shadow rays are not counted\n\n");
+	printf("%-8s %-10s %12s %12s %10s %10s\n", "Kernel", "Integrator", "Time (s)", "Samples/s", "Mrays/s", "Speedup");
+
+	const int tot = sizeof(bench_kernels)/sizeof(bench_kernels[0]);
+	double base_time = 0.0;
+
+	/* run from least to most optimized so the speedup is relative to the
+	 * kernel compiled without SIMD flags */
+	for(int i = tot - 1; i >= 0; i--) {
+		const BenchKernel& kernel = bench_kernels[i];
+
+		if(!bench_kernel_requested(kernel.name))
+			continue;
+
+		if(!kernel.supported()) {
+			printf("%-8s %-10s %12s\n", kernel.name, "", "unsupported");
+			continue;
+		}
+
+		bench_setenv("CYCLES_CPU_KERNEL", kernel.name);
+
+		for(int wavefront = 0; wavefront < 2; wavefront++) {
+			if(wavefront && bench.no_wavefront)
+				break;
+
+			/* keep the best of multiple runs to reduce noise */
+			BenchResult best;
+
+			for(int r = 0; r < bench.repeat; r++) {
+				BenchResult result = bench_kernel_time(device_info, wavefront != 0);
+				if(r == 0 || result.time < best.time)
+					best = result;
+			}
+
+			if(base_time == 0.0)
+				base_time = best.time;
+
+			bench_print(kernel.name, (wavefront)? "wavefront": "path", best, base_time);
+		}
+	}
+}
+
+static int files_parse(int argc, const char *argv[])
+{
+	if(argc > 0)
+		bench.filepath = argv[0];
+
+	return 0;
+}
+
+static void options_parse(int argc, const char **argv)
+{
+	bench.filepath = "";
+	bench.kernels = "";
+	bench.no_wavefront = false;
+	bench.samples = 16;
+	bench.threads = 0;
+	bench.repeat = 1;
+
+	ArgParse ap;
+	bool help = false;
+
+	ap.options ("Usage: cycles_bench [options] file.xml",
+		"%*", files_parse, "",
+		"--samples %d", &bench.samples, "Number of samples to render",
+		"--threads %d", &bench.threads, "CPU Rendering Threads",
+		"--repeat %d", &bench.repeat, "Render each kernel this many times and keep the fastest",
+		"--kernels %s", &bench.kernels, "Comma separated kernels to test: none, sse2, sse3, avx, avx2",
+		"--no-wavefront", &bench.no_wavefront, "Only test the regular path tracing integrator",
+		"--help", &help, "Print help message",
+		NULL);
+
+	if(ap.parse(argc, argv) < 0) {
+		fprintf(stderr, "%s\n", ap.geterror().c_str());
+		ap.usage();
+		exit(EXIT_FAILURE);
+	}
+	else if(help || bench.filepath == "") {
+		ap.usage();
+		exit(EXIT_SUCCESS);
+	}
+
+	if(bench.samples < 1 || bench.repeat < 1) {
+		fprintf(stderr, "Invalid number of samples or repeats\n");
+		exit(EXIT_FAILURE);
+	}
+}
+
+CCL_NAMESPACE_END
+
+using namespace ccl;
+
+int main(int argc, const char **argv)
+{
+	path_init();
+	options_parse(argc, argv);
+	bench_run();
+
+	return 0;
+}
+
@@ -0,0 +1,121 @@
+#
+# Copyright 2011-2013 Blender Foundation
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License
+#
+
+# Generates XML test scenes with many lights, for measuring how light sampling
+# scales with the number of lights, not intended for end users. Lamps and
+# emissive quads are scattered above a ground plane, like a city at night.
+#
+# Usage:
+#   python cycles_many_lights.py --lamps 10000 --quads 1000 --light-tree -o lights.xml
+#   cycles_bench --samples 16 lights.xml
+
+import argparse
+import random
+
+
+def xml_floats(values):
+    return " ".join("%g" % v for v in values)
+
+
+def write_shaders(lines, num_shaders, rng):
+    lines.append('<shader name="ground">')
+    lines.append('\t<diffuse_bsdf name="diffuse" color="0.5 0.5 0.5" />')
+    lines.append('\t<connect from="diffuse bsdf" to="output surface" />')
+    lines.append('</shader>')
+
+    # lights of varying color and strength, so importance by energy matters
+    for i in range(num_shaders):
+        color = (rng.uniform(0.5, 1.0), rng.uniform(0.4, 0.9), rng.uniform(0.2, 0.8))
+        strength = 10.0 ** rng.uniform(0.0, 2.0)
+
+        lines.append('<shader name="light%d">' % i)
+        lines.append('\t<emission name="emission" color="%s" strength="%g" />' % (xml_floats(color), strength))
+        lines.append('\t<connect from="emission emission" to="output surface" />')
+        lines.append('</shader>')
+
+
+def write_scene(args):
+    rng = random.Random(args.seed)
+    size = args.size
+    lines = []
+
+    lines.append('<cycles>')
+    lines.append('<film width="%d" height="%d" />' % (args.width, args.height))
+    lines.append('<integrator use_light_tree="%s" />' % ("true" if args.light_tree else "false"))
+
+    # camera above the ground, looking down at the lights
+    lines.append('<transform translate="0 %g %g" rotate="20 1 0 0">' % (0.4 * size, -1.2 * size))
+    lines.append('\t<camera type="perspective" fov="45" />')
+    lines.append('</transform>')
+
+    # black world, all light comes from the lamps and quads
+    lines.append('<background>')
+    lines.append('\t<background name="bg" strength="0.0" />')
+    lines.append('\t<connect from="bg background" to="output surface" />')
+    lines.append('</background>')
+
+    write_shaders(lines, args.shaders, rng)
+
+    # ground plane
+    lines.append('<state shader="ground">')
+    lines.append('\t<mesh P="%s" nverts="4" verts="0 1 2 3" />' %
+                 xml_floats((-size, 0, -size, size, 0, -size, size, 0, size, -size, 0, size)))
+    lines.append('</state>')
+
+    # small point lamps
+    for i in range(args.lamps):
+        P = (rng.uniform(-size, size), rng.uniform(0.05, 0.1) * size, rng.uniform(-size, size))
+        shader = rng.randrange(args.shaders)
+
+        lines.append('<state shader="light%d"><light P="%s" size="%g" use_mis="true" /></state>' %
+                     (shader, xml_floats(P), args.lamp_size))
+
+    # emissive quads facing down, like lit windows
+    for i in range(args.quads):
+        x, y, z = rng.uniform(-size, size), rng.uniform(0.05, 0.2) * size, rng.uniform(-size, size)
+        h = 0.5 * args.quad_size
+        P = (x - h, y, z - h, x + h, y, z - h, x + h, y, z + h, x - h, y, z + h)
+        shader = rng.randrange(args.shaders)
+
+        lines.append('<state shader="light%d"><mesh P="%s" nverts="4" verts="0 1 2 3" /></state>' %
+                     (shader, xml_floats(P)))
+
+    lines.append('</cycles>')
+
+    f = open(args.output, "w")
+    f.write("\n".join(lines) + "\n")
+    f.close()
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Generate a Cycles XML scene with many lights")
+    parser.add_argument("-o", "--output", default="many_lights.xml", help="output XML file")
+    parser.add_argument("--lamps", type=int, default=1000, help="number of point lamps")
+    parser.add_argument("--quads", type=int, default=0, help="number of emissive quads")
+    parser.add_argument("--shaders", type=int, default=16, help="number of distinct light shaders")
+    parser.add_argument("--size", type=float, default=50.0, help="half size of the ground plane")
+    parser.add_argument("--lamp-size", type=float, default=0.1, help="lamp radius")
+    parser.add_argument("--quad-size", type=float, default=0.5, help="emissive quad size")
+    parser.add_argument("--width", type=int, default=960)
+    parser.add_argument("--height", type=int, default=540)
+    parser.add_argument("--seed", type=int, default=0)
+    parser.add_argument("--light-tree", action="store_true", help="enable the light tree")
+
+    write_scene(parser.parse_args())
+
+
+if __name__ == "__main__":
+    main()
@@ -19,12 +19,15 @@
 #include "buffers.h"
 #include "camera.h"
 #include "device.h"
+#include "film.h"
+#include "integrator.h"
 #include "scene.h"
 #include "session.h"
 
 #include "util_args.h"
 #include "util_foreach.h"
 #include "util_function.h"
+#include "util_map.h"
 #include "util_path.h"
 #include "util_progress.h"
 #include "util_string.h"
@@ -45,6 +48,8 @@ struct Options {
 	int width, height;
 	SceneParams scene_params;
 	SessionParams session_params;
+	vector<Pass> passes;
+	float adaptive_threshold;
 	bool quiet;
 } options;
 
@@ -91,6 +96,7 @@ static BufferParams& session_buffer_params()
 	buffer_params.height = options.height;
 	buffer_params.full_width = options.width;
 	buffer_params.full_height = options.height;
+	buffer_params.passes = options.passes;
 
 	return buffer_params;
 }
@@ -117,6 +123,22 @@ static void scene_init(int width, int height)
 {
 	options.scene = new Scene(options.scene_params, options.session_params.device);
 	xml_read_file(options.scene, options.filepath.c_str());
+
+	/* adaptive sampling stores sample counts and variance in passes */
+	Integrator *integrator = options.scene->integrator;
+
+	if(options.adaptive_threshold > 0.0f)
+		integrator->adaptive_threshold = options.adaptive_threshold;
+
+	options.passes.clear();
+	Pass::add(PASS_COMBINED, options.passes);
+
+	if(integrator->adaptive_threshold > 0.0f) {
+		Pass::add(PASS_SAMPLE_COUNT, options.passes);
+		Pass::add(PASS_SAMPLE_VARIANCE, options.passes);
+	}
+
+	options.scene->film->tag_passes_update(options.scene, options.passes);
 	
 	if (width == 0 || height == 0) {
 		options.width = options.scene->camera->width;
@@ -124,9 +146,26 @@ static void scene_init(int width, int height)
 	}
 }
 
+static void session_print_phase_times(Progress& progress)
+{
+	map<string, double> phase_times;
+	progress.get_phase_times(phase_times);
+
+	if(phase_times.empty())
+		return;
+
+	printf("\n");
+
+	for(map<string, double>::iterator it = phase_times.begin(); it != phase_times.end(); it++)
+		printf("%-24s %10.4fs\n", (it->first + ":").c_str(), it->second);
+}
+
 static void session_exit()
 {
 	if(options.session) {
+		if(options.session_params.background && !options.quiet)
+			session_print_phase_times(options.session->progress);
+
 		delete options.session;
 		options.session = NULL;
 	}
@@ -209,6 +248,7 @@ static void options_parse(int argc, const char **argv)
 	options.filepath = "";
 	options.session = NULL;
 	options.quiet = false;
+	options.adaptive_threshold = 0.0f;
 
 	/* device names */
 	string device_names = "";
@@ -245,6 +285,13 @@ static void options_parse(int argc, const char **argv)
 		"--samples %d", &options.session_params.samples, "Number of samples to render",
 		"--output %s", &options.session_params.output_path, "File path to write output image",
 		"--threads %d", &options.session_params.threads, "CPU Rendering Threads",
+		"--wavefront", &options.session_params.wavefront, "Use the wavefront path tracing integrator on the CPU",
+		"--adaptive-threshold %f", &options.adaptive_threshold, "Stop sampling pixels once their noise is below this threshold",
+		"--texture-cache", &options.scene_params.use_texture_cache, "Load image textures on demand in tiles and MIP levels (CPU only)",
+		"--texture-cache-size %d", &options.scene_params.texture_cache_size, "Maximum memory used by the texture cache in MB",
+		"--out-of-core", &options.scene_params.use_out_of_core, "Page packed geometry from memory mapped files (CPU only)",
+		"--out-of-core-path %s", &options.scene_params.out_of_core_path, "Directory for out-of-core geometry files",
+		"--out-of-core-limit %d", &options.scene_params.out_of_core_memory_limit, "Maximum resident out-of-core geometry in MB, 0 for no limit",
 		"--width  %d", &options.width, "Window width in pixel",
 		"--height %d", &options.height, "Window height in pixel",
 		"--list-devices", &list, "List information about all available devices",
@@ -283,6 +283,11 @@ static void xml_read_integrator(const XMLReadState& state, pugi::xml_node node)
 	
 	xml_read_int(&integrator->seed, node, "seed");
 	xml_read_float(&integrator->sample_clamp, node, "sample_clamp");
+
+	xml_read_float(&integrator->adaptive_threshold, node, "adaptive_threshold");
+	xml_read_int(&integrator->adaptive_min_samples, node, "adaptive_min_samples");
+
+	xml_read_bool(&integrator->use_light_tree, node, "use_light_tree");
 }
 
 /* Camera */
@@ -811,6 +816,8 @@ static void xml_read_light(const XMLReadState& state, pugi::xml_node node)
 	light->shader = state.shader;
 	xml_read_float3(&light->co, node, "P");
 	light->co = transform_point(&state.tfm, light->co);
+	xml_read_float(&light->size, node, "size");
+	xml_read_bool(&light->use_mis, node, "use_mis");
 
 	state.scene->lights.push_back(light);
 }
@@ -21,7 +21,8 @@ from bpy.props import (BoolProperty,
                        EnumProperty,
                        FloatProperty,
                        IntProperty,
-                       PointerProperty)
+                       PointerProperty,
+                       StringProperty)
 
 # enums
 
@@ -337,6 +338,31 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
                 default=0.0,
                 )
 
+        cls.adaptive_threshold = FloatProperty(
+                name="Noise Threshold",
+                description="If non-zero, stop sampling pixels once their estimated noise "
+                            "is below this threshold, so render time goes to noisier regions "
+                            "(final renders only)",
+                min=0.0, max=1.0,
+                default=0.0,
+                precision=3,
+                )
+        cls.adaptive_min_samples = IntProperty(
+                name="Min Samples",
+                description="Number of samples to take for every pixel before "
+                            "estimating its noise for adaptive sampling",
+                min=2, max=4096,
+                default=16,
+                )
+
+        cls.use_light_tree = BoolProperty(
+                name="Light Tree",
+                description="Pick lights by their estimated contribution at each shading point, "
+                            "using a tree built over all lamps and emitting triangles, "
+                            "reduces noise in scenes with many lights",
+                default=False,
+                )
+
         cls.debug_tile_size = IntProperty(
                 name="Tile Size",
                 description="",
@@ -382,11 +408,50 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
                 description="Use BVH spatial splits: longer builder time, faster render",
                 default=False,
                 )
+        cls.debug_use_cpu_wavefront = BoolProperty(
+                name="Wavefront Integrator",
+                description="Trace the paths of a tile together one bounce at a time, sorted by ray direction "
+                            "and shader, instead of one path at a time (CPU only, not for branched path tracing)",
+                default=False,
+                )
         cls.use_cache = BoolProperty(
                 name="Cache BVH",
-                description="Cache last built BVH to disk for faster re-render if no geometry changed",
+                description="Cache built BVHs to disk for faster re-render of unchanged geometry, least recently used files are removed when the cache gets too large",
+                default=False,
+                )
+        cls.use_texture_cache = BoolProperty(
+                name="Texture Cache",
+                description="Load image textures on demand in tiles and MIP levels, instead of fully before rendering, "
+                            "works best with tiled and MIP-mapped .tx or EXR files (CPU only, not for packed or generated images)",
                 default=False,
                 )
+        cls.texture_cache_size = IntProperty(
+                name="Cache Size",
+                description="Maximum memory used by the texture cache in MB",
+                min=64, max=1048576,
+                default=1024,
+                )
+        cls.use_out_of_core = BoolProperty(
+                name="Out-of-core Geometry",
+                description="Store packed geometry in memory mapped files during rendering, so it can be paged "
+                            "out while rendering (CPU final renders only). Geometry is still packed in memory "
+                            "first, so this does not lower the peak memory usage of the scene update",
+                default=False,
+                )
+        cls.out_of_core_memory_limit = IntProperty(
+                name="Memory Limit",
+                description="Maximum memory for out-of-core geometry in MB, "
+                            "geometry not used recently is dropped from memory above it, 0 for no limit",
+                min=0, max=1048576,
+                default=0,
+                )
+        cls.out_of_core_directory = StringProperty(
+                name="Directory",
+                description="Directory for out-of-core geometry files, preferably on a fast local disk, "
+                            "uses the Blender user directory when empty",
+                subtype='DIR_PATH',
+                default="",
+                )
         cls.tile_order = EnumProperty(
                 name="Tile Order",
                 description="Tile order for rendering",
@@ -402,6 +467,24 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
                             "but time can be saved by manually stopping the render when the noise is low enough)",
                 default=False,
                 )
+        cls.use_checkpoints = BoolProperty(
+                name="Checkpoints",
+                description="Save finished and partially rendered tiles of final renders at regular intervals, "
+                            "and continue from them when a stopped render of the same frame is started again",
+                default=False,
+                )
+        cls.checkpoint_interval = FloatProperty(
+                name="Checkpoint Interval",
+                description="Time in seconds between saving checkpoints",
+                min=1.0, max=86400.0,
+                default=300.0,
+                )
+        cls.checkpoint_directory = StringProperty(
+                name="Checkpoint Directory",
+                description="Directory to save checkpoints in",
+                subtype='DIR_PATH',
+                default="//checkpoints/",
+                )
 
     @classmethod
     def unregister(cls):
@@ -118,6 +118,11 @@ class CyclesRender_PT_sampling(CyclesButtonsPanel, Panel):
         sub.label("Settings:")
         sub.prop(cscene, "seed")
         sub.prop(cscene, "sample_clamp")
+        sub.prop(cscene, "adaptive_threshold")
+        subsub = sub.row(align=True)
+        subsub.active = cscene.adaptive_threshold > 0.0
+        subsub.prop(cscene, "adaptive_min_samples")
+        sub.prop(cscene, "use_light_tree")
 
         if cscene.progressive == 'PATH':
             col = split.column()
@@ -266,6 +271,12 @@ class CyclesRender_PT_performance(CyclesButtonsPanel, Panel):
 
         sub.prop(cscene, "use_progressive_refine")
 
+        sub.prop(cscene, "use_checkpoints")
+        subsub = sub.column(align=True)
+        subsub.active = cscene.use_checkpoints and not cscene.use_progressive_refine
+        subsub.prop(cscene, "checkpoint_interval", text="Interval")
+        subsub.prop(cscene, "checkpoint_directory", text="")
+
         subsub = sub.column(align=True)
         subsub.enabled = not rd.use_border
         subsub.prop(rd, "use_save_buffers")
@@ -288,6 +299,20 @@ class CyclesRender_PT_performance(CyclesButtonsPanel, Panel):
         col.label(text="Acceleration structure:")
         col.prop(cscene, "debug_use_spatial_splits")
 
+        col.separator()
+
+        col.label(text="CPU:")
+        col.prop(cscene, "debug_use_cpu_wavefront")
+        col.prop(cscene, "use_texture_cache")
+        sub = col.column()
+        sub.active = cscene.use_texture_cache
+        sub.prop(cscene, "texture_cache_size")
+        col.prop(cscene, "use_out_of_core")
+        sub = col.column()
+        sub.active = cscene.use_out_of_core
+        sub.prop(cscene, "out_of_core_memory_limit")
+        sub.prop(cscene, "out_of_core_directory", text="")
+
 
 class CyclesRender_PT_opengl(CyclesButtonsPanel, Panel):
     bl_label = "OpenGL Render"
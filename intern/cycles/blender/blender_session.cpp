@@ -17,6 +17,7 @@
 #include "background.h"
 #include "buffers.h"
 #include "camera.h"
+#include "checkpoint.h"
 #include "device.h"
 #include "integrator.h"
 #include "film.h"
@@ -28,6 +29,7 @@
 #include "util_color.h"
 #include "util_foreach.h"
 #include "util_function.h"
+#include "util_path.h"
 #include "util_progress.h"
 #include "util_time.h"
 
@@ -79,7 +81,7 @@ BlenderSession::~BlenderSession()
 
 void BlenderSession::create_session()
 {
-	SceneParams scene_params = BlenderSync::get_scene_params(b_scene, background);
+	SceneParams scene_params = BlenderSync::get_scene_params(b_data, b_scene, background);
 	SessionParams session_params = BlenderSync::get_session_params(b_engine, b_userpref, b_scene, background);
 
 	/* reset status/progress */
@@ -131,7 +133,7 @@ void BlenderSession::reset_session(BL::BlendData b_data_, BL::Scene b_scene_)
 	b_render = b_engine.render();
 	b_scene = b_scene_;
 
-	SceneParams scene_params = BlenderSync::get_scene_params(b_scene, background);
+	SceneParams scene_params = BlenderSync::get_scene_params(b_data, b_scene, background);
 	SessionParams session_params = BlenderSync::get_session_params(b_engine, b_userpref, b_scene, background);
 
 	width = render_resolution_x(b_render);
@@ -328,6 +330,26 @@ void BlenderSession::update_render_tile(RenderTile& rtile)
 		do_write_update_render_tile(rtile, false);
 }
 
+string BlenderSession::checkpoint_filepath(const string& layer_name)
+{
+	PointerRNA cscene = RNA_pointer_get(&b_scene.ptr, "cycles");
+	string blend_filepath = b_data.filepath();
+
+	if(!get_boolean(cscene, "use_checkpoints") || blend_filepath == "")
+		return "";
+
+	/* one file per frame and layer, with the modification time of the blend
+	 * file so that saving changes does not continue an outdated render, and
+	 * a hash of the synced scene for changes that were not saved */
+	string dir = blender_absolute_path(b_data, b_scene, get_string(cscene, "checkpoint_directory"));
+	string name = string_printf("%s_%s_%s_%04d_%llu_%s.checkpoint",
+		path_filename(blend_filepath).c_str(), b_scene.name().c_str(), layer_name.c_str(),
+		b_scene.frame_current(), (unsigned long long)path_modified_time(blend_filepath),
+		RenderCheckpoint::scene_hash(scene).c_str());
+
+	return path_join(dir, name);
+}
+
 void BlenderSession::render()
 {
 	/* set callback to write out render results */
@@ -378,6 +400,12 @@ void BlenderSession::render()
 			}
 		}
 
+		/* per pixel sample count and variance for adaptive sampling */
+		if(scene->integrator->adaptive_threshold > 0.0f) {
+			Pass::add(PASS_SAMPLE_COUNT, passes);
+			Pass::add(PASS_SAMPLE_VARIANCE, passes);
+		}
+
 		/* free result without merging */
 		end_render_result(b_engine, b_rr, true);
 
@@ -390,6 +418,9 @@ void BlenderSession::render()
 		sync->sync_camera(b_render, b_engine.camera_override(), width, height);
 		sync->sync_data(b_v3d, b_engine.camera_override(), b_rlay_name.c_str());
 
+		/* checkpoint to continue a stopped render of this frame and layer */
+		session->params.checkpoint_path = checkpoint_filepath(b_rlay_name);
+
 		/* update number of samples per layer */
 		int samples = sync->get_layer_samples();
 		bool bound_samples = sync->get_layer_bound_samples();
@@ -478,7 +509,7 @@ void BlenderSession::synchronize()
 		return;
 
 	/* on session/scene parameter changes, we recreate session entirely */
-	SceneParams scene_params = BlenderSync::get_scene_params(b_scene, background);
+	SceneParams scene_params = BlenderSync::get_scene_params(b_data, b_scene, background);
 	SessionParams session_params = BlenderSync::get_session_params(b_engine, b_userpref, b_scene, background);
 
 	if(session->params.modified(session_params) ||
@@ -179,6 +179,11 @@ void BlenderSync::sync_integrator()
 	integrator->layer_flag = render_layer.layer;
 
 	integrator->sample_clamp = get_float(cscene, "sample_clamp");
+
+	/* adaptive sampling is only used for final renders, the passes it
+	 * needs are added by the session */
+	integrator->adaptive_threshold = (preview)? 0.0f: get_float(cscene, "adaptive_threshold");
+	integrator->adaptive_min_samples = get_int(cscene, "adaptive_min_samples");
 #ifdef __CAMERA_MOTION__
 	if(!preview) {
 		if(integrator->motion_blur != r.use_motion_blur()) {
@@ -192,6 +197,14 @@ void BlenderSync::sync_integrator()
 
 	integrator->method = (Integrator::Method)get_enum(cscene, "progressive");
 
+	/* the light tree is built by the light manager */
+	bool use_light_tree = get_boolean(cscene, "use_light_tree");
+
+	if(integrator->use_light_tree != use_light_tree) {
+		integrator->use_light_tree = use_light_tree;
+		scene->light_manager->tag_update(scene);
+	}
+
 	int diffuse_samples = get_int(cscene, "diffuse_samples");
 	int glossy_samples = get_int(cscene, "glossy_samples");
 	int transmission_samples = get_int(cscene, "transmission_samples");
@@ -333,7 +346,7 @@ void BlenderSync::sync_render_layers(BL::SpaceView3D b_v3d, const char *layer)
 
 /* Scene Parameters */
 
-SceneParams BlenderSync::get_scene_params(BL::Scene b_scene, bool background)
+SceneParams BlenderSync::get_scene_params(BL::BlendData b_data, BL::Scene b_scene, bool background)
 {
 	BL::RenderSettings r = b_scene.render();
 	SceneParams params;
@@ -345,18 +358,30 @@ SceneParams BlenderSync::get_scene_params(BL::Scene b_scene, bool background)
 	else if(shadingsystem == 1)
 		params.shadingsystem = SceneParams::OSL;
 	
-	if(background)
+	if(background && params.shadingsystem != SceneParams::OSL)
+		params.persistent_data = r.use_persistent_data();
+	else
+		params.persistent_data = false;
+
+	/* with persistent data, keep mesh BVH's across frames so objects that
+	 * only move just update the top level BVH */
+	if(background && !params.persistent_data)
 		params.bvh_type = SceneParams::BVH_STATIC;
+	else if(background)
+		params.bvh_type = SceneParams::BVH_DYNAMIC;
 	else
 		params.bvh_type = (SceneParams::BVHType)RNA_enum_get(&cscene, "debug_bvh_type");
 
 	params.use_bvh_spatial_split = RNA_boolean_get(&cscene, "debug_use_spatial_splits");
 	params.use_bvh_cache = (background)? RNA_boolean_get(&cscene, "use_cache"): false;
 
-	if(background && params.shadingsystem != SceneParams::OSL)
-		params.persistent_data = r.use_persistent_data();
-	else
-		params.persistent_data = false;
+	params.use_texture_cache = RNA_boolean_get(&cscene, "use_texture_cache");
+	params.texture_cache_size = get_int(cscene, "texture_cache_size");
+
+	/* out-of-core geometry forces BVH rebuilds, so only for final renders */
+	params.use_out_of_core = (background)? RNA_boolean_get(&cscene, "use_out_of_core"): false;
+	params.out_of_core_path = blender_absolute_path(b_data, b_scene, get_string(cscene, "out_of_core_directory"));
+	params.out_of_core_memory_limit = get_int(cscene, "out_of_core_memory_limit");
 
 	return params;
 }
@@ -473,8 +498,12 @@ SessionParams BlenderSync::get_session_params(BL::RenderEngine b_engine, BL::Use
 	params.reset_timeout = get_float(cscene, "debug_reset_timeout");
 	params.text_timeout = get_float(cscene, "debug_text_timeout");
 
+	params.wavefront = get_boolean(cscene, "debug_use_cpu_wavefront");
+
 	params.progressive_refine = get_boolean(cscene, "use_progressive_refine");
 
+	params.checkpoint_interval = get_float(cscene, "checkpoint_interval");
+
 	if(background) {
 		if(params.progressive_refine)
 			params.progressive = true;
@@ -31,6 +31,7 @@
 #include "util_map.h"
 #include "util_progress.h"
 #include "util_system.h"
+#include "util_time.h"
 #include "util_types.h"
 #include "util_math.h"
 
@@ -57,7 +58,7 @@ struct BVHStackEntry
 /* BVH */
 
 BVH::BVH(const BVHParams& params_, const vector<Object*>& objects_)
-: params(params_), objects(objects_)
+: params(params_), objects(objects_), top_level_prims(0)
 {
 }
 
@@ -73,6 +74,10 @@ BVH *BVH::create(const BVHParams& params, const vector<Object*>& objects)
 
 bool BVH::cache_read(CacheData& key)
 {
+	/* the key is the content the BVH is built from, so unchanged meshes and
+	 * scenes find their BVH again, also from other scenes or machines that
+	 * share the cache directory */
+	key.add(BVH_CACHE_VERSION);
 	key.add(system_cpu_bits());
 	key.add(&params, sizeof(params));
 
@@ -102,6 +107,13 @@ bool BVH::cache_read(CacheData& key)
 		value.read(pack.prim_index);
 		value.read(pack.prim_object);
 		value.read(pack.is_leaf);
+		value.read(top_level_prims);
+
+		if(value.read_error) {
+			/* invalid data, build again */
+			top_level_prims = 0;
+			return false;
+		}
 
 		return true;
 	}
@@ -124,30 +136,13 @@ void BVH::cache_write(CacheData& key)
 	value.add(pack.prim_index);
 	value.add(pack.prim_object);
 	value.add(pack.is_leaf);
+	value.add(top_level_prims);
 
 	Cache::global.insert(key, value);
 
 	cache_filename = key.get_filename();
 }
 
-void BVH::clear_cache_except()
-{
-	set<string> except;
-
-	if(!cache_filename.empty())
-		except.insert(cache_filename);
-
-	foreach(Object *ob, objects) {
-		Mesh *mesh = ob->mesh;
-		BVH *bvh = mesh->bvh;
-
-		if(bvh && !bvh->cache_filename.empty())
-			except.insert(bvh->cache_filename);
-	}
-
-	Cache::global.clear_except("bvh", except);
-}
-
 /* Building */
 
 void BVH::build(Progress& progress)
@@ -193,7 +188,10 @@ void BVH::build(Progress& progress)
 
 	/* pack triangles */
 	progress.set_substatus("Packing BVH triangles and strands");
+
+	double phase_start_time = time_dt();
 	pack_primitives();
+	progress.add_phase_time("BVH pack primitives", time_dt() - phase_start_time);
 
 	if(progress.get_cancel()) {
 		root->deleteSubtree();
@@ -203,7 +201,10 @@ void BVH::build(Progress& progress)
 	/* pack nodes */
 	progress.set_substatus("Packing BVH nodes");
 	array<int> tmp_prim_object = pack.prim_object;
+
+	phase_start_time = time_dt();
 	pack_nodes(tmp_prim_object, root);
+	progress.add_phase_time("BVH pack nodes", time_dt() - phase_start_time);
 	
 	/* free build nodes */
 	root->deleteSubtree();
@@ -214,10 +215,6 @@ void BVH::build(Progress& progress)
 	if(params.use_cache) {
 		progress.set_substatus("Writing BVH cache");
 		cache_write(key);
-
-		/* clear other bvh files from cache */
-		if(params.top_level)
-			clear_cache_except();
 	}
 }
 
@@ -225,13 +222,95 @@ void BVH::build(Progress& progress)
 
 void BVH::refit(Progress& progress)
 {
+	/* the top level BVH has the instance BVH's merged in, split them off so
+	 * only its own nodes are refit, and merge them again afterwards. this
+	 * also picks up the refitted nodes of deformed instanced meshes. */
+	if(params.top_level) {
+		assert(can_refit());
+		unpack_instances();
+	}
+
 	progress.set_substatus("Packing BVH primitives");
 	pack_primitives();
 
-	if(progress.get_cancel()) return;
+	if(!progress.get_cancel()) {
+		progress.set_substatus("Refitting BVH nodes");
+		refit_nodes();
+	}
 
-	progress.set_substatus("Refitting BVH nodes");
-	refit_nodes();
+	if(params.top_level) {
+		if(progress.get_cancel()) {
+			/* left unpacked, must be rebuilt */
+			top_level_prims = 0;
+			return;
+		}
+
+		progress.set_substatus("Merging instance BVHs");
+		size_t nsize = (params.use_qbvh)? BVH_QNODE_SIZE: BVH_NODE_SIZE;
+		pack_instances(pack.is_leaf.size()*nsize);
+	}
+}
+
+bool BVH::can_refit() const
+{
+	/* refit keeps the tree topology, so the caller must ensure the objects
+	 * and their primitives did not change, and for the top level that the
+	 * instance BVH's were not rebuilt */
+	if(params.top_level)
+		return top_level_prims != 0;
+
+	return pack.nodes.size() != 0;
+}
+
+void BVH::refit_primitives(int start, int end, BoundBox& bbox, uint& visibility)
+{
+	for(int prim = start; prim < end; prim++) {
+		int pidx = pack.prim_index[prim];
+		int tob = pack.prim_object[prim];
+		Object *ob = objects[tob];
+
+		if(pidx == -1) {
+			/* object instance */
+			bbox.grow(ob->bounds);
+		}
+		else {
+			/* primitives */
+			const Mesh *mesh = ob->mesh;
+
+			if(pack.prim_segment[prim] != ~0) {
+				/* curves */
+				int k0 = mesh->curves[pidx].first_key + pack.prim_segment[prim]; // XXX!
+				int k1 = k0 + 1;
+
+				float3 p[4];
+				p[0] = mesh->curve_keys[max(k0 - 1,mesh->curves[pidx].first_key)].co;
+				p[1] = mesh->curve_keys[k0].co;
+				p[2] = mesh->curve_keys[k1].co;
+				p[3] = mesh->curve_keys[min(k1 + 1,mesh->curves[pidx].first_key + mesh->curves[pidx].num_keys - 1)].co;
+				float3 lower;
+				float3 upper;
+				curvebounds(&lower.x, &upper.x, p, 0);
+				curvebounds(&lower.y, &upper.y, p, 1);
+				curvebounds(&lower.z, &upper.z, p, 2);
+				float mr = max(mesh->curve_keys[k0].radius,mesh->curve_keys[k1].radius);
+				bbox.grow(lower, mr);
+				bbox.grow(upper, mr);
+
+				visibility |= PATH_RAY_CURVE;
+			}
+			else {
+				/* triangles */
+				const int *vidx = mesh->triangles[pidx].v;
+				const float3 *vpos = &mesh->verts[0];
+
+				bbox.grow(vpos[vidx[0]]);
+				bbox.grow(vpos[vidx[1]]);
+				bbox.grow(vpos[vidx[2]]);
+			}
+		}
+
+		visibility |= ob->visibility;
+	}
 }
 
 /* Triangles */
@@ -355,6 +434,8 @@ void BVH::pack_instances(size_t nodes_size)
 	bool use_qbvh = params.use_qbvh;
 	size_t nsize = (use_qbvh)? BVH_QNODE_SIZE: BVH_NODE_SIZE;
 
+	top_level_prims = pack.prim_index.size();
+
 	/* adjust primitive index to point to the triangle in the global array, for
 	 * meshes with transform applied and already in the top level BVH */
 	for(size_t i = 0; i < pack.prim_index.size(); i++)
@@ -518,6 +599,29 @@ void BVH::pack_instances(size_t nodes_size)
 	}
 }
 
+void BVH::unpack_instances()
+{
+	/* inverse of pack_instances, leaves only the nodes and primitives of the
+	 * top level BVH itself, with primitive indexes local to their mesh */
+	size_t nsize = (params.use_qbvh)? BVH_QNODE_SIZE: BVH_NODE_SIZE;
+
+	pack.nodes.resize(pack.is_leaf.size()*nsize);
+	pack.prim_index.resize(top_level_prims);
+	pack.prim_segment.resize(top_level_prims);
+	pack.prim_object.resize(top_level_prims);
+	pack.prim_visibility.resize(top_level_prims);
+	pack.tri_woop.resize(top_level_prims*TRI_NODE_SIZE);
+	pack.object_node.clear();
+
+	for(size_t i = 0; i < pack.prim_index.size(); i++)
+		if(pack.prim_index[i] != -1) {
+			if(pack.prim_segment[i] != ~0)
+				pack.prim_index[i] -= objects[pack.prim_object[i]]->mesh->curve_offset;
+			else
+				pack.prim_index[i] -= objects[pack.prim_object[i]]->mesh->tri_offset;
+		}
+}
+
 /* Regular BVH */
 
 RegularBVH::RegularBVH(const BVHParams& params_, const vector<Object*>& objects_)
@@ -600,8 +704,6 @@ void RegularBVH::pack_nodes(const array<int>& prims, const BVHNode *root)
 
 void RegularBVH::refit_nodes()
 {
-	assert(!params.top_level);
-
 	BoundBox bbox = BoundBox::empty;
 	uint visibility = 0;
 	refit_node(0, (pack.is_leaf[0])? true: false, bbox, visibility);
@@ -615,56 +717,11 @@ void RegularBVH::refit_node(int idx, bool leaf, BoundBox& bbox, uint& visibility
 	int c1 = data[3].y;
 
 	if(leaf) {
-		/* refit leaf node */
-		for(int prim = c0; prim < c1; prim++) {
-			int pidx = pack.prim_index[prim];
-			int tob = pack.prim_object[prim];
-			Object *ob = objects[tob];
-
-			if(pidx == -1) {
-				/* object instance */
-				bbox.grow(ob->bounds);
-			}
-			else {
-				/* primitives */
-				const Mesh *mesh = ob->mesh;
-
-				if(pack.prim_segment[prim] != ~0) {
-					/* curves */
-					int str_offset = (params.top_level)? mesh->curve_offset: 0;
-					int k0 = mesh->curves[pidx - str_offset].first_key + pack.prim_segment[prim]; // XXX!
-					int k1 = k0 + 1;
-
-					float3 p[4];
-					p[0] = mesh->curve_keys[max(k0 - 1,mesh->curves[pidx - str_offset].first_key)].co;
-					p[1] = mesh->curve_keys[k0].co;
-					p[2] = mesh->curve_keys[k1].co;
-					p[3] = mesh->curve_keys[min(k1 + 1,mesh->curves[pidx - str_offset].first_key + mesh->curves[pidx - str_offset].num_keys - 1)].co;
-					float3 lower;
-					float3 upper;
-					curvebounds(&lower.x, &upper.x, p, 0);
-					curvebounds(&lower.y, &upper.y, p, 1);
-					curvebounds(&lower.z, &upper.z, p, 2);
-					float mr = max(mesh->curve_keys[k0].radius,mesh->curve_keys[k1].radius);
-					bbox.grow(lower, mr);
-					bbox.grow(upper, mr);
-
-					visibility |= PATH_RAY_CURVE;
-				}
-				else {
-					/* triangles */
-					int tri_offset = (params.top_level)? mesh->tri_offset: 0;
-					const int *vidx = mesh->triangles[pidx - tri_offset].v;
-					const float3 *vpos = &mesh->verts[0];
-
-					bbox.grow(vpos[vidx[0]]);
-					bbox.grow(vpos[vidx[1]]);
-					bbox.grow(vpos[vidx[2]]);
-				}
-			}
-
-			visibility |= ob->visibility;
-		}
+		/* refit leaf node, object leaves store the inverted primitive index */
+		if(c0 < 0)
+			refit_primitives(~c0, ~c0 + 1, bbox, visibility);
+		else
+			refit_primitives(c0, c1, bbox, visibility);
 
 		pack_node(idx, bbox, bbox, c0, c1, visibility, visibility);
 	}
@@ -824,7 +881,54 @@ void QBVH::pack_nodes(const array<int>& prims, const BVHNode *root)
 
 void QBVH::refit_nodes()
 {
-	assert(0); /* todo */
+	BoundBox bbox = BoundBox::empty;
+	uint visibility = 0;
+	refit_node(0, (pack.is_leaf[0])? true: false, bbox, visibility);
+}
+
+void QBVH::refit_node(int idx, bool leaf, BoundBox& bbox, uint& visibility)
+{
+	float4 data[BVH_QNODE_SIZE];
+
+	memcpy(data, &pack.nodes[idx * BVH_QNODE_SIZE], sizeof(float4)*BVH_QNODE_SIZE);
+
+	if(leaf) {
+		/* refit leaf node, the bounds are stored in the parent */
+		int c0 = __float_as_int(data[6].x);
+		int c1 = __float_as_int(data[6].y);
+
+		if(c0 < 0)
+			refit_primitives(~c0, ~c0 + 1, bbox, visibility);
+		else
+			refit_primitives(c0, c1, bbox, visibility);
+	}
+	else {
+		/* refit inner node, set bounds of each used child */
+		for(int i = 0; i < 4; i++) {
+			int c = __float_as_int(data[6][i]);
+
+			/* unused children have index 0, which is always the root */
+			if(c == 0)
+				continue;
+
+			BoundBox cbbox = BoundBox::empty;
+			uint cvisibility = 0;
+
+			refit_node((c < 0)? -c-1: c, (c < 0), cbbox, cvisibility);
+
+			data[0][i] = cbbox.min.x;
+			data[1][i] = cbbox.max.x;
+			data[2][i] = cbbox.min.y;
+			data[3][i] = cbbox.max.y;
+			data[4][i] = cbbox.min.z;
+			data[5][i] = cbbox.max.z;
+
+			bbox.grow(cbbox);
+			visibility |= cvisibility;
+		}
+
+		memcpy(&pack.nodes[idx * BVH_QNODE_SIZE], data, sizeof(float4)*BVH_QNODE_SIZE);
+	}
 }
 
 CCL_NAMESPACE_END
@@ -38,6 +38,7 @@ class Progress;
 #define BVH_NODE_SIZE	4
 #define BVH_QNODE_SIZE	8
 #define BVH_ALIGN		4096
+#define BVH_CACHE_VERSION	1
 #define TRI_NODE_SIZE	3
 
 /* Packed BVH
@@ -93,8 +94,7 @@ public:
 
 	void build(Progress& progress);
 	void refit(Progress& progress);
-
-	void clear_cache_except();
+	bool can_refit() const;
 
 protected:
 	BVH(const BVHParams& params, const vector<Object*>& objects);
@@ -110,6 +110,14 @@ protected:
 
 	/* merge instance BVH's */
 	void pack_instances(size_t nodes_size);
+	void unpack_instances();
+
+	/* refit */
+	void refit_primitives(int start, int end, BoundBox& bbox, uint& visibility);
+
+	/* number of primitives of the top level BVH itself, instance BVH
+	 * primitives are merged after these. zero if it can't be refit. */
+	size_t top_level_prims;
 
 	/* for subclasses to implement */
 	virtual void pack_nodes(const array<int>& prims, const BVHNode *root) = 0;
@@ -154,6 +162,7 @@ protected:
 
 	/* refit */
 	void refit_nodes();
+	void refit_node(int idx, bool leaf, BoundBox& bbox, uint& visibility);
 };
 
 CCL_NAMESPACE_END
@@ -23,7 +23,9 @@
 
 #include "util_algorithm.h"
 #include "util_boundbox.h"
+#include "util_task.h"
 #include "util_types.h"
+#include "util_vector.h"
 
 CCL_NAMESPACE_BEGIN
 
@@ -59,53 +61,43 @@ BVHObjectBinning::BVHObjectBinning(const BVHRange& job, BVHReference *prims)
 	num_bins = min(size_t(MAX_BINS), size_t(4.0f + 0.05f*size()));
 	scale = rcp(cent_bounds().size()) * make_float3((float)num_bins);
 
-	/* initialize binning counter and bounds */
-	BoundBox bin_bounds[MAX_BINS][4];	/* bounds for every bin in every dimension */
-	int4 bin_count[MAX_BINS];			/* number of primitives mapped to bin */
+	/* map geometry to bins, large ranges in chunks by multiple threads */
+	Bins bins;
 
-	for(size_t i = 0; i < num_bins; i++) {
-		bin_count[i] = make_int4(0);
-		bin_bounds[i][0] = bin_bounds[i][1] = bin_bounds[i][2] = BoundBox::empty;
+	if(size() < BVHParams::PARALLEL_SPLIT_SIZE) {
+		bin_primitives(prims, 0, size(), &bins);
 	}
+	else {
+		const size_t chunk_size = BVHParams::PARALLEL_CHUNK_SIZE;
+		size_t num_chunks = (size() + chunk_size - 1)/chunk_size;
+		vector<Bins> chunk_bins(num_chunks);
+		TaskPool pool;
 
-	/* map geometry to bins, unrolled once */
-	{
-		ssize_t i;
+		for(size_t c = 0; c < num_chunks; c++) {
+			size_t begin = c*chunk_size;
+			size_t end = min(begin + chunk_size, size());
 
-		for(i = 0; i < ssize_t(size()) - 1; i += 2) {
-			prefetch_L2(&prims[start() + i + 8]);
+			pool.push(function_bind(&BVHObjectBinning::bin_primitives, this, prims, begin, end, &chunk_bins[c]), true);
+		}
 
-			/* map even and odd primitive to bin */
-			BVHReference prim0 = prims[start() + i + 0];
-			BVHReference prim1 = prims[start() + i + 1];
+		pool.wait_work();
 
-			int4 bin0 = get_bin(prim0.bounds());
-			int4 bin1 = get_bin(prim1.bounds());
+		/* merge bins of all chunks */
+		bins = chunk_bins[0];
 
-			/* increase bounds for bins for even primitive */
-			int b00 = extract<0>(bin0); bin_count[b00][0]++; bin_bounds[b00][0].grow(prim0.bounds());
-			int b01 = extract<1>(bin0); bin_count[b01][1]++; bin_bounds[b01][1].grow(prim0.bounds());
-			int b02 = extract<2>(bin0); bin_count[b02][2]++; bin_bounds[b02][2].grow(prim0.bounds());
+		for(size_t c = 1; c < num_chunks; c++) {
+			for(size_t i = 0; i < num_bins; i++) {
+				bins.count[i] = bins.count[i] + chunk_bins[c].count[i];
 
-			/* increase bounds of bins for odd primitive */
-			int b10 = extract<0>(bin1); bin_count[b10][0]++; bin_bounds[b10][0].grow(prim1.bounds());
-			int b11 = extract<1>(bin1); bin_count[b11][1]++; bin_bounds[b11][1].grow(prim1.bounds());
-			int b12 = extract<2>(bin1); bin_count[b12][2]++; bin_bounds[b12][2].grow(prim1.bounds());
-		}
-
-		/* for uneven number of primitives */
-		if(i < ssize_t(size())) {
-			/* map primitive to bin */
-			BVHReference prim0 = prims[start() + i];
-			int4 bin0 = get_bin(prim0.bounds());
-
-			/* increase bounds of bins */
-			int b00 = extract<0>(bin0); bin_count[b00][0]++; bin_bounds[b00][0].grow(prim0.bounds());
-			int b01 = extract<1>(bin0); bin_count[b01][1]++; bin_bounds[b01][1].grow(prim0.bounds());
-			int b02 = extract<2>(bin0); bin_count[b02][2]++; bin_bounds[b02][2].grow(prim0.bounds());
+				for(int d = 0; d < 3; d++)
+					bins.bounds[i][d] = merge(bins.bounds[i][d], chunk_bins[c].bounds[i][d]);
+			}
 		}
 	}
 
+	BoundBox (*bin_bounds)[4] = bins.bounds;
+	int4 *bin_count = bins.count;
+
 	/* sweep from right to left and compute parallel prefix of merged bounds */
 	float4 r_area[MAX_BINS];	/* area of bounds of primitives on the right */
 	float4 r_count[MAX_BINS];	/* number of primitives on the right */
@@ -161,6 +153,56 @@ BVHObjectBinning::BVHObjectBinning(const BVHRange& job, BVHReference *prims)
 	leafSAH	= bounds().half_area() * blocks(size());
 }
 
+void BVHObjectBinning::bin_primitives(const BVHReference *prims, size_t begin, size_t end, Bins *bins) const
+{
+	/* initialize binning counter and bounds */
+	BoundBox (*bin_bounds)[4] = bins->bounds;
+	int4 *bin_count = bins->count;
+
+	for(size_t i = 0; i < num_bins; i++) {
+		bin_count[i] = make_int4(0);
+		bin_bounds[i][0] = bin_bounds[i][1] = bin_bounds[i][2] = BoundBox::empty;
+	}
+
+	/* map geometry to bins, unrolled once */
+	{
+		ssize_t i;
+
+		for(i = begin; i < ssize_t(end) - 1; i += 2) {
+			prefetch_L2(&prims[start() + i + 8]);
+
+			/* map even and odd primitive to bin */
+			BVHReference prim0 = prims[start() + i + 0];
+			BVHReference prim1 = prims[start() + i + 1];
+
+			int4 bin0 = get_bin(prim0.bounds());
+			int4 bin1 = get_bin(prim1.bounds());
+
+			/* increase bounds for bins for even primitive */
+			int b00 = extract<0>(bin0); bin_count[b00][0]++; bin_bounds[b00][0].grow(prim0.bounds());
+			int b01 = extract<1>(bin0); bin_count[b01][1]++; bin_bounds[b01][1].grow(prim0.bounds());
+			int b02 = extract<2>(bin0); bin_count[b02][2]++; bin_bounds[b02][2].grow(prim0.bounds());
+
+			/* increase bounds of bins for odd primitive */
+			int b10 = extract<0>(bin1); bin_count[b10][0]++; bin_bounds[b10][0].grow(prim1.bounds());
+			int b11 = extract<1>(bin1); bin_count[b11][1]++; bin_bounds[b11][1].grow(prim1.bounds());
+			int b12 = extract<2>(bin1); bin_count[b12][2]++; bin_bounds[b12][2].grow(prim1.bounds());
+		}
+
+		/* for uneven number of primitives */
+		if(i < ssize_t(end)) {
+			/* map primitive to bin */
+			BVHReference prim0 = prims[start() + i];
+			int4 bin0 = get_bin(prim0.bounds());
+
+			/* increase bounds of bins */
+			int b00 = extract<0>(bin0); bin_count[b00][0]++; bin_bounds[b00][0].grow(prim0.bounds());
+			int b01 = extract<1>(bin0); bin_count[b01][1]++; bin_bounds[b01][1].grow(prim0.bounds());
+			int b02 = extract<2>(bin0); bin_count[b02][2]++; bin_bounds[b02][2].grow(prim0.bounds());
+		}
+	}
+}
+
 void BVHObjectBinning::split(BVHReference* prims, BVHObjectBinning& left_o, BVHObjectBinning& right_o) const
 {
 	size_t N = size();
@@ -172,23 +214,29 @@ void BVHObjectBinning::split(BVHReference* prims, BVHObjectBinning& left_o, BVHO
 
 	ssize_t l = 0, r = N-1;
 
-	while(l <= r) {
-		prefetch_L2(&prims[start() + l + 8]);
-		prefetch_L2(&prims[start() + r - 8]);
-
-		BVHReference prim = prims[start() + l];
-		float3 center = prim.bounds().center2();
-
-		if(get_bin(center)[dim] < pos) {
-			lgeom_bounds.grow(prim.bounds());
-			lcent_bounds.grow(center);
-			l++;
-		}
-		else {
-			rgeom_bounds.grow(prim.bounds());
-			rcent_bounds.grow(center);
-			swap(prims[start()+l],prims[start()+r]);
-			r--;
+	if(N >= BVHParams::PARALLEL_SPLIT_SIZE) {
+		l = parallel_partition(prims, lgeom_bounds, rgeom_bounds, lcent_bounds, rcent_bounds);
+		r = l - 1;
+	}
+	else {
+		while(l <= r) {
+			prefetch_L2(&prims[start() + l + 8]);
+			prefetch_L2(&prims[start() + r - 8]);
+
+			BVHReference prim = prims[start() + l];
+			float3 center = prim.bounds().center2();
+
+			if(get_bin(center)[dim] < pos) {
+				lgeom_bounds.grow(prim.bounds());
+				lcent_bounds.grow(center);
+				l++;
+			}
+			else {
+				rgeom_bounds.grow(prim.bounds());
+				rcent_bounds.grow(center);
+				swap(prims[start()+l],prims[start()+r]);
+				r--;
+			}
 		}
 	}
 
@@ -220,5 +268,97 @@ void BVHObjectBinning::split(BVHReference* prims, BVHObjectBinning& left_o, BVHO
 	left_o  = BVHObjectBinning(BVHRange(lgeom_bounds, lcent_bounds, start(), N/2), prims);
 }
 
+/* Parallel Partition
+ *
+ * Chunks first count how many of their primitives go left, then copy them to
+ * their place in a temporary array, keeping their order within each side. */
+
+void BVHObjectBinning::partition_count(const BVHReference *prims, size_t begin, size_t end, Partition *part) const
+{
+	part->num_left = 0;
+	part->lgeom_bounds = BoundBox::empty;
+	part->rgeom_bounds = BoundBox::empty;
+	part->lcent_bounds = BoundBox::empty;
+	part->rcent_bounds = BoundBox::empty;
+
+	for(size_t i = begin; i < end; i++) {
+		const BVHReference& prim = prims[start() + i];
+		float3 center = prim.bounds().center2();
+
+		if(get_bin(center)[dim] < pos) {
+			part->lgeom_bounds.grow(prim.bounds());
+			part->lcent_bounds.grow(center);
+			part->num_left++;
+		}
+		else {
+			part->rgeom_bounds.grow(prim.bounds());
+			part->rcent_bounds.grow(center);
+		}
+	}
+}
+
+void BVHObjectBinning::partition_scatter(const BVHReference *prims, size_t begin, size_t end,
+	BVHReference *left, BVHReference *right) const
+{
+	for(size_t i = begin; i < end; i++) {
+		const BVHReference& prim = prims[start() + i];
+
+		if(get_bin(prim.bounds().center2())[dim] < pos)
+			*(left++) = prim;
+		else
+			*(right++) = prim;
+	}
+}
+
+size_t BVHObjectBinning::parallel_partition(BVHReference *prims, BoundBox& lgeom_bounds, BoundBox& rgeom_bounds,
+	BoundBox& lcent_bounds, BoundBox& rcent_bounds) const
+{
+	const size_t chunk_size = BVHParams::PARALLEL_CHUNK_SIZE;
+	size_t N = size();
+	size_t num_chunks = (N + chunk_size - 1)/chunk_size;
+	vector<Partition> parts(num_chunks);
+	TaskPool pool;
+
+	for(size_t c = 0; c < num_chunks; c++) {
+		size_t begin = c*chunk_size;
+		size_t end = min(begin + chunk_size, N);
+
+		pool.push(function_bind(&BVHObjectBinning::partition_count, this, prims, begin, end, &parts[c]), true);
+	}
+
+	pool.wait_work();
+
+	size_t num_left = 0;
+
+	for(size_t c = 0; c < num_chunks; c++) {
+		num_left += parts[c].num_left;
+		lgeom_bounds.grow(parts[c].lgeom_bounds);
+		rgeom_bounds.grow(parts[c].rgeom_bounds);
+		lcent_bounds.grow(parts[c].lcent_bounds);
+		rcent_bounds.grow(parts[c].rcent_bounds);
+	}
+
+	/* left side first, then right side, chunks in order */
+	vector<BVHReference> partitioned(N);
+	BVHReference *left = &partitioned[0];
+	BVHReference *right = &partitioned[0] + num_left;
+
+	for(size_t c = 0; c < num_chunks; c++) {
+		size_t begin = c*chunk_size;
+		size_t end = min(begin + chunk_size, N);
+
+		pool.push(function_bind(&BVHObjectBinning::partition_scatter, this, prims, begin, end, left, right), true);
+
+		left += parts[c].num_left;
+		right += (end - begin) - parts[c].num_left;
+	}
+
+	pool.wait_work();
+
+	std::copy(partitioned.begin(), partitioned.end(), prims + start());
+
+	return num_left;
+}
+
 CCL_NAMESPACE_END
 
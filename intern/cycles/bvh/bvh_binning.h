@@ -24,12 +24,14 @@
 
 CCL_NAMESPACE_BEGIN
 
-/* Single threaded object binner. Finds the split with the best SAH heuristic
- * by testing for each dimension multiple partitionings for regular spaced
- * partition locations. A partitioning for a partition location is computed,
- * by putting primitives whose centroid is on the left and right of the split
- * location to different sets. The SAH is evaluated by computing the number of
- * blocks occupied by the primitives in the partitions. */
+/* Object binner. Finds the split with the best SAH heuristic by testing for
+ * each dimension multiple partitionings for regular spaced partition
+ * locations. A partitioning for a partition location is computed, by putting
+ * primitives whose centroid is on the left and right of the split location to
+ * different sets. The SAH is evaluated by computing the number of blocks
+ * occupied by the primitives in the partitions.
+ *
+ * Large ranges are binned and partitioned in chunks by multiple threads. */
 
 class BVHObjectBinning : public BVHRange
 {
@@ -51,6 +53,26 @@ protected:
 	enum { MAX_BINS = 32 };
 	enum { LOG_BLOCK_SIZE = 2 };
 
+	/* bins of a chunk of primitives */
+	struct Bins {
+		BoundBox bounds[MAX_BINS][4];	/* bounds for every bin in every dimension */
+		int4 count[MAX_BINS];			/* number of primitives mapped to bin */
+	};
+
+	/* left/right partitioning of a chunk of primitives */
+	struct Partition {
+		size_t num_left;
+		BoundBox lgeom_bounds, rgeom_bounds;
+		BoundBox lcent_bounds, rcent_bounds;
+	};
+
+	void bin_primitives(const BVHReference *prims, size_t begin, size_t end, Bins *bins) const;
+	void partition_count(const BVHReference *prims, size_t begin, size_t end, Partition *part) const;
+	void partition_scatter(const BVHReference *prims, size_t begin, size_t end,
+		BVHReference *left, BVHReference *right) const;
+	size_t parallel_partition(BVHReference *prims, BoundBox& lgeom_bounds, BoundBox& rgeom_bounds,
+		BoundBox& lcent_bounds, BoundBox& rcent_bounds) const;
+
 	/* computes the bin numbers for each dimension for a box. */
 	__forceinline int4 get_bin(const BoundBox& box) const
 	{
@@ -46,6 +46,26 @@ public:
 	BVHObjectBinning range;
 };
 
+/* BVH Spatial Split Build Task
+ *
+ * Spatial splits insert duplicate references while building a subtree, so
+ * each task builds from its own copy of the references of its range. */
+
+class BVHSpatialSplitBuildTask : public Task {
+public:
+	BVHSpatialSplitBuildTask(BVHBuild *build, InnerNode *node, int child, const BVHRange& range_,
+		const vector<BVHReference>& references_, int level)
+	: range(range_),
+	  references(references_.begin() + range_.start(), references_.begin() + range_.end())
+	{
+		range.set_start(0);
+		run = function_bind(&BVHBuild::thread_build_spatial_split_node, build, node, child, &range, &references, level);
+	}
+
+	BVHRange range;
+	vector<BVHReference> references;
+};
+
 /* Constructor / Destructor */
 
 BVHBuild::BVHBuild(const vector<Object*>& objects_,
@@ -188,8 +208,12 @@ BVHNode* BVHBuild::run()
 	BVHRange root;
 
 	/* add references */
+	double phase_start_time = time_dt();
+
 	add_references(root);
 
+	progress.add_phase_time("BVH add references", time_dt() - phase_start_time);
+
 	if(progress.get_cancel())
 		return NULL;
 
@@ -198,8 +222,6 @@ BVHNode* BVHBuild::run()
 		params.use_spatial_split = false;
 
 	spatial_min_overlap = root.bounds().safe_area() * params.spatial_split_alpha;
-	spatial_right_bounds.clear();
-	spatial_right_bounds.resize(max(root.size(), (int)BVHParams::NUM_SPATIAL_BINS) - 1);
 
 	/* init progress updates */
 	progress_start_time = time_dt();
@@ -207,31 +229,43 @@ BVHNode* BVHBuild::run()
 	progress_total = references.size();
 	progress_original_total = progress_total;
 
-	prim_segment.resize(references.size());
-	prim_index.resize(references.size());
-	prim_object.resize(references.size());
-
 	/* build recursively */
 	BVHNode *rootnode;
 
+	phase_start_time = time_dt();
+
 	if(params.use_spatial_split) {
-		/* singlethreaded spatial split build */
-		rootnode = build_node(root, 0);
+		/* multithreaded spatial split build, leaf nodes append their
+		 * primitives since references get duplicated */
+		BVHSpatialStorage storage;
+
+		prim_segment.reserve(references.size());
+		prim_index.reserve(references.size());
+		prim_object.reserve(references.size());
+
+		rootnode = build_node(root, &references, 0, &storage);
+		task_pool.wait_work();
 	}
 	else {
 		/* multithreaded binning build */
+		prim_segment.resize(references.size());
+		prim_index.resize(references.size());
+		prim_object.resize(references.size());
+
 		BVHObjectBinning rootbin(root, (references.size())? &references[0]: NULL);
 		rootnode = build_node(rootbin, 0);
 		task_pool.wait_work();
 	}
 
+	progress.add_phase_time("BVH build nodes", time_dt() - phase_start_time);
+
 	/* delete if we canceled */
 	if(rootnode) {
 		if(progress.get_cancel()) {
 			rootnode->deleteSubtree();
 			rootnode = NULL;
 		}
-		else if(!params.use_spatial_split) {
+		else {
 			/*rotate(rootnode, 4, 5);*/
 			rootnode->update_visibility();
 		}
@@ -277,6 +311,20 @@ void BVHBuild::thread_build_node(InnerNode *inner, int child, BVHObjectBinning *
 	}
 }
 
+void BVHBuild::thread_build_spatial_split_node(InnerNode *inner, int child, BVHRange *range,
+	vector<BVHReference> *references, int level)
+{
+	if(progress.get_cancel())
+		return;
+
+	/* build nodes */
+	BVHSpatialStorage storage;
+	BVHNode *node = build_node(*range, references, level, &storage);
+
+	/* set child in inner node */
+	inner->children[child] = node;
+}
+
 /* multithreaded binning builder */
 BVHNode* BVHBuild::build_node(const BVHObjectBinning& range, int level)
 {
@@ -289,7 +337,7 @@ BVHNode* BVHBuild::build_node(const BVHObjectBinning& range, int level)
 	if(!(range.size() > 0 && params.top_level && level == 0)) {
 		/* make leaf node when threshold reached or SAH tells us */
 		if(params.small_enough_for_leaf(size, level) || (size <= params.max_leaf_size && leafSAH < splitSAH))
-			return create_leaf_node(range);
+			return create_leaf_node(range, references);
 	}
 
 	/* perform split */
@@ -317,48 +365,59 @@ BVHNode* BVHBuild::build_node(const BVHObjectBinning& range, int level)
 	return inner;
 }
 
-/* single threaded spatial split builder */
-BVHNode* BVHBuild::build_node(const BVHRange& range, int level)
+/* multithreaded spatial split builder */
+BVHNode* BVHBuild::build_node(const BVHRange& range, vector<BVHReference> *references, int level,
+	BVHSpatialStorage *storage)
 {
-	/* progress update */
-	progress_update();
 	if(progress.get_cancel())
 		return NULL;
 
 	/* small enough or too deep => create leaf. */
 	if(!(range.size() > 0 && params.top_level && level == 0)) {
-		if(params.small_enough_for_leaf(range.size(), level)) {
-			progress_count += range.size();
-			return create_leaf_node(range);
-		}
+		if(params.small_enough_for_leaf(range.size(), level))
+			return create_leaf_node(range, *references);
 	}
 
 	/* splitting test */
-	BVHMixedSplit split(this, range, level);
+	BVHMixedSplit split(this, storage, range, references, level);
 
 	if(!(range.size() > 0 && params.top_level && level == 0)) {
-		if(split.no_split) {
-			progress_count += range.size();
-			return create_leaf_node(range);
-		}
+		if(split.no_split)
+			return create_leaf_node(range, *references);
 	}
 	
 	/* do split */
 	BVHRange left, right;
-	split.split(this, left, right, range);
+	split.split(this, left, right, range, references);
+
+	{
+		thread_scoped_lock lock(build_mutex);
+		progress_total += left.size() + right.size() - range.size();
+	}
 
-	progress_total += left.size() + right.size() - range.size();
-	size_t total = progress_total;
+	if(range.size() < THREAD_TASK_SIZE) {
+		/* local build */
+		size_t num_references = references->size();
 
-	/* leaft node */
-	BVHNode *leftnode = build_node(left, level + 1);
+		/* left node */
+		BVHNode *leftnode = build_node(left, references, level + 1, storage);
 
-	/* right node (modify start for splits) */
-	right.set_start(right.start() + progress_total - total);
-	BVHNode *rightnode = build_node(right, level + 1);
+		/* right node (modify start for splits) */
+		right.set_start(right.start() + references->size() - num_references);
+		BVHNode *rightnode = build_node(right, references, level + 1, storage);
 
-	/* inner node */
-	return new InnerNode(range.bounds(), leftnode, rightnode);
+		/* inner node */
+		return new InnerNode(range.bounds(), leftnode, rightnode);
+	}
+	else {
+		/* threaded build */
+		InnerNode *inner = new InnerNode(range.bounds());
+
+		task_pool.push(new BVHSpatialSplitBuildTask(this, inner, 0, left, *references, level + 1), true);
+		task_pool.push(new BVHSpatialSplitBuildTask(this, inner, 1, right, *references, level + 1), true);
+
+		return inner;
+	}
 }
 
 /* Create Nodes */
@@ -370,18 +429,9 @@ BVHNode *BVHBuild::create_object_leaf_nodes(const BVHReference *ref, int start,
 		return new LeafNode(bounds, 0, 0, 0);
 	}
 	else if(num == 1) {
-		if(start == prim_index.size()) {
-			assert(params.use_spatial_split);
-
-			prim_segment.push_back(ref->prim_segment());
-			prim_index.push_back(ref->prim_index());
-			prim_object.push_back(ref->prim_object());
-		}
-		else {
-			prim_segment[start] = ref->prim_segment();
-			prim_index[start] = ref->prim_index();
-			prim_object[start] = ref->prim_object();
-		}
+		prim_segment[start] = ref->prim_segment();
+		prim_index[start] = ref->prim_index();
+		prim_object[start] = ref->prim_object();
 
 		uint visibility = objects[ref->prim_object()]->visibility;
 		return new LeafNode(ref->bounds(), visibility, start, start+1);
@@ -399,7 +449,29 @@ BVHNode *BVHBuild::create_object_leaf_nodes(const BVHReference *ref, int start,
 	}
 }
 
-BVHNode* BVHBuild::create_leaf_node(const BVHRange& range)
+BVHNode* BVHBuild::create_leaf_node(const BVHRange& range, vector<BVHReference>& references)
+{
+	if(!params.use_spatial_split)
+		return create_leaf_node(range, references, range.start());
+
+	/* with spatial splits, ranges index into the references of the build task
+	 * and primitives may be duplicated, so append them to the output arrays.
+	 * the lock is held while writing since appending can reallocate them */
+	thread_scoped_lock lock(build_mutex);
+
+	int prim_start = prim_index.size();
+
+	prim_segment.resize(prim_start + range.size());
+	prim_index.resize(prim_start + range.size());
+	prim_object.resize(prim_start + range.size());
+
+	progress_count += range.size();
+	progress_update();
+
+	return create_leaf_node(range, references, prim_start);
+}
+
+BVHNode* BVHBuild::create_leaf_node(const BVHRange& range, vector<BVHReference>& references, int prim_start)
 {
 	vector<int>& p_segment = prim_segment;
 	vector<int>& p_index = prim_index;
@@ -412,18 +484,9 @@ BVHNode* BVHBuild::create_leaf_node(const BVHRange& range)
 		BVHReference& ref = references[range.start() + i];
 
 		if(ref.prim_index() != -1) {
-			if(range.start() + num == prim_index.size()) {
-				assert(params.use_spatial_split);
-
-				p_segment.push_back(ref.prim_segment());
-				p_index.push_back(ref.prim_index());
-				p_object.push_back(ref.prim_object());
-			}
-			else {
-				p_segment[range.start() + num] = ref.prim_segment();
-				p_index[range.start() + num] = ref.prim_index();
-				p_object[range.start() + num] = ref.prim_object();
-			}
+			p_segment[prim_start + num] = ref.prim_segment();
+			p_index[prim_start + num] = ref.prim_index();
+			p_object[prim_start + num] = ref.prim_object();
 
 			bounds.grow(ref.bounds());
 			visibility |= objects[ref.prim_object()]->visibility;
@@ -439,7 +502,7 @@ BVHNode* BVHBuild::create_leaf_node(const BVHRange& range)
 	BVHNode *leaf = NULL;
 	
 	if(num > 0) {
-		leaf = new LeafNode(bounds, visibility, range.start(), range.start() + num);
+		leaf = new LeafNode(bounds, visibility, prim_start, prim_start + num);
 
 		if(num == range.size())
 			return leaf;
@@ -448,7 +511,7 @@ BVHNode* BVHBuild::create_leaf_node(const BVHRange& range)
 	/* while there may be multiple triangles in a leaf, for object primitives
 	 * we want there to be the only one, so we keep splitting */
 	const BVHReference *ref = (ob_num)? &references[range.start()]: NULL;
-	BVHNode *oleaf = create_object_leaf_nodes(ref, range.start() + num, ob_num);
+	BVHNode *oleaf = create_object_leaf_nodes(ref, prim_start + num, ob_num);
 	
 	if(leaf)
 		return new InnerNode(range.bounds(), leaf, oleaf);
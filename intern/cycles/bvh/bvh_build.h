@@ -30,6 +30,7 @@
 CCL_NAMESPACE_BEGIN
 
 class BVHBuildTask;
+class BVHSpatialSplitBuildTask;
 class BVHParams;
 class InnerNode;
 class Mesh;
@@ -58,6 +59,7 @@ protected:
 	friend class BVHObjectSplit;
 	friend class BVHSpatialSplit;
 	friend class BVHBuildTask;
+	friend class BVHSpatialSplitBuildTask;
 
 	/* adding references */
 	void add_reference_mesh(BoundBox& root, BoundBox& center, Mesh *mesh, int i);
@@ -65,14 +67,18 @@ protected:
 	void add_references(BVHRange& root);
 
 	/* building */
-	BVHNode *build_node(const BVHRange& range, int level);
+	BVHNode *build_node(const BVHRange& range, vector<BVHReference> *references, int level,
+		BVHSpatialStorage *storage);
 	BVHNode *build_node(const BVHObjectBinning& range, int level);
-	BVHNode *create_leaf_node(const BVHRange& range);
+	BVHNode *create_leaf_node(const BVHRange& range, vector<BVHReference>& references);
+	BVHNode *create_leaf_node(const BVHRange& range, vector<BVHReference>& references, int prim_start);
 	BVHNode *create_object_leaf_nodes(const BVHReference *ref, int start, int num);
 
 	/* threads */
 	enum { THREAD_TASK_SIZE = 4096 };
 	void thread_build_node(InnerNode *node, int child, BVHObjectBinning *range, int level);
+	void thread_build_spatial_split_node(InnerNode *node, int child, BVHRange *range,
+		vector<BVHReference> *references, int level);
 	thread_mutex build_mutex;
 
 	/* progress */
@@ -104,8 +110,6 @@ protected:
 
 	/* spatial splitting */
 	float spatial_min_overlap;
-	vector<BoundBox> spatial_right_bounds;
-	BVHSpatialBin spatial_bins[3][BVHParams::NUM_SPATIAL_BINS];
 
 	/* threads */
 	TaskPool task_pool;
@@ -19,6 +19,7 @@
 #define __BVH_PARAMS_H__
 
 #include "util_boundbox.h"
+#include "util_vector.h"
 
 CCL_NAMESPACE_BEGIN
 
@@ -57,6 +58,13 @@ public:
 		NUM_SPATIAL_BINS = 32
 	};
 
+	/* ranges with more references than this are binned, sorted and
+	 * partitioned by multiple threads, in chunks of the given size */
+	enum {
+		PARALLEL_SPLIT_SIZE = 131072,
+		PARALLEL_CHUNK_SIZE = 16384
+	};
+
 	BVHParams()
 	{
 		use_spatial_split = true;
@@ -171,6 +179,20 @@ struct BVHSpatialBin
 	}
 };
 
+/* BVH Spatial Storage
+ *
+ * Temporary memory of the spatial split builder. Every build task has its
+ * own, so that multiple nodes can be split at the same time. */
+
+struct BVHSpatialStorage
+{
+	/* bounds of the references right of each split candidate */
+	vector<BoundBox> right_bounds;
+
+	/* bins for each dimension */
+	BVHSpatialBin bins[3][BVHParams::NUM_SPATIAL_BINS];
+};
+
 CCL_NAMESPACE_END
 
 #endif /* __BVH_PARAMS_H__ */
@@ -20,6 +20,7 @@
 
 #include "util_algorithm.h"
 #include "util_debug.h"
+#include "util_task.h"
 
 CCL_NAMESPACE_BEGIN
 
@@ -41,7 +42,7 @@ public:
 		dim = dim_;
 	}
 
-	bool operator()(const BVHReference& ra, const BVHReference& rb)
+	bool operator()(const BVHReference& ra, const BVHReference& rb) const
 	{
 		NO_EXTENDED_PRECISION float ca = ra.bounds().min[dim] + ra.bounds().max[dim];
 		NO_EXTENDED_PRECISION float cb = rb.bounds().min[dim] + rb.bounds().max[dim];
@@ -59,10 +60,78 @@ public:
 	}
 };
 
+struct BVHReferenceIndexCompare {
+public:
+	const BVHReference *data;
+	BVHReferenceCompare compare;
+
+	BVHReferenceIndexCompare(const BVHReference *data_, int dim_)
+	: data(data_), compare(dim_)
+	{
+	}
+
+	bool operator()(int a, int b) const
+	{
+		return compare(data[a], data[b]);
+	}
+};
+
+/* Parallel Sort
+ *
+ * Large arrays are sorted in chunks by multiple threads, after which pairs of
+ * neighbouring sorted runs are merged, again in parallel, until one run is
+ * left. The result is the same as a single threaded sort, except for the
+ * order of references that compare equal. */
+
+template<typename T, typename Compare>
+static void bvh_sort_run(T *begin, T *end, Compare compare)
+{
+	sort(begin, end, compare);
+}
+
+template<typename T, typename Compare>
+static void bvh_merge_runs(T *begin, T *middle, T *end, Compare compare)
+{
+	inplace_merge(begin, middle, end, compare);
+}
+
+template<typename T, typename Compare>
+static void bvh_parallel_sort(T *data, int num, Compare compare)
+{
+	const int chunk_size = BVHParams::PARALLEL_CHUNK_SIZE;
+
+	if(num < BVHParams::PARALLEL_SPLIT_SIZE) {
+		sort(data, data + num, compare);
+		return;
+	}
+
+	TaskPool pool;
+
+	for(int start = 0; start < num; start += chunk_size)
+		pool.push(function_bind(&bvh_sort_run<T, Compare>,
+			data + start, data + min(start + chunk_size, num), compare), true);
+
+	pool.wait_work();
+
+	for(int run_size = chunk_size; run_size < num; run_size *= 2) {
+		for(int start = 0; start + run_size < num; start += 2*run_size)
+			pool.push(function_bind(&bvh_merge_runs<T, Compare>,
+				data + start, data + start + run_size, data + min(start + 2*run_size, num), compare), true);
+
+		pool.wait_work();
+	}
+}
+
 void bvh_reference_sort(int start, int end, BVHReference *data, int dim)
 {
 	BVHReferenceCompare compare(dim);
-	sort(data+start, data+end, compare);
+	bvh_parallel_sort(data + start, end - start, compare);
+}
+
+void bvh_reference_sort_indices(int *indices, int num, const BVHReference *data, int dim)
+{
+	BVHReferenceIndexCompare compare(data, dim);
+	bvh_parallel_sort(indices, num, compare);
 }
 
 CCL_NAMESPACE_END
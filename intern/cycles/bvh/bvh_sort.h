@@ -21,6 +21,7 @@
 CCL_NAMESPACE_BEGIN
 
 void bvh_reference_sort(int start, int end, BVHReference *data, int dim);
+void bvh_reference_sort_indices(int *indices, int num, const BVHReference *data, int dim);
 
 CCL_NAMESPACE_END
 
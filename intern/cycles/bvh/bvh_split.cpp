@@ -23,27 +23,37 @@
 #include "object.h"
 
 #include "util_algorithm.h"
+#include "util_task.h"
 
 CCL_NAMESPACE_BEGIN
 
 /* Object Split */
 
-BVHObjectSplit::BVHObjectSplit(BVHBuild *builder, const BVHRange& range, float nodeSAH)
+BVHObjectSplit::BVHObjectSplit(BVHBuild *builder, BVHSpatialStorage *storage, const BVHRange& range,
+	vector<BVHReference> *references, float nodeSAH)
 : sah(FLT_MAX), dim(0), num_left(0), left_bounds(BoundBox::empty), right_bounds(BoundBox::empty)
 {
-	const BVHReference *ref_ptr = &builder->references[range.start()];
+	if(range.size() >= BVHParams::PARALLEL_SPLIT_SIZE) {
+		find_split_parallel(builder, range, references, nodeSAH);
+		return;
+	}
+
+	const BVHReference *ref_ptr = &(*references)[range.start()];
 	float min_sah = FLT_MAX;
 
+	if(storage->right_bounds.size() < (size_t)range.size())
+		storage->right_bounds.resize(range.size());
+
 	for(int dim = 0; dim < 3; dim++) {
 		/* sort references */
-		bvh_reference_sort(range.start(), range.end(), &builder->references[0], dim);
+		bvh_reference_sort(range.start(), range.end(), &(*references)[0], dim);
 
 		/* sweep right to left and determine bounds. */
 		BoundBox right_bounds = BoundBox::empty;
 
 		for(int i = range.size() - 1; i > 0; i--) {
 			right_bounds.grow(ref_ptr[i].bounds());
-			builder->spatial_right_bounds[i - 1] = right_bounds;
+			storage->right_bounds[i - 1] = right_bounds;
 		}
 
 		/* sweep left to right and select lowest SAH. */
@@ -51,7 +61,7 @@ BVHObjectSplit::BVHObjectSplit(BVHBuild *builder, const BVHRange& range, float n
 
 		for(int i = 1; i < range.size(); i++) {
 			left_bounds.grow(ref_ptr[i - 1].bounds());
-			right_bounds = builder->spatial_right_bounds[i - 1];
+			right_bounds = storage->right_bounds[i - 1];
 
 			float sah = nodeSAH +
 				left_bounds.safe_area() * builder->params.triangle_cost(i) +
@@ -70,10 +80,96 @@ BVHObjectSplit::BVHObjectSplit(BVHBuild *builder, const BVHRange& range, float n
 	}
 }
 
-void BVHObjectSplit::split(BVHBuild *builder, BVHRange& left, BVHRange& right, const BVHRange& range)
+/* For large ranges the three dimensions are searched by separate threads. To
+ * avoid copying the references for each dimension, they sort indices into the
+ * references, and only store the area of the bounds right of every split
+ * candidate. The chosen split is the same as the single threaded search. */
+
+struct BVHObjectSplitCandidate {
+	float sah;
+	int num_left;
+	BoundBox left_bounds;
+	BoundBox right_bounds;
+};
+
+static void bvh_object_split_dimension(const BVHParams *params, const BVHReference *refs, int num, int dim,
+	float nodeSAH, BVHObjectSplitCandidate *candidate)
+{
+	vector<int> indices(num);
+	vector<float> right_area(num);
+
+	for(int i = 0; i < num; i++)
+		indices[i] = i;
+
+	/* sort references */
+	bvh_reference_sort_indices(&indices[0], num, refs, dim);
+
+	/* sweep right to left and determine areas. */
+	BoundBox right_bounds = BoundBox::empty;
+
+	for(int i = num - 1; i > 0; i--) {
+		right_bounds.grow(refs[indices[i]].bounds());
+		right_area[i - 1] = right_bounds.safe_area();
+	}
+
+	/* sweep left to right and select lowest SAH. */
+	BoundBox left_bounds = BoundBox::empty;
+
+	candidate->sah = FLT_MAX;
+	candidate->num_left = 0;
+	candidate->left_bounds = BoundBox::empty;
+	candidate->right_bounds = BoundBox::empty;
+
+	for(int i = 1; i < num; i++) {
+		left_bounds.grow(refs[indices[i - 1]].bounds());
+
+		float sah = nodeSAH +
+			left_bounds.safe_area() * params->triangle_cost(i) +
+			right_area[i - 1] * params->triangle_cost(num - i);
+
+		if(sah < candidate->sah) {
+			candidate->sah = sah;
+			candidate->num_left = i;
+			candidate->left_bounds = left_bounds;
+		}
+	}
+
+	/* bounds right of the best split */
+	if(candidate->num_left > 0)
+		for(int i = candidate->num_left; i < num; i++)
+			candidate->right_bounds.grow(refs[indices[i]].bounds());
+}
+
+void BVHObjectSplit::find_split_parallel(BVHBuild *builder, const BVHRange& range,
+	vector<BVHReference> *references, float nodeSAH)
+{
+	const BVHReference *refs = &(*references)[range.start()];
+	BVHObjectSplitCandidate candidates[3];
+	TaskPool pool;
+
+	for(int dim = 0; dim < 3; dim++)
+		pool.push(function_bind(&bvh_object_split_dimension, &builder->params, refs, range.size(),
+			dim, nodeSAH, &candidates[dim]), true);
+
+	pool.wait_work();
+
+	/* select lowest SAH, in the same order as the single threaded search */
+	for(int dim = 0; dim < 3; dim++) {
+		if(candidates[dim].sah < this->sah) {
+			this->sah = candidates[dim].sah;
+			this->dim = dim;
+			this->num_left = candidates[dim].num_left;
+			this->left_bounds = candidates[dim].left_bounds;
+			this->right_bounds = candidates[dim].right_bounds;
+		}
+	}
+}
+
+void BVHObjectSplit::split(BVHBuild *builder, BVHRange& left, BVHRange& right, const BVHRange& range,
+	vector<BVHReference> *references)
 {
 	/* sort references according to split */
-	bvh_reference_sort(range.start(), range.end(), &builder->references[0], this->dim);
+	bvh_reference_sort(range.start(), range.end(), &(*references)[0], this->dim);
 
 	/* split node ranges */
 	left = BVHRange(this->left_bounds, range.start(), this->num_left);
@@ -83,60 +179,61 @@ void BVHObjectSplit::split(BVHBuild *builder, BVHRange& left, BVHRange& right, c
 
 /* Spatial Split */
 
-BVHSpatialSplit::BVHSpatialSplit(BVHBuild *builder, const BVHRange& range, float nodeSAH)
+BVHSpatialSplit::BVHSpatialSplit(BVHBuild *builder, BVHSpatialStorage *storage, const BVHRange& range,
+	vector<BVHReference> *references, float nodeSAH)
 : sah(FLT_MAX), dim(0), pos(0.0f)
 {
-	/* initialize bins. */
 	float3 origin = range.bounds().min;
 	float3 binSize = (range.bounds().max - origin) * (1.0f / (float)BVHParams::NUM_SPATIAL_BINS);
-	float3 invBinSize = 1.0f / binSize;
+	const BVHReference *refs = &(*references)[0];
 
-	for(int dim = 0; dim < 3; dim++) {
-		for(int i = 0; i < BVHParams::NUM_SPATIAL_BINS; i++) {
-			BVHSpatialBin& bin = builder->spatial_bins[dim][i];
-
-			bin.bounds = BoundBox::empty;
-			bin.enter = 0;
-			bin.exit = 0;
-		}
+	/* chop references into bins, large ranges in chunks by multiple threads,
+	 * the merged bins are the same as when binning in a single thread. */
+	if(range.size() < BVHParams::PARALLEL_SPLIT_SIZE) {
+		bin_references(builder, refs, range.start(), range.end(), origin, binSize, storage);
 	}
+	else {
+		const int chunk_size = BVHParams::PARALLEL_CHUNK_SIZE;
+		int num_chunks = (range.size() + chunk_size - 1)/chunk_size;
+		vector<BVHSpatialStorage> chunks(num_chunks);
+		TaskPool pool;
 
-	/* chop references into bins. */
-	for(unsigned int refIdx = range.start(); refIdx < range.end(); refIdx++) {
-		const BVHReference& ref = builder->references[refIdx];
-		float3 firstBinf = (ref.bounds().min - origin) * invBinSize;
-		float3 lastBinf = (ref.bounds().max - origin) * invBinSize;
-		int3 firstBin = make_int3((int)firstBinf.x, (int)firstBinf.y, (int)firstBinf.z);
-		int3 lastBin = make_int3((int)lastBinf.x, (int)lastBinf.y, (int)lastBinf.z);
+		for(int c = 0; c < num_chunks; c++) {
+			int start = range.start() + c*chunk_size;
+			int end = min(start + chunk_size, range.end());
 
-		firstBin = clamp(firstBin, 0, BVHParams::NUM_SPATIAL_BINS - 1);
-		lastBin = clamp(lastBin, firstBin, BVHParams::NUM_SPATIAL_BINS - 1);
+			pool.push(function_bind(&BVHSpatialSplit::bin_references, this, builder, refs,
+				start, end, origin, binSize, &chunks[c]), true);
+		}
+
+		pool.wait_work();
 
 		for(int dim = 0; dim < 3; dim++) {
-			BVHReference currRef = ref;
+			for(int i = 0; i < BVHParams::NUM_SPATIAL_BINS; i++) {
+				BVHSpatialBin& bin = storage->bins[dim][i];
 
-			for(int i = firstBin[dim]; i < lastBin[dim]; i++) {
-				BVHReference leftRef, rightRef;
+				bin = chunks[0].bins[dim][i];
 
-				split_reference(builder, leftRef, rightRef, currRef, dim, origin[dim] + binSize[dim] * (float)(i + 1));
-				builder->spatial_bins[dim][i].bounds.grow(leftRef.bounds());
-				currRef = rightRef;
+				for(int c = 1; c < num_chunks; c++) {
+					bin.bounds.grow(chunks[c].bins[dim][i].bounds);
+					bin.enter += chunks[c].bins[dim][i].enter;
+					bin.exit += chunks[c].bins[dim][i].exit;
+				}
 			}
-
-			builder->spatial_bins[dim][lastBin[dim]].bounds.grow(currRef.bounds());
-			builder->spatial_bins[dim][firstBin[dim]].enter++;
-			builder->spatial_bins[dim][lastBin[dim]].exit++;
 		}
 	}
 
+	if(storage->right_bounds.size() < BVHParams::NUM_SPATIAL_BINS)
+		storage->right_bounds.resize(BVHParams::NUM_SPATIAL_BINS);
+
 	/* select best split plane. */
 	for(int dim = 0; dim < 3; dim++) {
 		/* sweep right to left and determine bounds. */
 		BoundBox right_bounds = BoundBox::empty;
 
 		for(int i = BVHParams::NUM_SPATIAL_BINS - 1; i > 0; i--) {
-			right_bounds.grow(builder->spatial_bins[dim][i].bounds);
-			builder->spatial_right_bounds[i - 1] = right_bounds;
+			right_bounds.grow(storage->bins[dim][i].bounds);
+			storage->right_bounds[i - 1] = right_bounds;
 		}
 
 		/* sweep left to right and select lowest SAH. */
@@ -145,13 +242,13 @@ BVHSpatialSplit::BVHSpatialSplit(BVHBuild *builder, const BVHRange& range, float
 		int rightNum = range.size();
 
 		for(int i = 1; i < BVHParams::NUM_SPATIAL_BINS; i++) {
-			left_bounds.grow(builder->spatial_bins[dim][i - 1].bounds);
-			leftNum += builder->spatial_bins[dim][i - 1].enter;
-			rightNum -= builder->spatial_bins[dim][i - 1].exit;
+			left_bounds.grow(storage->bins[dim][i - 1].bounds);
+			leftNum += storage->bins[dim][i - 1].enter;
+			rightNum -= storage->bins[dim][i - 1].exit;
 
 			float sah = nodeSAH +
 				left_bounds.safe_area() * builder->params.triangle_cost(leftNum) +
-				builder->spatial_right_bounds[i - 1].safe_area() * builder->params.triangle_cost(rightNum);
+				storage->right_bounds[i - 1].safe_area() * builder->params.triangle_cost(rightNum);
 
 			if(sah < this->sah) {
 				this->sah = sah;
@@ -162,7 +259,53 @@ BVHSpatialSplit::BVHSpatialSplit(BVHBuild *builder, const BVHRange& range, float
 	}
 }
 
-void BVHSpatialSplit::split(BVHBuild *builder, BVHRange& left, BVHRange& right, const BVHRange& range)
+void BVHSpatialSplit::bin_references(BVHBuild *builder, const BVHReference *refs, int start, int end,
+	float3 origin, float3 binSize, BVHSpatialStorage *storage)
+{
+	/* initialize bins. */
+	float3 invBinSize = 1.0f / binSize;
+
+	for(int dim = 0; dim < 3; dim++) {
+		for(int i = 0; i < BVHParams::NUM_SPATIAL_BINS; i++) {
+			BVHSpatialBin& bin = storage->bins[dim][i];
+
+			bin.bounds = BoundBox::empty;
+			bin.enter = 0;
+			bin.exit = 0;
+		}
+	}
+
+	/* chop references into bins. */
+	for(int refIdx = start; refIdx < end; refIdx++) {
+		const BVHReference& ref = refs[refIdx];
+		float3 firstBinf = (ref.bounds().min - origin) * invBinSize;
+		float3 lastBinf = (ref.bounds().max - origin) * invBinSize;
+		int3 firstBin = make_int3((int)firstBinf.x, (int)firstBinf.y, (int)firstBinf.z);
+		int3 lastBin = make_int3((int)lastBinf.x, (int)lastBinf.y, (int)lastBinf.z);
+
+		firstBin = clamp(firstBin, 0, BVHParams::NUM_SPATIAL_BINS - 1);
+		lastBin = clamp(lastBin, firstBin, BVHParams::NUM_SPATIAL_BINS - 1);
+
+		for(int dim = 0; dim < 3; dim++) {
+			BVHReference currRef = ref;
+
+			for(int i = firstBin[dim]; i < lastBin[dim]; i++) {
+				BVHReference leftRef, rightRef;
+
+				split_reference(builder, leftRef, rightRef, currRef, dim, origin[dim] + binSize[dim] * (float)(i + 1));
+				storage->bins[dim][i].bounds.grow(leftRef.bounds());
+				currRef = rightRef;
+			}
+
+			storage->bins[dim][lastBin[dim]].bounds.grow(currRef.bounds());
+			storage->bins[dim][firstBin[dim]].enter++;
+			storage->bins[dim][lastBin[dim]].exit++;
+		}
+	}
+}
+
+void BVHSpatialSplit::split(BVHBuild *builder, BVHRange& left, BVHRange& right, const BVHRange& range,
+	vector<BVHReference> *references)
 {
 	/* Categorize references and compute bounds.
 	 *
@@ -170,7 +313,7 @@ void BVHSpatialSplit::split(BVHBuild *builder, BVHRange& left, BVHRange& right,
 	 * Uncategorized/split:		[left_end, right_start[
 	 * Right-hand side:			[right_start, refs.size()[ */
 
-	vector<BVHReference>& refs = builder->references;
+	vector<BVHReference>& refs = *references;
 	int left_start = range.start();
 	int left_end = left_start;
 	int right_start = range.end();
@@ -37,9 +37,15 @@ public:
 	BoundBox right_bounds;
 
 	BVHObjectSplit() {}
-	BVHObjectSplit(BVHBuild *builder, const BVHRange& range, float nodeSAH);
+	BVHObjectSplit(BVHBuild *builder, BVHSpatialStorage *storage, const BVHRange& range,
+		vector<BVHReference> *references, float nodeSAH);
 
-	void split(BVHBuild *builder, BVHRange& left, BVHRange& right, const BVHRange& range);
+	void split(BVHBuild *builder, BVHRange& left, BVHRange& right, const BVHRange& range,
+		vector<BVHReference> *references);
+
+protected:
+	void find_split_parallel(BVHBuild *builder, const BVHRange& range,
+		vector<BVHReference> *references, float nodeSAH);
 };
 
 /* Spatial Split */
@@ -52,10 +58,16 @@ public:
 	float pos;
 
 	BVHSpatialSplit() : sah(FLT_MAX), dim(0), pos(0.0f) {}
-	BVHSpatialSplit(BVHBuild *builder, const BVHRange& range, float nodeSAH);
+	BVHSpatialSplit(BVHBuild *builder, BVHSpatialStorage *storage, const BVHRange& range,
+		vector<BVHReference> *references, float nodeSAH);
 
-	void split(BVHBuild *builder, BVHRange& left, BVHRange& right, const BVHRange& range);
+	void split(BVHBuild *builder, BVHRange& left, BVHRange& right, const BVHRange& range,
+		vector<BVHReference> *references);
 	void split_reference(BVHBuild *builder, BVHReference& left, BVHReference& right, const BVHReference& ref, int dim, float pos);
+
+protected:
+	void bin_references(BVHBuild *builder, const BVHReference *refs, int start, int end,
+		float3 origin, float3 binSize, BVHSpatialStorage *storage);
 };
 
 /* Mixed Object-Spatial Split */
@@ -72,7 +84,8 @@ public:
 
 	bool no_split;
 
-	__forceinline BVHMixedSplit(BVHBuild *builder, const BVHRange& range, int level)
+	__forceinline BVHMixedSplit(BVHBuild *builder, BVHSpatialStorage *storage, const BVHRange& range,
+		vector<BVHReference> *references, int level)
 	{
 		/* find split candidates. */
 		float area = range.bounds().safe_area();
@@ -80,14 +93,14 @@ public:
 		leafSAH = area * builder->params.triangle_cost(range.size());
 		nodeSAH = area * builder->params.node_cost(2);
 
-		object = BVHObjectSplit(builder, range, nodeSAH);
+		object = BVHObjectSplit(builder, storage, range, references, nodeSAH);
 
 		if(builder->params.use_spatial_split && level < BVHParams::MAX_SPATIAL_DEPTH) {
 			BoundBox overlap = object.left_bounds;
 			overlap.intersect(object.right_bounds);
 
 			if(overlap.safe_area() >= builder->spatial_min_overlap)
-				spatial = BVHSpatialSplit(builder, range, nodeSAH);
+				spatial = BVHSpatialSplit(builder, storage, range, references, nodeSAH);
 		}
 
 		/* leaf SAH is the lowest => create leaf. */
@@ -95,12 +108,13 @@ public:
 		no_split = (minSAH == leafSAH && range.size() <= builder->params.max_leaf_size);
 	}
 
-	__forceinline void split(BVHBuild *builder, BVHRange& left, BVHRange& right, const BVHRange& range)
+	__forceinline void split(BVHBuild *builder, BVHRange& left, BVHRange& right, const BVHRange& range,
+		vector<BVHReference> *references)
 	{
 		if(builder->params.use_spatial_split && minSAH == spatial.sah)
-			spatial.split(builder, left, right, range);
+			spatial.split(builder, left, right, range, references);
 		if(!left.size() || !right.size())
-			object.split(builder, left, right, range);
+			object.split(builder, left, right, range, references);
 	}
 };
 
@@ -111,6 +111,9 @@ public:
 	/* open shading language, only for CPU device */
 	virtual void *osl_memory() { return NULL; }
 
+	/* on demand image texture loading, only for CPU device */
+	virtual void *image_cache_memory() { return NULL; }
+
 	/* load/compile kernels, must be called before adding tasks */ 
 	virtual bool load_kernels(bool experimental) { return true; }
 
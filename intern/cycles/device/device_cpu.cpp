@@ -40,11 +40,89 @@
 
 CCL_NAMESPACE_BEGIN
 
+/* CPU Kernel Variants
+ *
+ * The same kernel is compiled for several instruction sets, the best one the
+ * CPU supports is picked once when the device is created. For debugging and
+ * benchmarking, the CYCLES_CPU_KERNEL environment variable can be set to one
+ * of the names below to use a less optimized kernel. */
+
+typedef void (*CPUPathTraceFunction)(KernelGlobals *kg, float *buffer, unsigned int *rng_state,
+	int sample, int x, int y, int offset, int stride);
+typedef void (*CPUPathTraceStreamFunction)(KernelGlobals *kg, KernelPathStream *stream, float *buffer,
+	unsigned int *rng_state, int sample, int x, int y, int w, int h, int offset, int stride);
+typedef void (*CPUFilmConvertFunction)(KernelGlobals *kg, uchar4 *rgba, float *buffer,
+	float sample_scale, int x, int y, int offset, int stride);
+typedef void (*CPUShaderFunction)(KernelGlobals *kg, uint4 *input, float4 *output,
+	int type, int i);
+
+struct CPUKernelFunctions {
+	const char *name;
+	bool (*supported)();
+	CPUPathTraceFunction path_trace;
+	CPUPathTraceStreamFunction path_trace_stream;
+	CPUFilmConvertFunction convert_to_byte;
+	CPUFilmConvertFunction convert_to_half_float;
+	CPUShaderFunction shader;
+};
+
+static bool cpu_kernel_always_supported()
+{
+	return true;
+}
+
+#define CPU_KERNEL_FUNCTIONS(name, supported, prefix) \
+	{name, supported, prefix##_path_trace, prefix##_path_trace_stream, \
+	 prefix##_convert_to_byte, prefix##_convert_to_half_float, prefix##_shader}
+
+/* most optimized first */
+static const CPUKernelFunctions cpu_kernel_functions[] = {
+#ifdef WITH_CYCLES_OPTIMIZED_KERNEL_AVX2
+	CPU_KERNEL_FUNCTIONS("avx2", system_cpu_support_avx2, kernel_cpu_avx2),
+#endif
+#ifdef WITH_CYCLES_OPTIMIZED_KERNEL_AVX
+	CPU_KERNEL_FUNCTIONS("avx", system_cpu_support_avx, kernel_cpu_avx),
+#endif
+#ifdef WITH_OPTIMIZED_KERNEL
+	CPU_KERNEL_FUNCTIONS("sse3", system_cpu_support_sse3, kernel_cpu_sse3),
+	CPU_KERNEL_FUNCTIONS("sse2", system_cpu_support_sse2, kernel_cpu_sse2),
+#endif
+	CPU_KERNEL_FUNCTIONS("none", cpu_kernel_always_supported, kernel_cpu),
+};
+
+#undef CPU_KERNEL_FUNCTIONS
+
+static const CPUKernelFunctions *cpu_kernel_functions_get()
+{
+	const int tot = sizeof(cpu_kernel_functions)/sizeof(cpu_kernel_functions[0]);
+	const char *force = getenv("CYCLES_CPU_KERNEL");
+	int start = 0;
+
+	/* skip variants better than the requested one, unknown names are ignored */
+	if(force) {
+		for(int i = 0; i < tot; i++)
+			if(strcmp(cpu_kernel_functions[i].name, force) == 0)
+				start = i;
+	}
+
+	for(int i = start; i < tot; i++)
+		if(cpu_kernel_functions[i].supported())
+			return &cpu_kernel_functions[i];
+
+	return &cpu_kernel_functions[tot - 1];
+}
+
+/* number of paths the wavefront integrator advances together, larger streams
+ * give more coherence but don't fit in the CPU cache anymore */
+#define CPU_PATH_STREAM_SIZE 4096
+
 class CPUDevice : public Device
 {
 public:
 	TaskPool task_pool;
 	KernelGlobals kernel_globals;
+	KernelImageCache *image_cache;
+	const CPUKernelFunctions *kernel;
 #ifdef WITH_OSL
 	OSLGlobals osl_globals;
 #endif
@@ -54,15 +132,18 @@ public:
 #ifdef WITH_OSL
 		kernel_globals.osl = &osl_globals;
 #endif
+		image_cache = kernel_image_cache_create();
+		kernel_globals.image_cache = NULL;
+		kernel_globals.image_cache_thread = NULL;
 
 		/* do now to avoid thread issues */
-		system_cpu_support_sse2();
-		system_cpu_support_sse3();
+		kernel = cpu_kernel_functions_get();
 	}
 
 	~CPUDevice()
 	{
 		task_pool.stop();
+		kernel_image_cache_free(image_cache);
 	}
 
 	void mem_alloc(device_memory& mem, MemoryType type)
@@ -123,6 +204,11 @@ public:
 #endif
 	}
 
+	void *image_cache_memory()
+	{
+		return image_cache;
+	}
+
 	void thread_run(DeviceTask *task)
 	{
 		if(task->type == DeviceTask::PATH_TRACE)
@@ -142,6 +228,31 @@ public:
 		}
 	};
 
+	/* with adaptive sampling a tile is done once none of its pixels took the
+	 * last sample, the thread can then move on to tiles that are still noisy */
+	bool tile_converged(KernelGlobals *kg, RenderTile& tile, int sample)
+	{
+		KernelData *data = &kg->__data;
+
+		if(data->integrator.adaptive_threshold == 0.0f || sample < data->integrator.adaptive_min_samples)
+			return false;
+
+		float *render_buffer = (float*)tile.buffer;
+		int pass_stride = data->film.pass_stride;
+		int pass_sample_count = data->film.pass_sample_count;
+
+		for(int y = tile.y; y < tile.y + tile.h; y++) {
+			for(int x = tile.x; x < tile.x + tile.w; x++) {
+				int index = tile.offset + x + y*tile.stride;
+
+				if(render_buffer[index*pass_stride + pass_sample_count] > (float)sample)
+					return false;
+			}
+		}
+
+		return true;
+	}
+
 	void thread_path_trace(DeviceTask& task)
 	{
 		if(task_pool.canceled()) {
@@ -155,7 +266,19 @@ public:
 		OSLShader::thread_init(&kg, &kernel_globals, &osl_globals);
 #endif
 
+		/* only use the image cache once images were added to it */
+		kg.image_cache_thread = kernel_image_cache_thread_init(image_cache);
+		kg.image_cache = (kg.image_cache_thread)? image_cache: NULL;
+
 		RenderTile tile;
+
+		/* the wavefront integrator only supports plain path tracing */
+		KernelPathStream *stream = NULL;
+
+		if(task.integrator_wavefront && !task.integrator_branched)
+			stream = kernel_path_stream_create(CPU_PATH_STREAM_SIZE);
+
+		kg.num_rays = 0;
 		
 		while(task.acquire_tile(this, tile)) {
 			float *render_buffer = (float*)tile.buffer;
@@ -163,67 +286,46 @@ public:
 			int start_sample = tile.start_sample;
 			int end_sample = tile.start_sample + tile.num_samples;
 
-#ifdef WITH_OPTIMIZED_KERNEL
-			if(system_cpu_support_sse3()) {
-				for(int sample = start_sample; sample < end_sample; sample++) {
-					if (task.get_cancel() || task_pool.canceled()) {
-						if(task.need_finish_queue == false)
-							break;
-					}
+			CPUPathTraceFunction path_trace = kernel->path_trace;
+			CPUPathTraceStreamFunction path_trace_stream = kernel->path_trace_stream;
 
-					for(int y = tile.y; y < tile.y + tile.h; y++) {
-						for(int x = tile.x; x < tile.x + tile.w; x++) {
-							kernel_cpu_sse3_path_trace(&kg, render_buffer, rng_state,
-								sample, x, y, tile.offset, tile.stride);
-						}
-					}
-
-					tile.sample = sample + 1;
-
-					task.update_progress(tile);
+			for(int sample = start_sample; sample < end_sample; sample++) {
+				if (task.get_cancel() || task_pool.canceled()) {
+					if(task.need_finish_queue == false)
+						break;
 				}
-			}
-			else if(system_cpu_support_sse2()) {
-				for(int sample = start_sample; sample < end_sample; sample++) {
-					if (task.get_cancel() || task_pool.canceled()) {
-						if(task.need_finish_queue == false)
-							break;
-					}
 
+				if(stream) {
+					path_trace_stream(&kg, stream, render_buffer, rng_state,
+						sample, tile.x, tile.y, tile.w, tile.h, tile.offset, tile.stride);
+				}
+				else {
 					for(int y = tile.y; y < tile.y + tile.h; y++) {
 						for(int x = tile.x; x < tile.x + tile.w; x++) {
-							kernel_cpu_sse2_path_trace(&kg, render_buffer, rng_state,
+							path_trace(&kg, render_buffer, rng_state,
 								sample, x, y, tile.offset, tile.stride);
 						}
 					}
-
-					tile.sample = sample + 1;
-
-					task.update_progress(tile);
 				}
-			}
-			else
-#endif
-			{
-				for(int sample = start_sample; sample < end_sample; sample++) {
-					if (task.get_cancel() || task_pool.canceled()) {
-						if(task.need_finish_queue == false)
-							break;
-					}
 
-					for(int y = tile.y; y < tile.y + tile.h; y++) {
-						for(int x = tile.x; x < tile.x + tile.w; x++) {
-							kernel_cpu_path_trace(&kg, render_buffer, rng_state,
-								sample, x, y, tile.offset, tile.stride);
-						}
-					}
+				tile.sample = sample + 1;
 
-					tile.sample = sample + 1;
+				task.update_progress(tile);
 
-					task.update_progress(tile);
+				if(tile_converged(&kg, tile, sample)) {
+					/* still count the skipped samples for progress */
+					while(tile.sample < end_sample) {
+						tile.sample++;
+						task.update_progress(tile);
+					}
+					break;
 				}
 			}
 
+			/* collect the rays of the tile, instead of locking stats every sample */
+			stats.rays_traced(kg.num_rays);
+			kg.num_rays = 0;
+
 			task.release_tile(tile);
 
 			if(task_pool.canceled()) {
@@ -232,6 +334,9 @@ public:
 			}
 		}
 
+		if(stream)
+			kernel_path_stream_free(stream);
+
 #ifdef WITH_OSL
 		OSLShader::thread_free(&kg);
 #endif
@@ -242,50 +347,20 @@ public:
 		float sample_scale = 1.0f/(task.sample + 1);
 
 		if(task.rgba_half) {
-#ifdef WITH_OPTIMIZED_KERNEL
-			if(system_cpu_support_sse3()) {
-				for(int y = task.y; y < task.y + task.h; y++)
-					for(int x = task.x; x < task.x + task.w; x++)
-						kernel_cpu_sse3_convert_to_half_float(&kernel_globals, (uchar4*)task.rgba_half, (float*)task.buffer,
-							sample_scale, x, y, task.offset, task.stride);
-			}
-			else if(system_cpu_support_sse2()) {
-				for(int y = task.y; y < task.y + task.h; y++)
-					for(int x = task.x; x < task.x + task.w; x++)
-						kernel_cpu_sse2_convert_to_half_float(&kernel_globals, (uchar4*)task.rgba_half, (float*)task.buffer,
-							sample_scale, x, y, task.offset, task.stride);
-			}
-			else
-#endif
-			{
-				for(int y = task.y; y < task.y + task.h; y++)
-					for(int x = task.x; x < task.x + task.w; x++)
-						kernel_cpu_convert_to_half_float(&kernel_globals, (uchar4*)task.rgba_half, (float*)task.buffer,
-							sample_scale, x, y, task.offset, task.stride);
-			}
+			CPUFilmConvertFunction convert_to_half_float = kernel->convert_to_half_float;
+
+			for(int y = task.y; y < task.y + task.h; y++)
+				for(int x = task.x; x < task.x + task.w; x++)
+					convert_to_half_float(&kernel_globals, (uchar4*)task.rgba_half, (float*)task.buffer,
+						sample_scale, x, y, task.offset, task.stride);
 		}
 		else {
-#ifdef WITH_OPTIMIZED_KERNEL
-			if(system_cpu_support_sse3()) {
-				for(int y = task.y; y < task.y + task.h; y++)
-					for(int x = task.x; x < task.x + task.w; x++)
-						kernel_cpu_sse3_convert_to_byte(&kernel_globals, (uchar4*)task.rgba_byte, (float*)task.buffer,
-							sample_scale, x, y, task.offset, task.stride);
-			}
-			else if(system_cpu_support_sse2()) {
-				for(int y = task.y; y < task.y + task.h; y++)
-					for(int x = task.x; x < task.x + task.w; x++)
-						kernel_cpu_sse2_convert_to_byte(&kernel_globals, (uchar4*)task.rgba_byte, (float*)task.buffer,
-							sample_scale, x, y, task.offset, task.stride);
-			}
-			else
-#endif
-			{
-				for(int y = task.y; y < task.y + task.h; y++)
-					for(int x = task.x; x < task.x + task.w; x++)
-						kernel_cpu_convert_to_byte(&kernel_globals, (uchar4*)task.rgba_byte, (float*)task.buffer,
-							sample_scale, x, y, task.offset, task.stride);
-			}
+			CPUFilmConvertFunction convert_to_byte = kernel->convert_to_byte;
+
+			for(int y = task.y; y < task.y + task.h; y++)
+				for(int x = task.x; x < task.x + task.w; x++)
+					convert_to_byte(&kernel_globals, (uchar4*)task.rgba_byte, (float*)task.buffer,
+						sample_scale, x, y, task.offset, task.stride);
 		}
 	}
 
@@ -297,32 +372,17 @@ public:
 		OSLShader::thread_init(&kg, &kernel_globals, &osl_globals);
 #endif
 
-#ifdef WITH_OPTIMIZED_KERNEL
-		if(system_cpu_support_sse3()) {
-			for(int x = task.shader_x; x < task.shader_x + task.shader_w; x++) {
-				kernel_cpu_sse3_shader(&kg, (uint4*)task.shader_input, (float4*)task.shader_output, task.shader_eval_type, x);
+		/* only use the image cache once images were added to it */
+		kg.image_cache_thread = kernel_image_cache_thread_init(image_cache);
+		kg.image_cache = (kg.image_cache_thread)? image_cache: NULL;
 
-				if(task_pool.canceled())
-					break;
-			}
-		}
-		else if(system_cpu_support_sse2()) {
-			for(int x = task.shader_x; x < task.shader_x + task.shader_w; x++) {
-				kernel_cpu_sse2_shader(&kg, (uint4*)task.shader_input, (float4*)task.shader_output, task.shader_eval_type, x);
+		CPUShaderFunction shader = kernel->shader;
 
-				if(task_pool.canceled())
-					break;
-			}
-		}
-		else
-#endif
-		{
-			for(int x = task.shader_x; x < task.shader_x + task.shader_w; x++) {
-				kernel_cpu_shader(&kg, (uint4*)task.shader_input, (float4*)task.shader_output, task.shader_eval_type, x);
+		for(int x = task.shader_x; x < task.shader_x + task.shader_w; x++) {
+			shader(&kg, (uint4*)task.shader_input, (float4*)task.shader_output, task.shader_eval_type, x);
 
-				if(task_pool.canceled())
-					break;
-			}
+			if(task_pool.canceled())
+				break;
 		}
 
 #ifdef WITH_OSL
@@ -23,6 +23,7 @@
 #include "kernel_globals.h"
 #include "kernel_film.h"
 #include "kernel_path.h"
+#include "kernel_path_stream.h"
 #include "kernel_displace.h"
 
 CCL_NAMESPACE_BEGIN
@@ -37,6 +38,17 @@ void kernel_const_copy(KernelGlobals *kg, const char *name, void *host, size_t s
 		assert(0);
 }
 
+template<typename T> static void kernel_tex_image_copy(texture_image<T> *images, int num_images, int array_index, device_ptr mem, size_t width, size_t height)
+{
+	if(array_index >= 0 && array_index < num_images) {
+		texture_image<T> *tex = &images[array_index];
+
+		tex->data = (T*)mem;
+		tex->width = width;
+		tex->height = height;
+	}
+}
+
 void kernel_tex_copy(KernelGlobals *kg, const char *name, device_ptr mem, size_t width, size_t height)
 {
 	if(0) {
@@ -50,40 +62,52 @@ void kernel_tex_copy(KernelGlobals *kg, const char *name, device_ptr mem, size_t
 #define KERNEL_IMAGE_TEX(type, ttype, tname)
 #include "kernel_textures.h"
 
-	else if(strstr(name, "__tex_image_float")) {
-		texture_image_float4 *tex = NULL;
-		int id = atoi(name + strlen("__tex_image_float_"));
-		int array_index = id;
-
-		if (array_index >= 0 && array_index < MAX_FLOAT_IMAGES) {
-			tex = &kg->texture_float_images[array_index];
-		}
-
-		if(tex) {
-			tex->data = (float4*)mem;
-			tex->width = width;
-			tex->height = height;
-		}
-	}
-	else if(strstr(name, "__tex_image")) {
-		texture_image_uchar4 *tex = NULL;
-		int id = atoi(name + strlen("__tex_image_"));
-		int array_index = id - MAX_FLOAT_IMAGES;
-
-		if (array_index >= 0 && array_index < MAX_BYTE_IMAGES) {
-			tex = &kg->texture_byte_images[array_index];
-		}
-
-		if(tex) {
-			tex->data = (uchar4*)mem;
-			tex->width = width;
-			tex->height = height;
-		}
-	}
+	else if(strstr(name, "__tex_image_half4"))
+		kernel_tex_image_copy(kg->texture_half4_images, TEX_NUM_HALF4_IMAGES,
+			atoi(name + strlen("__tex_image_half4_")) - TEX_IMAGE_HALF4_START, mem, width, height);
+	else if(strstr(name, "__tex_image_float1"))
+		kernel_tex_image_copy(kg->texture_float1_images, TEX_NUM_FLOAT1_IMAGES,
+			atoi(name + strlen("__tex_image_float1_")) - TEX_IMAGE_FLOAT1_START, mem, width, height);
+	else if(strstr(name, "__tex_image_byte1"))
+		kernel_tex_image_copy(kg->texture_byte1_images, TEX_NUM_BYTE1_IMAGES,
+			atoi(name + strlen("__tex_image_byte1_")) - TEX_IMAGE_BYTE1_START, mem, width, height);
+	else if(strstr(name, "__tex_image_half1"))
+		kernel_tex_image_copy(kg->texture_half1_images, TEX_NUM_HALF1_IMAGES,
+			atoi(name + strlen("__tex_image_half1_")) - TEX_IMAGE_HALF1_START, mem, width, height);
+	else if(strstr(name, "__tex_image_float"))
+		kernel_tex_image_copy(kg->texture_float_images, MAX_FLOAT_IMAGES,
+			atoi(name + strlen("__tex_image_float_")), mem, width, height);
+	else if(strstr(name, "__tex_image"))
+		kernel_tex_image_copy(kg->texture_byte_images, MAX_BYTE_IMAGES,
+			atoi(name + strlen("__tex_image_")) - MAX_FLOAT_IMAGES, mem, width, height);
 	else
 		assert(0);
 }
 
+/* Wavefront Path Tracing Memory */
+
+KernelPathStream *kernel_path_stream_create(int size)
+{
+	KernelPathStream *stream = new KernelPathStream;
+
+	stream->items = new PathStreamItem[size];
+	stream->active = new int[size];
+	stream->active_tmp = new int[size];
+	stream->keys = new uint[size];
+	stream->size = size;
+
+	return stream;
+}
+
+void kernel_path_stream_free(KernelPathStream *stream)
+{
+	delete [] stream->items;
+	delete [] stream->active;
+	delete [] stream->active_tmp;
+	delete [] stream->keys;
+	delete stream;
+}
+
 /* Path Tracing */
 
 void kernel_cpu_path_trace(KernelGlobals *kg, float *buffer, unsigned int *rng_state, int sample, int x, int y, int offset, int stride)
@@ -96,6 +120,11 @@ void kernel_cpu_path_trace(KernelGlobals *kg, float *buffer, unsigned int *rng_s
 		kernel_path_trace(kg, buffer, rng_state, sample, x, y, offset, stride);
 }
 
+void kernel_cpu_path_trace_stream(KernelGlobals *kg, KernelPathStream *stream, float *buffer, unsigned int *rng_state, int sample, int x, int y, int w, int h, int offset, int stride)
+{
+	kernel_path_trace_stream(kg, stream, buffer, rng_state, sample, x, y, w, h, offset, stride);
+}
+
 /* Film */
 
 void kernel_cpu_convert_to_byte(KernelGlobals *kg, uchar4 *rgba, float *buffer, float sample_scale, int x, int y, int offset, int stride)
@@ -113,9 +113,70 @@ __device_inline void bvh_instance_motion_pop(KernelGlobals *kg, int object, cons
 #endif
 
 /* Sven Woop's algorithm */
+#ifdef __KERNEL_SSE2__
+/* Woop test of all three planes at once. The rows are transposed so that one
+ * lane holds one plane, which replaces the nine scalar dot products with three
+ * multiply-adds for each of origin and direction. */
+__device_inline bool bvh_triangle_woop_sse(KernelGlobals *kg, float3 P, float3 dir,
+	int triAddr, float tmax, float *t_r, float *u_r, float *v_r)
+{
+	const ssef *tri = (const ssef*)&kg->__tri_woop.data[triAddr*TRI_NODE_SIZE];
+	const ssef zero(_mm_setzero_ps());
+	ssef px, py, pz, pw;
+
+	transpose(tri[0], tri[1], tri[2], zero, px, py, pz, pw);
+
+	/* origin dot products, first plane is subtracted instead of added */
+	const ssef PO = madd(px, ssef(P.x), madd(py, ssef(P.y), pz*ssef(P.z)));
+	const ssef O = pw + (PO ^ ssei(0x80000000, 0, 0, 0));
+	const ssef D = madd(px, ssef(dir.x), madd(py, ssef(dir.y), pz*ssef(dir.z)));
+
+	float t = O[0] / D[0];
+
+	if(!(t > 0.0f && t < tmax))
+		return false;
+
+	/* barycentrics u and v end up in lanes 1 and 2 */
+	const ssef uv = madd(ssef(t), D, O);
+	float u = uv[1];
+	float v = uv[2];
+
+	if(!(u >= 0.0f && v >= 0.0f && u + v <= 1.0f))
+		return false;
+
+	*t_r = t;
+	*u_r = u;
+	*v_r = v;
+	return true;
+}
+#endif
+
 __device_inline bool bvh_triangle_intersect(KernelGlobals *kg, Intersection *isect,
 	float3 P, float3 idir, uint visibility, int object, int triAddr)
 {
+#ifdef __KERNEL_SSE2__
+	float t, u, v;
+	float3 dir = 1.0f/idir;
+
+	if(bvh_triangle_woop_sse(kg, P, dir, triAddr, isect->t, &t, &u, &v)) {
+#ifdef __VISIBILITY_FLAG__
+		/* visibility flag test. we do it here under the assumption
+		 * that most triangles are culled by node flags */
+		if(kernel_tex_fetch(__prim_visibility, triAddr) & visibility)
+#endif
+		{
+			/* record intersection */
+			isect->prim = triAddr;
+			isect->object = object;
+			isect->u = u;
+			isect->v = v;
+			isect->t = t;
+			return true;
+		}
+	}
+
+	return false;
+#else
 	/* compute and check intersection t-value */
 	float4 v00 = kernel_tex_fetch(__tri_woop, triAddr*TRI_NODE_SIZE+0);
 	float4 v11 = kernel_tex_fetch(__tri_woop, triAddr*TRI_NODE_SIZE+1);
@@ -158,6 +219,7 @@ __device_inline bool bvh_triangle_intersect(KernelGlobals *kg, Intersection *ise
 	}
 
 	return false;
+#endif
 }
 
 #ifdef __HAIR__
@@ -692,6 +754,36 @@ __device_inline bool bvh_curve_intersect(KernelGlobals *kg, Intersection *isect,
 __device_inline void bvh_triangle_intersect_subsurface(KernelGlobals *kg, Intersection *isect_array,
 	float3 P, float3 idir, int object, int triAddr, float tmax, uint *num_hits, uint *lcg_state, int max_hits)
 {
+#ifdef __KERNEL_SSE2__
+	float t, u, v;
+	float3 dir = 1.0f/idir;
+
+	if(bvh_triangle_woop_sse(kg, P, dir, triAddr, tmax, &t, &u, &v)) {
+		(*num_hits)++;
+
+		int hit;
+
+		if(*num_hits <= (uint)max_hits) {
+			hit = *num_hits - 1;
+		}
+		else {
+			/* reservoir sampling: if we are at the maximum number of
+			 * hits, randomly replace element or skip it */
+			hit = lcg_step_uint(lcg_state) % *num_hits;
+
+			if(hit >= max_hits)
+				return;
+		}
+
+		/* record intersection */
+		Intersection *isect = &isect_array[hit];
+		isect->prim = triAddr;
+		isect->object = object;
+		isect->u = u;
+		isect->v = v;
+		isect->t = t;
+	}
+#else
 	/* compute and check intersection t-value */
 	float4 v00 = kernel_tex_fetch(__tri_woop, triAddr*TRI_NODE_SIZE+0);
 	float4 v11 = kernel_tex_fetch(__tri_woop, triAddr*TRI_NODE_SIZE+1);
@@ -719,7 +811,7 @@ __device_inline void bvh_triangle_intersect_subsurface(KernelGlobals *kg, Inters
 
 				int hit;
 
-				if(*num_hits <= max_hits) {
+				if(*num_hits <= (uint)max_hits) {
 					hit = *num_hits - 1;
 				}
 				else {
@@ -741,6 +833,7 @@ __device_inline void bvh_triangle_intersect_subsurface(KernelGlobals *kg, Inters
 			}
 		}
 	}
+#endif
 }
 #endif
 
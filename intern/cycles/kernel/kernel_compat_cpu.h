@@ -21,6 +21,7 @@
 
 #include "util_debug.h"
 #include "util_math.h"
+#include "util_simd.h"
 #include "util_types.h"
 
 CCL_NAMESPACE_BEGIN
@@ -71,6 +72,29 @@ template<typename T> struct texture_image  {
 		return make_float4(r.x*f, r.y*f, r.z*f, r.w*f);
 	}
 
+	float4 read(half4 r)
+	{
+		return make_float4(half_to_float(r.x), half_to_float(r.y), half_to_float(r.z), half_to_float(r.w));
+	}
+
+	/* single channel images are grayscale without alpha */
+	float4 read(float r)
+	{
+		return make_float4(r, r, r, 1.0f);
+	}
+
+	float4 read(uchar r)
+	{
+		float f = r*(1.0f/255.0f);
+		return make_float4(f, f, f, 1.0f);
+	}
+
+	float4 read(half r)
+	{
+		float f = half_to_float(r);
+		return make_float4(f, f, f, 1.0f);
+	}
+
 	int wrap_periodic(int x, int width)
 	{
 		x %= width;
@@ -136,6 +160,10 @@ typedef texture<uint4> texture_uint4;
 typedef texture<uchar4> texture_uchar4;
 typedef texture_image<float4> texture_image_float4;
 typedef texture_image<uchar4> texture_image_uchar4;
+typedef texture_image<half4> texture_image_half4;
+typedef texture_image<float> texture_image_float;
+typedef texture_image<uchar> texture_image_uchar;
+typedef texture_image<half> texture_image_half;
 
 /* Macros to handle different memory storage on different devices */
 
@@ -143,7 +171,7 @@ typedef texture_image<uchar4> texture_image_uchar4;
 #define kernel_tex_fetch_m128(tex, index) (kg->tex.fetch_m128(index))
 #define kernel_tex_fetch_m128i(tex, index) (kg->tex.fetch_m128i(index))
 #define kernel_tex_lookup(tex, t, offset, size) (kg->tex.lookup(t, offset, size))
-#define kernel_tex_image_interp(tex, x, y) ((tex < MAX_FLOAT_IMAGES) ? kg->texture_float_images[tex].interp(x, y) : kg->texture_byte_images[tex - MAX_FLOAT_IMAGES].interp(x, y))
+#define kernel_tex_image_interp(tex, x, y) (kernel_tex_image_interp_cpu(kg, tex, x, y))
 
 #define kernel_data (kg->__data)
 
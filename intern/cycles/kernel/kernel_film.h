@@ -32,6 +32,17 @@ __device float4 film_map(KernelGlobals *kg, float4 irradiance, float scale)
 	return result;
 }
 
+/* with adaptive sampling pixels stop at different sample counts */
+__device float film_sample_scale(KernelGlobals *kg, __global float *buffer, float sample_scale)
+{
+	if(kernel_data.film.pass_flag & PASS_SAMPLE_COUNT) {
+		float n = buffer[kernel_data.film.pass_sample_count];
+		return (n > 0.0f)? 1.0f/n: sample_scale;
+	}
+
+	return sample_scale;
+}
+
 __device uchar4 film_float_to_byte(float4 color)
 {
 	uchar4 result;
@@ -54,6 +65,7 @@ __device void kernel_film_convert_to_byte(KernelGlobals *kg,
 
 	rgba += index;
 	buffer += index*kernel_data.film.pass_stride;
+	sample_scale = film_sample_scale(kg, buffer, sample_scale);
 
 	/* map colors */
 	float4 irradiance = *((__global float4*)buffer);
@@ -70,7 +82,10 @@ __device void kernel_film_convert_to_half_float(KernelGlobals *kg,
 	/* buffer offset */
 	int index = offset + x + y*stride;
 
-	__global float4 *in = (__global float4*)(buffer + index*kernel_data.film.pass_stride);
+	buffer += index*kernel_data.film.pass_stride;
+	sample_scale = film_sample_scale(kg, buffer, sample_scale);
+
+	__global float4 *in = (__global float4*)buffer;
 	__global half *out = (__global half*)rgba + index*4;
 
 	float exposure = kernel_data.film.exposure;
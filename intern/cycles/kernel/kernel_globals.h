@@ -16,6 +16,10 @@
 
 /* Constant Globals */
 
+#ifdef __KERNEL_CPU__
+#include "kernel_image_cache.h"
+#endif
+
 CCL_NAMESPACE_BEGIN
 
 /* On the CPU, we pass along the struct KernelGlobals to nearly everywhere in
@@ -37,6 +41,10 @@ struct OSLShadingSystem;
 typedef struct KernelGlobals {
 	texture_image_uchar4 texture_byte_images[MAX_BYTE_IMAGES];
 	texture_image_float4 texture_float_images[MAX_FLOAT_IMAGES];
+	texture_image_half4 texture_half4_images[TEX_NUM_HALF4_IMAGES];
+	texture_image_float texture_float1_images[TEX_NUM_FLOAT1_IMAGES];
+	texture_image_uchar texture_byte1_images[TEX_NUM_BYTE1_IMAGES];
+	texture_image_half texture_half1_images[TEX_NUM_HALF1_IMAGES];
 
 #define KERNEL_TEX(type, ttype, name) ttype name;
 #define KERNEL_IMAGE_TEX(type, ttype, name)
@@ -52,8 +60,32 @@ typedef struct KernelGlobals {
 	OSLThreadData *osl_tdata;
 #endif
 
+	/* image textures looked up on demand, NULL if all images are in memory */
+	KernelImageCache *image_cache;
+	KernelImageCacheThread *image_cache_thread;
+
+	/* number of camera and bounce rays traced by this thread, for statistics.
+	 * added once per path, shadow and subsurface rays are not counted */
+	uint64_t num_rays;
 } KernelGlobals;
 
+/* image slots are grouped by storage type */
+__device_inline float4 kernel_tex_image_interp_cpu(KernelGlobals *kg, int tex, float x, float y)
+{
+	if(tex < MAX_FLOAT_IMAGES)
+		return kg->texture_float_images[tex].interp(x, y);
+	else if(tex < TEX_IMAGE_HALF4_START)
+		return kg->texture_byte_images[tex - MAX_FLOAT_IMAGES].interp(x, y);
+	else if(tex < TEX_IMAGE_FLOAT1_START)
+		return kg->texture_half4_images[tex - TEX_IMAGE_HALF4_START].interp(x, y);
+	else if(tex < TEX_IMAGE_BYTE1_START)
+		return kg->texture_float1_images[tex - TEX_IMAGE_FLOAT1_START].interp(x, y);
+	else if(tex < TEX_IMAGE_HALF1_START)
+		return kg->texture_byte1_images[tex - TEX_IMAGE_BYTE1_START].interp(x, y);
+	else
+		return kg->texture_half1_images[tex - TEX_IMAGE_HALF1_START].interp(x, y);
+}
+
 #endif
 
 /* For CUDA, constant memory textures must be globals, so we can't put them
@@ -0,0 +1,163 @@
+/*
+ * Copyright 2011-2013 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+#include <OpenImageIO/texture.h>
+
+#include "kernel_image_cache.h"
+
+#include "util_string.h"
+#include "util_thread.h"
+#include "util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+OIIO_NAMESPACE_USING
+
+struct KernelImageCache {
+	TextureSystem *ts;
+	int max_memory_mb;
+
+	/* texture handle per image slot, NULL for images loaded in memory */
+	vector<TextureSystem::TextureHandle*> handles;
+	vector<string> filenames;
+
+	thread_mutex mutex;
+};
+
+KernelImageCache *kernel_image_cache_create()
+{
+	KernelImageCache *cache = new KernelImageCache();
+
+	cache->ts = NULL;
+	cache->max_memory_mb = 1024;
+
+	return cache;
+}
+
+void kernel_image_cache_free(KernelImageCache *cache)
+{
+	if(cache->ts)
+		TextureSystem::destroy(cache->ts);
+
+	delete cache;
+}
+
+void kernel_image_cache_set_max_memory(KernelImageCache *cache, int max_memory_mb)
+{
+	thread_scoped_lock lock(cache->mutex);
+
+	cache->max_memory_mb = max_memory_mb;
+
+	if(cache->ts)
+		cache->ts->attribute("max_memory_MB", (float)max_memory_mb);
+}
+
+bool kernel_image_cache_add_image(KernelImageCache *cache, int slot, const char *filename)
+{
+	thread_scoped_lock lock(cache->mutex);
+
+	if(!cache->ts) {
+		/* not shared with OSL or other renders, so the memory limit and
+		 * invalidation only affect this device */
+		cache->ts = TextureSystem::create(false);
+
+		cache->ts->attribute("automip", 1);
+		cache->ts->attribute("autotile", 64);
+		cache->ts->attribute("gray_to_rgb", 1);
+		cache->ts->attribute("max_memory_MB", (float)cache->max_memory_mb);
+	}
+
+	if(slot >= cache->handles.size()) {
+		cache->handles.resize(slot + 1, NULL);
+		cache->filenames.resize(slot + 1);
+	}
+
+	/* image may have changed on disk for animations or reloads */
+	if(cache->filenames[slot] != "")
+		cache->ts->invalidate(ustring(cache->filenames[slot]));
+
+	cache->handles[slot] = NULL;
+	cache->filenames[slot] = "";
+
+	ustring ufilename(filename);
+	int exists = 0;
+
+	cache->ts->invalidate(ufilename);
+
+	/* missing files are loaded in memory as usual, to show the missing image color */
+	if(!cache->ts->get_texture_info(ufilename, 0, ustring("exists"), TypeDesc::TypeInt, &exists) || !exists)
+		return false;
+
+	cache->handles[slot] = cache->ts->get_texture_handle(ufilename);
+	cache->filenames[slot] = filename;
+
+	return (cache->handles[slot] != NULL);
+}
+
+void kernel_image_cache_remove_image(KernelImageCache *cache, int slot)
+{
+	thread_scoped_lock lock(cache->mutex);
+
+	if(slot >= cache->handles.size() || !cache->handles[slot])
+		return;
+
+	cache->ts->invalidate(ustring(cache->filenames[slot]));
+
+	cache->handles[slot] = NULL;
+	cache->filenames[slot] = "";
+}
+
+KernelImageCacheThread *kernel_image_cache_thread_init(KernelImageCache *cache)
+{
+	thread_scoped_lock lock(cache->mutex);
+
+	if(!cache->ts)
+		return NULL;
+
+	return (KernelImageCacheThread*)cache->ts->get_perthread_info();
+}
+
+bool kernel_image_cache_lookup(KernelImageCache *cache, KernelImageCacheThread *thread,
+	int slot, float x, float y, float2 dx, float2 dy, float4 *result)
+{
+	/* handles only change in between renders, no locking needed */
+	if(slot < 0 || slot >= cache->handles.size() || !cache->handles[slot])
+		return false;
+
+	TextureOpt options;
+
+	/* same filtering and wrapping as images loaded in memory */
+	options.nchannels = 4;
+	options.fill = 1.0f;
+	options.interpmode = TextureOpt::InterpBilinear;
+	options.swrap = TextureOpt::WrapPeriodic;
+	options.twrap = TextureOpt::WrapPeriodic;
+
+	/* images in memory are stored bottom to top, texture lookups go from top to bottom */
+	float rgba[4];
+	bool status = cache->ts->texture(cache->handles[slot], (TextureSystem::Perthread*)thread,
+		options, x, 1.0f - y, dx.x, -dx.y, dy.x, -dy.y, rgba);
+
+	if(status)
+		*result = make_float4(rgba[0], rgba[1], rgba[2], rgba[3]);
+	else
+		*result = make_float4(1.0f, 0.0f, 1.0f, 1.0f);
+
+	return true;
+}
+
+CCL_NAMESPACE_END
+
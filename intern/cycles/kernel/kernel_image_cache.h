@@ -0,0 +1,54 @@
+/*
+ * Copyright 2011-2013 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+#ifndef __KERNEL_IMAGE_CACHE_H__
+#define __KERNEL_IMAGE_CACHE_H__
+
+/* CPU Image Cache
+ *
+ * Instead of loading image textures fully before rendering, the CPU device
+ * can look them up through the OpenImageIO texture system. Tiles of tiled and
+ * MIP-mapped files (.tx, tiled EXR) are then only read when a lookup needs
+ * them, at the MIP level selected from the texture coordinate differentials,
+ * and least recently used tiles are dropped to stay within the memory limit.
+ * Untiled files are tiled and MIP-mapped when first used, which still reads
+ * them fully once. */
+
+#include "util_types.h"
+
+CCL_NAMESPACE_BEGIN
+
+struct KernelImageCache;
+struct KernelImageCacheThread;
+
+KernelImageCache *kernel_image_cache_create();
+void kernel_image_cache_free(KernelImageCache *cache);
+
+void kernel_image_cache_set_max_memory(KernelImageCache *cache, int max_memory_mb);
+bool kernel_image_cache_add_image(KernelImageCache *cache, int slot, const char *filename);
+void kernel_image_cache_remove_image(KernelImageCache *cache, int slot);
+
+KernelImageCacheThread *kernel_image_cache_thread_init(KernelImageCache *cache);
+
+/* returns false if the image in this slot is not in the cache, in which case
+ * it was loaded in memory as usual */
+bool kernel_image_cache_lookup(KernelImageCache *cache, KernelImageCacheThread *thread,
+	int slot, float x, float y, float2 dx, float2 dy, float4 *result);
+
+CCL_NAMESPACE_END
+
+#endif /* __KERNEL_IMAGE_CACHE_H__ */
+
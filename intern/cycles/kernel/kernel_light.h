@@ -542,12 +542,108 @@ __device int light_distribution_sample(KernelGlobals *kg, float randt)
 	return clamp(first-1, 0, kernel_data.integrator.num_distribution-1);
 }
 
+/* Light Tree
+ *
+ * Each node is stored as two float4: the bounds minimum with the total energy
+ * of its emitters, and the bounds maximum with the index of the second child.
+ * The first child directly follows the node. In leaves the index is ~index
+ * into the light distribution instead. Nodes with only distant or background
+ * lights have empty bounds. */
+
+__device float light_tree_node_importance(KernelGlobals *kg, int node, float3 P)
+{
+	float4 data0 = kernel_tex_fetch(__light_tree_nodes, node*LIGHT_TREE_NODE_SIZE + 0);
+	float4 data1 = kernel_tex_fetch(__light_tree_nodes, node*LIGHT_TREE_NODE_SIZE + 1);
+
+	float energy = data0.w;
+
+	/* no falloff for distant and background lights */
+	if(data0.x > data1.x)
+		return energy;
+
+	/* estimate with distance to the center, clamped to the bounds radius so
+	 * shading points inside or near the bounds don't favor a single child */
+	float3 bmin = make_float3(data0.x, data0.y, data0.z);
+	float3 bmax = make_float3(data1.x, data1.y, data1.z);
+	float3 extent = bmax - bmin;
+
+	float dist2 = len_squared(P - 0.5f*(bmin + bmax));
+	float radius2 = 0.25f*dot(extent, extent);
+
+	return energy/max(max(dist2, radius2), 1e-8f);
+}
+
+__device int light_tree_sample(KernelGlobals *kg, int node, float randt, float3 P, float *pdf)
+{
+	*pdf = 1.0f;
+
+	while(1) {
+		int child = __float_as_int(kernel_tex_fetch(__light_tree_nodes, node*LIGHT_TREE_NODE_SIZE + 1).w);
+
+		if(child < 0)
+			return ~child;
+
+		/* pick child proportional to importance, and reuse random number */
+		float importance0 = light_tree_node_importance(kg, node + 1, P);
+		float importance1 = light_tree_node_importance(kg, child, P);
+		float total = importance0 + importance1;
+		float prob0 = (total > 0.0f)? importance0/total: 0.5f;
+
+		if(randt < prob0) {
+			randt = randt/prob0;
+			*pdf *= prob0;
+			node = node + 1;
+		}
+		else {
+			randt = min((randt - prob0)/(1.0f - prob0), 1.0f - 1e-7f);
+			*pdf *= 1.0f - prob0;
+			node = child;
+		}
+	}
+}
+
+__device int light_tree_distribution_sample(KernelGlobals *kg, float randt, float3 P, float *fac)
+{
+	/* triangles and lamps are picked with the same probability as the light
+	 * distribution, so branched path can still sample only triangles */
+	float triangles_pdf = kernel_data.integrator.light_tree_triangles_pdf;
+	float pdf;
+	int index;
+
+	if(randt < triangles_pdf) {
+		index = light_tree_sample(kg, 0, randt/triangles_pdf, P, &pdf);
+		pdf *= triangles_pdf;
+	}
+	else {
+		float lamps_pdf = 1.0f - triangles_pdf;
+		index = light_tree_sample(kg, kernel_data.integrator.light_tree_lamps,
+			min((randt - triangles_pdf)/lamps_pdf, 1.0f - 1e-7f), P, &pdf);
+		pdf *= lamps_pdf;
+	}
+
+	/* light pdfs assume the light distribution, so we correct the evaluation
+	 * for the tree pdf. MIS weights keep using the distribution pdf on both
+	 * sides, which keeps the result unbiased. */
+	float cdf0 = kernel_tex_fetch(__light_distribution, index).x;
+	float cdf1 = kernel_tex_fetch(__light_distribution, index + 1).x;
+
+	*fac = (pdf > 0.0f)? (cdf1 - cdf0)/pdf: 0.0f;
+
+	return index;
+}
+
 /* Generic Light */
 
 __device void light_sample(KernelGlobals *kg, float randt, float randu, float randv, float time, float3 P, LightSample *ls)
 {
 	/* sample index */
-	int index = light_distribution_sample(kg, randt);
+	float fac = 1.0f;
+	int index;
+
+	if(kernel_data.integrator.use_light_tree)
+		index = light_tree_distribution_sample(kg, randt, P, &fac);
+	else
+		index = light_distribution_sample(kg, randt);
 
 	/* fetch light data */
 	float4 l = kernel_tex_fetch(__light_distribution, index);
@@ -575,6 +671,8 @@ __device void light_sample(KernelGlobals *kg, float randt, float randu, float ra
 		int lamp = -prim-1;
 		lamp_light_sample(kg, lamp, randu, randv, P, ls);
 	}
+
+	ls->eval_fac *= fac;
 }
 
 __device int light_select_num_samples(KernelGlobals *kg, int index)
@@ -164,5 +164,54 @@ __device_inline void kernel_write_light_passes(KernelGlobals *kg, __global float
 #endif
 }
 
+
+/* Adaptive Sampling
+ *
+ * Each pixel counts the samples it took and sums the squared luminance of
+ * them. From that and the combined pass the standard error of the pixel
+ * mean is estimated, relative to the square root of its brightness so that
+ * dark pixels are not held to a much stricter threshold than bright ones.
+ * Once it is below the threshold no more samples are taken for the pixel,
+ * its statistics then no longer change so it stays converged. */
+
+__device_inline void kernel_write_adaptive_passes(KernelGlobals *kg, __global float *buffer, int sample, float4 L)
+{
+#ifdef __PASSES__
+	int flag = kernel_data.film.pass_flag;
+
+	if(flag & PASS_SAMPLE_COUNT)
+		kernel_write_pass_float(buffer + kernel_data.film.pass_sample_count, sample, 1.0f);
+	if(flag & PASS_SAMPLE_VARIANCE) {
+		float lum = linear_rgb_to_gray(make_float3(L.x, L.y, L.z));
+		kernel_write_pass_float(buffer + kernel_data.film.pass_sample_variance, sample, lum*lum);
+	}
+#endif
+}
+
+__device_inline bool kernel_adaptive_pixel_converged(KernelGlobals *kg, __global float *buffer, int sample)
+{
+#ifdef __PASSES__
+	float threshold = kernel_data.integrator.adaptive_threshold;
+
+	if(threshold == 0.0f || sample < kernel_data.integrator.adaptive_min_samples)
+		return false;
+
+	float n = buffer[kernel_data.film.pass_sample_count];
+
+	/* skipped an earlier sample already */
+	if(n < (float)sample)
+		return true;
+
+	float4 L = *((__global float4*)(buffer + kernel_data.film.pass_combined));
+	float mean = max(linear_rgb_to_gray(make_float3(L.x, L.y, L.z))/n, 0.0f);
+	float variance = max(buffer[kernel_data.film.pass_sample_variance]/n - mean*mean, 0.0f);
+	float error = sqrtf(variance/n)/(sqrtf(mean) + 1e-4f);
+
+	return (error < threshold);
+#else
+	return false;
+#endif
+}
+
 CCL_NAMESPACE_END
 
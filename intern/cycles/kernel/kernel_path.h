@@ -452,340 +452,405 @@ __device_inline bool kernel_path_integrate_lighting(KernelGlobals *kg, RNG *rng,
 
 #endif
 
-__device float4 kernel_path_integrate(KernelGlobals *kg, RNG *rng, int sample, Ray ray, __global float *buffer)
-{
-	/* initialize */
-	PathRadiance L;
-	float3 throughput = make_float3(1.0f, 1.0f, 1.0f);
-	float L_transparent = 0.0f;
+/* Path Integration
+ *
+ * The state of a path between bounces, so that the megakernel below and the
+ * wavefront integrator for the CPU (kernel_path_stream.h) can share the code
+ * that intersects and shades a single bounce. */
 
-	path_radiance_init(&L, kernel_data.film.use_light_pass);
+typedef struct PathIntegrateState {
+	PathRadiance L;
+	float3 throughput;
+	float L_transparent;
 
-	float min_ray_pdf = FLT_MAX;
-	float ray_pdf = 0.0f;
+	float min_ray_pdf;
+	float ray_pdf;
 #ifdef __LAMP_MIS__
-	float ray_t = 0.0f;
+	float ray_t;
 #endif
 	PathState state;
-	int rng_offset = PRNG_BASE_NUM;
+	int rng_offset;
+	int num_samples;
+
+	Ray ray;
+} PathIntegrateState;
+
+__device_inline void kernel_path_integrate_init(KernelGlobals *kg, PathIntegrateState *pi, Ray *ray)
+{
+	pi->throughput = make_float3(1.0f, 1.0f, 1.0f);
+	pi->L_transparent = 0.0f;
+
+	path_radiance_init(&pi->L, kernel_data.film.use_light_pass);
+
+	pi->min_ray_pdf = FLT_MAX;
+	pi->ray_pdf = 0.0f;
+#ifdef __LAMP_MIS__
+	pi->ray_t = 0.0f;
+#endif
+	pi->rng_offset = PRNG_BASE_NUM;
 #ifdef __CMJ__
-	int num_samples = kernel_data.integrator.aa_samples;
+	pi->num_samples = kernel_data.integrator.aa_samples;
 #else
-	int num_samples = 0;
+	pi->num_samples = 0;
 #endif
 
-	path_state_init(&state);
-
-	/* path iteration */
-	for(;; rng_offset += PRNG_BOUNCE_NUM) {
-		/* intersect scene */
-		Intersection isect;
-		uint visibility = path_state_ray_visibility(kg, &state);
+	path_state_init(&pi->state);
 
-#ifdef __HAIR__
-		float difl = 0.0f, extmax = 0.0f;
-		uint lcg_state = 0;
+	pi->ray = *ray;
+}
 
-		if(kernel_data.bvh.have_curves) {
-			if((kernel_data.cam.resolution == 1) && (state.flag & PATH_RAY_CAMERA)) {	
-				float3 pixdiff = ray.dD.dx + ray.dD.dy;
-				/*pixdiff = pixdiff - dot(pixdiff, ray.D)*ray.D;*/
-				difl = kernel_data.curve.minimum_width * len(pixdiff) * 0.5f;
-			}
+__device_inline bool kernel_path_integrate_intersect(KernelGlobals *kg, RNG *rng, int sample,
+	PathIntegrateState *pi, Intersection *isect)
+{
+	uint visibility = path_state_ray_visibility(kg, &pi->state);
 
-			extmax = kernel_data.curve.maximum_width;
-			lcg_state = lcg_init(*rng + rng_offset + sample*0x51633e2d);
+#ifdef __HAIR__
+	float difl = 0.0f, extmax = 0.0f;
+	uint lcg_state = 0;
+
+	if(kernel_data.bvh.have_curves) {
+		if((kernel_data.cam.resolution == 1) && (pi->state.flag & PATH_RAY_CAMERA)) {	
+			float3 pixdiff = pi->ray.dD.dx + pi->ray.dD.dy;
+			/*pixdiff = pixdiff - dot(pixdiff, ray.D)*ray.D;*/
+			difl = kernel_data.curve.minimum_width * len(pixdiff) * 0.5f;
 		}
 
-		bool hit = scene_intersect(kg, &ray, visibility, &isect, &lcg_state, difl, extmax);
+		extmax = kernel_data.curve.maximum_width;
+		lcg_state = lcg_init(*rng + pi->rng_offset + sample*0x51633e2d);
+	}
+
+	bool hit = scene_intersect(kg, &pi->ray, visibility, isect, &lcg_state, difl, extmax);
 #else
-		bool hit = scene_intersect(kg, &ray, visibility, &isect);
+	bool hit = scene_intersect(kg, &pi->ray, visibility, isect);
 #endif
 
+	return hit;
+}
+
+/* shade the result of kernel_path_integrate_intersect, returns false when the
+ * path terminates, otherwise pi->ray is set up for the next bounce */
+__device_inline bool kernel_path_integrate_bounce(KernelGlobals *kg, RNG *rng, int sample,
+	PathIntegrateState *pi, bool hit, Intersection *isect, __global float *buffer)
+{
 #ifdef __LAMP_MIS__
-		if(kernel_data.integrator.use_lamp_mis && !(state.flag & PATH_RAY_CAMERA)) {
-			/* ray starting from previous non-transparent bounce */
-			Ray light_ray;
+	if(kernel_data.integrator.use_lamp_mis && !(pi->state.flag & PATH_RAY_CAMERA)) {
+		/* ray starting from previous non-transparent bounce */
+		Ray light_ray;
 
-			light_ray.P = ray.P - ray_t*ray.D;
-			ray_t += isect.t;
-			light_ray.D = ray.D;
-			light_ray.t = ray_t;
-			light_ray.time = ray.time;
-			light_ray.dD = ray.dD;
-			light_ray.dP = ray.dP;
+		light_ray.P = pi->ray.P - pi->ray_t*pi->ray.D;
+		pi->ray_t += isect->t;
+		light_ray.D = pi->ray.D;
+		light_ray.t = pi->ray_t;
+		light_ray.time = pi->ray.time;
+		light_ray.dD = pi->ray.dD;
+		light_ray.dP = pi->ray.dP;
 
-			/* intersect with lamp */
-			float light_t = path_rng_1D(kg, rng, sample, num_samples, rng_offset + PRNG_LIGHT);
-			float3 emission;
+		/* intersect with lamp */
+		float light_t = path_rng_1D(kg, rng, sample, pi->num_samples, pi->rng_offset + PRNG_LIGHT);
+		float3 emission;
 
-			if(indirect_lamp_emission(kg, &light_ray, state.flag, ray_pdf, light_t, &emission, state.bounce))
-				path_radiance_accum_emission(&L, throughput, emission, state.bounce);
-		}
+		if(indirect_lamp_emission(kg, &light_ray, pi->state.flag, pi->ray_pdf, light_t, &emission, pi->state.bounce))
+			path_radiance_accum_emission(&pi->L, pi->throughput, emission, pi->state.bounce);
+	}
 #endif
 
-		if(!hit) {
-			/* eval background shader if nothing hit */
-			if(kernel_data.background.transparent && (state.flag & PATH_RAY_CAMERA)) {
-				L_transparent += average(throughput);
+	if(!hit) {
+		/* eval background shader if nothing hit */
+		if(kernel_data.background.transparent && (pi->state.flag & PATH_RAY_CAMERA)) {
+			pi->L_transparent += average(pi->throughput);
 
 #ifdef __PASSES__
-				if(!(kernel_data.film.pass_flag & PASS_BACKGROUND))
+			if(!(kernel_data.film.pass_flag & PASS_BACKGROUND))
 #endif
-					break;
-			}
+				return false;
+		}
 
 #ifdef __BACKGROUND__
-			/* sample background shader */
-			float3 L_background = indirect_background(kg, &ray, state.flag, ray_pdf, state.bounce);
-			path_radiance_accum_background(&L, throughput, L_background, state.bounce);
+		/* sample background shader */
+		float3 L_background = indirect_background(kg, &pi->ray, pi->state.flag, pi->ray_pdf, pi->state.bounce);
+		path_radiance_accum_background(&pi->L, pi->throughput, L_background, pi->state.bounce);
 #endif
 
-			break;
-		}
+		return false;
+	}
 
-		/* setup shading */
-		ShaderData sd;
-		shader_setup_from_ray(kg, &sd, &isect, &ray, state.bounce);
-		float rbsdf = path_rng_1D(kg, rng, sample, num_samples, rng_offset + PRNG_BSDF);
-		shader_eval_surface(kg, &sd, rbsdf, state.flag, SHADER_CONTEXT_MAIN);
+	/* setup shading */
+	ShaderData sd;
+	shader_setup_from_ray(kg, &sd, isect, &pi->ray, pi->state.bounce);
+	float rbsdf = path_rng_1D(kg, rng, sample, pi->num_samples, pi->rng_offset + PRNG_BSDF);
+	shader_eval_surface(kg, &sd, rbsdf, pi->state.flag, SHADER_CONTEXT_MAIN);
 
-		/* holdout */
+	/* holdout */
 #ifdef __HOLDOUT__
-		if((sd.flag & (SD_HOLDOUT|SD_HOLDOUT_MASK)) && (state.flag & PATH_RAY_CAMERA)) {
-			if(kernel_data.background.transparent) {
-				float3 holdout_weight;
-				
-				if(sd.flag & SD_HOLDOUT_MASK)
-					holdout_weight = make_float3(1.0f, 1.0f, 1.0f);
-				else
-					holdout_weight = shader_holdout_eval(kg, &sd);
-
-				/* any throughput is ok, should all be identical here */
-				L_transparent += average(holdout_weight*throughput);
-			}
-
+	if((sd.flag & (SD_HOLDOUT|SD_HOLDOUT_MASK)) && (pi->state.flag & PATH_RAY_CAMERA)) {
+		if(kernel_data.background.transparent) {
+			float3 holdout_weight;
+			
 			if(sd.flag & SD_HOLDOUT_MASK)
-				break;
+				holdout_weight = make_float3(1.0f, 1.0f, 1.0f);
+			else
+				holdout_weight = shader_holdout_eval(kg, &sd);
+
+			/* any throughput is ok, should all be identical here */
+			pi->L_transparent += average(holdout_weight*pi->throughput);
 		}
+
+		if(sd.flag & SD_HOLDOUT_MASK)
+			return false;
+	}
 #endif
 
-		/* holdout mask objects do not write data passes */
-		kernel_write_data_passes(kg, buffer, &L, &sd, sample, state.flag, throughput);
+	/* holdout mask objects do not write data passes */
+	kernel_write_data_passes(kg, buffer, &pi->L, &sd, sample, pi->state.flag, pi->throughput);
 
-		/* blurring of bsdf after bounces, for rays that have a small likelihood
-		 * of following this particular path (diffuse, rough glossy) */
-		if(kernel_data.integrator.filter_glossy != FLT_MAX) {
-			float blur_pdf = kernel_data.integrator.filter_glossy*min_ray_pdf;
+	/* blurring of bsdf after bounces, for rays that have a small likelihood
+	 * of following this particular path (diffuse, rough glossy) */
+	if(kernel_data.integrator.filter_glossy != FLT_MAX) {
+		float blur_pdf = kernel_data.integrator.filter_glossy*pi->min_ray_pdf;
 
-			if(blur_pdf < 1.0f) {
-				float blur_roughness = sqrtf(1.0f - blur_pdf)*0.5f;
-				shader_bsdf_blur(kg, &sd, blur_roughness);
-			}
+		if(blur_pdf < 1.0f) {
+			float blur_roughness = sqrtf(1.0f - blur_pdf)*0.5f;
+			shader_bsdf_blur(kg, &sd, blur_roughness);
 		}
+	}
 
 #ifdef __EMISSION__
-		/* emission */
-		if(sd.flag & SD_EMISSION) {
-			/* todo: is isect.t wrong here for transparent surfaces? */
-			float3 emission = indirect_primitive_emission(kg, &sd, isect.t, state.flag, ray_pdf);
-			path_radiance_accum_emission(&L, throughput, emission, state.bounce);
-		}
+	/* emission */
+	if(sd.flag & SD_EMISSION) {
+		/* todo: is isect->t wrong here for transparent surfaces? */
+		float3 emission = indirect_primitive_emission(kg, &sd, isect->t, pi->state.flag, pi->ray_pdf);
+		path_radiance_accum_emission(&pi->L, pi->throughput, emission, pi->state.bounce);
+	}
 #endif
 
-		/* path termination. this is a strange place to put the termination, it's
-		 * mainly due to the mixed in MIS that we use. gives too many unneeded
-		 * shader evaluations, only need emission if we are going to terminate */
-		float probability = path_state_terminate_probability(kg, &state, throughput);
+	/* path termination. this is a strange place to put the termination, it's
+	 * mainly due to the mixed in MIS that we use. gives too many unneeded
+	 * shader evaluations, only need emission if we are going to terminate */
+	float probability = path_state_terminate_probability(kg, &pi->state, pi->throughput);
 
-		if(probability == 0.0f) {
-			break;
-		}
-		else if(probability != 1.0f) {
-			float terminate = path_rng_1D(kg, rng, sample, num_samples, rng_offset + PRNG_TERMINATE);
+	if(probability == 0.0f) {
+		return false;
+	}
+	else if(probability != 1.0f) {
+		float terminate = path_rng_1D(kg, rng, sample, pi->num_samples, pi->rng_offset + PRNG_TERMINATE);
 
-			if(terminate >= probability)
-				break;
+		if(terminate >= probability)
+			return false;
 
-			throughput /= probability;
-		}
+		pi->throughput /= probability;
+	}
 
 #ifdef __AO__
-		/* ambient occlusion */
-		if(kernel_data.integrator.use_ambient_occlusion || (sd.flag & SD_AO)) {
-			/* todo: solve correlation */
-			float bsdf_u, bsdf_v;
-			path_rng_2D(kg, rng, sample, num_samples, rng_offset + PRNG_BSDF_U, &bsdf_u, &bsdf_v);
+	/* ambient occlusion */
+	if(kernel_data.integrator.use_ambient_occlusion || (sd.flag & SD_AO)) {
+		/* todo: solve correlation */
+		float bsdf_u, bsdf_v;
+		path_rng_2D(kg, rng, sample, pi->num_samples, pi->rng_offset + PRNG_BSDF_U, &bsdf_u, &bsdf_v);
 
-			float ao_factor = kernel_data.background.ao_factor;
-			float3 ao_N;
-			float3 ao_bsdf = shader_bsdf_ao(kg, &sd, ao_factor, &ao_N);
-			float3 ao_D;
-			float ao_pdf;
-			float3 ao_alpha = shader_bsdf_alpha(kg, &sd);
+		float ao_factor = kernel_data.background.ao_factor;
+		float3 ao_N;
+		float3 ao_bsdf = shader_bsdf_ao(kg, &sd, ao_factor, &ao_N);
+		float3 ao_D;
+		float ao_pdf;
+		float3 ao_alpha = shader_bsdf_alpha(kg, &sd);
 
-			sample_cos_hemisphere(ao_N, bsdf_u, bsdf_v, &ao_D, &ao_pdf);
+		sample_cos_hemisphere(ao_N, bsdf_u, bsdf_v, &ao_D, &ao_pdf);
 
-			if(dot(sd.Ng, ao_D) > 0.0f && ao_pdf != 0.0f) {
-				Ray light_ray;
-				float3 ao_shadow;
+		if(dot(sd.Ng, ao_D) > 0.0f && ao_pdf != 0.0f) {
+			Ray light_ray;
+			float3 ao_shadow;
 
-				light_ray.P = ray_offset(sd.P, sd.Ng);
-				light_ray.D = ao_D;
-				light_ray.t = kernel_data.background.ao_distance;
+			light_ray.P = ray_offset(sd.P, sd.Ng);
+			light_ray.D = ao_D;
+			light_ray.t = kernel_data.background.ao_distance;
 #ifdef __OBJECT_MOTION__
-				light_ray.time = sd.time;
+			light_ray.time = sd.time;
 #endif
-				light_ray.dP = sd.dP;
-				light_ray.dD = differential3_zero();
+			light_ray.dP = sd.dP;
+			light_ray.dD = differential3_zero();
 
-				if(!shadow_blocked(kg, &state, &light_ray, &ao_shadow))
-					path_radiance_accum_ao(&L, throughput, ao_alpha, ao_bsdf, ao_shadow, state.bounce);
-			}
+			if(!shadow_blocked(kg, &pi->state, &light_ray, &ao_shadow))
+				path_radiance_accum_ao(&pi->L, pi->throughput, ao_alpha, ao_bsdf, ao_shadow, pi->state.bounce);
 		}
+	}
 #endif
 
 #ifdef __SUBSURFACE__
-		/* bssrdf scatter to a different location on the same object, replacing
-		 * the closures with a diffuse BSDF */
-		if(sd.flag & SD_BSSRDF) {
-			float bssrdf_probability;
-			ShaderClosure *sc = subsurface_scatter_pick_closure(kg, &sd, &bssrdf_probability);
-
-			/* modify throughput for picking bssrdf or bsdf */
-			throughput *= bssrdf_probability;
-
-			/* do bssrdf scatter step if we picked a bssrdf closure */
-			if(sc) {
-				uint lcg_state = lcg_init(*rng + rng_offset + sample*0x68bc21eb);
-
-				ShaderData bssrdf_sd[BSSRDF_MAX_HITS];
-				float bssrdf_u, bssrdf_v;
-				path_rng_2D(kg, rng, sample, num_samples, rng_offset + PRNG_BSDF_U, &bssrdf_u, &bssrdf_v);
-				int num_hits = subsurface_scatter_multi_step(kg, &sd, bssrdf_sd, state.flag, sc, &lcg_state, bssrdf_u, bssrdf_v, false);
-
-				/* compute lighting with the BSDF closure */
-				for(int hit = 0; hit < num_hits; hit++) {
-					float3 tp = throughput;
-					PathState hit_state = state;
-					Ray hit_ray = ray;
-					float hit_ray_t = ray_t;
-					float hit_ray_pdf = ray_pdf;
-					float hit_min_ray_pdf = min_ray_pdf;
-
-					hit_state.flag |= PATH_RAY_BSSRDF_ANCESTOR;
-					
-					if(kernel_path_integrate_lighting(kg, rng, sample, num_samples, &bssrdf_sd[hit],
-						&tp, &hit_min_ray_pdf, &hit_ray_pdf, &hit_state, rng_offset+PRNG_BOUNCE_NUM, &L, &hit_ray, &hit_ray_t)) {
-						kernel_path_indirect(kg, rng, sample, hit_ray, buffer,
-							tp, num_samples, num_samples,
-							hit_min_ray_pdf, hit_ray_pdf, hit_state, rng_offset+PRNG_BOUNCE_NUM*2, &L);
-
-						/* for render passes, sum and reset indirect light pass variables
-						 * for the next samples */
-						path_radiance_sum_indirect(&L);
-						path_radiance_reset_indirect(&L);
-					}
+	/* bssrdf scatter to a different location on the same object, replacing
+	 * the closures with a diffuse BSDF */
+	if(sd.flag & SD_BSSRDF) {
+		float bssrdf_probability;
+		ShaderClosure *sc = subsurface_scatter_pick_closure(kg, &sd, &bssrdf_probability);
+
+		/* modify throughput for picking bssrdf or bsdf */
+		pi->throughput *= bssrdf_probability;
+
+		/* do bssrdf scatter step if we picked a bssrdf closure */
+		if(sc) {
+			uint lcg_state = lcg_init(*rng + pi->rng_offset + sample*0x68bc21eb);
+
+			ShaderData bssrdf_sd[BSSRDF_MAX_HITS];
+			float bssrdf_u, bssrdf_v;
+			path_rng_2D(kg, rng, sample, pi->num_samples, pi->rng_offset + PRNG_BSDF_U, &bssrdf_u, &bssrdf_v);
+			int num_hits = subsurface_scatter_multi_step(kg, &sd, bssrdf_sd, pi->state.flag, sc, &lcg_state, bssrdf_u, bssrdf_v, false);
+
+			/* compute lighting with the BSDF closure */
+			for(int hit = 0; hit < num_hits; hit++) {
+				float3 tp = pi->throughput;
+				PathState hit_state = pi->state;
+				Ray hit_ray = pi->ray;
+				float hit_ray_t = pi->ray_t;
+				float hit_ray_pdf = pi->ray_pdf;
+				float hit_min_ray_pdf = pi->min_ray_pdf;
+
+				hit_state.flag |= PATH_RAY_BSSRDF_ANCESTOR;
+				
+				if(kernel_path_integrate_lighting(kg, rng, sample, pi->num_samples, &bssrdf_sd[hit],
+					&tp, &hit_min_ray_pdf, &hit_ray_pdf, &hit_state, pi->rng_offset+PRNG_BOUNCE_NUM, &pi->L, &hit_ray, &hit_ray_t)) {
+					kernel_path_indirect(kg, rng, sample, hit_ray, buffer,
+						tp, pi->num_samples, pi->num_samples,
+						hit_min_ray_pdf, hit_ray_pdf, hit_state, pi->rng_offset+PRNG_BOUNCE_NUM*2, &pi->L);
+
+					/* for render passes, sum and reset indirect light pass variables
+					 * for the next samples */
+					path_radiance_sum_indirect(&pi->L);
+					path_radiance_reset_indirect(&pi->L);
 				}
-				break;
 			}
+			return false;
 		}
+	}
 #endif
-		
-		/* The following code is the same as in kernel_path_integrate_lighting(),
-		   but for CUDA the function call is slower. */
+	
 #ifdef __EMISSION__
-		if(kernel_data.integrator.use_direct_light) {
-			/* sample illumination from lights to find path contribution */
-			if(sd.flag & SD_BSDF_HAS_EVAL) {
-				float light_t = path_rng_1D(kg, rng, sample, num_samples, rng_offset + PRNG_LIGHT);
+	if(kernel_data.integrator.use_direct_light) {
+		/* sample illumination from lights to find path contribution */
+		if(sd.flag & SD_BSDF_HAS_EVAL) {
+			float light_t = path_rng_1D(kg, rng, sample, pi->num_samples, pi->rng_offset + PRNG_LIGHT);
 #ifdef __MULTI_CLOSURE__
-				float light_o = 0.0f;
+			float light_o = 0.0f;
 #else
-				float light_o = path_rng_1D(kg, rng, sample, num_samples, rng_offset + PRNG_LIGHT_F);
+			float light_o = path_rng_1D(kg, rng, sample, pi->num_samples, pi->rng_offset + PRNG_LIGHT_F);
 #endif
-				float light_u, light_v;
-				path_rng_2D(kg, rng, sample, num_samples, rng_offset + PRNG_LIGHT_U, &light_u, &light_v);
+			float light_u, light_v;
+			path_rng_2D(kg, rng, sample, pi->num_samples, pi->rng_offset + PRNG_LIGHT_U, &light_u, &light_v);
 
-				Ray light_ray;
-				BsdfEval L_light;
-				bool is_lamp;
+			Ray light_ray;
+			BsdfEval L_light;
+			bool is_lamp;
 
 #ifdef __OBJECT_MOTION__
-				light_ray.time = sd.time;
+			light_ray.time = sd.time;
 #endif
 
-				if(direct_emission(kg, &sd, -1, light_t, light_o, light_u, light_v, &light_ray, &L_light, &is_lamp, state.bounce)) {
-					/* trace shadow ray */
-					float3 shadow;
+			if(direct_emission(kg, &sd, -1, light_t, light_o, light_u, light_v, &light_ray, &L_light, &is_lamp, pi->state.bounce)) {
+				/* trace shadow ray */
+				float3 shadow;
 
-					if(!shadow_blocked(kg, &state, &light_ray, &shadow)) {
-						/* accumulate */
-						path_radiance_accum_light(&L, throughput, &L_light, shadow, 1.0f, state.bounce, is_lamp);
-					}
+				if(!shadow_blocked(kg, &pi->state, &light_ray, &shadow)) {
+					/* accumulate */
+					path_radiance_accum_light(&pi->L, pi->throughput, &L_light, shadow, 1.0f, pi->state.bounce, is_lamp);
 				}
 			}
 		}
+	}
 #endif
 
-		/* no BSDF? we can stop here */
-		if(!(sd.flag & SD_BSDF))
-			break;
+	/* no BSDF? we can stop here */
+	if(!(sd.flag & SD_BSDF))
+		return false;
 
-		/* sample BSDF */
-		float bsdf_pdf;
-		BsdfEval bsdf_eval;
-		float3 bsdf_omega_in;
-		differential3 bsdf_domega_in;
-		float bsdf_u, bsdf_v;
-		path_rng_2D(kg, rng, sample, num_samples, rng_offset + PRNG_BSDF_U, &bsdf_u, &bsdf_v);
-		int label;
+	/* sample BSDF */
+	float bsdf_pdf;
+	BsdfEval bsdf_eval;
+	float3 bsdf_omega_in;
+	differential3 bsdf_domega_in;
+	float bsdf_u, bsdf_v;
+	path_rng_2D(kg, rng, sample, pi->num_samples, pi->rng_offset + PRNG_BSDF_U, &bsdf_u, &bsdf_v);
+	int label;
 
-		label = shader_bsdf_sample(kg, &sd, bsdf_u, bsdf_v, &bsdf_eval,
-			&bsdf_omega_in, &bsdf_domega_in, &bsdf_pdf);
+	label = shader_bsdf_sample(kg, &sd, bsdf_u, bsdf_v, &bsdf_eval,
+		&bsdf_omega_in, &bsdf_domega_in, &bsdf_pdf);
 
-		if(bsdf_pdf == 0.0f || bsdf_eval_is_zero(&bsdf_eval))
-			break;
+	if(bsdf_pdf == 0.0f || bsdf_eval_is_zero(&bsdf_eval))
+		return false;
 
-		/* modify throughput */
-		path_radiance_bsdf_bounce(&L, &throughput, &bsdf_eval, bsdf_pdf, state.bounce, label);
+	/* modify throughput */
+	path_radiance_bsdf_bounce(&pi->L, &pi->throughput, &bsdf_eval, bsdf_pdf, pi->state.bounce, label);
 
-		/* set labels */
-		if(!(label & LABEL_TRANSPARENT)) {
-			ray_pdf = bsdf_pdf;
+	/* set labels */
+	if(!(label & LABEL_TRANSPARENT)) {
+		pi->ray_pdf = bsdf_pdf;
 #ifdef __LAMP_MIS__
-			ray_t = 0.0f;
+		pi->ray_t = 0.0f;
 #endif
-			min_ray_pdf = fminf(bsdf_pdf, min_ray_pdf);
-		}
+		pi->min_ray_pdf = fminf(bsdf_pdf, pi->min_ray_pdf);
+	}
 
-		/* update path state */
-		path_state_next(kg, &state, label);
+	/* update path state */
+	path_state_next(kg, &pi->state, label);
 
-		/* setup ray */
-		ray.P = ray_offset(sd.P, (label & LABEL_TRANSMIT)? -sd.Ng: sd.Ng);
-		ray.D = bsdf_omega_in;
+	/* setup ray */
+	pi->ray.P = ray_offset(sd.P, (label & LABEL_TRANSMIT)? -sd.Ng: sd.Ng);
+	pi->ray.D = bsdf_omega_in;
 
-		if(state.bounce == 0)
-			ray.t -= sd.ray_length; /* clipping works through transparent */
-		else
-			ray.t = FLT_MAX;
+	if(pi->state.bounce == 0)
+		pi->ray.t -= sd.ray_length; /* clipping works through transparent */
+	else
+		pi->ray.t = FLT_MAX;
 
 #ifdef __RAY_DIFFERENTIALS__
-		ray.dP = sd.dP;
-		ray.dD = bsdf_domega_in;
+	pi->ray.dP = sd.dP;
+	pi->ray.dD = bsdf_domega_in;
 #endif
-	}
 
-	float3 L_sum = path_radiance_sum(kg, &L);
+	pi->rng_offset += PRNG_BOUNCE_NUM;
+
+	return true;
+}
+
+__device_inline float4 kernel_path_integrate_end(KernelGlobals *kg, PathIntegrateState *pi, int sample, __global float *buffer)
+{
+	float3 L_sum = path_radiance_sum(kg, &pi->L);
 
 #ifdef __CLAMP_SAMPLE__
-	path_radiance_clamp(&L, &L_sum, kernel_data.integrator.sample_clamp);
+	path_radiance_clamp(&pi->L, &L_sum, kernel_data.integrator.sample_clamp);
 #endif
 
-	kernel_write_light_passes(kg, buffer, &L, sample);
+	kernel_write_light_passes(kg, buffer, &pi->L, sample);
 
-	return make_float4(L_sum.x, L_sum.y, L_sum.z, 1.0f - L_transparent);
+	return make_float4(L_sum.x, L_sum.y, L_sum.z, 1.0f - pi->L_transparent);
+}
+
+__device float4 kernel_path_integrate(KernelGlobals *kg, RNG *rng, int sample, Ray ray, __global float *buffer)
+{
+	/* initialize */
+	PathIntegrateState pi;
+#ifdef __KERNEL_CPU__
+	uint num_rays = 0;
+#endif
+
+	kernel_path_integrate_init(kg, &pi, &ray);
+
+	/* path iteration */
+	for(;;) {
+		/* intersect scene */
+		Intersection isect;
+		bool hit = kernel_path_integrate_intersect(kg, rng, sample, &pi, &isect);
+
+#ifdef __KERNEL_CPU__
+		num_rays++;
+#endif
+
+		if(!kernel_path_integrate_bounce(kg, rng, sample, &pi, hit, &isect, buffer))
+			break;
+	}
+
+#ifdef __KERNEL_CPU__
+	kg->num_rays += num_rays;
+#endif
+
+	return kernel_path_integrate_end(kg, &pi, sample, buffer);
 }
 
 #ifdef __BRANCHED_PATH__
@@ -959,6 +1024,10 @@ __device float4 kernel_branched_path_integrate(KernelGlobals *kg, RNG *rng, int
 	int aa_samples = 0;
 #endif
 
+#ifdef __KERNEL_CPU__
+	uint num_rays = 0;
+#endif
+
 	path_state_init(&state);
 
 	for(;; rng_offset += PRNG_BOUNCE_NUM) {
@@ -966,6 +1035,10 @@ __device float4 kernel_branched_path_integrate(KernelGlobals *kg, RNG *rng, int
 		Intersection isect;
 		uint visibility = path_state_ray_visibility(kg, &state);
 
+#ifdef __KERNEL_CPU__
+		num_rays++;
+#endif
+
 #ifdef __HAIR__
 		float difl = 0.0f, extmax = 0.0f;
 		uint lcg_state = 0;
@@ -1153,6 +1226,10 @@ __device float4 kernel_branched_path_integrate(KernelGlobals *kg, RNG *rng, int
 		ray.t -= sd.ray_length; /* clipping works through transparent */
 	}
 
+#ifdef __KERNEL_CPU__
+	kg->num_rays += num_rays;
+#endif
+
 	float3 L_sum = path_radiance_sum(kg, &L);
 
 #ifdef __CLAMP_SAMPLE__
@@ -1206,6 +1283,10 @@ __device void kernel_path_trace(KernelGlobals *kg,
 	rng_state += index;
 	buffer += index*pass_stride;
 
+	/* converged pixels take no more samples */
+	if(kernel_adaptive_pixel_converged(kg, buffer, sample))
+		return;
+
 	/* initialize random numbers and ray */
 	RNG rng;
 	Ray ray;
@@ -1222,6 +1303,7 @@ __device void kernel_path_trace(KernelGlobals *kg,
 
 	/* accumulate result in output buffer */
 	kernel_write_pass_float4(buffer, sample, L);
+	kernel_write_adaptive_passes(kg, buffer, sample, L);
 
 	path_rng_end(kg, rng_state, rng);
 }
@@ -1238,6 +1320,10 @@ __device void kernel_branched_path_trace(KernelGlobals *kg,
 	rng_state += index;
 	buffer += index*pass_stride;
 
+	/* converged pixels take no more samples */
+	if(kernel_adaptive_pixel_converged(kg, buffer, sample))
+		return;
+
 	/* initialize random numbers and ray */
 	RNG rng;
 	Ray ray;
@@ -1254,6 +1340,7 @@ __device void kernel_branched_path_trace(KernelGlobals *kg,
 
 	/* accumulate result in output buffer */
 	kernel_write_pass_float4(buffer, sample, L);
+	kernel_write_adaptive_passes(kg, buffer, sample, L);
 
 	path_rng_end(kg, rng_state, rng);
 }
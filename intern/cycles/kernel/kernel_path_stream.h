@@ -0,0 +1,224 @@
+/*
+ * Copyright 2011-2013 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+CCL_NAMESPACE_BEGIN
+
+/* Wavefront Path Tracing
+ *
+ * CPU only alternative to kernel_path_trace, instead of following one path
+ * from camera to termination, the paths of a whole tile are advanced one
+ * bounce at a time. Before each bounce the active rays are sorted by
+ * direction so that rays traversing the BVH one after the other touch the
+ * same nodes, and after intersection they are sorted by shader so shading
+ * runs the same SVM nodes back to back. Shadow rays are still traced from
+ * inside the shading of each bounce.
+ *
+ * The result is the same as the megakernel, each path uses its own RNG and
+ * bounces are shaded with the same code from kernel_path.h. */
+
+#define PATH_STREAM_KEY_BITS 16
+#define PATH_STREAM_KEY_MISS 0xFFFF
+
+typedef struct PathStreamItem {
+	PathIntegrateState pi;
+	Intersection isect;
+	RNG rng;
+	int index;
+	bool hit;
+} PathStreamItem;
+
+typedef struct KernelPathStream {
+	PathStreamItem *items;
+	int *active;
+	int *active_tmp;
+	uint *keys;
+	int size;
+} KernelPathStream;
+
+/* 16 bit key grouping rays by octant and then by direction quantized on the
+ * cube face of the dominant axis */
+
+__device_inline uint path_stream_direction_key(float3 D)
+{
+	uint octant = ((D.x < 0.0f)? 1: 0) | ((D.y < 0.0f)? 2: 0) | ((D.z < 0.0f)? 4: 0);
+	float3 aD = fabs(D);
+	float a, b, m;
+	uint axis;
+
+	if(aD.x >= aD.y && aD.x >= aD.z) { axis = 0; m = aD.x; a = aD.y; b = aD.z; }
+	else if(aD.y >= aD.z) { axis = 1; m = aD.y; a = aD.x; b = aD.z; }
+	else { axis = 2; m = aD.z; a = aD.x; b = aD.y; }
+
+	float inv_m = (m > 0.0f)? 1.0f/m: 0.0f;
+	uint qa = (uint)clamp(float_to_int(a*inv_m*15.0f), 0, 15);
+	uint qb = (uint)clamp(float_to_int(b*inv_m*15.0f), 0, 15);
+
+	return (octant << 10) | (axis << 8) | (qa << 4) | qb;
+}
+
+__device_inline uint path_stream_shader_key(KernelGlobals *kg, PathStreamItem *item)
+{
+	if(!item->hit)
+		return PATH_STREAM_KEY_MISS;
+
+	int prim = kernel_tex_fetch(__prim_index, item->isect.prim);
+	int shader;
+
+#ifdef __HAIR__
+	if(kernel_tex_fetch(__prim_segment, item->isect.prim) != ~0u)
+		shader = __float_as_int(kernel_tex_fetch(__curves, prim).z);
+	else
+#endif
+		shader = __float_as_int(kernel_tex_fetch(__tri_normal, prim).w);
+
+	return (uint)min(shader & SHADER_MASK, PATH_STREAM_KEY_MISS - 1);
+}
+
+/* stable LSD radix sort of the active path indices by 16 bit key, two 8 bit
+ * passes, the order is kept for equal keys so results don't depend on it */
+
+__device void path_stream_sort(KernelPathStream *stream, int num_active)
+{
+	int *src = stream->active;
+	int *dst = stream->active_tmp;
+	uint *keys = stream->keys;
+
+	for(int shift = 0; shift < PATH_STREAM_KEY_BITS; shift += 8) {
+		int count[256];
+
+		memset(count, 0, sizeof(count));
+
+		for(int i = 0; i < num_active; i++)
+			count[(keys[src[i]] >> shift) & 0xFF]++;
+
+		for(int i = 0, total = 0; i < 256; i++) {
+			int c = count[i];
+			count[i] = total;
+			total += c;
+		}
+
+		for(int i = 0; i < num_active; i++)
+			dst[count[(keys[src[i]] >> shift) & 0xFF]++] = src[i];
+
+		int *tmp = src;
+		src = dst;
+		dst = tmp;
+	}
+
+	/* even number of passes, result is back in stream->active */
+}
+
+__device void path_stream_finish(KernelGlobals *kg, PathStreamItem *item,
+	__global float *buffer, __global uint *rng_state, int sample, int pass_stride)
+{
+	__global float *pixel_buffer = buffer + item->index*pass_stride;
+
+	float4 L = kernel_path_integrate_end(kg, &item->pi, sample, pixel_buffer);
+	kernel_write_pass_float4(pixel_buffer, sample, L);
+	kernel_write_adaptive_passes(kg, pixel_buffer, sample, L);
+
+	path_rng_end(kg, rng_state + item->index, item->rng);
+}
+
+/* trace one sample for all pixels in the tile */
+
+__device void kernel_path_trace_stream(KernelGlobals *kg, KernelPathStream *stream,
+	__global float *buffer, __global uint *rng_state,
+	int sample, int x, int y, int w, int h, int offset, int stride)
+{
+	int pass_stride = kernel_data.film.pass_stride;
+	int num_pixels = w*h;
+	uint64_t num_rays = 0;
+
+	for(int first = 0; first < num_pixels; first += stream->size) {
+		int num_items = min(stream->size, num_pixels - first);
+		int num_active = 0;
+
+		/* generate camera rays */
+		for(int i = 0; i < num_items; i++) {
+			PathStreamItem *item = &stream->items[i];
+			int px = x + (first + i) % w;
+			int py = y + (first + i) / w;
+			Ray ray;
+
+			item->index = offset + px + py*stride;
+
+			/* converged pixels take no more samples */
+			if(kernel_adaptive_pixel_converged(kg, buffer + item->index*pass_stride, sample))
+				continue;
+
+			kernel_path_trace_setup(kg, rng_state + item->index, sample, px, py, &item->rng, &ray);
+
+			if(ray.t != 0.0f) {
+				kernel_path_integrate_init(kg, &item->pi, &ray);
+				stream->active[num_active++] = i;
+			}
+			else {
+				__global float *pixel_buffer = buffer + item->index*pass_stride;
+
+				kernel_write_pass_float4(pixel_buffer, sample, make_float4(0.0f, 0.0f, 0.0f, 0.0f));
+				kernel_write_adaptive_passes(kg, pixel_buffer, sample, make_float4(0.0f, 0.0f, 0.0f, 0.0f));
+				path_rng_end(kg, rng_state + item->index, item->rng);
+			}
+		}
+
+		/* advance all active paths one bounce at a time */
+		while(num_active) {
+			/* intersect, in direction order */
+			for(int i = 0; i < num_active; i++) {
+				int a = stream->active[i];
+				stream->keys[a] = path_stream_direction_key(stream->items[a].pi.ray.D);
+			}
+
+			path_stream_sort(stream, num_active);
+
+			for(int i = 0; i < num_active; i++) {
+				PathStreamItem *item = &stream->items[stream->active[i]];
+				item->hit = kernel_path_integrate_intersect(kg, &item->rng, sample, &item->pi, &item->isect);
+			}
+
+			num_rays += num_active;
+
+			/* shade, in shader order */
+			for(int i = 0; i < num_active; i++) {
+				int a = stream->active[i];
+				stream->keys[a] = path_stream_shader_key(kg, &stream->items[a]);
+			}
+
+			path_stream_sort(stream, num_active);
+
+			int num_next = 0;
+
+			for(int i = 0; i < num_active; i++) {
+				int a = stream->active[i];
+				PathStreamItem *item = &stream->items[a];
+				__global float *pixel_buffer = buffer + item->index*pass_stride;
+
+				if(kernel_path_integrate_bounce(kg, &item->rng, sample, &item->pi, item->hit, &item->isect, pixel_buffer))
+					stream->active[num_next++] = a;
+				else
+					path_stream_finish(kg, item, buffer, rng_state, sample, pass_stride);
+			}
+
+			num_active = num_next;
+		}
+	}
+
+	kg->num_rays += num_rays;
+}
+
+CCL_NAMESPACE_END
+
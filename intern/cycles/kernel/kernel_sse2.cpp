@@ -32,6 +32,7 @@
 #include "kernel_globals.h"
 #include "kernel_film.h"
 #include "kernel_path.h"
+#include "kernel_path_stream.h"
 #include "kernel_displace.h"
 
 CCL_NAMESPACE_BEGIN
@@ -48,6 +49,11 @@ void kernel_cpu_sse2_path_trace(KernelGlobals *kg, float *buffer, unsigned int *
 		kernel_path_trace(kg, buffer, rng_state, sample, x, y, offset, stride);
 }
 
+void kernel_cpu_sse2_path_trace_stream(KernelGlobals *kg, KernelPathStream *stream, float *buffer, unsigned int *rng_state, int sample, int x, int y, int w, int h, int offset, int stride)
+{
+	kernel_path_trace_stream(kg, stream, buffer, rng_state, sample, x, y, w, h, offset, stride);
+}
+
 /* Film */
 
 void kernel_cpu_sse2_convert_to_byte(KernelGlobals *kg, uchar4 *rgba, float *buffer, float sample_scale, int x, int y, int offset, int stride)
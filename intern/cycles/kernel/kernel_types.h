@@ -30,6 +30,7 @@ CCL_NAMESPACE_BEGIN
 #define OBJECT_SIZE 		11
 #define OBJECT_VECTOR_SIZE	6
 #define LIGHT_SIZE			4
+#define LIGHT_TREE_NODE_SIZE	2
 #define FILTER_TABLE_SIZE	256
 #define RAMP_TABLE_SIZE		256
 #define PARTICLE_SIZE 		5
@@ -46,6 +47,17 @@ CCL_NAMESPACE_BEGIN
 
 #define TEX_NUM_FLOAT_IMAGES	5
 
+/* half float and single channel images are only supported on the CPU, their
+ * slots come after the float and byte images of the extended image limits */
+#define TEX_IMAGE_HALF4_START	(TEX_NUM_FLOAT_IMAGES + 512)
+#define TEX_NUM_HALF4_IMAGES	128
+#define TEX_IMAGE_FLOAT1_START	(TEX_IMAGE_HALF4_START + TEX_NUM_HALF4_IMAGES)
+#define TEX_NUM_FLOAT1_IMAGES	128
+#define TEX_IMAGE_BYTE1_START	(TEX_IMAGE_FLOAT1_START + TEX_NUM_FLOAT1_IMAGES)
+#define TEX_NUM_BYTE1_IMAGES	256
+#define TEX_IMAGE_HALF1_START	(TEX_IMAGE_BYTE1_START + TEX_NUM_BYTE1_IMAGES)
+#define TEX_NUM_HALF1_IMAGES	128
+
 /* device capabilities */
 #ifdef __KERNEL_CPU__
 #define __KERNEL_SHADING__
@@ -268,7 +280,9 @@ typedef enum PassType {
 	PASS_MIST = 2097152,
 	PASS_SUBSURFACE_DIRECT = 4194304,
 	PASS_SUBSURFACE_INDIRECT = 8388608,
-	PASS_SUBSURFACE_COLOR = 16777216
+	PASS_SUBSURFACE_COLOR = 16777216,
+	PASS_SAMPLE_COUNT = 33554432,
+	PASS_SAMPLE_VARIANCE = 67108864
 } PassType;
 
 #define PASS_ALL (~0)
@@ -693,12 +707,12 @@ typedef struct KernelFilm {
 	int pass_emission;
 	int pass_background;
 	int pass_ao;
-	int pass_pad1;
+	int pass_sample_count;
 
 	int pass_shadow;
 	float pass_shadow_scale;
 	int filter_table_offset;
-	int pass_pad2;
+	int pass_sample_variance;
 
 	int pass_mist;
 	float mist_start;
@@ -769,8 +783,14 @@ typedef struct KernelIntegrator {
 	/* sampler */
 	int sampling_pattern;
 
-	/* padding */
-	int pad;
+	/* adaptive sampling */
+	float adaptive_threshold;
+	int adaptive_min_samples;
+
+	/* light tree, triangles start at node 0 */
+	int use_light_tree;
+	int light_tree_lamps;
+	float light_tree_triangles_pdf;
 } KernelIntegrator;
 
 typedef struct KernelBVH {
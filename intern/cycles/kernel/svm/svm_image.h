@@ -48,7 +48,7 @@ __device_inline float svm_image_texture_frac(float x, int *ix)
 	return x - (float)i;
 }
 
-__device float4 svm_image_texture(KernelGlobals *kg, int id, float x, float y, uint srgb, uint use_alpha)
+__device float4 svm_image_texture(KernelGlobals *kg, int id, float x, float y, float2 dx, float2 dy, uint srgb, uint use_alpha)
 {
 	/* first slots are used by float textures, which are not supported here */
 	if(id < TEX_NUM_FLOAT_IMAGES)
@@ -110,12 +110,14 @@ __device float4 svm_image_texture(KernelGlobals *kg, int id, float x, float y, u
 
 #else
 
-__device float4 svm_image_texture(KernelGlobals *kg, int id, float x, float y, uint srgb, uint use_alpha)
+__device float4 svm_image_texture(KernelGlobals *kg, int id, float x, float y, float2 dx, float2 dy, uint srgb, uint use_alpha)
 {
 	float4 r;
 
 #ifdef __KERNEL_CPU__
-	r = kernel_tex_image_interp(id, x, y);
+	/* images that were not loaded in memory are read through the image cache */
+	if(!(kg->image_cache && kernel_image_cache_lookup(kg->image_cache, kg->image_cache_thread, id, x, y, dx, dy, &r)))
+		r = kernel_tex_image_interp(id, x, y);
 #else
 	/* not particularly proud of this massive switch, what are the
 	 * alternatives?
@@ -239,7 +241,7 @@ __device float4 svm_image_texture(KernelGlobals *kg, int id, float x, float y, u
 		r.y *= invw;
 		r.z *= invw;
 
-		if(id >= TEX_NUM_FLOAT_IMAGES) {
+		if(id >= TEX_NUM_FLOAT_IMAGES && id < TEX_IMAGE_HALF4_START) {
 			r.x = min(r.x, 1.0f);
 			r.y = min(r.y, 1.0f);
 			r.z = min(r.z, 1.0f);
@@ -257,6 +259,30 @@ __device float4 svm_image_texture(KernelGlobals *kg, int id, float x, float y, u
 
 #endif
 
+/* texture coordinate differentials from the UV map, used by the image cache to
+ * select the MIP level, zero when looking up images loaded in memory */
+__device void svm_image_texture_uv_differentials(KernelGlobals *kg, ShaderData *sd, uint attr, float2 *dx, float2 *dy)
+{
+	*dx = make_float2(0.0f, 0.0f);
+	*dy = make_float2(0.0f, 0.0f);
+
+#if defined(__KERNEL_CPU__) && defined(__RAY_DIFFERENTIALS__)
+	if(!kg->image_cache || attr == ATTR_STD_NOT_FOUND)
+		return;
+
+	AttributeElement elem;
+	int offset = find_attribute(kg, sd, attr, &elem);
+
+	if(offset != ATTR_STD_NOT_FOUND) {
+		float3 duv_dx, duv_dy;
+		primitive_attribute_float3(kg, sd, elem, offset, &duv_dx, &duv_dy);
+
+		*dx = make_float2(duv_dx.x, duv_dx.y);
+		*dy = make_float2(duv_dy.x, duv_dy.y);
+	}
+#endif
+}
+
 __device void svm_node_tex_image(KernelGlobals *kg, ShaderData *sd, float *stack, uint4 node)
 {
 	uint id = node.y;
@@ -265,8 +291,12 @@ __device void svm_node_tex_image(KernelGlobals *kg, ShaderData *sd, float *stack
 	decode_node_uchar4(node.z, &co_offset, &out_offset, &alpha_offset, &srgb);
 
 	float3 co = stack_load_float3(stack, co_offset);
+	float2 dx, dy;
+
+	svm_image_texture_uv_differentials(kg, sd, node.w, &dx, &dy);
+
 	uint use_alpha = stack_valid(alpha_offset);
-	float4 f = svm_image_texture(kg, id, co.x, co.y, srgb, use_alpha);
+	float4 f = svm_image_texture(kg, id, co.x, co.y, dx, dy, srgb, use_alpha);
 
 	if(stack_valid(out_offset))
 		stack_store_float3(stack, out_offset, make_float3(f.x, f.y, f.z));
@@ -347,14 +377,15 @@ __device void svm_node_tex_image_box(KernelGlobals *kg, ShaderData *sd, float *s
 	uint id = node.y;
 
 	float4 f = make_float4(0.0f, 0.0f, 0.0f, 0.0f);
+	float2 zero = make_float2(0.0f, 0.0f);
 	uint use_alpha = stack_valid(alpha_offset);
 
 	if(weight.x > 0.0f)
-		f += weight.x*svm_image_texture(kg, id, co.y, co.z, srgb, use_alpha);
+		f += weight.x*svm_image_texture(kg, id, co.y, co.z, zero, zero, srgb, use_alpha);
 	if(weight.y > 0.0f)
-		f += weight.y*svm_image_texture(kg, id, co.x, co.z, srgb, use_alpha);
+		f += weight.y*svm_image_texture(kg, id, co.x, co.z, zero, zero, srgb, use_alpha);
 	if(weight.z > 0.0f)
-		f += weight.z*svm_image_texture(kg, id, co.y, co.x, srgb, use_alpha);
+		f += weight.z*svm_image_texture(kg, id, co.y, co.x, zero, zero, srgb, use_alpha);
 
 	if(stack_valid(out_offset))
 		stack_store_float3(stack, out_offset, make_float3(f.x, f.y, f.z));
@@ -381,8 +412,9 @@ __device void svm_node_tex_environment(KernelGlobals *kg, ShaderData *sd, float
 	else
 		uv = direction_to_mirrorball(co);
 
+	float2 zero = make_float2(0.0f, 0.0f);
 	uint use_alpha = stack_valid(alpha_offset);
-	float4 f = svm_image_texture(kg, id, uv.x, uv.y, srgb, use_alpha);
+	float4 f = svm_image_texture(kg, id, uv.x, uv.y, zero, zero, srgb, use_alpha);
 
 	if(stack_valid(out_offset))
 		stack_store_float3(stack, out_offset, make_float3(f.x, f.y, f.z));
@@ -156,6 +156,16 @@ bool RenderBuffers::copy_from_device()
 	return true;
 }
 
+bool RenderBuffers::copy_to_device()
+{
+	if(!buffer.device_pointer)
+		return false;
+
+	device->mem_copy_to(buffer);
+
+	return true;
+}
+
 bool RenderBuffers::get_pass_rect(PassType type, float exposure, int sample, int components, float *pixels)
 {
 	int pass_offset = 0;
@@ -169,29 +179,51 @@ bool RenderBuffers::get_pass_rect(PassType type, float exposure, int sample, int
 		float *in = (float*)buffer.data_pointer + pass_offset;
 		int pass_stride = params.get_passes_size();
 
-		float scale = (pass.filter)? 1.0f/(float)sample: 1.0f;
-		float scale_exposure = (pass.exposure)? scale*exposure: scale;
-
 		int size = params.width*params.height;
 
+		/* filtered passes are divided by the number of samples, which with
+		 * adaptive sampling differs per pixel and is read from its pass */
+		float sample_count = (float)sample;
+		float *in_count = &sample_count;
+		int count_stride = 0;
+
+		if(pass.filter) {
+			int count_offset = 0;
+
+			foreach(Pass& count_pass, params.passes) {
+				if(count_pass.type == PASS_SAMPLE_COUNT) {
+					in_count = (float*)buffer.data_pointer + count_offset;
+					count_stride = pass_stride;
+					break;
+				}
+				count_offset += count_pass.components;
+			}
+		}
+
 		if(components == 1) {
 			assert(pass.components == components);
 
 			/* scalar */
 			if(type == PASS_DEPTH) {
-				for(int i = 0; i < size; i++, in += pass_stride, pixels++) {
+				for(int i = 0; i < size; i++, in += pass_stride, in_count += count_stride, pixels++) {
+					float scale = (pass.filter)? 1.0f/max(*in_count, 1.0f): 1.0f;
+					float scale_exposure = (pass.exposure)? scale*exposure: scale;
 					float f = *in;
 					pixels[0] = (f == 0.0f)? 1e10f: f*scale_exposure;
 				}
 			}
 			else if(type == PASS_MIST) {
-				for(int i = 0; i < size; i++, in += pass_stride, pixels++) {
+				for(int i = 0; i < size; i++, in += pass_stride, in_count += count_stride, pixels++) {
+					float scale = (pass.filter)? 1.0f/max(*in_count, 1.0f): 1.0f;
+					float scale_exposure = (pass.exposure)? scale*exposure: scale;
 					float f = *in;
 					pixels[0] = clamp(f*scale_exposure, 0.0f, 1.0f);
 				}
 			}
 			else {
-				for(int i = 0; i < size; i++, in += pass_stride, pixels++) {
+				for(int i = 0; i < size; i++, in += pass_stride, in_count += count_stride, pixels++) {
+					float scale = (pass.filter)? 1.0f/max(*in_count, 1.0f): 1.0f;
+					float scale_exposure = (pass.exposure)? scale*exposure: scale;
 					float f = *in;
 					pixels[0] = f*scale_exposure;
 				}
@@ -235,7 +267,9 @@ bool RenderBuffers::get_pass_rect(PassType type, float exposure, int sample, int
 			}
 			else {
 				/* RGB/vector */
-				for(int i = 0; i < size; i++, in += pass_stride, pixels += 3) {
+				for(int i = 0; i < size; i++, in += pass_stride, in_count += count_stride, pixels += 3) {
+					float scale = (pass.filter)? 1.0f/max(*in_count, 1.0f): 1.0f;
+					float scale_exposure = (pass.exposure)? scale*exposure: scale;
 					float3 f = make_float3(in[0], in[1], in[2]);
 
 					pixels[0] = f.x*scale_exposure;
@@ -282,7 +316,9 @@ bool RenderBuffers::get_pass_rect(PassType type, float exposure, int sample, int
 				}
 			}
 			else {
-				for(int i = 0; i < size; i++, in += pass_stride, pixels += 4) {
+				for(int i = 0; i < size; i++, in += pass_stride, in_count += count_stride, pixels += 4) {
+					float scale = (pass.filter)? 1.0f/max(*in_count, 1.0f): 1.0f;
+					float scale_exposure = (pass.exposure)? scale*exposure: scale;
 					float4 f = make_float4(in[0], in[1], in[2], in[3]);
 
 					pixels[0] = f.x*scale_exposure;
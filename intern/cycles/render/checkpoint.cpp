@@ -0,0 +1,455 @@
+/*
+ * Copyright 2011-2013 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "camera.h"
+#include "checkpoint.h"
+#include "graph.h"
+#include "integrator.h"
+#include "light.h"
+#include "mesh.h"
+#include "object.h"
+#include "scene.h"
+#include "shader.h"
+
+#include "util_foreach.h"
+#include "util_md5.h"
+#include "util_path.h"
+#include "util_time.h"
+#include "util_types.h"
+
+#include <boost/version.hpp>
+
+#if (BOOST_VERSION < 104400)
+#  define BOOST_FILESYSTEM_VERSION 2
+#endif
+
+#include <boost/filesystem.hpp>
+
+CCL_NAMESPACE_BEGIN
+
+/* Checkpoint File
+ *
+ * Header with the buffer layout followed by the pass types and the tiles,
+ * each with position, size and number of samples followed by its render
+ * buffer. The random number state is not stored, with sobol sampling it
+ * only depends on the pixel position. */
+
+#define CHECKPOINT_FILE_MAGIC 0x43594350 /* "CYCP" */
+#define CHECKPOINT_FILE_VERSION 1
+
+struct CheckpointFileHeader {
+	uint32_t magic;
+	uint32_t version;
+	int32_t full_x, full_y;
+	int32_t full_width, full_height;
+	int32_t pass_stride;
+	int32_t num_passes;
+	int32_t num_tiles;
+};
+
+struct CheckpointTileHeader {
+	int32_t x, y;
+	int32_t w, h;
+	int32_t sample;
+};
+
+/* Render Checkpoint */
+
+RenderCheckpoint::RenderCheckpoint(const string& filepath_, double interval_)
+{
+	filepath = filepath_;
+	interval = interval_;
+	last_write_time = time_dt();
+}
+
+RenderCheckpoint::~RenderCheckpoint()
+{
+}
+
+bool RenderCheckpoint::load(BufferParams& params_)
+{
+	params = params_;
+	tiles.clear();
+
+	FILE *f = fopen(filepath.c_str(), "rb");
+
+	if(!f)
+		return false;
+
+	/* only use checkpoints of the same image size and passes */
+	CheckpointFileHeader header;
+	int pass_stride = params.get_passes_size();
+	bool ok = (fread(&header, sizeof(header), 1, f) == 1) &&
+	          header.magic == CHECKPOINT_FILE_MAGIC &&
+	          header.version == CHECKPOINT_FILE_VERSION &&
+	          header.full_x == params.full_x &&
+	          header.full_y == params.full_y &&
+	          header.full_width == params.full_width &&
+	          header.full_height == params.full_height &&
+	          header.pass_stride == pass_stride &&
+	          header.num_passes == (int)params.passes.size();
+
+	for(int i = 0; ok && i < header.num_passes; i++) {
+		int32_t type;
+
+		if(fread(&type, sizeof(type), 1, f) != 1 || type != (int32_t)params.passes[i].type)
+			ok = false;
+	}
+
+	for(int i = 0; ok && i < header.num_tiles; i++) {
+		CheckpointTileHeader theader;
+
+		if(fread(&theader, sizeof(theader), 1, f) != 1 ||
+		   theader.w <= 0 || theader.h <= 0 || theader.sample < 0)
+		{
+			ok = false;
+			break;
+		}
+
+		Tile& tile = tiles[pair<int, int>(theader.x, theader.y)];
+		tile.w = theader.w;
+		tile.h = theader.h;
+		tile.sample = theader.sample;
+		tile.buffer.resize(tile.w*tile.h*pass_stride);
+
+		if(fread(&tile.buffer[0], sizeof(float)*tile.buffer.size(), 1, f) != 1)
+			ok = false;
+	}
+
+	fclose(f);
+
+	if(!ok) {
+		fprintf(stderr, "Ignoring invalid or outdated checkpoint %s.\n", filepath.c_str());
+		tiles.clear();
+	}
+
+	return tiles.size() > 0;
+}
+
+void RenderCheckpoint::update_tile(RenderTile& rtile, bool force)
+{
+	RenderBuffers *buffers = rtile.buffers;
+	double current_time = time_dt();
+
+	/* nothing rendered yet */
+	if(rtile.sample <= 0 || !buffers)
+		return;
+
+	pair<int, int> key(rtile.x, rtile.y);
+
+	if(!force) {
+		thread_scoped_lock tiles_lock(tiles_mutex);
+		map<pair<int, int>, Tile>::iterator it = tiles.find(key);
+
+		if(it != tiles.end() && current_time - it->second.time < interval)
+			return;
+	}
+
+	/* only this thread renders the tile, so we can copy it without locking */
+	buffers->copy_from_device();
+
+	thread_scoped_lock tiles_lock(tiles_mutex);
+
+	Tile& tile = tiles[key];
+	tile.w = rtile.w;
+	tile.h = rtile.h;
+	tile.sample = rtile.sample;
+	tile.time = current_time;
+	tile.buffer.resize(buffers->buffer.size());
+	memcpy(&tile.buffer[0], (void*)buffers->buffer.data_pointer, sizeof(float)*tile.buffer.size());
+
+	if(current_time - last_write_time >= interval) {
+		write_file();
+		last_write_time = time_dt();
+	}
+}
+
+bool RenderCheckpoint::restore_tile(RenderTile& rtile)
+{
+	RenderBuffers *buffers = rtile.buffers;
+	thread_scoped_lock tiles_lock(tiles_mutex);
+
+	map<pair<int, int>, Tile>::iterator it = tiles.find(pair<int, int>(rtile.x, rtile.y));
+
+	if(it == tiles.end())
+		return false;
+
+	Tile& tile = it->second;
+
+	if(tile.w != rtile.w || tile.h != rtile.h || tile.buffer.size() != buffers->buffer.size())
+		return false;
+
+	memcpy((void*)buffers->buffer.data_pointer, &tile.buffer[0], sizeof(float)*tile.buffer.size());
+	buffers->copy_to_device();
+
+	/* tiles may have more samples than needed when continuing with fewer samples */
+	int end_sample = rtile.start_sample + rtile.num_samples;
+
+	rtile.start_sample = tile.sample;
+	rtile.num_samples = max(end_sample - tile.sample, 0);
+	rtile.sample = tile.sample;
+
+	return true;
+}
+
+bool RenderCheckpoint::write()
+{
+	thread_scoped_lock tiles_lock(tiles_mutex);
+
+	last_write_time = time_dt();
+
+	return write_file();
+}
+
+bool RenderCheckpoint::write_file()
+{
+	if(tiles.size() == 0)
+		return true;
+
+	path_create_directories(filepath);
+
+	/* write to a temporary file and rename when done, so a render stopped
+	 * while writing keeps the previous checkpoint */
+	string tmp_filepath = filepath + ".tmp";
+	FILE *f = fopen(tmp_filepath.c_str(), "wb");
+
+	if(!f) {
+		fprintf(stderr, "Failed to open file %s for writing.\n", tmp_filepath.c_str());
+		return false;
+	}
+
+	CheckpointFileHeader header;
+	header.magic = CHECKPOINT_FILE_MAGIC;
+	header.version = CHECKPOINT_FILE_VERSION;
+	header.full_x = params.full_x;
+	header.full_y = params.full_y;
+	header.full_width = params.full_width;
+	header.full_height = params.full_height;
+	header.pass_stride = params.get_passes_size();
+	header.num_passes = params.passes.size();
+	header.num_tiles = tiles.size();
+
+	bool ok = (fwrite(&header, sizeof(header), 1, f) == 1);
+
+	foreach(Pass& pass, params.passes) {
+		int32_t type = pass.type;
+
+		if(ok && fwrite(&type, sizeof(type), 1, f) != 1)
+			ok = false;
+	}
+
+	map<pair<int, int>, Tile>::iterator it;
+
+	for(it = tiles.begin(); ok && it != tiles.end(); it++) {
+		Tile& tile = it->second;
+		CheckpointTileHeader theader;
+
+		theader.x = it->first.first;
+		theader.y = it->first.second;
+		theader.w = tile.w;
+		theader.h = tile.h;
+		theader.sample = tile.sample;
+
+		if(fwrite(&theader, sizeof(theader), 1, f) != 1 ||
+		   fwrite(&tile.buffer[0], sizeof(float)*tile.buffer.size(), 1, f) != 1)
+			ok = false;
+	}
+
+	if(fclose(f) != 0)
+		ok = false;
+
+	boost::system::error_code ec;
+
+	if(ok)
+		boost::filesystem::rename(tmp_filepath, filepath, ec);
+
+	if(!ok || ec) {
+		fprintf(stderr, "Failed to write checkpoint %s.\n", filepath.c_str());
+		boost::filesystem::remove(tmp_filepath, ec);
+		return false;
+	}
+
+	return true;
+}
+
+void RenderCheckpoint::remove()
+{
+	thread_scoped_lock tiles_lock(tiles_mutex);
+	boost::system::error_code ec;
+
+	boost::filesystem::remove(filepath, ec);
+	tiles.clear();
+}
+
+/* Scene Hash */
+
+template<typename T> static void hash_append(MD5Hash& md5, const T& value)
+{
+	md5.append((const uint8_t*)&value, sizeof(T));
+}
+
+/* the fourth component of float3 is not initialized */
+static void hash_append_float3(MD5Hash& md5, const float3& f)
+{
+	md5.append((const uint8_t*)&f.x, sizeof(float));
+	md5.append((const uint8_t*)&f.y, sizeof(float));
+	md5.append((const uint8_t*)&f.z, sizeof(float));
+}
+
+static void hash_append_string(MD5Hash& md5, const char *str)
+{
+	if(str)
+		md5.append((const uint8_t*)str, strlen(str) + 1);
+}
+
+static void hash_append_attributes(MD5Hash& md5, AttributeSet& attributes)
+{
+	foreach(Attribute& attr, attributes.attributes) {
+		hash_append_string(md5, attr.name.c_str());
+
+		if(attr.buffer.size() == 0)
+			continue;
+
+		if(attr.data_sizeof() == sizeof(float3)) {
+			float3 *data = (float3*)&attr.buffer[0];
+			size_t size = attr.buffer.size()/sizeof(float3);
+
+			for(size_t i = 0; i < size; i++)
+				hash_append_float3(md5, data[i]);
+		}
+		else
+			md5.append((const uint8_t*)&attr.buffer[0], attr.buffer.size());
+	}
+}
+
+string RenderCheckpoint::scene_hash(Scene *scene)
+{
+	MD5Hash md5;
+	map<Mesh*, int> mesh_index;
+	int num_meshes = 0;
+
+	foreach(Mesh *mesh, scene->meshes) {
+		mesh_index[mesh] = num_meshes++;
+
+		foreach(const float3& co, mesh->verts)
+			hash_append_float3(md5, co);
+		foreach(const Mesh::Triangle& tri, mesh->triangles)
+			hash_append(md5, tri);
+		foreach(uint shader, mesh->shader)
+			hash_append(md5, shader);
+		foreach(const Mesh::CurveKey& key, mesh->curve_keys) {
+			hash_append_float3(md5, key.co);
+			hash_append(md5, key.radius);
+		}
+		foreach(const Mesh::Curve& curve, mesh->curves)
+			hash_append(md5, curve);
+
+		hash_append_attributes(md5, mesh->attributes);
+		hash_append_attributes(md5, mesh->curve_attributes);
+	}
+
+	foreach(Object *object, scene->objects) {
+		hash_append(md5, mesh_index[object->mesh]);
+		hash_append(md5, object->tfm);
+		hash_append(md5, object->visibility);
+		hash_append(md5, object->pass_id);
+		hash_append(md5, object->use_holdout);
+		hash_append(md5, object->use_motion);
+		if(object->use_motion)
+			hash_append(md5, object->motion);
+	}
+
+	foreach(Light *light, scene->lights) {
+		hash_append(md5, light->type);
+		hash_append_float3(md5, light->co);
+		hash_append_float3(md5, light->dir);
+		hash_append(md5, light->size);
+		hash_append_float3(md5, light->axisu);
+		hash_append(md5, light->sizeu);
+		hash_append_float3(md5, light->axisv);
+		hash_append(md5, light->sizev);
+		hash_append(md5, light->spot_angle);
+		hash_append(md5, light->spot_smooth);
+		hash_append(md5, light->cast_shadow);
+		hash_append(md5, light->use_mis);
+		hash_append(md5, light->shader);
+		hash_append(md5, light->samples);
+	}
+
+	foreach(Shader *shader, scene->shaders) {
+		hash_append(md5, shader->use_mis);
+		hash_append(md5, shader->use_transparent_shadow);
+		hash_append(md5, shader->homogeneous_volume);
+
+		if(!shader->graph)
+			continue;
+
+		foreach(ShaderNode *node, shader->graph->nodes) {
+			hash_append_string(md5, node->name.c_str());
+
+			foreach(ShaderInput *input, node->inputs) {
+				hash_append_string(md5, input->name);
+				hash_append_float3(md5, input->value);
+				hash_append_string(md5, input->value_string.c_str());
+
+				if(input->link) {
+					hash_append_string(md5, input->link->parent->name.c_str());
+					hash_append_string(md5, input->link->name);
+				}
+			}
+		}
+	}
+
+	Camera *cam = scene->camera;
+	hash_append(md5, cam->matrix);
+	hash_append(md5, cam->type);
+	hash_append(md5, cam->fov);
+	hash_append(md5, cam->panorama_type);
+	hash_append(md5, cam->fisheye_fov);
+	hash_append(md5, cam->fisheye_lens);
+	hash_append(md5, cam->nearclip);
+	hash_append(md5, cam->farclip);
+	hash_append(md5, cam->aperturesize);
+	hash_append(md5, cam->focaldistance);
+	hash_append(md5, cam->blades);
+	hash_append(md5, cam->bladesrotation);
+	hash_append(md5, cam->viewplane);
+	hash_append(md5, cam->shuttertime);
+
+	Integrator *integrator = scene->integrator;
+	hash_append(md5, integrator->min_bounce);
+	hash_append(md5, integrator->max_bounce);
+	hash_append(md5, integrator->max_diffuse_bounce);
+	hash_append(md5, integrator->max_glossy_bounce);
+	hash_append(md5, integrator->max_transmission_bounce);
+	hash_append(md5, integrator->transparent_min_bounce);
+	hash_append(md5, integrator->transparent_max_bounce);
+	hash_append(md5, integrator->transparent_shadows);
+	hash_append(md5, integrator->no_caustics);
+	hash_append(md5, integrator->filter_glossy);
+	hash_append(md5, integrator->seed);
+	hash_append(md5, integrator->sample_clamp);
+	hash_append(md5, integrator->method);
+	hash_append(md5, integrator->sampling_pattern);
+
+	return md5.get_hex();
+}
+
+CCL_NAMESPACE_END
+
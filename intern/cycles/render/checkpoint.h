@@ -0,0 +1,89 @@
+/*
+ * Copyright 2011-2013 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+#ifndef __CHECKPOINT_H__
+#define __CHECKPOINT_H__
+
+#include "buffers.h"
+
+#include "util_map.h"
+#include "util_string.h"
+#include "util_thread.h"
+#include "util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+class Scene;
+
+/* Render Checkpoint
+ *
+ * Copies of finished and partially sampled tiles of a final render, written
+ * to disk at regular intervals. When the same frame is rendered again after
+ * the render was stopped, tiles continue from the samples in the checkpoint
+ * instead of starting over. The scene is not stored, so the caller must use
+ * a different file when rendering something else, see scene_hash. */
+
+class RenderCheckpoint {
+public:
+	RenderCheckpoint(const string& filepath, double interval);
+	~RenderCheckpoint();
+
+	/* read tiles from an existing file with the same buffer layout */
+	bool load(BufferParams& params);
+
+	/* copy the render buffers of a tile, and write the file when the
+	 * interval passed since the last write */
+	void update_tile(RenderTile& rtile, bool force = false);
+
+	/* copy a tile into the render buffers and advance its start sample to
+	 * continue rendering, returns false if the tile is not in the checkpoint */
+	bool restore_tile(RenderTile& rtile);
+
+	bool write();
+	void remove();
+
+	int num_tiles() { return tiles.size(); }
+
+	/* hash of the synced geometry, objects, lights, camera, shader sockets and
+	 * integrator settings, to tell apart renders of the same file with unsaved
+	 * changes. node settings that are not sockets are not included */
+	static string scene_hash(Scene *scene);
+
+protected:
+	struct Tile {
+		int w, h;
+		int sample;
+		double time;
+		vector<float> buffer;
+
+		Tile() : w(0), h(0), sample(0), time(0.0) {}
+	};
+
+	bool write_file();
+
+	string filepath;
+	double interval;
+	double last_write_time;
+
+	BufferParams params;
+	map<pair<int, int>, Tile> tiles;
+	thread_mutex tiles_mutex;
+};
+
+CCL_NAMESPACE_END
+
+#endif /* __CHECKPOINT_H__ */
+
@@ -0,0 +1,334 @@
+/*
+ * Copyright 2011-2013 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+#include <errno.h>
+#include <stdio.h>
+
+#include "geometry_pager.h"
+
+#include "util_algorithm.h"
+#include "util_foreach.h"
+#include "util_path.h"
+#include "util_time.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+CCL_NAMESPACE_BEGIN
+
+/* interval in seconds between residency checks */
+#define GEOMETRY_PAGER_CHECK_INTERVAL 1.0
+
+GeometryPager::GeometryPager(const string& directory_, size_t memory_limit_)
+{
+	directory = directory_;
+	memory_limit = memory_limit_;
+	last_check_time = 0.0;
+	file_counter = 0;
+}
+
+GeometryPager::~GeometryPager()
+{
+	free();
+}
+
+void *GeometryPager::map(const string& name, void *data, size_t size)
+{
+#ifdef _WIN32
+	return NULL;
+#else
+	thread_scoped_lock lock(pager_mutex);
+
+	string filepath = path_join(directory,
+		string_printf("geometry_%d_%d_%s.bin", (int)getpid(), file_counter++, name.c_str()));
+
+	path_create_directories(filepath);
+
+	int fd = open(filepath.c_str(), O_RDWR|O_CREAT|O_TRUNC, 0600);
+
+	if(fd == -1) {
+		fprintf(stderr, "Failed to open file %s for out-of-core geometry.\n", filepath.c_str());
+		return NULL;
+	}
+
+	/* write in chunks, large writes may be partial */
+	const char *p = (const char*)data;
+	size_t remaining = size;
+	bool ok = true;
+
+	while(remaining > 0) {
+		ssize_t written = write(fd, p, min(remaining, (size_t)1 << 30));
+
+		if(written < 0 && errno == EINTR)
+			continue;
+
+		if(written <= 0) {
+			ok = false;
+			break;
+		}
+
+		p += written;
+		remaining -= written;
+	}
+
+	/* write out to disk, only clean pages can be dropped from the cache */
+	if(ok && fsync(fd) != 0)
+		ok = false;
+
+	void *pointer = (ok)? mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0): MAP_FAILED;
+
+	/* the file stays around until it is unmapped and closed, and is cleaned
+	 * up by the system if we crash */
+	unlink(filepath.c_str());
+
+	if(pointer == MAP_FAILED) {
+		fprintf(stderr, "Failed to map file %s for out-of-core geometry.\n", filepath.c_str());
+		close(fd);
+		return NULL;
+	}
+
+	Mapping mapping;
+	mapping.name = name;
+	mapping.pointer = pointer;
+	mapping.size = size;
+	mapping.fd = fd;
+
+	mappings.push_back(mapping);
+
+	return pointer;
+#endif
+}
+
+void GeometryPager::add_object_range(int object, const string& name, size_t offset, size_t size)
+{
+	thread_scoped_lock lock(pager_mutex);
+
+	if(size == 0)
+		return;
+
+	for(size_t i = 0; i < mappings.size(); i++) {
+		if(mappings[i].name == name && offset + size <= mappings[i].size) {
+			Range range;
+			range.mapping = i;
+			range.offset = offset;
+			range.size = size;
+
+			if(object >= (int)objects.size())
+				objects.resize(object + 1);
+
+			objects[object].ranges.push_back(range);
+			return;
+		}
+	}
+}
+
+size_t GeometryPager::range_resident_size(const Range& range)
+{
+#ifdef _WIN32
+	return 0;
+#else
+	/* query pages in memory, ranges are rounded out to whole pages */
+	size_t page_size = sysconf(_SC_PAGESIZE);
+	size_t start = (size_t)mappings[range.mapping].pointer + range.offset;
+	size_t end = start + range.size;
+
+	start -= start % page_size;
+
+	vector<unsigned char> pages((end - start + page_size - 1)/page_size);
+
+#ifdef __APPLE__
+	if(mincore((void*)start, end - start, (char*)&pages[0]) != 0)
+#else
+	if(mincore((void*)start, end - start, &pages[0]) != 0)
+#endif
+		return 0;
+
+	size_t resident = 0;
+
+	foreach(unsigned char page, pages)
+		if(page & 1)
+			resident += page_size;
+
+	return min(resident, range.size);
+#endif
+}
+
+void GeometryPager::range_evict(const Range& range)
+{
+#ifndef _WIN32
+	/* pages are read back from the file on next access. unmapping them is
+	 * not enough, they also have to be dropped from the file cache */
+	Mapping& mapping = mappings[range.mapping];
+	size_t page_size = sysconf(_SC_PAGESIZE);
+	size_t offset = range.offset - range.offset % page_size;
+	size_t size = range.offset + range.size - offset;
+
+	madvise((char*)mapping.pointer + offset, size, MADV_DONTNEED);
+#ifdef __linux__
+	posix_fadvise(mapping.fd, offset, size, POSIX_FADV_DONTNEED);
+#endif
+#endif
+}
+
+float GeometryPager::object_residency(int object)
+{
+	thread_scoped_lock lock(pager_mutex);
+
+	if(object >= (int)objects.size())
+		return 1.0f;
+
+	size_t size = 0, resident = 0;
+
+	foreach(Range& range, objects[object].ranges) {
+		size += range.size;
+		resident += range_resident_size(range);
+	}
+
+	return (size > 0)? (float)resident/(float)size: 1.0f;
+}
+
+size_t GeometryPager::resident_size()
+{
+	thread_scoped_lock lock(pager_mutex);
+	return mappings_resident_size();
+}
+
+size_t GeometryPager::mappings_resident_size()
+{
+	size_t resident = 0;
+
+	for(size_t i = 0; i < mappings.size(); i++) {
+		Range range;
+		range.mapping = i;
+		range.offset = 0;
+		range.size = mappings[i].size;
+
+		resident += range_resident_size(range);
+	}
+
+	return resident;
+}
+
+size_t GeometryPager::mapped_size()
+{
+	thread_scoped_lock lock(pager_mutex);
+	size_t size = 0;
+
+	foreach(Mapping& mapping, mappings)
+		size += mapping.size;
+
+	return size;
+}
+
+struct GeometryPagerLastUsedCompare {
+	const vector<double>& last_used;
+
+	GeometryPagerLastUsedCompare(const vector<double>& last_used_)
+	: last_used(last_used_) {}
+
+	bool operator()(int a, int b) const
+	{
+		return last_used[a] < last_used[b];
+	}
+};
+
+void GeometryPager::enforce_limit(bool force)
+{
+	thread_scoped_lock lock(pager_mutex);
+	double current_time = time_dt();
+
+	if(memory_limit == 0 || mappings.size() == 0)
+		return;
+	if(!force && current_time - last_check_time < GEOMETRY_PAGER_CHECK_INTERVAL)
+		return;
+
+	last_check_time = current_time;
+
+	size_t total = mappings_resident_size();
+
+	/* objects that gained pages since the last check are in use */
+	vector<double> last_used(objects.size());
+	vector<int> order;
+
+	for(size_t i = 0; i < objects.size(); i++) {
+		Object& object = objects[i];
+		size_t resident = 0;
+
+		foreach(Range& range, object.ranges)
+			resident += range_resident_size(range);
+
+		if(resident > object.resident)
+			object.last_used = current_time;
+
+		object.resident = resident;
+		last_used[i] = object.last_used;
+
+		if(resident > 0)
+			order.push_back(i);
+	}
+
+	if(total <= memory_limit)
+		return;
+
+	/* evict least recently used objects first */
+	std::sort(order.begin(), order.end(), GeometryPagerLastUsedCompare(last_used));
+
+	foreach(int i, order) {
+		if(total <= memory_limit)
+			break;
+
+		Object& object = objects[i];
+
+		foreach(Range& range, object.ranges)
+			range_evict(range);
+
+		total -= min(total, object.resident);
+		object.resident = 0;
+	}
+
+	/* arrays not registered per object, like triangles in the top level BVH */
+	if(total > memory_limit) {
+		for(size_t i = 0; i < mappings.size(); i++) {
+			Range range;
+			range.mapping = i;
+			range.offset = 0;
+			range.size = mappings[i].size;
+
+			range_evict(range);
+		}
+	}
+}
+
+void GeometryPager::free()
+{
+	thread_scoped_lock lock(pager_mutex);
+
+#ifndef _WIN32
+	foreach(Mapping& mapping, mappings) {
+		munmap(mapping.pointer, mapping.size);
+		close(mapping.fd);
+	}
+#endif
+
+	mappings.clear();
+	objects.clear();
+}
+
+CCL_NAMESPACE_END
+
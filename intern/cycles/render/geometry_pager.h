@@ -0,0 +1,121 @@
+/*
+ * Copyright 2011-2013 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+#ifndef __GEOMETRY_PAGER_H__
+#define __GEOMETRY_PAGER_H__
+
+#include "device_memory.h"
+
+#include "util_string.h"
+#include "util_thread.h"
+#include "util_types.h"
+#include "util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Geometry Pager
+ *
+ * Out-of-core storage for packed geometry on the CPU. Arrays are written to
+ * files and memory mapped read-only, so the operating system can drop pages
+ * and read them back from disk when memory runs low. Ranges of the arrays are
+ * registered per object, to track how much of each object is resident, and to
+ * evict objects that are no longer being accessed when the resident size
+ * exceeds the memory limit.
+ *
+ * Arrays are paged only after they are fully packed in memory, so this lowers
+ * the memory used while rendering, not the peak during the scene update.
+ *
+ * Only supported on systems with mmap, elsewhere arrays stay in memory. */
+
+class GeometryPager {
+public:
+	GeometryPager(const string& directory, size_t memory_limit);
+	~GeometryPager();
+
+	/* move array into a mapped file, and make the vector reference it. on
+	 * failure the vector keeps its data in memory and false is returned */
+	template<typename T> bool page(device_vector<T>& mem, const string& name)
+	{
+		if(mem.data_size == 0)
+			return false;
+
+		void *pointer = map(name, (void*)mem.data_pointer, mem.memory_size());
+
+		if(!pointer)
+			return false;
+
+		mem.reference((T*)pointer, mem.data_width, mem.data_height);
+		return true;
+	}
+
+	/* byte range of a paged array used by an object */
+	void add_object_range(int object, const string& name, size_t offset, size_t size);
+
+	/* fraction of the object's ranges that is in memory */
+	float object_residency(int object);
+
+	/* size of all paged arrays in memory */
+	size_t resident_size();
+	size_t mapped_size();
+
+	/* evict objects until the resident size is below the memory limit, checked
+	 * at most once per interval unless forced */
+	void enforce_limit(bool force = false);
+
+	/* unmap all arrays, vectors referencing them must be cleared first */
+	void free();
+
+protected:
+	struct Mapping {
+		string name;
+		void *pointer;
+		size_t size;
+		int fd;
+	};
+
+	struct Range {
+		int mapping;
+		size_t offset;
+		size_t size;
+	};
+
+	struct Object {
+		vector<Range> ranges;
+		size_t resident;
+		double last_used;
+
+		Object() : resident(0), last_used(0.0) {}
+	};
+
+	void *map(const string& name, void *data, size_t size);
+	size_t range_resident_size(const Range& range);
+	size_t mappings_resident_size();
+	void range_evict(const Range& range);
+
+	string directory;
+	size_t memory_limit;
+	double last_check_time;
+	int file_counter;
+
+	vector<Mapping> mappings;
+	vector<Object> objects;
+	thread_mutex pager_mutex;
+};
+
+CCL_NAMESPACE_END
+
+#endif /* __GEOMETRY_PAGER_H__ */
+
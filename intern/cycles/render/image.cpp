@@ -18,6 +18,8 @@
 #include "image.h"
 #include "scene.h"
 
+#include "kernel_image_cache.h"
+
 #include "util_foreach.h"
 #include "util_image.h"
 #include "util_path.h"
@@ -35,18 +37,29 @@ ImageManager::ImageManager()
 	pack_images = false;
 	osl_texture_system = NULL;
 	animation_frame = 0;
-
-	tex_num_images = TEX_NUM_IMAGES;
-	tex_num_float_images = TEX_NUM_FLOAT_IMAGES;
-	tex_image_byte_start = TEX_IMAGE_BYTE_START;
+	use_texture_cache = false;
+	texture_cache_size = 1024;
+
+	tex_num_images[IMAGE_DATA_TYPE_FLOAT4] = TEX_NUM_FLOAT_IMAGES;
+	tex_num_images[IMAGE_DATA_TYPE_BYTE4] = TEX_NUM_IMAGES;
+	tex_num_images[IMAGE_DATA_TYPE_HALF4] = 0;
+	tex_num_images[IMAGE_DATA_TYPE_FLOAT1] = 0;
+	tex_num_images[IMAGE_DATA_TYPE_BYTE1] = 0;
+	tex_num_images[IMAGE_DATA_TYPE_HALF1] = 0;
+
+	tex_start_images[IMAGE_DATA_TYPE_FLOAT4] = 0;
+	tex_start_images[IMAGE_DATA_TYPE_BYTE4] = TEX_IMAGE_BYTE_START;
+	tex_start_images[IMAGE_DATA_TYPE_HALF4] = TEX_IMAGE_HALF4_START;
+	tex_start_images[IMAGE_DATA_TYPE_FLOAT1] = TEX_IMAGE_FLOAT1_START;
+	tex_start_images[IMAGE_DATA_TYPE_BYTE1] = TEX_IMAGE_BYTE1_START;
+	tex_start_images[IMAGE_DATA_TYPE_HALF1] = TEX_IMAGE_HALF1_START;
 }
 
 ImageManager::~ImageManager()
 {
-	for(size_t slot = 0; slot < images.size(); slot++)
-		assert(!images[slot]);
-	for(size_t slot = 0; slot < float_images.size(); slot++)
-		assert(!float_images[slot]);
+	for(int type = 0; type < IMAGE_DATA_NUM_TYPES; type++)
+		for(size_t slot = 0; slot < images[type].size(); slot++)
+			assert(!images[type][slot]);
 }
 
 void ImageManager::set_pack_images(bool pack_images_)
@@ -59,11 +72,23 @@ void ImageManager::set_osl_texture_system(void *texture_system)
 	osl_texture_system = texture_system;
 }
 
+void ImageManager::set_texture_cache(bool use_texture_cache_, int texture_cache_size_)
+{
+	use_texture_cache = use_texture_cache_;
+	texture_cache_size = texture_cache_size_;
+}
+
 void ImageManager::set_extended_image_limits(void)
 {
-	tex_num_images = TEX_EXTENDED_NUM_IMAGES;
-	tex_num_float_images = TEX_EXTENDED_NUM_FLOAT_IMAGES;
-	tex_image_byte_start = TEX_EXTENDED_IMAGE_BYTE_START;
+	tex_num_images[IMAGE_DATA_TYPE_FLOAT4] = TEX_EXTENDED_NUM_FLOAT_IMAGES;
+	tex_num_images[IMAGE_DATA_TYPE_BYTE4] = TEX_EXTENDED_NUM_IMAGES;
+	tex_start_images[IMAGE_DATA_TYPE_BYTE4] = TEX_EXTENDED_IMAGE_BYTE_START;
+
+	/* half float and single channel images are only supported here */
+	tex_num_images[IMAGE_DATA_TYPE_HALF4] = TEX_NUM_HALF4_IMAGES;
+	tex_num_images[IMAGE_DATA_TYPE_FLOAT1] = TEX_NUM_FLOAT1_IMAGES;
+	tex_num_images[IMAGE_DATA_TYPE_BYTE1] = TEX_NUM_BYTE1_IMAGES;
+	tex_num_images[IMAGE_DATA_TYPE_HALF1] = TEX_NUM_HALF1_IMAGES;
 }
 
 bool ImageManager::set_animation_frame_update(int frame)
@@ -71,21 +96,104 @@ bool ImageManager::set_animation_frame_update(int frame)
 	if(frame != animation_frame) {
 		animation_frame = frame;
 
-		for(size_t slot = 0; slot < images.size(); slot++)
-			if(images[slot] && images[slot]->animated)
-				return true;
-
-		for(size_t slot = 0; slot < float_images.size(); slot++)
-			if(float_images[slot] && float_images[slot]->animated)
-				return true;
+		for(int type = 0; type < IMAGE_DATA_NUM_TYPES; type++)
+			for(size_t slot = 0; slot < images[type].size(); slot++)
+				if(images[type][slot] && images[type][slot]->animated)
+					return true;
 	}
 	
 	return false;
 }
 
-bool ImageManager::is_float_image(const string& filename, void *builtin_data, bool& is_linear)
+static const char *image_data_type_name(ImageDataType type)
 {
-	bool is_float = false;
+	switch(type) {
+		case IMAGE_DATA_TYPE_FLOAT4: return "float";
+		case IMAGE_DATA_TYPE_BYTE4: return "byte";
+		case IMAGE_DATA_TYPE_HALF4: return "half4";
+		case IMAGE_DATA_TYPE_FLOAT1: return "float1";
+		case IMAGE_DATA_TYPE_BYTE1: return "byte1";
+		case IMAGE_DATA_TYPE_HALF1: return "half1";
+		default: return "";
+	}
+}
+
+static int image_data_type_channels(ImageDataType type)
+{
+	switch(type) {
+		case IMAGE_DATA_TYPE_FLOAT1:
+		case IMAGE_DATA_TYPE_BYTE1:
+		case IMAGE_DATA_TYPE_HALF1:
+			return 1;
+		default:
+			return 4;
+	}
+}
+
+static TypeDesc image_data_type_format(ImageDataType type)
+{
+	switch(type) {
+		case IMAGE_DATA_TYPE_BYTE4:
+		case IMAGE_DATA_TYPE_BYTE1:
+			return TypeDesc::UINT8;
+		case IMAGE_DATA_TYPE_HALF4:
+		case IMAGE_DATA_TYPE_HALF1:
+			return TypeDesc::HALF;
+		default:
+			return TypeDesc::FLOAT;
+	}
+}
+
+/* store a color in a pixel of the given storage type */
+static void image_store_pixel(uchar *pixel, int channels, float4 f)
+{
+	for(int i = 0; i < channels; i++)
+		pixel[i] = (uchar)(f[i] * 255.0f);
+}
+
+static void image_store_pixel(float *pixel, int channels, float4 f)
+{
+	for(int i = 0; i < channels; i++)
+		pixel[i] = f[i];
+}
+
+static void image_store_pixel(half *pixel, int channels, float4 f)
+{
+	half h[4];
+
+	float4_store_half(h, &f, 1.0f);
+
+	for(int i = 0; i < channels; i++)
+		pixel[i] = h[i];
+}
+
+template<typename StorageType> static StorageType image_storage_one();
+template<> uchar image_storage_one<uchar>() { return 255; }
+template<> float image_storage_one<float>() { return 1.0f; }
+template<> half image_storage_one<half>() { return 0x3C00; }
+
+int ImageManager::type_index_to_slot(int index, ImageDataType type)
+{
+	return tex_start_images[type] + index;
+}
+
+int ImageManager::slot_to_type_index(int slot, ImageDataType *type)
+{
+	for(int i = 0; i < IMAGE_DATA_NUM_TYPES; i++) {
+		if(slot >= tex_start_images[i] && slot < tex_start_images[i] + tex_num_images[i]) {
+			*type = (ImageDataType)i;
+			return slot - tex_start_images[i];
+		}
+	}
+
+	assert(0);
+	*type = IMAGE_DATA_TYPE_BYTE4;
+	return 0;
+}
+
+ImageDataType ImageManager::get_image_type(const string& filename, void *builtin_data, bool& is_float, bool& is_linear)
+{
+	is_float = false;
 	is_linear = false;
 
 	if(builtin_data) {
@@ -97,10 +205,14 @@ bool ImageManager::is_float_image(const string& filename, void *builtin_data, bo
 		if(is_float)
 			is_linear = true;
 
-		return is_float;
+		/* builtin images are always stored as four channel byte or float */
+		return (is_float)? IMAGE_DATA_TYPE_FLOAT4: IMAGE_DATA_TYPE_BYTE4;
 	}
 
 	ImageInput *in = ImageInput::create(filename);
+	size_t basesize = 1;
+	bool is_half = false;
+	int channels = 4;
 
 	if(in) {
 		ImageSpec spec;
@@ -108,17 +220,23 @@ bool ImageManager::is_float_image(const string& filename, void *builtin_data, bo
 		if(in->open(filename, spec)) {
 			/* check the main format, and channel formats;
 			 * if any take up more than one byte, we'll need a float texture slot */
-			if(spec.format.basesize() > 1) {
+			basesize = spec.format.basesize();
+			/* only half float files fit in half storage, 16 bit integers do not */
+			is_half = (spec.format == TypeDesc::HALF);
+
+			for(size_t channel = 0; channel < spec.channelformats.size(); channel++) {
+				if(spec.channelformats[channel].basesize() > basesize)
+					basesize = spec.channelformats[channel].basesize();
+				if(spec.channelformats[channel] != TypeDesc::HALF)
+					is_half = false;
+			}
+
+			if(basesize > 1) {
 				is_float = true;
 				is_linear = true;
 			}
 
-			for(size_t channel = 0; channel < spec.channelformats.size(); channel++) {
-				if(spec.channelformats[channel].basesize() > 1) {
-					is_float = true;
-					is_linear = true;
-				}
-			}
+			channels = spec.nchannels;
 
 			/* basic color space detection, not great but better than nothing
 			 * before we do OpenColorIO integration */
@@ -142,6 +260,23 @@ bool ImageManager::is_float_image(const string& filename, void *builtin_data, bo
 		delete in;
 	}
 
+	/* pick the smallest storage that holds the bit depth and channels of the
+	 * file, when the device supports it; half float images are stored as half */
+	bool extended_types = (tex_num_images[IMAGE_DATA_TYPE_HALF4] > 0);
+	bool single = (extended_types && channels == 1);
+
+	if(!is_float)
+		return (single)? IMAGE_DATA_TYPE_BYTE1: IMAGE_DATA_TYPE_BYTE4;
+	else if(extended_types && is_half)
+		return (single)? IMAGE_DATA_TYPE_HALF1: IMAGE_DATA_TYPE_HALF4;
+	else
+		return (single)? IMAGE_DATA_TYPE_FLOAT1: IMAGE_DATA_TYPE_FLOAT4;
+}
+
+bool ImageManager::is_float_image(const string& filename, void *builtin_data, bool& is_linear)
+{
+	bool is_float;
+	get_image_type(filename, builtin_data, is_float, is_linear);
 	return is_float;
 }
 
@@ -150,128 +285,78 @@ int ImageManager::add_image(const string& filename, void *builtin_data, bool ani
 	Image *img;
 	size_t slot;
 
-	/* load image info and find out if we need a float texture */
-	is_float = (pack_images)? false: is_float_image(filename, builtin_data, is_linear);
-
-	if(is_float) {
-		/* find existing image */
-		for(slot = 0; slot < float_images.size(); slot++) {
-			if(float_images[slot] && float_images[slot]->filename == filename) {
-				float_images[slot]->users++;
-				return slot;
-			}
-		}
+	/* load image info and find out which storage we need */
+	ImageDataType type = IMAGE_DATA_TYPE_BYTE4;
+	is_float = false;
 
-		/* find free slot */
-		for(slot = 0; slot < float_images.size(); slot++) {
-			if(!float_images[slot])
-				break;
-		}
+	if(!pack_images)
+		type = get_image_type(filename, builtin_data, is_float, is_linear);
 
-		if(slot == float_images.size()) {
-			/* max images limit reached */
-			if(float_images.size() == TEX_NUM_FLOAT_IMAGES) {
-				printf("ImageManager::add_image: float image limit reached %d, skipping '%s'\n",
-				       tex_num_float_images, filename.c_str());
-				return -1;
-			}
-
-			float_images.resize(float_images.size() + 1);
+	/* find existing image */
+	for(slot = 0; slot < images[type].size(); slot++) {
+		if(images[type][slot] && images[type][slot]->filename == filename) {
+			images[type][slot]->users++;
+			return type_index_to_slot(slot, type);
 		}
+	}
 
-		/* add new image */
-		img = new Image();
-		img->filename = filename;
-		img->builtin_data = builtin_data;
-		img->need_load = true;
-		img->animated = animated;
-		img->users = 1;
-
-		float_images[slot] = img;
+	/* find free slot */
+	for(slot = 0; slot < images[type].size(); slot++) {
+		if(!images[type][slot])
+			break;
 	}
-	else {
-		for(slot = 0; slot < images.size(); slot++) {
-			if(images[slot] && images[slot]->filename == filename) {
-				images[slot]->users++;
-				return slot+tex_image_byte_start;
-			}
-		}
 
-		/* find free slot */
-		for(slot = 0; slot < images.size(); slot++) {
-			if(!images[slot])
-				break;
+	if(slot == images[type].size()) {
+		/* max images limit reached */
+		if(images[type].size() == tex_num_images[type]) {
+			printf("ImageManager::add_image: %s image limit reached %d, skipping '%s'\n",
+			       image_data_type_name(type), tex_num_images[type], filename.c_str());
+			return -1;
 		}
 
-		if(slot == images.size()) {
-			/* max images limit reached */
-			if(images.size() == tex_num_images) {
-				printf("ImageManager::add_image: byte image limit reached %d, skipping '%s'\n",
-				       tex_num_images, filename.c_str());
-				return -1;
-			}
-
-			images.resize(images.size() + 1);
-		}
+		images[type].resize(images[type].size() + 1);
+	}
 
-		/* add new image */
-		img = new Image();
-		img->filename = filename;
-		img->builtin_data = builtin_data;
-		img->need_load = true;
-		img->animated = animated;
-		img->users = 1;
+	/* add new image */
+	img = new Image();
+	img->filename = filename;
+	img->builtin_data = builtin_data;
+	img->need_load = true;
+	img->animated = animated;
+	img->users = 1;
 
-		images[slot] = img;
+	images[type][slot] = img;
 
-		slot += tex_image_byte_start;
-	}
 	need_update = true;
 
-	return slot;
+	return type_index_to_slot(slot, type);
 }
 
 void ImageManager::remove_image(const string& filename, void *builtin_data)
 {
-	size_t slot;
-
-	for(slot = 0; slot < images.size(); slot++) {
-		if(images[slot] && images[slot]->filename == filename && images[slot]->builtin_data == builtin_data) {
-			/* decrement user count */
-			images[slot]->users--;
-			assert(images[slot]->users >= 0);
+	for(int type = 0; type < IMAGE_DATA_NUM_TYPES; type++) {
+		for(size_t slot = 0; slot < images[type].size(); slot++) {
+			Image *img = images[type][slot];
 
-			/* don't remove immediately, rather do it all together later on. one of
-			 * the reasons for this is that on shader changes we add and remove nodes
-			 * that use them, but we do not want to reload the image all the time. */
-			if(images[slot]->users == 0)
-				need_update = true;
-
-			break;
-		}
-	}
-
-	if(slot == images.size()) {
-		/* see if it's in a float texture slot */
-		for(slot = 0; slot < float_images.size(); slot++) {
-			if(float_images[slot] && float_images[slot]->filename == filename && float_images[slot]->builtin_data == builtin_data) {
+			if(img && img->filename == filename && img->builtin_data == builtin_data) {
 				/* decrement user count */
-				float_images[slot]->users--;
-				assert(float_images[slot]->users >= 0);
+				img->users--;
+				assert(img->users >= 0);
 
 				/* don't remove immediately, rather do it all together later on. one of
 				 * the reasons for this is that on shader changes we add and remove nodes
 				 * that use them, but we do not want to reload the image all the time. */
-				if(float_images[slot]->users == 0)
+				if(img->users == 0)
 					need_update = true;
 
-				break;
+				return;
 			}
 		}
 	}
 }
 
-bool ImageManager::file_load_image(Image *img, device_vector<uchar4>& tex_img)
+template<typename StorageType, typename DeviceType>
+bool ImageManager::file_load_image(Image *img, ImageDataType type, device_vector<DeviceType>& tex_img)
 {
 	if(img->filename == "")
 		return false;
@@ -298,8 +383,13 @@ bool ImageManager::file_load_image(Image *img, device_vector<uchar4>& tex_img)
 		components = spec.nchannels;
 	}
 	else {
-		/* load image using builtin images callbacks */
-		if(!builtin_image_info_cb || !builtin_image_pixels_cb)
+		/* load image using builtin images callbacks, these are only
+		 * stored as four channel byte or float images */
+		if(!builtin_image_info_cb)
+			return false;
+		if(type == IMAGE_DATA_TYPE_FLOAT4 && !builtin_image_float_pixels_cb)
+			return false;
+		if(type == IMAGE_DATA_TYPE_BYTE4 && !builtin_image_pixels_cb)
 			return false;
 
 		bool is_float;
@@ -316,12 +406,13 @@ bool ImageManager::file_load_image(Image *img, device_vector<uchar4>& tex_img)
 		return false;
 	}
 
-	/* read RGBA pixels */
-	uchar *pixels = (uchar*)tex_img.resize(width, height);
-	int scanlinesize = width*components*sizeof(uchar);
+	/* read pixels, single channel storage is only used for single channel files */
+	int channels = image_data_type_channels(type);
+	StorageType *pixels = (StorageType*)tex_img.resize(width, height);
+	int scanlinesize = width*components*sizeof(StorageType);
 
 	if(in) {
-		in->read_image(TypeDesc::UINT8,
+		in->read_image(image_data_type_format(type),
 			(uchar*)pixels + (height-1)*scanlinesize,
 			AutoStride,
 			-scanlinesize,
@@ -330,10 +421,18 @@ bool ImageManager::file_load_image(Image *img, device_vector<uchar4>& tex_img)
 		in->close();
 		delete in;
 	}
+	else if(type == IMAGE_DATA_TYPE_FLOAT4) {
+		builtin_image_float_pixels_cb(img->filename, img->builtin_data, (float*)pixels);
+	}
 	else {
-		builtin_image_pixels_cb(img->filename, img->builtin_data, pixels);
+		builtin_image_pixels_cb(img->filename, img->builtin_data, (uchar*)pixels);
 	}
 
+	if(channels == 1)
+		return true;
+
+	StorageType one = image_storage_one<StorageType>();
+
 	if(components == 2) {
 		for(int i = width*height-1; i >= 0; i--) {
 			pixels[i*4+3] = pixels[i*2+1];
@@ -344,7 +443,7 @@ bool ImageManager::file_load_image(Image *img, device_vector<uchar4>& tex_img)
 	}
 	else if(components == 3) {
 		for(int i = width*height-1; i >= 0; i--) {
-			pixels[i*4+3] = 255;
+			pixels[i*4+3] = one;
 			pixels[i*4+2] = pixels[i*3+2];
 			pixels[i*4+1] = pixels[i*3+1];
 			pixels[i*4+0] = pixels[i*3+0];
@@ -352,7 +451,7 @@ bool ImageManager::file_load_image(Image *img, device_vector<uchar4>& tex_img)
 	}
 	else if(components == 1) {
 		for(int i = width*height-1; i >= 0; i--) {
-			pixels[i*4+3] = 255;
+			pixels[i*4+3] = one;
 			pixels[i*4+2] = pixels[i];
 			pixels[i*4+1] = pixels[i];
 			pixels[i*4+0] = pixels[i];
@@ -362,94 +461,54 @@ bool ImageManager::file_load_image(Image *img, device_vector<uchar4>& tex_img)
 	return true;
 }
 
-bool ImageManager::file_load_float_image(Image *img, device_vector<float4>& tex_img)
+bool ImageManager::cache_load_image(Device *device, Image *img, int slot)
 {
-	if(img->filename == "")
+	/* builtin images are in memory already, and only some devices
+	 * support looking up images on demand */
+	if(!use_texture_cache || img->builtin_data || img->filename == "")
 		return false;
 
-	ImageInput *in = NULL;
-	int width, height, components;
+	KernelImageCache *cache = (KernelImageCache*)device->image_cache_memory();
 
-	if(!img->builtin_data) {
-		/* load image from file through OIIO */
-		in = ImageInput::create(img->filename);
-
-		if(!in)
-			return false;
-
-		ImageSpec spec;
+	if(!cache)
+		return false;
 
-		if(!in->open(img->filename, spec)) {
-			delete in;
-			return false;
-		}
+	return kernel_image_cache_add_image(cache, slot, img->filename.c_str());
+}
 
-		/* we only handle certain number of components */
-		width = spec.width;
-		height = spec.height;
-		components = spec.nchannels;
+template<typename StorageType, typename DeviceType>
+void ImageManager::device_load_image_data(Device *device, Image *img, ImageDataType type, int slot, device_vector<DeviceType>& tex_img)
+{
+	if(tex_img.device_pointer) {
+		thread_scoped_lock device_lock(device_mutex);
+		device->tex_free(tex_img);
 	}
-	else {
-		/* load image using builtin images callbacks */
-		if(!builtin_image_info_cb || !builtin_image_float_pixels_cb)
-			return false;
 
-		bool is_float;
-		builtin_image_info_cb(img->filename, img->builtin_data, is_float, width, height, components);
+	if(cache_load_image(device, img, slot)) {
+		/* tiles are loaded on demand during rendering */
+		tex_img.clear();
+		return;
 	}
 
-	if(!(components >= 1 && components <= 4)) {
-		if(in) {
-			in->close();
-			delete in;
-		}
-		return false;
+	if(!file_load_image<StorageType>(img, type, tex_img)) {
+		/* on failure to load, we set a 1x1 pixels pink image */
+		StorageType *pixels = (StorageType*)tex_img.resize(1, 1);
+		float4 missing = make_float4(TEX_IMAGE_MISSING_R, TEX_IMAGE_MISSING_G, TEX_IMAGE_MISSING_B, TEX_IMAGE_MISSING_A);
+
+		image_store_pixel(pixels, image_data_type_channels(type), missing);
 	}
 
-	/* read RGBA pixels */
-	float *pixels = (float*)tex_img.resize(width, height);
-	int scanlinesize = width*components*sizeof(float);
+	string name;
 
-	if(in) {
-		in->read_image(TypeDesc::FLOAT,
-			(uchar*)pixels + (height-1)*scanlinesize,
-			AutoStride,
-			-scanlinesize,
-			AutoStride);
+	if(type == IMAGE_DATA_TYPE_BYTE4)
+		name = string_printf("__tex_image_%03d", slot);
+	else
+		name = string_printf("__tex_image_%s_%03d", image_data_type_name(type), slot);
 
-		in->close();
-		delete in;
-	}
-	else {
-		builtin_image_float_pixels_cb(img->filename, img->builtin_data, pixels);
+	if(!pack_images) {
+		thread_scoped_lock device_lock(device_mutex);
+		device->tex_alloc(name.c_str(), tex_img, true, true);
 	}
-
-	if(components == 2) {
-		for(int i = width*height-1; i >= 0; i--) {
-			pixels[i*4+3] = pixels[i*2+1];
-			pixels[i*4+2] = pixels[i*2+0];
-			pixels[i*4+1] = pixels[i*2+0];
-			pixels[i*4+0] = pixels[i*2+0];
-		}
-	}
-	else if(components == 3) {
-		for(int i = width*height-1; i >= 0; i--) {
-			pixels[i*4+3] = 1.0f;
-			pixels[i*4+2] = pixels[i*3+2];
-			pixels[i*4+1] = pixels[i*3+1];
-			pixels[i*4+0] = pixels[i*3+0];
-		}
-	}
-	else if(components == 1) {
-		for(int i = width*height-1; i >= 0; i--) {
-			pixels[i*4+3] = 1.0f;
-			pixels[i*4+2] = pixels[i];
-			pixels[i*4+1] = pixels[i];
-			pixels[i*4+0] = pixels[i];
-		}
-	}
-
-	return true;
 }
 
 void ImageManager::device_load_image(Device *device, DeviceScene *dscene, int slot, Progress *progress)
@@ -459,130 +518,94 @@ void ImageManager::device_load_image(Device *device, DeviceScene *dscene, int sl
 	if(osl_texture_system)
 		return;
 
-	Image *img;
-	bool is_float;
-
-	if(slot >= tex_image_byte_start) {
-		img = images[slot - tex_image_byte_start];
-		is_float = false;
-	}
-	else {
-		img = float_images[slot];
-		is_float = true;
-	}
-
-	if(is_float) {
-		string filename = path_filename(float_images[slot]->filename);
-		progress->set_status("Updating Images", "Loading " + filename);
-
-		device_vector<float4>& tex_img = dscene->tex_float_image[slot];
-
-		if(tex_img.device_pointer) {
-			thread_scoped_lock device_lock(device_mutex);
-			device->tex_free(tex_img);
-		}
-
-		if(!file_load_float_image(img, tex_img)) {
-			/* on failure to load, we set a 1x1 pixels pink image */
-			float *pixels = (float*)tex_img.resize(1, 1);
+	ImageDataType type;
+	int index = slot_to_type_index(slot, &type);
+	Image *img = images[type][index];
 
-			pixels[0] = TEX_IMAGE_MISSING_R;
-			pixels[1] = TEX_IMAGE_MISSING_G;
-			pixels[2] = TEX_IMAGE_MISSING_B;
-			pixels[3] = TEX_IMAGE_MISSING_A;
-		}
-
-		string name;
+	string filename = path_filename(img->filename);
+	progress->set_status("Updating Images", "Loading " + filename);
 
-		if(slot >= 10) name = string_printf("__tex_image_float_0%d", slot);
-		else name = string_printf("__tex_image_float_00%d", slot);
-
-		if(!pack_images) {
-			thread_scoped_lock device_lock(device_mutex);
-			device->tex_alloc(name.c_str(), tex_img, true, true);
-		}
+	switch(type) {
+		case IMAGE_DATA_TYPE_FLOAT4:
+			device_load_image_data<float>(device, img, type, slot, dscene->tex_float_image[index]);
+			break;
+		case IMAGE_DATA_TYPE_BYTE4:
+			device_load_image_data<uchar>(device, img, type, slot, dscene->tex_image[index]);
+			break;
+		case IMAGE_DATA_TYPE_HALF4:
+			device_load_image_data<half>(device, img, type, slot, dscene->tex_half4_image[index]);
+			break;
+		case IMAGE_DATA_TYPE_FLOAT1:
+			device_load_image_data<float>(device, img, type, slot, dscene->tex_float1_image[index]);
+			break;
+		case IMAGE_DATA_TYPE_BYTE1:
+			device_load_image_data<uchar>(device, img, type, slot, dscene->tex_byte1_image[index]);
+			break;
+		case IMAGE_DATA_TYPE_HALF1:
+			device_load_image_data<half>(device, img, type, slot, dscene->tex_half1_image[index]);
+			break;
+		default:
+			break;
 	}
-	else {
-		string filename = path_filename(images[slot - tex_image_byte_start]->filename);
-		progress->set_status("Updating Images", "Loading " + filename);
-
-		device_vector<uchar4>& tex_img = dscene->tex_image[slot - tex_image_byte_start];
 
-		if(tex_img.device_pointer) {
-			thread_scoped_lock device_lock(device_mutex);
-			device->tex_free(tex_img);
-		}
-
-		if(!file_load_image(img, tex_img)) {
-			/* on failure to load, we set a 1x1 pixels pink image */
-			uchar *pixels = (uchar*)tex_img.resize(1, 1);
-
-			pixels[0] = (TEX_IMAGE_MISSING_R * 255);
-			pixels[1] = (TEX_IMAGE_MISSING_G * 255);
-			pixels[2] = (TEX_IMAGE_MISSING_B * 255);
-			pixels[3] = (TEX_IMAGE_MISSING_A * 255);
-		}
-
-		string name;
-
-		if(slot >= 10) name = string_printf("__tex_image_0%d", slot);
-		else name = string_printf("__tex_image_00%d", slot);
+	img->need_load = false;
+}
 
-		if(!pack_images) {
-			thread_scoped_lock device_lock(device_mutex);
-			device->tex_alloc(name.c_str(), tex_img, true, true);
-		}
+template<typename DeviceType>
+void ImageManager::device_free_image_data(Device *device, device_vector<DeviceType>& tex_img)
+{
+	if(tex_img.device_pointer) {
+		thread_scoped_lock device_lock(device_mutex);
+		device->tex_free(tex_img);
 	}
 
-	img->need_load = false;
+	tex_img.clear();
 }
 
 void ImageManager::device_free_image(Device *device, DeviceScene *dscene, int slot)
 {
-	Image *img;
-	bool is_float;
-
-	if(slot >= tex_image_byte_start) {
-		img = images[slot - tex_image_byte_start];
-		is_float = false;
-	}
-	else {
-		img = float_images[slot];
-		is_float = true;
-	}
+	ImageDataType type;
+	int index = slot_to_type_index(slot, &type);
+	Image *img = images[type][index];
 
 	if(img) {
+		KernelImageCache *cache = (KernelImageCache*)device->image_cache_memory();
+
+		if(cache)
+			kernel_image_cache_remove_image(cache, slot);
+
 		if(osl_texture_system) {
 #ifdef WITH_OSL
-			ustring filename(images[slot]->filename);
+			ustring filename(img->filename);
 			((OSL::TextureSystem*)osl_texture_system)->invalidate(filename);
 #endif
 		}
-		else if(is_float) {
-			device_vector<float4>& tex_img = dscene->tex_float_image[slot];
-
-			if(tex_img.device_pointer) {
-				thread_scoped_lock device_lock(device_mutex);
-				device->tex_free(tex_img);
-			}
-
-			tex_img.clear();
-
-			delete float_images[slot];
-			float_images[slot] = NULL;
-		}
 		else {
-			device_vector<uchar4>& tex_img = dscene->tex_image[slot - tex_image_byte_start];
-
-			if(tex_img.device_pointer) {
-				thread_scoped_lock device_lock(device_mutex);
-				device->tex_free(tex_img);
+			switch(type) {
+				case IMAGE_DATA_TYPE_FLOAT4:
+					device_free_image_data(device, dscene->tex_float_image[index]);
+					break;
+				case IMAGE_DATA_TYPE_BYTE4:
+					device_free_image_data(device, dscene->tex_image[index]);
+					break;
+				case IMAGE_DATA_TYPE_HALF4:
+					device_free_image_data(device, dscene->tex_half4_image[index]);
+					break;
+				case IMAGE_DATA_TYPE_FLOAT1:
+					device_free_image_data(device, dscene->tex_float1_image[index]);
+					break;
+				case IMAGE_DATA_TYPE_BYTE1:
+					device_free_image_data(device, dscene->tex_byte1_image[index]);
+					break;
+				case IMAGE_DATA_TYPE_HALF1:
+					device_free_image_data(device, dscene->tex_half1_image[index]);
+					break;
+				default:
+					break;
 			}
 
-			tex_img.clear();
-
-			delete images[slot - tex_image_byte_start];
-			images[slot - tex_image_byte_start] = NULL;
+			delete img;
+			images[type][index] = NULL;
 		}
 	}
 }
@@ -592,31 +615,27 @@ void ImageManager::device_update(Device *device, DeviceScene *dscene, Progress&
 	if(!need_update)
 		return;
 
-	TaskPool pool;
+	KernelImageCache *cache = (KernelImageCache*)device->image_cache_memory();
 
-	for(size_t slot = 0; slot < images.size(); slot++) {
-		if(!images[slot])
-			continue;
+	if(cache && use_texture_cache)
+		kernel_image_cache_set_max_memory(cache, texture_cache_size);
 
-		if(images[slot]->users == 0) {
-			device_free_image(device, dscene, slot + tex_image_byte_start);
-		}
-		else if(images[slot]->need_load) {
-			if(!osl_texture_system) 
-				pool.push(function_bind(&ImageManager::device_load_image, this, device, dscene, slot + tex_image_byte_start, &progress));
-		}
-	}
+	TaskPool pool;
 
-	for(size_t slot = 0; slot < float_images.size(); slot++) {
-		if(!float_images[slot])
-			continue;
+	for(int type = 0; type < IMAGE_DATA_NUM_TYPES; type++) {
+		for(size_t slot = 0; slot < images[type].size(); slot++) {
+			if(!images[type][slot])
+				continue;
 
-		if(float_images[slot]->users == 0) {
-			device_free_image(device, dscene, slot);
-		}
-		else if(float_images[slot]->need_load) {
-			if(!osl_texture_system) 
-				pool.push(function_bind(&ImageManager::device_load_image, this, device, dscene, slot, &progress));
+			int tex_slot = type_index_to_slot(slot, (ImageDataType)type);
+
+			if(images[type][slot]->users == 0) {
+				device_free_image(device, dscene, tex_slot);
+			}
+			else if(images[type][slot]->need_load) {
+				if(!osl_texture_system) 
+					pool.push(function_bind(&ImageManager::device_load_image, this, device, dscene, tex_slot, &progress));
+			}
 		}
 	}
 
@@ -632,23 +651,24 @@ void ImageManager::device_pack_images(Device *device, DeviceScene *dscene, Progr
 {
 	/* for OpenCL, we pack all image textures inside a single big texture, and
 	 * will do our own interpolation in the kernel */
+	vector<Image*>& byte_images = images[IMAGE_DATA_TYPE_BYTE4];
 	size_t size = 0;
 
-	for(size_t slot = 0; slot < images.size(); slot++) {
-		if(!images[slot])
+	for(size_t slot = 0; slot < byte_images.size(); slot++) {
+		if(!byte_images[slot])
 			continue;
 
 		device_vector<uchar4>& tex_img = dscene->tex_image[slot];
 		size += tex_img.size();
 	}
 
-	uint4 *info = dscene->tex_image_packed_info.resize(images.size());
+	uint4 *info = dscene->tex_image_packed_info.resize(byte_images.size());
 	uchar4 *pixels = dscene->tex_image_packed.resize(size);
 
 	size_t offset = 0;
 
-	for(size_t slot = 0; slot < images.size(); slot++) {
-		if(!images[slot])
+	for(size_t slot = 0; slot < byte_images.size(); slot++) {
+		if(!byte_images[slot])
 			continue;
 
 		device_vector<uchar4>& tex_img = dscene->tex_image[slot];
@@ -667,19 +687,18 @@ void ImageManager::device_pack_images(Device *device, DeviceScene *dscene, Progr
 
 void ImageManager::device_free(Device *device, DeviceScene *dscene)
 {
-	for(size_t slot = 0; slot < images.size(); slot++)
-		device_free_image(device, dscene, slot + tex_image_byte_start);
-	for(size_t slot = 0; slot < float_images.size(); slot++)
-		device_free_image(device, dscene, slot);
+	for(int type = 0; type < IMAGE_DATA_NUM_TYPES; type++) {
+		for(size_t slot = 0; slot < images[type].size(); slot++)
+			device_free_image(device, dscene, type_index_to_slot(slot, (ImageDataType)type));
+
+		images[type].clear();
+	}
 
 	device->tex_free(dscene->tex_image_packed);
 	device->tex_free(dscene->tex_image_packed_info);
 
 	dscene->tex_image_packed.clear();
 	dscene->tex_image_packed_info.clear();
-
-	images.clear();
-	float_images.clear();
 }
 
 CCL_NAMESPACE_END
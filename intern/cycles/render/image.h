@@ -34,6 +34,19 @@ CCL_NAMESPACE_BEGIN
 #define TEX_EXTENDED_NUM_IMAGES			512
 #define TEX_EXTENDED_IMAGE_BYTE_START	TEX_EXTENDED_NUM_FLOAT_IMAGES
 
+/* storage of image pixels on the device, half float and single channel
+ * images are only used with the extended image limits of the CPU */
+enum ImageDataType {
+	IMAGE_DATA_TYPE_FLOAT4 = 0,
+	IMAGE_DATA_TYPE_BYTE4 = 1,
+	IMAGE_DATA_TYPE_HALF4 = 2,
+	IMAGE_DATA_TYPE_FLOAT1 = 3,
+	IMAGE_DATA_TYPE_BYTE1 = 4,
+	IMAGE_DATA_TYPE_HALF1 = 5,
+
+	IMAGE_DATA_NUM_TYPES
+};
+
 /* color to use when textures are not found */
 #define TEX_IMAGE_MISSING_R 1
 #define TEX_IMAGE_MISSING_G 0
@@ -57,6 +70,7 @@ public:
 	void device_free(Device *device, DeviceScene *dscene);
 
 	void set_osl_texture_system(void *texture_system);
+	void set_texture_cache(bool use_texture_cache, int texture_cache_size);
 	void set_pack_images(bool pack_images_);
 	void set_extended_image_limits(void);
 	bool set_animation_frame_update(int frame);
@@ -67,9 +81,8 @@ public:
 	boost::function<bool(const string &filename, void *data, unsigned char *pixels)> builtin_image_pixels_cb;
 	boost::function<bool(const string &filename, void *data, float *pixels)> builtin_image_float_pixels_cb;
 private:
-	int tex_num_images;
-	int tex_num_float_images;
-	int tex_image_byte_start;
+	int tex_num_images[IMAGE_DATA_NUM_TYPES];
+	int tex_start_images[IMAGE_DATA_NUM_TYPES];
 	thread_mutex device_mutex;
 	int animation_frame;
 
@@ -82,16 +95,26 @@ private:
 		int users;
 	};
 
-	vector<Image*> images;
-	vector<Image*> float_images;
+	vector<Image*> images[IMAGE_DATA_NUM_TYPES];
 	void *osl_texture_system;
 	bool pack_images;
+	bool use_texture_cache;
+	int texture_cache_size;
+
+	ImageDataType get_image_type(const string& filename, void *builtin_data, bool& is_float, bool& is_linear);
+	int type_index_to_slot(int index, ImageDataType type);
+	int slot_to_type_index(int slot, ImageDataType *type);
 
-	bool file_load_image(Image *img, device_vector<uchar4>& tex_img);
-	bool file_load_float_image(Image *img, device_vector<float4>& tex_img);
+	bool cache_load_image(Device *device, Image *img, int slot);
+	template<typename StorageType, typename DeviceType>
+	bool file_load_image(Image *img, ImageDataType type, device_vector<DeviceType>& tex_img);
 
 	void device_load_image(Device *device, DeviceScene *dscene, int slot, Progress *progess);
+	template<typename StorageType, typename DeviceType>
+	void device_load_image_data(Device *device, Image *img, ImageDataType type, int slot, device_vector<DeviceType>& tex_img);
 	void device_free_image(Device *device, DeviceScene *dscene, int slot);
+	template<typename DeviceType>
+	void device_free_image_data(Device *device, device_vector<DeviceType>& tex_img);
 
 	void device_pack_images(Device *device, DeviceScene *dscene, Progress& progess);
 };
@@ -66,6 +66,11 @@ public:
 
 	SamplingPattern sampling_pattern;
 
+	float adaptive_threshold;
+	int adaptive_min_samples;
+
+	bool use_light_tree;
+
 	bool need_update;
 
 	Integrator();
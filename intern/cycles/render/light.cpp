@@ -18,7 +18,9 @@
 #include "device.h"
 #include "integrator.h"
 #include "film.h"
+#include "graph.h"
 #include "light.h"
+#include "light_tree.h"
 #include "mesh.h"
 #include "object.h"
 #include "scene.h"
@@ -93,6 +95,40 @@ static void shade_background_pixels(Device *device, DeviceScene *dscene, int res
 	}
 }
 
+/* Emission Estimate
+ *
+ * Rough strength of a shader for the light tree, only known when the output
+ * is directly connected to an emission or background node. */
+
+static float shader_emission_estimate(Shader *shader)
+{
+	ShaderGraph *graph = shader->graph;
+
+	if(!graph)
+		return 1.0f;
+
+	ShaderInput *surface_in = graph->output()->input("Surface");
+
+	if(!surface_in || !surface_in->link)
+		return 1.0f;
+
+	ShaderNode *node = surface_in->link->parent;
+
+	if(node->name != "emission" && node->name != "background")
+		return 1.0f;
+
+	ShaderInput *color_in = node->input("Color");
+	ShaderInput *strength_in = node->input("Strength");
+	float estimate = 1.0f;
+
+	if(color_in && !color_in->link)
+		estimate *= average(color_in->value);
+	if(strength_in && !strength_in->link)
+		estimate *= strength_in->value.x;
+
+	return max(estimate, 0.0f);
+}
+
 /* Light */
 
 Light::Light()
@@ -196,6 +232,17 @@ void LightManager::device_update_distribution(Device *device, DeviceScene *dscen
 	float4 *distribution = dscene->light_distribution.resize(num_distribution + 1);
 	float totarea = 0.0f;
 
+	/* light tree emitters */
+	bool use_light_tree = scene->integrator->use_light_tree;
+	vector<LightTreeEmitter> tree_triangles;
+	vector<LightTreeEmitter> tree_lamps;
+	vector<float> shader_estimate;
+
+	if(use_light_tree) {
+		foreach(Shader *shader, scene->shaders)
+			shader_estimate.push_back(shader_emission_estimate(shader));
+	}
+
 	/* triangles */
 	size_t offset = 0;
 	int j = 0;
@@ -264,7 +311,18 @@ void LightManager::device_update_distribution(Device *device, DeviceScene *dscen
 						p3 = transform_point(&tfm, p3);
 					}
 
-					totarea += triangle_area(p1, p2, p3);
+					float area = triangle_area(p1, p2, p3);
+					totarea += area;
+
+					if(use_light_tree) {
+						BoundBox bounds = BoundBox::empty;
+						bounds.grow(p1);
+						bounds.grow(p2);
+						bounds.grow(p3);
+
+						float energy = area*shader_estimate[mesh->shader[i]];
+						tree_triangles.push_back(LightTreeEmitter(bounds, energy, offset - 1));
+					}
 				}
 			}
 
@@ -327,6 +385,26 @@ void LightManager::device_update_distribution(Device *device, DeviceScene *dscen
 			use_lamp_mis = true;
 		if(light->type == LIGHT_BACKGROUND)
 			num_background_lights++;
+
+		if(use_light_tree) {
+			BoundBox bounds = BoundBox::empty;
+
+			if(light->type == LIGHT_POINT || light->type == LIGHT_SPOT) {
+				bounds.grow(light->co, light->size);
+			}
+			else if(light->type == LIGHT_AREA) {
+				float3 axisu = light->axisu*(light->sizeu*light->size);
+				float3 axisv = light->axisv*(light->sizev*light->size);
+
+				bounds.grow(light->co + 0.5f*(axisu + axisv));
+				bounds.grow(light->co + 0.5f*(axisu - axisv));
+				bounds.grow(light->co - 0.5f*(axisu + axisv));
+				bounds.grow(light->co - 0.5f*(axisu - axisv));
+			}
+
+			float energy = shader_estimate[light->shader];
+			tree_lamps.push_back(LightTreeEmitter(bounds, energy, offset));
+		}
 	}
 
 	/* normalize cumulative distribution functions */
@@ -388,9 +466,36 @@ void LightManager::device_update_distribution(Device *device, DeviceScene *dscen
 
 		/* CDF */
 		device->tex_alloc("__light_distribution", dscene->light_distribution);
+
+		/* light tree, with triangles and lamps in separate subtrees that are
+		 * picked with the same probability as in the distribution */
+		kintegrator->use_light_tree = false;
+		kintegrator->light_tree_lamps = 0;
+		kintegrator->light_tree_triangles_pdf = 0.0f;
+
+		if(use_light_tree) {
+			vector<float4> nodes;
+
+			LightTree::build(tree_triangles, nodes);
+			int lamps_root = LightTree::build(tree_lamps, nodes);
+
+			if(progress.get_cancel()) return;
+
+			kintegrator->use_light_tree = true;
+			kintegrator->light_tree_lamps = max(lamps_root, 0);
+			kintegrator->light_tree_triangles_pdf = trianglearea/totarea;
+
+			float4 *tree_nodes = dscene->light_tree_nodes.resize(nodes.size());
+			memcpy(tree_nodes, &nodes[0], sizeof(float4)*nodes.size());
+
+			device->tex_alloc("__light_tree_nodes", dscene->light_tree_nodes);
+		}
 	}
 	else {
 		dscene->light_distribution.clear();
+		dscene->light_tree_nodes.clear();
+
+		kintegrator->use_light_tree = false;
 
 		kintegrator->num_distribution = 0;
 		kintegrator->num_all_lights = 0;
@@ -666,11 +771,13 @@ void LightManager::device_free(Device *device, DeviceScene *dscene)
 {
 	device->tex_free(dscene->light_distribution);
 	device->tex_free(dscene->light_data);
+	device->tex_free(dscene->light_tree_nodes);
 	device->tex_free(dscene->light_background_marginal_cdf);
 	device->tex_free(dscene->light_background_conditional_cdf);
 
 	dscene->light_distribution.clear();
 	dscene->light_data.clear();
+	dscene->light_tree_nodes.clear();
 	dscene->light_background_marginal_cdf.clear();
 	dscene->light_background_conditional_cdf.clear();
 }
@@ -0,0 +1,130 @@
+/*
+ * Copyright 2011-2013 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+#include "kernel_types.h"
+
+#include "light_tree.h"
+
+#include "util_algorithm.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* same workaround for x86 extended float precision as in bvh_sort.cpp */
+#if !defined(__i386__)
+#define NO_EXTENDED_PRECISION
+#else
+#define NO_EXTENDED_PRECISION volatile
+#endif
+
+struct LightTreeEmitterCompare {
+public:
+	int dim;
+
+	LightTreeEmitterCompare(int dim_)
+	{
+		dim = dim_;
+	}
+
+	bool operator()(const LightTreeEmitter& a, const LightTreeEmitter& b) const
+	{
+		NO_EXTENDED_PRECISION float ca = a.bounds.min[dim] + a.bounds.max[dim];
+		NO_EXTENDED_PRECISION float cb = b.bounds.min[dim] + b.bounds.max[dim];
+
+		if(ca < cb) return true;
+		else if(ca > cb) return false;
+
+		return a.distribution_index < b.distribution_index;
+	}
+};
+
+static bool light_tree_emitter_is_finite(const LightTreeEmitter& emitter)
+{
+	return !emitter.is_infinite();
+}
+
+int LightTree::build(vector<LightTreeEmitter>& emitters, vector<float4>& nodes)
+{
+	if(emitters.size() == 0)
+		return -1;
+
+	return recurse(emitters, 0, emitters.size(), nodes);
+}
+
+int LightTree::recurse(vector<LightTreeEmitter>& emitters, int start, int end, vector<float4>& nodes)
+{
+	int index = nodes.size()/LIGHT_TREE_NODE_SIZE;
+	nodes.resize(nodes.size() + LIGHT_TREE_NODE_SIZE);
+
+	/* bounds of finite emitters, and energy */
+	BoundBox bounds = BoundBox::empty;
+	BoundBox centroid_bounds = BoundBox::empty;
+	float energy = 0.0f;
+	int num_finite = 0;
+
+	for(int i = start; i < end; i++) {
+		LightTreeEmitter& emitter = emitters[i];
+
+		if(!emitter.is_infinite()) {
+			bounds.grow(emitter.bounds);
+			centroid_bounds.grow(emitter.centroid());
+			num_finite++;
+		}
+
+		energy += emitter.energy;
+	}
+
+	int child;
+
+	if(end - start == 1) {
+		/* leaf */
+		child = ~emitters[start].distribution_index;
+	}
+	else {
+		int mid;
+
+		if(num_finite > 0 && num_finite < end - start) {
+			/* separate distant and background lights from the others first, so
+			 * nodes never mix importance with and without distance falloff */
+			std::stable_partition(emitters.begin() + start, emitters.begin() + end,
+				light_tree_emitter_is_finite);
+			mid = start + num_finite;
+		}
+		else {
+			/* median split along the largest centroid extent */
+			mid = (start + end)/2;
+
+			if(num_finite > 0) {
+				float3 size = centroid_bounds.size();
+				int dim = (size.x > size.y)? ((size.x > size.z)? 0: 2): ((size.y > size.z)? 1: 2);
+
+				std::nth_element(emitters.begin() + start, emitters.begin() + mid,
+					emitters.begin() + end, LightTreeEmitterCompare(dim));
+			}
+		}
+
+		/* first child directly follows this node */
+		recurse(emitters, start, mid, nodes);
+		child = recurse(emitters, mid, end, nodes);
+	}
+
+	nodes[index*LIGHT_TREE_NODE_SIZE + 0] = make_float4(bounds.min.x, bounds.min.y, bounds.min.z, energy);
+	nodes[index*LIGHT_TREE_NODE_SIZE + 1] = make_float4(bounds.max.x, bounds.max.y, bounds.max.z, __int_as_float(child));
+
+	return index;
+}
+
+CCL_NAMESPACE_END
+
@@ -0,0 +1,65 @@
+/*
+ * Copyright 2011-2013 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+#ifndef __LIGHT_TREE_H__
+#define __LIGHT_TREE_H__
+
+#include "util_boundbox.h"
+#include "util_types.h"
+#include "util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Light Tree Emitter
+ *
+ * Emissive triangle or lamp, referring to its index in the light distribution.
+ * Distant and background lights have empty bounds, their importance does not
+ * depend on the shading point. */
+
+struct LightTreeEmitter {
+	BoundBox bounds;
+	float energy;
+	int distribution_index;
+
+	LightTreeEmitter(const BoundBox& bounds_, float energy_, int distribution_index_)
+	: bounds(bounds_), energy(energy_), distribution_index(distribution_index_) {}
+
+	bool is_infinite() const { return !bounds.valid(); }
+	float3 centroid() const { return bounds.center(); }
+};
+
+/* Light Tree
+ *
+ * Binary tree over emitters with their bounds and total energy in each node,
+ * for picking a light proportional to its estimated contribution at the
+ * shading point. Nodes are stored depth first, so the first child directly
+ * follows its parent, see kernel_light.h for the layout. Each leaf holds a
+ * single emitter. */
+
+class LightTree {
+public:
+	/* build tree and append nodes, returns index of the root node or -1 when
+	 * there are no emitters */
+	static int build(vector<LightTreeEmitter>& emitters, vector<float4>& nodes);
+
+protected:
+	static int recurse(vector<LightTreeEmitter>& emitters, int start, int end, vector<float4>& nodes);
+};
+
+CCL_NAMESPACE_END
+
+#endif /* __LIGHT_TREE_H__ */
+
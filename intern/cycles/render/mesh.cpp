@@ -19,6 +19,7 @@
 
 #include "camera.h"
 #include "device.h"
+#include "geometry_pager.h"
 #include "shader.h"
 #include "light.h"
 #include "mesh.h"
@@ -29,6 +30,7 @@
 
 #include "util_cache.h"
 #include "util_foreach.h"
+#include "util_path.h"
 #include "util_progress.h"
 #include "util_set.h"
 
@@ -435,12 +437,26 @@ void Mesh::tag_update(Scene *scene, bool rebuild)
 MeshManager::MeshManager()
 {
 	bvh = NULL;
+	geometry_pager = NULL;
 	need_update = true;
+	need_bvh_rebuild = true;
 }
 
 MeshManager::~MeshManager()
 {
 	delete bvh;
+	delete geometry_pager;
+}
+
+void MeshManager::set_out_of_core(bool use_out_of_core, const string& directory, int memory_limit)
+{
+	delete geometry_pager;
+	geometry_pager = NULL;
+
+	if(use_out_of_core) {
+		string path = (directory == "")? path_user_get("geometry"): directory;
+		geometry_pager = new GeometryPager(path, (size_t)memory_limit*1024*1024);
+	}
 }
 
 void MeshManager::update_osl_attributes(Device *device, Scene *scene, vector<AttributeRequestSet>& mesh_attributes)
@@ -743,10 +759,14 @@ void MeshManager::device_update_attributes(Device *device, DeviceScene *dscene,
 
 	if(attr_float.size()) {
 		dscene->attributes_float.copy(&attr_float[0], attr_float.size());
+		if(geometry_pager)
+			geometry_pager->page(dscene->attributes_float, "attributes_float");
 		device->tex_alloc("__attributes_float", dscene->attributes_float);
 	}
 	if(attr_float3.size()) {
 		dscene->attributes_float3.copy(&attr_float3[0], attr_float3.size());
+		if(geometry_pager)
+			geometry_pager->page(dscene->attributes_float3, "attributes_float3");
 		device->tex_alloc("__attributes_float3", dscene->attributes_float3);
 	}
 }
@@ -793,6 +813,13 @@ void MeshManager::device_update_mesh(Device *device, DeviceScene *dscene, Scene
 		/* vertex coordinates */
 		progress.set_status("Updating Mesh", "Copying Mesh to device");
 
+		if(geometry_pager) {
+			geometry_pager->page(dscene->tri_normal, "tri_normal");
+			geometry_pager->page(dscene->tri_vnormal, "tri_vnormal");
+			geometry_pager->page(dscene->tri_verts, "tri_verts");
+			geometry_pager->page(dscene->tri_vindex, "tri_vindex");
+		}
+
 		device->tex_alloc("__tri_normal", dscene->tri_normal);
 		device->tex_alloc("__tri_vnormal", dscene->tri_vnormal);
 		device->tex_alloc("__tri_verts", dscene->tri_verts);
@@ -810,28 +837,73 @@ void MeshManager::device_update_mesh(Device *device, DeviceScene *dscene, Scene
 			if(progress.get_cancel()) return;
 		}
 
+		if(geometry_pager) {
+			geometry_pager->page(dscene->curve_keys, "curve_keys");
+			geometry_pager->page(dscene->curves, "curves");
+		}
+
 		device->tex_alloc("__curve_keys", dscene->curve_keys);
 		device->tex_alloc("__curves", dscene->curves);
 	}
 }
 
+bool MeshManager::bvh_objects_modified(Scene *scene)
+{
+	if(bvh_objects.size() != scene->objects.size())
+		return true;
+
+	for(size_t i = 0; i < bvh_objects.size(); i++) {
+		Object *object = scene->objects[i];
+
+		if(bvh_objects[i].object != object ||
+		   bvh_objects[i].mesh != object->mesh ||
+		   bvh_objects[i].transform_applied != object->mesh->transform_applied)
+			return true;
+	}
+
+	return false;
+}
+
 void MeshManager::device_update_bvh(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress)
 {
-	/* bvh build */
-	progress.set_status("Updating Scene BVH", "Building");
+	if(bvh && !need_bvh_rebuild && bvh->can_refit() && !bvh_objects_modified(scene)) {
+		/* bvh refit */
+		progress.set_status("Updating Scene BVH", "Refitting");
 
-	BVHParams bparams;
-	bparams.top_level = true;
-	bparams.use_qbvh = scene->params.use_qbvh;
-	bparams.use_spatial_split = scene->params.use_bvh_spatial_split;
-	bparams.use_cache = scene->params.use_bvh_cache;
+		bvh->objects = scene->objects;
+		bvh->refit(progress);
+	}
+	else {
+		/* bvh build */
+		progress.set_status("Updating Scene BVH", "Building");
 
-	delete bvh;
-	bvh = BVH::create(bparams, scene->objects);
-	bvh->build(progress);
+		BVHParams bparams;
+		bparams.top_level = true;
+		bparams.use_qbvh = scene->params.use_qbvh;
+		bparams.use_spatial_split = scene->params.use_bvh_spatial_split;
+		bparams.use_cache = scene->params.use_bvh_cache;
+
+		delete bvh;
+		bvh = BVH::create(bparams, scene->objects);
+		bvh->build(progress);
+
+		bvh_objects.clear();
+
+		foreach(Object *object, scene->objects) {
+			BVHObject bvh_object;
+
+			bvh_object.object = object;
+			bvh_object.mesh = object->mesh;
+			bvh_object.transform_applied = object->mesh->transform_applied;
+
+			bvh_objects.push_back(bvh_object);
+		}
+	}
 
 	if(progress.get_cancel()) return;
 
+	need_bvh_rebuild = false;
+
 	/* copy to device */
 	progress.set_status("Updating Scene BVH", "Copying BVH to device");
 
@@ -847,6 +919,14 @@ void MeshManager::device_update_bvh(Device *device, DeviceScene *dscene, Scene *
 	}
 	if(pack.tri_woop.size()) {
 		dscene->tri_woop.reference(&pack.tri_woop[0], pack.tri_woop.size());
+
+		/* the packed triangles are freed once paged, so the BVH can't be
+		 * refit anymore and must be rebuilt on the next update */
+		if(geometry_pager && geometry_pager->page(dscene->tri_woop, "tri_woop")) {
+			pack.tri_woop.clear();
+			need_bvh_rebuild = true;
+		}
+
 		device->tex_alloc("__tri_woop", dscene->tri_woop);
 	}
 	if(pack.prim_segment.size()) {
@@ -925,6 +1005,12 @@ void MeshManager::device_update(Device *device, DeviceScene *dscene, Scene *scen
 		if(mesh->need_update && !mesh->transform_applied)
 			num_bvh++;
 
+	/* mesh BVH's are merged into the top level BVH, which can only be refit
+	 * if their primitives stay the same */
+	foreach(Mesh *mesh, scene->meshes)
+		if(mesh->need_update && (mesh->need_update_rebuild || (!mesh->transform_applied && !mesh->bvh)))
+			need_bvh_rebuild = true;
+
 	TaskPool pool;
 
 	foreach(Mesh *mesh, scene->meshes) {
@@ -954,9 +1040,33 @@ void MeshManager::device_update(Device *device, DeviceScene *dscene, Scene *scen
 
 	device_update_bvh(device, dscene, scene, progress);
 
+	if(geometry_pager)
+		device_update_object_ranges(scene);
+
 	need_update = false;
 }
 
+void MeshManager::device_update_object_ranges(Scene *scene)
+{
+	/* register the mesh arrays used by each object for residency tracking,
+	 * instances share ranges with other objects using the same mesh */
+	for(size_t i = 0; i < scene->objects.size(); i++) {
+		Mesh *mesh = scene->objects[i]->mesh;
+		size_t num_tris = mesh->triangles.size();
+		size_t num_verts = mesh->verts.size();
+
+		geometry_pager->add_object_range(i, "tri_normal", mesh->tri_offset*sizeof(float4), num_tris*sizeof(float4));
+		geometry_pager->add_object_range(i, "tri_vindex", mesh->tri_offset*sizeof(float4), num_tris*sizeof(float4));
+		geometry_pager->add_object_range(i, "tri_vnormal", mesh->vert_offset*sizeof(float4), num_verts*sizeof(float4));
+		geometry_pager->add_object_range(i, "tri_verts", mesh->vert_offset*sizeof(float4), num_verts*sizeof(float4));
+
+		geometry_pager->add_object_range(i, "curve_keys",
+			mesh->curvekey_offset*sizeof(float4), mesh->curve_keys.size()*sizeof(float4));
+		geometry_pager->add_object_range(i, "curves",
+			mesh->curve_offset*sizeof(float4), mesh->curves.size()*sizeof(float4));
+	}
+}
+
 void MeshManager::device_free(Device *device, DeviceScene *dscene)
 {
 	device->tex_free(dscene->bvh_nodes);
@@ -993,6 +1103,9 @@ void MeshManager::device_free(Device *device, DeviceScene *dscene)
 	dscene->attributes_float.clear();
 	dscene->attributes_float3.clear();
 
+	if(geometry_pager)
+		geometry_pager->free();
+
 #ifdef WITH_OSL
 	OSLGlobals *og = (OSLGlobals*)device->osl_memory();
 
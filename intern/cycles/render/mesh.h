@@ -33,7 +33,9 @@ CCL_NAMESPACE_BEGIN
 class BVH;
 class Device;
 class DeviceScene;
+class GeometryPager;
 class Mesh;
+class Object;
 class Progress;
 class Scene;
 class SceneParams;
@@ -134,11 +136,16 @@ class MeshManager {
 public:
 	BVH *bvh;
 
+	/* out-of-core storage of packed geometry, NULL if not used */
+	GeometryPager *geometry_pager;
+
 	bool need_update;
 
 	MeshManager();
 	~MeshManager();
 
+	void set_out_of_core(bool use_out_of_core, const string& directory, int memory_limit);
+
 	bool displace(Device *device, DeviceScene *dscene, Scene *scene, Mesh *mesh, Progress& progress);
 
 	/* attributes */
@@ -153,6 +160,22 @@ public:
 	void device_free(Device *device, DeviceScene *dscene);
 
 	void tag_update(Scene *scene);
+
+protected:
+	/* objects the top level BVH was built for. as long as these stay the same
+	 * and no mesh BVH is rebuilt, it is refit instead of rebuilt, so objects
+	 * that only move or deform do not rebuild the whole scene BVH. */
+	struct BVHObject {
+		Object *object;
+		Mesh *mesh;
+		bool transform_applied;
+	};
+
+	vector<BVHObject> bvh_objects;
+	bool need_bvh_rebuild;
+
+	bool bvh_objects_modified(Scene *scene);
+	void device_update_object_ranges(Scene *scene);
 };
 
 CCL_NAMESPACE_END
@@ -247,13 +247,25 @@ void ImageTextureNode::compile(SVMCompiler& compiler)
 		}
 
 		if(projection == "Flat") {
+			/* UV map differentials for MIP level selection in the image cache,
+			 * only when the coordinates are directly from the UV map */
+			uint uv_attr = ATTR_STD_NOT_FOUND;
+			ShaderOutput *vector_link = vector_in->link;
+
+			if(vector_link && tex_mapping.skip() && strcmp(vector_link->name, "UV") == 0 &&
+			   vector_link->parent->name == ustring("texture_coordinate")) {
+				if(!((TextureCoordinateNode*)vector_link->parent)->from_dupli)
+					uv_attr = compiler.attribute(ATTR_STD_UV);
+			}
+
 			compiler.add_node(NODE_TEX_IMAGE,
 				slot,
 				compiler.encode_uchar4(
 					vector_offset,
 					color_out->stack_offset,
 					alpha_out->stack_offset,
-					srgb));
+					srgb),
+				uv_attr);
 		}
 		else {
 			compiler.add_node(NODE_TEX_IMAGE_BOX,
@@ -63,6 +63,12 @@ Scene::Scene(const SceneParams& params_, const DeviceInfo& device_info_)
 
 	if (device_info_.type == DEVICE_CPU)
 		image_manager->set_extended_image_limits();
+
+	image_manager->set_texture_cache(params.use_texture_cache, params.texture_cache_size);
+
+	/* out-of-core geometry is read directly from the mapped files by the CPU */
+	mesh_manager->set_out_of_core(params.use_out_of_core && device_info_.type == DEVICE_CPU,
+		params.out_of_core_path, params.out_of_core_memory_limit);
 }
 
 Scene::~Scene()
@@ -86,6 +86,7 @@ public:
 	/* lights */
 	device_vector<float4> light_distribution;
 	device_vector<float4> light_data;
+	device_vector<float4> light_tree_nodes;
 	device_vector<float2> light_background_marginal_cdf;
 	device_vector<float2> light_background_conditional_cdf;
 
@@ -106,6 +107,10 @@ public:
 	/* images */
 	device_vector<uchar4> tex_image[TEX_EXTENDED_NUM_IMAGES];
 	device_vector<float4> tex_float_image[TEX_EXTENDED_NUM_FLOAT_IMAGES];
+	device_vector<half4> tex_half4_image[TEX_NUM_HALF4_IMAGES];
+	device_vector<float> tex_float1_image[TEX_NUM_FLOAT1_IMAGES];
+	device_vector<uchar> tex_byte1_image[TEX_NUM_BYTE1_IMAGES];
+	device_vector<half> tex_half1_image[TEX_NUM_HALF1_IMAGES];
 
 	/* opencl images */
 	device_vector<uchar4> tex_image_packed;
@@ -124,6 +129,11 @@ public:
 	bool use_bvh_spatial_split;
 	bool use_qbvh;
 	bool persistent_data;
+	bool use_texture_cache;
+	int texture_cache_size;
+	bool use_out_of_core;
+	string out_of_core_path;
+	int out_of_core_memory_limit;
 
 	SceneParams()
 	{
@@ -137,6 +147,11 @@ public:
 		use_qbvh = false;
 #endif
 		persistent_data = false;
+		use_texture_cache = false;
+		texture_cache_size = 1024;
+		use_out_of_core = false;
+		out_of_core_path = "";
+		out_of_core_memory_limit = 0;
 	}
 
 	bool modified(const SceneParams& params)
@@ -145,7 +160,12 @@ public:
 		&& use_bvh_cache == params.use_bvh_cache
 		&& use_bvh_spatial_split == params.use_bvh_spatial_split
 		&& use_qbvh == params.use_qbvh
-		&& persistent_data == params.persistent_data); }
+		&& persistent_data == params.persistent_data
+		&& use_texture_cache == params.use_texture_cache
+		&& texture_cache_size == params.texture_cache_size
+		&& use_out_of_core == params.use_out_of_core
+		&& out_of_core_path == params.out_of_core_path
+		&& out_of_core_memory_limit == params.out_of_core_memory_limit); }
 };
 
 /* Scene */
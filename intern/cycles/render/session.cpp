@@ -19,8 +19,11 @@
 
 #include "buffers.h"
 #include "camera.h"
+#include "checkpoint.h"
 #include "device.h"
+#include "geometry_pager.h"
 #include "integrator.h"
+#include "mesh.h"
 #include "scene.h"
 #include "session.h"
 
@@ -61,6 +64,7 @@ Session::Session(const SessionParams& params_)
 
 	session_thread = NULL;
 	scene = NULL;
+	checkpoint = NULL;
 
 	start_time = 0.0;
 	reset_time = 0.0;
@@ -107,6 +111,7 @@ Session::~Session()
 
 	delete buffers;
 	delete display;
+	delete checkpoint;
 	delete scene;
 	delete device;
 
@@ -337,6 +342,17 @@ bool Session::draw_cpu(BufferParams& buffer_params)
 }
 
 bool Session::acquire_tile(Device *tile_device, RenderTile& rtile)
+{
+	/* tiles finished in the checkpoint are written without rendering them */
+	while(acquire_next_tile(tile_device, rtile)) {
+		if(!restore_tile(rtile))
+			return true;
+	}
+
+	return false;
+}
+
+bool Session::acquire_next_tile(Device *tile_device, RenderTile& rtile)
 {
 	if(progress.get_cancel()) {
 		if(params.progressive_refine == false) {
@@ -361,6 +377,7 @@ bool Session::acquire_tile(Device *tile_device, RenderTile& rtile)
 	rtile.h = tile.h;
 	rtile.start_sample = tile_manager.state.sample;
 	rtile.num_samples = tile_manager.state.num_samples;
+	rtile.sample = rtile.start_sample;
 	rtile.resolution = tile_manager.state.resolution_divider;
 
 	tile_lock.unlock();
@@ -426,8 +443,33 @@ bool Session::acquire_tile(Device *tile_device, RenderTile& rtile)
 	return true;
 }
 
+bool Session::restore_tile(RenderTile& rtile)
+{
+	if(!checkpoint)
+		return false;
+
+	int start_sample = rtile.start_sample;
+	int end_sample = rtile.start_sample + rtile.num_samples;
+
+	if(!checkpoint->restore_tile(rtile))
+		return false;
+
+	/* count samples from the checkpoint for progress */
+	progress.add_samples(min(rtile.start_sample, end_sample) - start_sample);
+
+	if(rtile.num_samples > 0)
+		return false;
+
+	release_tile(rtile);
+
+	return true;
+}
+
 void Session::update_tile_sample(RenderTile& rtile)
 {
+	if(checkpoint)
+		checkpoint->update_tile(rtile);
+
 	thread_scoped_lock tile_lock(tile_mutex);
 
 	if(update_render_tile_cb) {
@@ -443,6 +485,13 @@ void Session::update_tile_sample(RenderTile& rtile)
 
 void Session::release_tile(RenderTile& rtile)
 {
+	if(checkpoint)
+		checkpoint->update_tile(rtile, true);
+
+	/* keep resident out-of-core geometry within the memory limit */
+	if(scene->mesh_manager->geometry_pager)
+		scene->mesh_manager->geometry_pager->enforce_limit();
+
 	thread_scoped_lock tile_lock(tile_mutex);
 
 	if(write_render_tile_cb) {
@@ -582,6 +631,14 @@ void Session::run_cpu()
 
 	if(!tiles_written)
 		update_progressive_refine(true);
+
+	if(checkpoint) {
+		/* keep the checkpoint of a stopped render only */
+		if(progress.get_cancel())
+			checkpoint->write();
+		else
+			checkpoint->remove();
+	}
 }
 
 void Session::run()
@@ -644,6 +701,19 @@ void Session::reset_(BufferParams& buffer_params, int samples)
 
 	tile_manager.reset(buffer_params, samples);
 
+	/* checkpoints are only used for final renders rendering each tile until
+	 * it is finished, in progressive refine all tiles are always in progress */
+	delete checkpoint;
+	checkpoint = NULL;
+
+	if(params.background && !params.progressive_refine && params.checkpoint_path != "") {
+		checkpoint = new RenderCheckpoint(params.checkpoint_path, params.checkpoint_interval);
+
+		if(checkpoint->load(buffer_params))
+			printf("Continuing render from checkpoint %s with %d tiles.\n",
+			       params.checkpoint_path.c_str(), checkpoint->num_tiles());
+	}
+
 	start_time = time_dt();
 	preview_time = 0.0;
 	paused_time = 0.0;
@@ -830,6 +900,7 @@ void Session::path_trace()
 	task.update_progress_sample = function_bind(&Session::update_progress_sample, this);
 	task.need_finish_queue = params.progressive_refine;
 	task.integrator_branched = scene->integrator->method == Integrator::BRANCHED_PATH;
+	task.integrator_wavefront = params.wavefront;
 
 	device->task_add(task);
 }
@@ -34,6 +34,7 @@ class DeviceScene;
 class DisplayBuffer;
 class Progress;
 class RenderBuffers;
+class RenderCheckpoint;
 class Scene;
 
 /* Session Parameters */
@@ -52,6 +53,12 @@ public:
 	TileOrder tile_order;
 	int start_resolution;
 	int threads;
+	bool wavefront;
+
+	/* checkpoint file to continue stopped final renders, and the time in
+	 * seconds between writing it */
+	string checkpoint_path;
+	double checkpoint_interval;
 
 	bool display_buffer_linear;
 
@@ -73,6 +80,10 @@ public:
 		tile_size = make_int2(64, 64);
 		start_resolution = INT_MAX;
 		threads = 0;
+		wavefront = false;
+
+		checkpoint_path = "";
+		checkpoint_interval = 300.0;
 
 		display_buffer_linear = false;
 
@@ -96,6 +107,11 @@ public:
 		&& tile_size == params.tile_size
 		&& start_resolution == params.start_resolution
 		&& threads == params.threads
+		&& wavefront == params.wavefront
+		/* checkpoint_path is not compared, it is set per render layer after
+		 * the session is created and is not part of the session parameters
+		 * read from the scene, comparing would recreate the session */
+		&& checkpoint_interval == params.checkpoint_interval
 		&& display_buffer_linear == params.display_buffer_linear
 		&& cancel_timeout == params.cancel_timeout
 		&& reset_timeout == params.reset_timeout
@@ -163,6 +179,8 @@ protected:
 	void reset_gpu(BufferParams& params, int samples);
 
 	bool acquire_tile(Device *tile_device, RenderTile& tile);
+	bool acquire_next_tile(Device *tile_device, RenderTile& tile);
+	bool restore_tile(RenderTile& tile);
 	void update_tile_sample(RenderTile& tile);
 	void release_tile(RenderTile& tile);
 
@@ -197,6 +215,9 @@ protected:
 	bool update_progressive_refine(bool cancel);
 
 	vector<RenderBuffers *> tile_buffers;
+
+	/* checkpoint of final render tiles */
+	RenderCheckpoint *checkpoint;
 };
 
 CCL_NAMESPACE_END
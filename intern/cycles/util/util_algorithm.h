@@ -22,6 +22,7 @@
 CCL_NAMESPACE_BEGIN
 
 using std::sort;
+using std::inplace_merge;
 using std::swap;
 using std::max;
 using std::min;
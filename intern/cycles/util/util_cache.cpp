@@ -15,7 +15,9 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 
+#include "util_algorithm.h"
 #include "util_cache.h"
 #include "util_debug.h"
 #include "util_foreach.h"
@@ -35,6 +37,21 @@
 
 CCL_NAMESPACE_BEGIN
 
+/* Cache File Header
+ *
+ * Bump the version when the file layout changes, users of the cache should
+ * add their own version to keys when the layout of their data changes. */
+
+#define CACHE_FILE_MAGIC 0x43594343 /* "CYCC" */
+#define CACHE_FILE_VERSION 1
+#define CACHE_DEFAULT_MAX_SIZE (4096ULL*1024ULL*1024ULL)
+
+struct CacheFileHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t data_size;
+};
+
 /* CacheData */
 
 CacheData::CacheData(const string& name_)
@@ -42,6 +59,7 @@ CacheData::CacheData(const string& name_)
 	name = name_;
 	f = NULL;
 	have_filename = false;
+	read_error = false;
 }
 
 CacheData::~CacheData()
@@ -70,31 +88,94 @@ const string& CacheData::get_filename()
 
 Cache Cache::global;
 
+Cache::Cache()
+{
+	/* directory is resolved on first use, user path may not be set yet */
+	const char *env_directory = getenv("CYCLES_CACHE_DIR");
+	const char *env_size = getenv("CYCLES_CACHE_SIZE");
+
+	directory = (env_directory)? env_directory: "";
+	max_size = (env_size)? (uint64_t)atoll(env_size)*1024ULL*1024ULL: CACHE_DEFAULT_MAX_SIZE;
+
+	size = 0;
+	have_size = false;
+}
+
+string Cache::get_directory()
+{
+	if(directory == "")
+		return path_user_get("cache");
+
+	return directory;
+}
+
 string Cache::data_filename(CacheData& key)
 {
-	return path_user_get(path_join("cache", key.get_filename()));
+	return path_join(get_directory(), key.get_filename());
 }
 
 void Cache::insert(CacheData& key, CacheData& value)
 {
 	string filename = data_filename(key);
 	path_create_directories(filename);
-	FILE *f = fopen(filename.c_str(), "wb");
+
+	/* write to a unique temporary file and rename when done */
+#if (BOOST_FILESYSTEM_VERSION == 2)
+	string tmp_filename = filename + ".tmp";
+#else
+	string tmp_filename = filename + boost::filesystem::unique_path(".%%%%%%%%.tmp").string();
+#endif
+
+	FILE *f = fopen(tmp_filename.c_str(), "wb");
 
 	if(!f) {
-		fprintf(stderr, "Failed to open file %s for writing.\n", filename.c_str());
+		fprintf(stderr, "Failed to open file %s for writing.\n", tmp_filename.c_str());
 		return;
 	}
 
+	CacheFileHeader header;
+	header.magic = CACHE_FILE_MAGIC;
+	header.version = CACHE_FILE_VERSION;
+	header.data_size = 0;
+
+	foreach(CacheBuffer& buffer, value.buffers)
+		header.data_size += sizeof(buffer.size) + buffer.size;
+
+	bool ok = (fwrite(&header, sizeof(header), 1, f) == 1);
+
 	foreach(CacheBuffer& buffer, value.buffers) {
+		if(!ok)
+			break;
+
 		if(!fwrite(&buffer.size, sizeof(buffer.size), 1, f))
-			fprintf(stderr, "Failed to write to file %s.\n", filename.c_str());
+			ok = false;
 		if(buffer.size)
 			if(!fwrite(buffer.data, buffer.size, 1, f))
-				fprintf(stderr, "Failed to write to file %s.\n", filename.c_str());
+				ok = false;
 	}
 	
-	fclose(f);
+	if(fclose(f) != 0)
+		ok = false;
+
+	boost::system::error_code ec;
+
+	if(!ok) {
+		fprintf(stderr, "Failed to write to file %s.\n", tmp_filename.c_str());
+		boost::filesystem::remove(tmp_filename, ec);
+		return;
+	}
+
+	/* another process may have written the same data already, or have the
+	 * file opened on platforms where that prevents renaming, keep it then */
+	boost::filesystem::rename(tmp_filename, filename, ec);
+
+	if(ec) {
+		boost::filesystem::remove(tmp_filename, ec);
+		return;
+	}
+
+	if(max_size && need_evict(sizeof(header) + header.data_size))
+		evict(max_size, key.get_filename());
 }
 
 bool Cache::lookup(CacheData& key, CacheData& value)
@@ -104,32 +185,112 @@ bool Cache::lookup(CacheData& key, CacheData& value)
 
 	if(!f)
 		return false;
+
+	/* validate header and file size, in case of older or corrupt files */
+	CacheFileHeader header;
+	boost::system::error_code ec;
+	uint64_t file_size = boost::filesystem::file_size(filename, ec);
+
+	if(ec || !fread(&header, sizeof(header), 1, f) ||
+	   header.magic != CACHE_FILE_MAGIC ||
+	   header.version != CACHE_FILE_VERSION ||
+	   header.data_size + sizeof(header) != file_size)
+	{
+		fclose(f);
+		return false;
+	}
+
+	/* mark as recently used for eviction */
+	boost::filesystem::last_write_time(filename, time(NULL), ec);
 	
 	value.name = key.name;
 	value.f = f;
+	value.read_error = false;
 
 	return true;
 }
 
-void Cache::clear_except(const string& name, const set<string>& except)
+bool Cache::need_evict(uint64_t inserted_size)
 {
-	string dir = path_user_get("cache");
+	thread_scoped_lock lock(size_mutex);
+
+	if(!have_size)
+		return true;
 
-	if(boost::filesystem::exists(dir)) {
-		boost::filesystem::directory_iterator it(dir), it_end;
+	size += inserted_size;
+
+	return size > max_size;
+}
+
+struct CacheFile {
+	boost::filesystem::path path;
+	time_t time;
+	uint64_t size;
+
+	bool operator<(const CacheFile& other) const
+	{
+		return time < other.time;
+	}
+};
+
+void Cache::evict(uint64_t size_limit, const string& keep_filename)
+{
+	thread_scoped_lock lock(size_mutex);
+
+	string dir = get_directory();
+	boost::system::error_code ec;
+
+	size = 0;
+	have_size = true;
+
+	if(!boost::filesystem::exists(dir, ec))
+		return;
+
+	/* gather cache files, temporary files are being written by others */
+	vector<CacheFile> files;
+	uint64_t total_size = 0;
+
+	boost::filesystem::directory_iterator it(dir, ec), it_end;
+
+	for(; !ec && it != it_end; it.increment(ec)) {
+		if(!boost::filesystem::is_regular_file(it->path(), ec))
+			continue;
+		if(it->path().extension() == ".tmp")
+			continue;
+
+		CacheFile file;
+		file.path = it->path();
+		file.time = boost::filesystem::last_write_time(file.path, ec);
+		file.size = boost::filesystem::file_size(file.path, ec);
+
+		if(ec)
+			continue;
+
+		total_size += file.size;
+		files.push_back(file);
+	}
+
+	/* remove least recently used first */
+	if(total_size > size_limit) {
+		sort(files.begin(), files.end());
+
+		foreach(CacheFile& file, files) {
+			if(total_size <= size_limit)
+				break;
 
-		for(; it != it_end; it++) {
 #if (BOOST_FILESYSTEM_VERSION == 2)
-			string filename = it->path().filename();
+			if(file.path.filename() == keep_filename)
 #else
-			string filename = it->path().filename().string();
+			if(file.path.filename().string() == keep_filename)
 #endif
+				continue;
 
-			if(boost::starts_with(filename, name))
-				if(except.find(filename) == except.end())
-					boost::filesystem::remove(it->path());
+			if(boost::filesystem::remove(file.path, ec))
+				total_size -= file.size;
 		}
 	}
+
+	size = total_size;
 }
 
 CCL_NAMESPACE_END
@@ -28,10 +28,22 @@
  * invalidate cache entries, at the cost of exta computation. If everything
  * is stored in a global cache, computations can perhaps even be shared between
  * different scenes where it may be hard to detect duplicate work.
+ *
+ * Files start with a header holding the cache format version and the size of
+ * the data, files that do not match are ignored. They are written to a
+ * temporary file first and then renamed, so other processes sharing the cache
+ * directory never see partial files. When the cache grows beyond its maximum
+ * size, the least recently used files are removed.
+ *
+ * The directory and maximum size can be set with the CYCLES_CACHE_DIR and
+ * CYCLES_CACHE_SIZE (in megabytes) environment variables, for example to
+ * share one cache between the machines of a render farm.
  */
 
-#include "util_set.h"
+#include "util_list.h"
 #include "util_string.h"
+#include "util_thread.h"
+#include "util_types.h"
 #include "util_vector.h"
 
 CCL_NAMESPACE_BEGIN
@@ -51,6 +63,7 @@ public:
 	string name;
 	string filename;
 	bool have_filename;
+	bool read_error;
 	FILE *f;
 
 	CacheData(const string& name = "");
@@ -78,72 +91,101 @@ public:
 		}
 	}
 
+	/* values are copied, so temporaries can be added too */
 	void add(const int& data)
 	{
-		CacheBuffer buffer(&data, sizeof(int));
-		buffers.push_back(buffer);
+		add_copy(&data, sizeof(int));
 	}
 
 	void add(const float& data)
 	{
-		CacheBuffer buffer(&data, sizeof(float));
-		buffers.push_back(buffer);
+		add_copy(&data, sizeof(float));
 	}
 
 	void add(const size_t& data)
 	{
-		CacheBuffer buffer(&data, sizeof(size_t));
-		buffers.push_back(buffer);
+		add_copy(&data, sizeof(size_t));
 	}
 
+	/* reading stops at the first error, which is remembered in read_error */
 	template<typename T> void read(array<T>& data)
 	{
 		size_t size;
 
-		if(!fread(&size, sizeof(size), 1, f)) {
-			fprintf(stderr, "Failed to read vector size from cache.\n");
+		if(!read_size(size))
+			return;
+
+		if(!size) {
+			data.clear();
 			return;
 		}
 
-		if(!size)
+		if(size % sizeof(T)) {
+			fprintf(stderr, "Invalid vector size in cache (%lu).\n", (unsigned long)size);
+			read_error = true;
 			return;
+		}
 
 		data.resize(size/sizeof(T));
 
 		if(!fread(&data[0], size, 1, f)) {
 			fprintf(stderr, "Failed to read vector data from cache (%lu).\n", (unsigned long)size);
+			read_error = true;
 			return;
 		}
 	}
 
 	void read(int& data)
 	{
-		size_t size;
-
-		if(!fread(&size, sizeof(size), 1, f))
-			fprintf(stderr, "Failed to read int size from cache.\n");
-		if(!fread(&data, sizeof(data), 1, f))
-			fprintf(stderr, "Failed to read int from cache.\n");
+		read_value(&data, sizeof(data));
 	}
 
 	void read(float& data)
 	{
-		size_t size;
-
-		if(!fread(&size, sizeof(size), 1, f))
-			fprintf(stderr, "Failed to read float size from cache.\n");
-		if(!fread(&data, sizeof(data), 1, f))
-			fprintf(stderr, "Failed to read float from cache.\n");
+		read_value(&data, sizeof(data));
 	}
 
 	void read(size_t& data)
+	{
+		read_value(&data, sizeof(data));
+	}
+
+protected:
+	list<vector<uint8_t> > copies;
+
+	void add_copy(const void *data, size_t size)
+	{
+		const uint8_t *bytes = (const uint8_t*)data;
+
+		copies.push_back(vector<uint8_t>(bytes, bytes + size));
+		add(&copies.back()[0], size);
+	}
+
+	bool read_size(size_t& size)
+	{
+		if(read_error || !f)
+			return false;
+
+		if(!fread(&size, sizeof(size), 1, f)) {
+			fprintf(stderr, "Failed to read size from cache.\n");
+			read_error = true;
+			return false;
+		}
+
+		return true;
+	}
+
+	void read_value(void *data, size_t data_size)
 	{
 		size_t size;
 
-		if(!fread(&size, sizeof(size), 1, f))
-			fprintf(stderr, "Failed to read size_t size from cache.\n");
-		if(!fread(&data, sizeof(data), 1, f))
-			fprintf(stderr, "Failed to read size_t from cache.\n");
+		if(!read_size(size))
+			return;
+
+		if(size != data_size || !fread(data, data_size, 1, f)) {
+			fprintf(stderr, "Failed to read value from cache.\n");
+			read_error = true;
+		}
 	}
 };
 
@@ -151,13 +193,28 @@ class Cache {
 public:
 	static Cache global;
 
+	Cache();
+
 	void insert(CacheData& key, CacheData& value);
 	bool lookup(CacheData& key, CacheData& value);
 
-	void clear_except(const string& name, const set<string>& except);
+	/* remove least recently used files until the cache is below the size
+	 * limit, except for the file with the given name */
+	void evict(uint64_t size_limit, const string& keep_filename = "");
 
 protected:
+	string directory;
+	uint64_t max_size;
+
+	/* size of the cache directory as of the last eviction, plus the files
+	 * inserted since, so the directory is only scanned when it gets full */
+	thread_mutex size_mutex;
+	uint64_t size;
+	bool have_size;
+
+	string get_directory();
 	string data_filename(CacheData& key);
+	bool need_evict(uint64_t inserted_size);
 };
 
 CCL_NAMESPACE_END
@@ -24,6 +24,7 @@
  * except for the constructor/destructor are thread safe. */
 
 #include "util_function.h"
+#include "util_map.h"
 #include "util_string.h"
 #include "util_time.h"
 #include "util_thread.h"
@@ -62,6 +63,7 @@ public:
 		progress.get_tile(tile, total_time, tile_time);
 
 		sample = progress.get_sample();
+		phase_times = progress.phase_times;
 
 		return *this;
 	}
@@ -79,6 +81,7 @@ public:
 		sync_substatus = "";
 		cancel = false;
 		cancel_message = "";
+		phase_times.clear();
 	}
 
 	/* cancel */
@@ -149,6 +152,13 @@ public:
 		sample++;
 	}
 
+	void add_samples(int num_samples)
+	{
+		thread_scoped_lock lock(progress_mutex);
+
+		sample += num_samples;
+	}
+
 	int get_sample()
 	{
 		return sample;
@@ -217,6 +227,20 @@ public:
 		}
 	}
 
+	/* phase timings, accumulated over all builds of the same phase */
+
+	void add_phase_time(const string& phase, double time)
+	{
+		thread_scoped_lock lock(progress_mutex);
+		phase_times[phase] += time;
+	}
+
+	void get_phase_times(map<string, double>& phase_times_)
+	{
+		thread_scoped_lock lock(progress_mutex);
+		phase_times_ = phase_times;
+	}
+
 	/* callback */
 
 	void set_update()
@@ -253,6 +277,8 @@ protected:
 
 	volatile bool cancel;
 	string cancel_message;
+
+	map<string, double> phase_times;
 };
 
 CCL_NAMESPACE_END
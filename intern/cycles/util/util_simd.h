@@ -0,0 +1,288 @@
+/*
+ * Copyright 2011-2013 Intel Corporation
+ * Modifications Copyright 2014, Blender Foundation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License
+ */
+
+#ifndef __UTIL_SIMD_H__
+#define __UTIL_SIMD_H__
+
+#include "util_types.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* SIMD Vector Types
+ *
+ * Thin wrappers around the SSE registers, adapted from Embree. Unlike float3
+ * and float4 these are always backed by __m128 when available, so they can be
+ * used in the hot kernel code without changing the layout of the structs that
+ * are shared with the device. Which instructions end up being used depends on
+ * the kernel the code is compiled into (SSE2, SSE3, SSE4.1, AVX or AVX2). */
+
+#ifdef __KERNEL_SSE2__
+
+struct sseb;
+struct ssei;
+struct ssef;
+
+/* 4-wide SSE bool type */
+
+struct __align(16) sseb {
+	union { __m128 m128; int32_t v[4]; };
+
+	__forceinline sseb() {}
+	__forceinline sseb(const sseb& other) { m128 = other.m128; }
+	__forceinline sseb& operator=(const sseb& other) { m128 = other.m128; return *this; }
+
+	__forceinline sseb(const __m128 input) : m128(input) {}
+	__forceinline operator const __m128&(void) const { return m128; }
+	__forceinline operator const __m128i(void) const { return _mm_castps_si128(m128); }
+
+	__forceinline bool operator[](const size_t i) const { return v[i] != 0; }
+};
+
+__forceinline const sseb operator!(const sseb& a) { return _mm_xor_ps(a, _mm_castsi128_ps(_mm_set1_epi32(-1))); }
+__forceinline const sseb operator&(const sseb& a, const sseb& b) { return _mm_and_ps(a, b); }
+__forceinline const sseb operator|(const sseb& a, const sseb& b) { return _mm_or_ps(a, b); }
+__forceinline const sseb operator^(const sseb& a, const sseb& b) { return _mm_xor_ps(a, b); }
+
+__forceinline int movemask(const sseb& a) { return _mm_movemask_ps(a); }
+__forceinline bool all(const sseb& a) { return _mm_movemask_ps(a) == 0xf; }
+__forceinline bool any(const sseb& a) { return _mm_movemask_ps(a) != 0x0; }
+__forceinline bool none(const sseb& a) { return _mm_movemask_ps(a) == 0x0; }
+
+/* 4-wide SSE integer type */
+
+struct __align(16) ssei {
+	union { __m128i m128; int32_t v[4]; };
+
+	__forceinline ssei() {}
+	__forceinline ssei(const ssei& other) { m128 = other.m128; }
+	__forceinline ssei& operator=(const ssei& other) { m128 = other.m128; return *this; }
+
+	__forceinline ssei(const __m128i input) : m128(input) {}
+	__forceinline operator const __m128i&(void) const { return m128; }
+	__forceinline operator __m128i&(void) { return m128; }
+
+	__forceinline explicit ssei(const int a) : m128(_mm_set1_epi32(a)) {}
+	__forceinline ssei(int a, int b, int c, int d) : m128(_mm_setr_epi32(a, b, c, d)) {}
+
+	__forceinline const int32_t& operator[](const size_t i) const { return v[i]; }
+	__forceinline int32_t& operator[](const size_t i) { return v[i]; }
+};
+
+__forceinline const ssei operator+(const ssei& a, const ssei& b) { return _mm_add_epi32(a, b); }
+__forceinline const ssei operator-(const ssei& a, const ssei& b) { return _mm_sub_epi32(a, b); }
+__forceinline const ssei operator&(const ssei& a, const ssei& b) { return _mm_and_si128(a, b); }
+__forceinline const ssei operator|(const ssei& a, const ssei& b) { return _mm_or_si128(a, b); }
+__forceinline const ssei operator^(const ssei& a, const ssei& b) { return _mm_xor_si128(a, b); }
+__forceinline const ssei operator<<(const ssei& a, const int n) { return _mm_slli_epi32(a, n); }
+__forceinline const ssei operator>>(const ssei& a, const int n) { return _mm_srai_epi32(a, n); }
+
+__forceinline const sseb operator==(const ssei& a, const ssei& b) { return _mm_castsi128_ps(_mm_cmpeq_epi32(a, b)); }
+__forceinline const sseb operator<(const ssei& a, const ssei& b) { return _mm_castsi128_ps(_mm_cmplt_epi32(a, b)); }
+__forceinline const sseb operator>(const ssei& a, const ssei& b) { return _mm_castsi128_ps(_mm_cmpgt_epi32(a, b)); }
+
+#ifdef __KERNEL_SSE41__
+__forceinline const ssei operator*(const ssei& a, const ssei& b) { return _mm_mullo_epi32(a, b); }
+__forceinline const ssei min(const ssei& a, const ssei& b) { return _mm_min_epi32(a, b); }
+__forceinline const ssei max(const ssei& a, const ssei& b) { return _mm_max_epi32(a, b); }
+#else
+__forceinline const ssei min(const ssei& a, const ssei& b)
+{
+	const __m128i mask = _mm_cmplt_epi32(a, b);
+	return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+__forceinline const ssei max(const ssei& a, const ssei& b)
+{
+	const __m128i mask = _mm_cmpgt_epi32(a, b);
+	return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+#endif
+
+/* 4-wide SSE float type */
+
+struct __align(16) ssef {
+	union { __m128 m128; float f[4]; int32_t i[4]; };
+
+	__forceinline ssef() {}
+	__forceinline ssef(const ssef& other) { m128 = other.m128; }
+	__forceinline ssef& operator=(const ssef& other) { m128 = other.m128; return *this; }
+
+	__forceinline ssef(const __m128 a) : m128(a) {}
+	__forceinline operator const __m128&(void) const { return m128; }
+	__forceinline operator __m128&(void) { return m128; }
+
+	__forceinline explicit ssef(const float a) : m128(_mm_set1_ps(a)) {}
+	__forceinline ssef(float a, float b, float c, float d) : m128(_mm_setr_ps(a, b, c, d)) {}
+	__forceinline explicit ssef(const float4& a) : m128(_mm_loadu_ps(&a.x)) {}
+	__forceinline explicit ssef(const float3& a) : m128(_mm_loadu_ps(&a.x)) {}
+
+	__forceinline const float& operator[](const size_t index) const { return f[index]; }
+	__forceinline float& operator[](const size_t index) { return f[index]; }
+};
+
+__forceinline const ssef cast(const ssei& a) { return _mm_castsi128_ps(a); }
+__forceinline const ssei cast(const ssef& a) { return _mm_castps_si128(a); }
+
+/* unary operators */
+
+__forceinline const ssef operator-(const ssef& a) { return _mm_xor_ps(a, _mm_castsi128_ps(_mm_set1_epi32(0x80000000))); }
+__forceinline const ssef fabs(const ssef& a) { return _mm_and_ps(a, _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff))); }
+__forceinline const ssef mm_sqrt(const ssef& a) { return _mm_sqrt_ps(a); }
+
+__forceinline const ssef rcp(const ssef& a)
+{
+	/* one newton-raphson iteration on top of the estimate */
+	const ssef r = _mm_rcp_ps(a);
+	return _mm_sub_ps(_mm_add_ps(r, r), _mm_mul_ps(_mm_mul_ps(r, r), a));
+}
+
+/* binary operators */
+
+__forceinline const ssef operator+(const ssef& a, const ssef& b) { return _mm_add_ps(a, b); }
+__forceinline const ssef operator-(const ssef& a, const ssef& b) { return _mm_sub_ps(a, b); }
+__forceinline const ssef operator*(const ssef& a, const ssef& b) { return _mm_mul_ps(a, b); }
+__forceinline const ssef operator*(const ssef& a, const float b) { return a * ssef(b); }
+__forceinline const ssef operator*(const float a, const ssef& b) { return ssef(a) * b; }
+__forceinline const ssef operator/(const ssef& a, const ssef& b) { return _mm_div_ps(a, b); }
+__forceinline const ssef operator&(const ssef& a, const ssef& b) { return _mm_and_ps(a, b); }
+__forceinline const ssef operator|(const ssef& a, const ssef& b) { return _mm_or_ps(a, b); }
+__forceinline const ssef operator^(const ssef& a, const ssef& b) { return _mm_xor_ps(a, b); }
+__forceinline const ssef operator^(const ssef& a, const ssei& b) { return _mm_xor_ps(a, _mm_castsi128_ps(b)); }
+
+__forceinline ssef& operator+=(ssef& a, const ssef& b) { return a = a + b; }
+__forceinline ssef& operator-=(ssef& a, const ssef& b) { return a = a - b; }
+__forceinline ssef& operator*=(ssef& a, const ssef& b) { return a = a * b; }
+
+__forceinline const ssef min(const ssef& a, const ssef& b) { return _mm_min_ps(a, b); }
+__forceinline const ssef max(const ssef& a, const ssef& b) { return _mm_max_ps(a, b); }
+
+/* ternary operators, fused on AVX2 capable CPUs */
+
+#ifdef __KERNEL_AVX2__
+__forceinline const ssef madd(const ssef& a, const ssef& b, const ssef& c) { return _mm_fmadd_ps(a, b, c); }
+__forceinline const ssef msub(const ssef& a, const ssef& b, const ssef& c) { return _mm_fmsub_ps(a, b, c); }
+#else
+__forceinline const ssef madd(const ssef& a, const ssef& b, const ssef& c) { return a*b + c; }
+__forceinline const ssef msub(const ssef& a, const ssef& b, const ssef& c) { return a*b - c; }
+#endif
+
+/* comparison operators */
+
+__forceinline const sseb operator==(const ssef& a, const ssef& b) { return _mm_cmpeq_ps(a, b); }
+__forceinline const sseb operator!=(const ssef& a, const ssef& b) { return _mm_cmpneq_ps(a, b); }
+__forceinline const sseb operator<(const ssef& a, const ssef& b) { return _mm_cmplt_ps(a, b); }
+__forceinline const sseb operator<=(const ssef& a, const ssef& b) { return _mm_cmple_ps(a, b); }
+__forceinline const sseb operator>(const ssef& a, const ssef& b) { return _mm_cmpgt_ps(a, b); }
+__forceinline const sseb operator>=(const ssef& a, const ssef& b) { return _mm_cmpge_ps(a, b); }
+
+__forceinline const ssef select(const sseb& mask, const ssef& t, const ssef& f)
+{
+#ifdef __KERNEL_SSE41__
+	return _mm_blendv_ps(f, t, mask);
+#else
+	return _mm_or_ps(_mm_and_ps(mask, t), _mm_andnot_ps(mask, f));
+#endif
+}
+
+/* shuffles */
+
+template<size_t i0, size_t i1, size_t i2, size_t i3> __forceinline const ssef shuffle(const ssef& a)
+{
+	return _mm_castsi128_ps(_mm_shuffle_epi32(_mm_castps_si128(a), _MM_SHUFFLE(i3, i2, i1, i0)));
+}
+
+template<size_t i0, size_t i1, size_t i2, size_t i3> __forceinline const ssef shuffle(const ssef& a, const ssef& b)
+{
+	return _mm_shuffle_ps(a, b, _MM_SHUFFLE(i3, i2, i1, i0));
+}
+
+template<size_t i> __forceinline const ssef broadcast(const ssef& a)
+{
+	return shuffle<i, i, i, i>(a);
+}
+
+__forceinline void transpose(const ssef& r0, const ssef& r1, const ssef& r2, const ssef& r3,
+	ssef& c0, ssef& c1, ssef& c2, ssef& c3)
+{
+	const ssef l02 = _mm_unpacklo_ps(r0, r2);
+	const ssef h02 = _mm_unpackhi_ps(r0, r2);
+	const ssef l13 = _mm_unpacklo_ps(r1, r3);
+	const ssef h13 = _mm_unpackhi_ps(r1, r3);
+
+	c0 = _mm_unpacklo_ps(l02, l13);
+	c1 = _mm_unpackhi_ps(l02, l13);
+	c2 = _mm_unpacklo_ps(h02, h13);
+	c3 = _mm_unpackhi_ps(h02, h13);
+}
+
+/* reductions */
+
+__forceinline const ssef vreduce_min(const ssef& v) { ssef h = min(shuffle<1, 0, 3, 2>(v), v); return min(shuffle<2, 3, 0, 1>(h), h); }
+__forceinline const ssef vreduce_max(const ssef& v) { ssef h = max(shuffle<1, 0, 3, 2>(v), v); return max(shuffle<2, 3, 0, 1>(h), h); }
+__forceinline const ssef vreduce_add(const ssef& v) { ssef h = shuffle<1, 0, 3, 2>(v) + v; return shuffle<2, 3, 0, 1>(h) + h; }
+
+__forceinline float reduce_min(const ssef& v) { return _mm_cvtss_f32(vreduce_min(v)); }
+__forceinline float reduce_max(const ssef& v) { return _mm_cvtss_f32(vreduce_max(v)); }
+__forceinline float reduce_add(const ssef& v) { return _mm_cvtss_f32(vreduce_add(v)); }
+
+__forceinline float extract0(const ssef& a) { return _mm_cvtss_f32(a); }
+
+/* 3 component dot product of the xyz lanes, result in all lanes */
+
+__forceinline const ssef dot3_splat(const ssef& a, const ssef& b)
+{
+#ifdef __KERNEL_SSE41__
+	return _mm_dp_ps(a, b, 0x7f);
+#else
+	const ssef t = a * b;
+	return broadcast<0>(t) + broadcast<1>(t) + broadcast<2>(t);
+#endif
+}
+
+__forceinline float dot3(const ssef& a, const ssef& b)
+{
+	return extract0(dot3_splat(a, b));
+}
+
+__forceinline const ssef cross(const ssef& a, const ssef& b)
+{
+	const ssef a_yzx = shuffle<1, 2, 0, 3>(a);
+	const ssef b_yzx = shuffle<1, 2, 0, 3>(b);
+	return shuffle<1, 2, 0, 3>(msub(a, b_yzx, a_yzx * b));
+}
+
+/* conversion back to the kernel vector types */
+
+__forceinline float3 ssef_to_float3(const ssef& a)
+{
+	float3 r;
+	_mm_storeu_ps(&r.x, a);
+	return r;
+}
+
+__forceinline float4 ssef_to_float4(const ssef& a)
+{
+	float4 r;
+	_mm_storeu_ps(&r.x, a);
+	return r;
+}
+
+#endif /* __KERNEL_SSE2__ */
+
+CCL_NAMESPACE_END
+
+#endif /* __UTIL_SIMD_H__ */
+
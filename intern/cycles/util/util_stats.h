@@ -17,11 +17,14 @@
 #ifndef __UTIL_STATS_H__
 #define __UTIL_STATS_H__
 
+#include "util_thread.h"
+#include "util_types.h"
+
 CCL_NAMESPACE_BEGIN
 
 class Stats {
 public:
-	Stats() : mem_used(0), mem_peak(0) {}
+	Stats() : mem_used(0), mem_peak(0), num_rays(0) {}
 
 	void mem_alloc(size_t size) {
 		mem_used += size;
@@ -33,8 +36,23 @@ public:
 		mem_used -= size;
 	}
 
+	/* called by render threads */
+	void rays_traced(uint64_t num) {
+		thread_scoped_lock lock(rays_mutex);
+		num_rays += num;
+	}
+
+	uint64_t get_num_rays() {
+		thread_scoped_lock lock(rays_mutex);
+		return num_rays;
+	}
+
 	size_t mem_used;
 	size_t mem_peak;
+
+protected:
+	thread_mutex rays_mutex;
+	uint64_t num_rays;
 };
 
 CCL_NAMESPACE_END
@@ -61,13 +61,13 @@ int system_cpu_thread_count()
 static void __cpuid(int data[4], int selector)
 {
 #ifdef __x86_64__
-	asm("cpuid" : "=a" (data[0]), "=b" (data[1]), "=c" (data[2]), "=d" (data[3]) : "a"(selector));
+	asm("cpuid" : "=a" (data[0]), "=b" (data[1]), "=c" (data[2]), "=d" (data[3]) : "a"(selector), "c"(0));
 #else
 #ifdef __i386__
 	asm("pushl %%ebx    \n\t"
 		"cpuid          \n\t"
 		"movl %%ebx, %1 \n\t"
-		"popl %%ebx     \n\t" : "=a" (data[0]), "=r" (data[1]), "=c" (data[2]), "=d" (data[3]) : "a"(selector));
+		"popl %%ebx     \n\t" : "=a" (data[0]), "=r" (data[1]), "=c" (data[2]), "=d" (data[3]) : "a"(selector), "c"(0));
 #else
 	data[0] = data[1] = data[2] = data[3] = 0;
 #endif
@@ -129,11 +129,33 @@ struct CPUCapabilities {
 	bool sse42;
 	bool sse4a;
 	bool avx;
+	bool avx2;
+	bool bmi1;
+	bool bmi2;
 	bool xop;
 	bool fma3;
 	bool fma4;
 };
 
+/* extended control register 0, tells which register state the OS saves */
+static uint64_t system_cpu_xgetbv()
+{
+#if defined(_WIN32) && !defined(FREE_WINDOWS)
+#if _MSC_VER >= 1600
+	return _xgetbv(0);
+#else
+	return 0;
+#endif
+#elif defined(__x86_64__) || defined(__i386__)
+	uint32_t eax, edx;
+	/* xgetbv, spelled out for assemblers that don't know it */
+	asm(".byte 0x0f, 0x01, 0xd0" : "=a" (eax), "=d" (edx) : "c" (0));
+	return ((uint64_t)edx << 32) | eax;
+#else
+	return 0;
+#endif
+}
+
 static CPUCapabilities& system_cpu_capabilities()
 {
 	static CPUCapabilities caps;
@@ -165,6 +187,23 @@ static CPUCapabilities& system_cpu_capabilities()
 
 			caps.avx = (result[2] & ((int)1 << 28)) != 0;
 			caps.fma3 = (result[2] & ((int)1 << 12)) != 0;
+
+			/* AVX also needs the OS to save the YMM registers (OSXSAVE and XCR0) */
+			if(caps.avx) {
+				bool osxsave = (result[2] & ((int)1 << 27)) != 0;
+				caps.avx = osxsave && (system_cpu_xgetbv() & 0x6) == 0x6;
+			}
+		}
+
+		if(num >= 7) {
+#if defined(_WIN32) && !defined(FREE_WINDOWS)
+			__cpuidex(result, 0x00000007, 0);
+#else
+			__cpuid(result, 0x00000007);
+#endif
+			caps.bmi1 = (result[1] & ((int)1 << 3)) != 0;
+			caps.avx2 = (result[1] & ((int)1 << 5)) != 0;
+			caps.bmi2 = (result[1] & ((int)1 << 8)) != 0;
 		}
 
 #if 0
@@ -195,6 +234,18 @@ bool system_cpu_support_sse3()
 	return caps.sse && caps.sse2 && caps.sse3 && caps.ssse3;
 }
 
+bool system_cpu_support_avx()
+{
+	CPUCapabilities& caps = system_cpu_capabilities();
+	return caps.sse && caps.sse2 && caps.sse3 && caps.ssse3 && caps.sse41 && caps.avx;
+}
+
+bool system_cpu_support_avx2()
+{
+	CPUCapabilities& caps = system_cpu_capabilities();
+	return caps.sse && caps.sse2 && caps.sse3 && caps.ssse3 && caps.sse41 && caps.avx && caps.avx2 && caps.fma3;
+}
+
 #else
 
 bool system_cpu_support_sse2()
@@ -207,6 +258,16 @@ bool system_cpu_support_sse3()
 	return false;
 }
 
+bool system_cpu_support_avx()
+{
+	return false;
+}
+
+bool system_cpu_support_avx2()
+{
+	return false;
+}
+
 #endif
 
 CCL_NAMESPACE_END
@@ -26,6 +26,8 @@ string system_cpu_brand_string();
 int system_cpu_bits();
 bool system_cpu_support_sse2();
 bool system_cpu_support_sse3();
+bool system_cpu_support_avx();
+bool system_cpu_support_avx2();
 
 CCL_NAMESPACE_END
 
@@ -97,6 +97,14 @@
 #include <tmmintrin.h> /* SSSE 3 */
 #endif
 
+#ifdef __KERNEL_SSE41__
+#include <smmintrin.h> /* SSE 4.1 */
+#endif
+
+#ifdef __KERNEL_AVX__
+#include <immintrin.h> /* AVX, AVX2 and FMA */
+#endif
+
 #else
 
 /* MinGW64 has conflicting declarations for these SSE headers in <windows.h>.
@@ -600,6 +608,30 @@ __device_inline void float4_store_half(half *h, const float4 *f, float scale)
 
 #endif
 
+#ifndef __KERNEL_CUDA__
+
+__device_inline float half_to_float(half h)
+{
+	/* full conversion, including denormals, infinity and nan */
+	union { uint i; float f; } out;
+	uint sign = (uint)(h & 0x8000) << 16;
+	uint exponent = (h >> 10) & 0x1F;
+	uint mantissa = h & 0x3FF;
+
+	if(exponent == 0) {
+		out.f = (float)mantissa * (1.0f/16777216.0f);
+		out.i |= sign;
+	}
+	else if(exponent == 0x1F)
+		out.i = sign | 0x7F800000 | (mantissa << 13);
+	else
+		out.i = sign | ((exponent + 112) << 23) | (mantissa << 13);
+
+	return out.f;
+}
+
+#endif
+
 #endif
 
 CCL_NAMESPACE_END
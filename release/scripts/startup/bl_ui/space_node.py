@@ -393,7 +393,10 @@ class NODE_PT_quality(bpy.types.Panel):
         col.prop(tree, "use_opencl")
         col.prop(tree, "use_groupnode_buffer")
         col.prop(tree, "use_two_pass")
+        col.prop(tree, "use_buffer_cache")
+        col.prop(tree, "use_half_buffers")
         col.prop(tree, "use_viewer_border")
+        col.prop(tree, "use_view_region")
         col.prop(snode, "show_highlight")
         col.prop(snode, "use_hidden_preview")
 
@@ -58,12 +58,23 @@ struct Scene;
  * be rebuilt later. The graph is not rebuilt immediately to avoid slowdowns
  * when this function is call multiple times from different operators.
  *
+ * DAG_id_relations_tag_update marks only the relations of a single datablock
+ * to be rebuilt later, the existing graph is patched instead of rebuilt. Use
+ * this when only the relations the datablock itself creates have changed (its
+ * constraints, modifiers, parent, ..). Non-object datablocks fall back to
+ * DAG_relations_tag_update.
+ *
  * DAG_scene_relations_rebuild forces an immediaterebuild of the dependency
  * graph, this is only needed in rare cases
+ *
+ * DAG_scene_relations_num_touched returns the number of graph nodes touched by
+ * the last build or update, for profiling.
  */
 
 void DAG_scene_relations_update(struct Main *bmain, struct Scene *sce);
 void DAG_relations_tag_update(struct Main *bmain);
+void DAG_id_relations_tag_update(struct Main *bmain, struct ID *id);
+int  DAG_scene_relations_num_touched(struct Scene *sce);
 void DAG_scene_relations_rebuild(struct Main *bmain, struct Scene *scene);
 void DAG_scene_free(struct Scene *sce);
 
@@ -106,6 +117,27 @@ void DAG_ids_flush_tagged(struct Main *bmain);
 void DAG_ids_check_recalc(struct Main *bmain, struct Scene *scene, int time);
 void DAG_ids_clear_recalc(struct Main *bmain);
 
+/* Threaded Update
+ *
+ * DAG_threaded_update_begin calls func for every node of the scene dependency
+ * graph that has no dependencies. Once such a node is evaluated, the caller
+ * must call DAG_threaded_update_handle_node_updated for it, which in turn calls
+ * func for every child node that has all of its parents evaluated now. func may
+ * be called from any thread, nodes can then be evaluated in parallel.
+ *
+ * Nodes which are part of a dependency cycle (or depend on such nodes) are never
+ * passed to func, DAG_threaded_update_object_done can be used afterwards to find
+ * the objects that still need to be evaluated in a single thread. */
+
+void DAG_threaded_update_begin(struct Scene *scene,
+                               void (*func)(void *node, void *user_data),
+                               void *user_data);
+void DAG_threaded_update_handle_node_updated(void *node_v,
+                                             void (*func)(void *node, void *user_data),
+                                             void *user_data);
+struct Object *DAG_threaded_update_node_object(void *node_v);
+int DAG_threaded_update_object_done(struct Scene *scene, struct Object *ob);
+
 /* Armature: sorts the bones according to dependencies between them */
 
 void DAG_pose_sort(struct Object *ob);
@@ -70,6 +70,7 @@ typedef struct DagAdjList {
 	int count;  /* number of identical arcs */
 	unsigned int lay;   // for flushing redraw/rebuild events
 	const char *name;
+	struct DagNode *owner;  /* node of the object which created this arc when building its relations */
 	struct DagAdjList *next;
 } DagAdjList;
 
@@ -89,6 +90,11 @@ typedef struct DagNode {
 	int DFS_dist;       /* DFS distance */
 	int DFS_dvtm;       /* DFS discovery time */
 	int DFS_fntm;       /* DFS Finishing time */
+	unsigned int valency;   /* threaded update: number of parents not evaluated yet */
+	short is_base;          /* threaded update: node is an object from the scene bases */
+	short done;             /* threaded update: node was evaluated */
+	short relations_built;  /* relations of the object were built in this graph */
+	short relations_tagged; /* relations of the object need to be rebuilt */
 	struct DagAdjList *child;
 	struct DagAdjList *parent;
 	struct DagNode *next;
@@ -114,6 +120,9 @@ typedef struct DagForest {
 	int numNodes;
 	int is_acyclic;
 	int time;  /* for flushing/tagging, compare with node->lasttime */
+	struct DagNode *build_owner;  /* node whose relations are being built, owner of new arcs */
+	int num_relations_tagged;     /* number of nodes with relations_tagged set */
+	int num_nodes_touched;        /* stats: nodes touched by the last relations update */
 } DagForest;
 
 
@@ -566,7 +566,6 @@ typedef struct UndoElem {
 	char str[FILE_MAX];
 	char name[BKE_UNDO_STR_MAX];
 	MemFile memfile;
-	uintptr_t undosize;
 } UndoElem;
 
 static ListBase undobase = {NULL, NULL};
@@ -606,7 +605,7 @@ static int read_undosave(bContext *C, UndoElem *uel)
 /* name can be a dynamic string */
 void BKE_write_undo(bContext *C, const char *name)
 {
-	uintptr_t maxmem, totmem, memused;
+	uintptr_t maxmem, totmem;
 	int nr /*, success */ /* UNUSED */;
 	UndoElem *uel;
 	
@@ -644,7 +643,7 @@ void BKE_write_undo(bContext *C, const char *name)
 			UndoElem *first = undobase.first;
 			BLI_remlink(&undobase, first);
 			/* the merge is because of compression */
-			BLO_merge_memfile(&first->memfile, &first->next->memfile);
+			BLO_merge_memfile(&first->memfile);
 			MEM_freeN(first);
 		}
 	}
@@ -673,9 +672,7 @@ void BKE_write_undo(bContext *C, const char *name)
 		
 		if (curundo->prev) prevfile = &(curundo->prev->memfile);
 		
-		memused = MEM_get_memory_in_use();
 		/* success = */ /* UNUSED */ BLO_write_file_mem(CTX_data_main(C), prevfile, &curundo->memfile, G.fileflags);
-		curundo->undosize = MEM_get_memory_in_use() - memused;
 	}
 
 	if (U.undomemory != 0) {
@@ -683,10 +680,12 @@ void BKE_write_undo(bContext *C, const char *name)
 		totmem = 0;
 		maxmem = ((uintptr_t)U.undomemory) * 1024 * 1024;
 
-		/* keep at least two (original + other) */
+		/* keep at least two (original + other), buffers shared by
+		 * steps are counted once, for the newest step using them */
+		BLO_memfile_size_begin();
 		uel = undobase.last;
 		while (uel && uel->prev) {
-			totmem += uel->undosize;
+			totmem += BLO_memfile_size_add(&uel->memfile);
 			if (totmem > maxmem) break;
 			uel = uel->prev;
 		}
@@ -699,7 +698,7 @@ void BKE_write_undo(bContext *C, const char *name)
 				UndoElem *first = undobase.first;
 				BLI_remlink(&undobase, first);
 				/* the merge is because of compression */
-				BLO_merge_memfile(&first->memfile, &first->next->memfile);
+				BLO_merge_memfile(&first->memfile);
 				MEM_freeN(first);
 			}
 		}
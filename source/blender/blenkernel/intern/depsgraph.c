@@ -79,6 +79,8 @@
 #include "BKE_tracking.h"
 
 #include "depsgraph_private.h"
+
+#include "atomic_ops.h"
  
 /* Queue and stack operations for dag traversal 
  *
@@ -444,11 +446,16 @@ static void build_dag_object(DagForest *dag, DagNode *scenenode, Scene *scene, O
 	DagNode *node;
 	DagNode *node2;
 	DagNode *node3;
+	DagNode *owner_prev = dag->build_owner;
 	Key *key;
 	ParticleSystem *psys;
 	int addtoroot = 1;
 	
 	node = dag_get_node(dag, ob);
+	node->relations_built = TRUE;
+
+	/* all arcs added from here on belong to this object */
+	dag->build_owner = node;
 	
 	if ((ob->data) && (mask & DAG_RL_DATA)) {
 		node2 = dag_get_node(dag, ob->data);
@@ -818,6 +825,8 @@ static void build_dag_object(DagForest *dag, DagNode *scenenode, Scene *scene, O
 
 	if (addtoroot == 1)
 		dag_add_relation(dag, scenenode, node, DAG_RL_SCENE, "Scene Relation");
+
+	dag->build_owner = owner_prev;
 }
 
 static void build_dag_group(DagForest *dag, DagNode *scenenode, Scene *scene, Group *group, short mask)
@@ -836,14 +845,48 @@ static void build_dag_group(DagForest *dag, DagNode *scenenode, Scene *scene, Gr
 	}
 }
 
+/* Now all relations were built, but we need to solve 1 exceptional case;
+ * When objects have multiple "parents" (for example parent + constraint working on same object)
+ * the relation type has to be synced. One of the parents can change, and should give same event to child */
+static void dag_sync_relation_types(DagForest *dag)
+{
+	DagNode *node;
+	DagAdjList *itA;
+
+	/* use node->color for temporal storage */
+	for (node = dag->DagNode.first; node; node = node->next)
+		node->color = 0;
+
+	for (node = dag->DagNode.first; node; node = node->next) {
+		if (node->type == ID_OB) {
+			for (itA = node->child; itA; itA = itA->next) {
+				if (itA->node->type == ID_OB) {
+					itA->node->color |= itA->type;
+				}
+			}
+
+			/* also flush custom data mask */
+			((Object *)node->ob)->customdata_mask = node->customdata_mask;
+		}
+	}
+	/* now set relations equal, so that when only one parent changes, the correct recalcs are found */
+	for (node = dag->DagNode.first; node; node = node->next) {
+		if (node->type == ID_OB) {
+			for (itA = node->child; itA; itA = itA->next) {
+				if (itA->node->type == ID_OB) {
+					itA->type |= itA->node->color;
+				}
+			}
+		}
+	}
+}
+
 DagForest *build_dag(Main *bmain, Scene *sce, short mask)
 {
 	Base *base;
 	Object *ob;
-	DagNode *node;
 	DagNode *scenenode;
 	DagForest *dag;
-	DagAdjList *itA;
 
 	dag = sce->theDag;
 	if (dag)
@@ -874,38 +917,112 @@ DagForest *build_dag(Main *bmain, Scene *sce, short mask)
 	
 	tag_main_idcode(bmain, ID_GR, FALSE);
 	
-	/* Now all relations were built, but we need to solve 1 exceptional case;
-	 * When objects have multiple "parents" (for example parent + constraint working on same object)
-	 * the relation type has to be synced. One of the parents can change, and should give same event to child */
+	dag_sync_relation_types(dag);
 	
-	/* nodes were callocced, so we can use node->color for temporal storage */
-	for (node = sce->theDag->DagNode.first; node; node = node->next) {
-		if (node->type == ID_OB) {
-			for (itA = node->child; itA; itA = itA->next) {
-				if (itA->node->type == ID_OB) {
-					itA->node->color |= itA->type;
-				}
+	/* cycle detection and solving */
+	// solve_cycles(dag);
+	
+	return dag;
+}
+
+/* remove all arcs created by building the relations of tagged nodes,
+ * returns the number of nodes which had arcs removed */
+static int dag_remove_tagged_relations(DagForest *dag)
+{
+	DagNode *node;
+	DagAdjList *itA, **itA_p;
+	int tot_touched = 0;
+
+	for (node = dag->DagNode.first; node; node = node->next) {
+		int touched = node->relations_tagged;
+
+		for (itA_p = &node->child; (itA = *itA_p); ) {
+			if (itA->owner && itA->owner->relations_tagged) {
+				*itA_p = itA->next;
+				MEM_freeN(itA);
+				touched = TRUE;
 			}
+			else
+				itA_p = &itA->next;
+		}
 
-			/* also flush custom data mask */
-			((Object *)node->ob)->customdata_mask = node->customdata_mask;
+		if (touched)
+			tot_touched++;
+	}
+
+	return tot_touched;
+}
+
+static void dag_add_parent_relation(DagNode *owner, DagNode *fob1, DagNode *fob2, short rel, const char *name);
+
+/* parent arcs are freed after cycle checking, recreate them from the child arcs */
+static void dag_rebuild_parent_relations(DagForest *dag)
+{
+	DagNode *node;
+	DagAdjList *itA;
+
+	for (node = dag->DagNode.first; node; node = node->next) {
+		while (node->parent) {
+			itA = node->parent->next;
+			MEM_freeN(node->parent);
+			node->parent = itA;
 		}
 	}
-	/* now set relations equal, so that when only one parent changes, the correct recalcs are found */
-	for (node = sce->theDag->DagNode.first; node; node = node->next) {
-		if (node->type == ID_OB) {
-			for (itA = node->child; itA; itA = itA->next) {
-				if (itA->node->type == ID_OB) {
-					itA->type |= itA->node->color;
-				}
-			}
+
+	for (node = dag->DagNode.first; node; node = node->next) {
+		for (itA = node->child; itA; itA = itA->next)
+			dag_add_parent_relation(itA->owner, node, itA->node, itA->type, itA->name);
+	}
+}
+
+/* rebuild only the relations of tagged objects, patching the existing graph.
+ * returns the number of nodes which were touched */
+static int update_dag_tagged(Main *bmain, Scene *sce, short mask)
+{
+	DagForest *dag = sce->theDag;
+	DagNode *node, *scenenode, *lastnode;
+	int tot_nodes = dag->numNodes;
+	int tot_touched;
+
+	/* clear "LIB_DOIT" flag, same as for a full build */
+	tag_main_idcode(bmain, ID_MA, FALSE);
+	tag_main_idcode(bmain, ID_LA, FALSE);
+	tag_main_idcode(bmain, ID_GR, FALSE);
+
+	tot_touched = dag_remove_tagged_relations(dag);
+
+	/* building may add new nodes at the end, these don't need to be visited */
+	scenenode = dag->DagNode.first;
+	lastnode = dag->DagNode.last;
+
+	for (node = scenenode; node; node = node->next) {
+		if (node->relations_tagged) {
+			Object *ob = node->ob;
+			/* masks requested by other objects are not rebuilt, keep them */
+			uint64_t customdata_mask = node->customdata_mask;
+
+			build_dag_object(dag, scenenode, sce, ob, mask);
+			if (ob->proxy)
+				build_dag_object(dag, scenenode, sce, ob->proxy, mask);
+			if (ob->dup_group)
+				build_dag_group(dag, scenenode, sce, ob->dup_group, mask);
+
+			node->customdata_mask |= customdata_mask;
+			node->relations_tagged = FALSE;
 		}
+
+		if (node == lastnode)
+			break;
 	}
-	
-	/* cycle detection and solving */
-	// solve_cycles(dag);
-	
-	return dag;
+
+	tag_main_idcode(bmain, ID_GR, FALSE);
+
+	dag->num_relations_tagged = 0;
+
+	dag_sync_relation_types(dag);
+	dag_rebuild_parent_relations(dag);
+
+	return tot_touched + (dag->numNodes - tot_nodes);
 }
 
 
@@ -941,6 +1058,8 @@ void free_forest(DagForest *Dag)
 	Dag->DagNode.first = NULL;
 	Dag->DagNode.last = NULL;
 	Dag->numNodes = 0;
+	Dag->build_owner = NULL;
+	Dag->num_relations_tagged = 0;
 
 }
 
@@ -1026,12 +1145,12 @@ DagNode *dag_get_sub_node(DagForest *forest, void *fob)
 	return node;
 }
 
-static void dag_add_parent_relation(DagForest *UNUSED(forest), DagNode *fob1, DagNode *fob2, short rel, const char *name) 
+static void dag_add_parent_relation(DagNode *owner, DagNode *fob1, DagNode *fob2, short rel, const char *name) 
 {
 	DagAdjList *itA = fob2->parent;
 	
 	while (itA) { /* search if relation exist already */
-		if (itA->node == fob1) {
+		if (itA->node == fob1 && itA->owner == owner) {
 			itA->type |= rel;
 			itA->count += 1;
 			return;
@@ -1045,18 +1164,22 @@ static void dag_add_parent_relation(DagForest *UNUSED(forest), DagNode *fob1, Da
 	itA->count = 1;
 	itA->next = fob2->parent;
 	itA->name = name;
+	itA->owner = owner;
 	fob2->parent = itA;
 }
 
 void dag_add_relation(DagForest *forest, DagNode *fob1, DagNode *fob2, short rel, const char *name) 
 {
 	DagAdjList *itA = fob1->child;
+	DagNode *owner = forest->build_owner;
 	
 	/* parent relation is for cycle checking */
-	dag_add_parent_relation(forest, fob1, fob2, rel, name);
+	dag_add_parent_relation(owner, fob1, fob2, rel, name);
 
+	/* arcs are unique per owner, so the relations of a single object can
+	 * be removed again without rebuilding the whole graph */
 	while (itA) { /* search if relation exist already */
-		if (itA->node == fob2) {
+		if (itA->node == fob2 && itA->owner == owner) {
 			itA->type |= rel;
 			itA->count += 1;
 			return;
@@ -1070,6 +1193,7 @@ void dag_add_relation(DagForest *forest, DagNode *fob1, DagNode *fob2, short rel
 	itA->count = 1;
 	itA->next = fob1->child;
 	itA->name = name;
+	itA->owner = owner;
 	fob1->child = itA;
 }
 
@@ -1323,21 +1447,23 @@ static void dag_scene_free(Scene *sce)
 }
 
 /* sort the base list on dependency order */
-static void dag_scene_build(Main *bmain, Scene *sce)
+static void dag_scene_sort_bases(Main *bmain, Scene *sce)
 {
 	DagNode *node, *rootnode;
 	DagNodeQueue *nqueue;
 	DagAdjList *itA;
+	GHash *base_hash;
 	int time;
 	int skip = 0;
 	ListBase tempbase;
 	Base *base;
 
 	tempbase.first = tempbase.last = NULL;
-	
-	build_dag(bmain, sce, DAG_RL_ALL_BUT_DATA);
-	
-	dag_check_cycle(sce->theDag);
+
+	/* object -> base lookup, avoids a linear search for every node */
+	base_hash = BLI_ghash_ptr_new("dag_scene_sort_bases gh");
+	for (base = sce->base.first; base; base = base->next)
+		BLI_ghash_insert(base_hash, base->object, base);
 
 	nqueue = queue_create(DAGQUEUEALLOC);
 	
@@ -1379,9 +1505,7 @@ static void dag_scene_build(Main *bmain, Scene *sce)
 				node->color = DAG_BLACK;
 				
 				time++;
-				base = sce->base.first;
-				while (base && base->object != node->ob)
-					base = base->next;
+				base = BLI_ghash_popkey(base_hash, node->ob, NULL);
 				if (base) {
 					BLI_remlink(&sce->base, base);
 					BLI_addhead(&tempbase, base);
@@ -1402,6 +1526,7 @@ static void dag_scene_build(Main *bmain, Scene *sce)
 	
 	sce->base = tempbase;
 	queue_delete(nqueue);
+	BLI_ghash_free(base_hash, NULL, NULL);
 	
 	/* all groups with objects in this scene gets resorted too */
 	scene_sort_groups(bmain, sce);
@@ -1417,6 +1542,32 @@ static void dag_scene_build(Main *bmain, Scene *sce)
 	sce->recalc |= SCE_PRV_CHANGED; /* test for 3d preview */
 }
 
+static void dag_scene_build(Main *bmain, Scene *sce)
+{
+	build_dag(bmain, sce, DAG_RL_ALL_BUT_DATA);
+	sce->theDag->num_nodes_touched = sce->theDag->numNodes;
+
+	dag_check_cycle(sce->theDag);
+	dag_scene_sort_bases(bmain, sce);
+
+	if (G.debug & G_DEBUG_DEPSGRAPH)
+		printf("%s: relations rebuilt, %d nodes\n", sce->id.name + 2, sce->theDag->numNodes);
+}
+
+/* incremental version of dag_scene_build, only for tagged objects */
+static void dag_scene_update_tagged(Main *bmain, Scene *sce)
+{
+	sce->theDag->num_nodes_touched = update_dag_tagged(bmain, sce, DAG_RL_ALL_BUT_DATA);
+
+	dag_check_cycle(sce->theDag);
+	dag_scene_sort_bases(bmain, sce);
+
+	if (G.debug & G_DEBUG_DEPSGRAPH) {
+		printf("%s: relations updated, %d of %d nodes touched\n", sce->id.name + 2,
+		       sce->theDag->num_nodes_touched, sce->theDag->numNodes);
+	}
+}
+
 /* clear all dependency graphs */
 void DAG_relations_tag_update(Main *bmain)
 {
@@ -1433,11 +1584,47 @@ void DAG_scene_relations_rebuild(Main *bmain, Scene *sce)
 	DAG_scene_relations_update(bmain, sce);
 }
 
-/* create dependency graph if it was cleared or didn't exist yet */
+/* tag relations of a single datablock for rebuild, unlike DAG_relations_tag_update
+ * the graph is kept and only the relations of this datablock are rebuilt */
+void DAG_id_relations_tag_update(Main *bmain, ID *id)
+{
+	Scene *sce;
+
+	/* only relations built by objects can be rebuilt separately */
+	if (GS(id->name) != ID_OB) {
+		DAG_relations_tag_update(bmain);
+		return;
+	}
+
+	for (sce = bmain->scene.first; sce; sce = sce->id.next) {
+		DagNode *node;
+
+		if (sce->theDag == NULL)
+			continue;
+
+		/* objects not built in this graph don't add any relations to it */
+		node = dag_find_node(sce->theDag, id);
+		if (node && node->relations_built && !node->relations_tagged) {
+			node->relations_tagged = TRUE;
+			sce->theDag->num_relations_tagged++;
+		}
+	}
+}
+
+/* number of nodes touched by the last (re)build of the scene relations */
+int DAG_scene_relations_num_touched(Scene *sce)
+{
+	return (sce->theDag) ? sce->theDag->num_nodes_touched : 0;
+}
+
+/* create dependency graph if it was cleared or didn't exist yet,
+ * or update relations of tagged datablocks */
 void DAG_scene_relations_update(Main *bmain, Scene *sce)
 {
 	if (!sce->theDag)
 		dag_scene_build(bmain, sce);
+	else if (sce->theDag->num_relations_tagged)
+		dag_scene_update_tagged(bmain, sce);
 }
 
 void DAG_scene_free(Scene *sce)
@@ -1449,6 +1636,91 @@ void DAG_scene_free(Scene *sce)
 	}
 }
 
+/* ************************ THREADED UPDATE ********************* */
+
+void DAG_threaded_update_begin(Scene *scene,
+                               void (*func)(void *node, void *user_data),
+                               void *user_data)
+{
+	DagForest *dag = scene->theDag;
+	DagNode *node, **ready_nodes;
+	DagAdjList *itA;
+	Base *base;
+	int i, tot_ready = 0;
+
+	for (node = dag->DagNode.first; node; node = node->next) {
+		node->valency = 0;
+		node->is_base = FALSE;
+		node->done = FALSE;
+	}
+
+	/* count number of parents, relations of a node to itself are ignored */
+	for (node = dag->DagNode.first; node; node = node->next) {
+		for (itA = node->child; itA; itA = itA->next) {
+			if (itA->node != node)
+				itA->node->valency++;
+		}
+	}
+
+	/* only objects from the scene bases are evaluated, other nodes (group
+	 * objects, objects from other scenes) only pass dependencies on */
+	for (base = scene->base.first; base; base = base->next) {
+		node = dag_find_node(dag, base->object);
+		if (node)
+			node->is_base = TRUE;
+	}
+
+	/* collect nodes first, func may start evaluating and scheduling children
+	 * before we're done iterating over the graph */
+	ready_nodes = MEM_mallocN(sizeof(DagNode *) * dag->numNodes, "DAG ready nodes");
+
+	for (node = dag->DagNode.first; node; node = node->next) {
+		if (node->valency == 0)
+			ready_nodes[tot_ready++] = node;
+	}
+
+	for (i = 0; i < tot_ready; i++)
+		func(ready_nodes[i], user_data);
+
+	MEM_freeN(ready_nodes);
+}
+
+void DAG_threaded_update_handle_node_updated(void *node_v,
+                                             void (*func)(void *node, void *user_data),
+                                             void *user_data)
+{
+	DagNode *node = node_v;
+	DagAdjList *itA;
+
+	node->done = TRUE;
+
+	for (itA = node->child; itA; itA = itA->next) {
+		DagNode *child_node = itA->node;
+
+		if (child_node != node) {
+			if (atomic_sub_uint32(&child_node->valency, 1) == 0)
+				func(child_node, user_data);
+		}
+	}
+}
+
+Object *DAG_threaded_update_node_object(void *node_v)
+{
+	DagNode *node = node_v;
+
+	if (node->type == ID_OB && node->is_base)
+		return node->ob;
+
+	return NULL;
+}
+
+int DAG_threaded_update_object_done(Scene *scene, Object *ob)
+{
+	DagNode *node = dag_find_node(scene->theDag, ob);
+
+	return (node && node->done);
+}
+
 static void lib_id_recalc_tag(Main *bmain, ID *id)
 {
 	id->flag |= LIB_ID_RECALC;
@@ -1707,6 +1707,11 @@ void ntreeFreeTree_ex(bNodeTree *ntree, const short do_id_user)
 		}
 	}
 	
+	/* cached compositor buffers may belong to this tree, localized copies
+	 * are freed after every execution and leave the cache alone */
+	if (ntree->type == NTREE_COMPOSIT && !(ntree->flag & NTREE_IS_LOCALIZED))
+		ntreeCompositClearCaches();
+	
 	/* XXX not nice, but needed to free localized node groups properly */
 	free_localized_node_groups(ntree);
 	
@@ -65,6 +65,7 @@
 #include "BLI_utildefines.h"
 #include "BLI_linklist.h"
 #include "BLI_kdtree.h"
+#include "BLI_threads.h"
 
 #include "BLF_translation.h"
 
@@ -2680,6 +2681,9 @@ bool BKE_object_parent_loop_check(const Object *par, const Object *ob)
 	return BKE_object_parent_loop_check(par->parent, ob);
 }
 
+/* material and lamp drivers of objects updated from multiple threads */
+static ThreadMutex material_drivers_mutex = BLI_MUTEX_INITIALIZER;
+
 /* proxy rule: lib_object->proxy_from == the one we borrow from, only set temporal and cleared here */
 /*           local_object->proxy      == pointer to library object, saved in files and read */
 
@@ -2811,7 +2815,10 @@ void BKE_object_handle_update_ex(Scene *scene, Object *ob,
 			/* XXX: without depsgraph tagging, this will always need to be run, which will be slow! 
 			 * However, not doing anything (or trying to hack around this lack) is not an option 
 			 * anymore, especially due to Cycles [#31834] 
+			 * materials and lamps can be shared by objects updated from different threads,
+			 * their drivers and LIB_DOIT tags are evaluated under a lock (see scene.c)
 			 */
+			BLI_mutex_lock(&material_drivers_mutex);
 			if (ob->totcol) {
 				int a;
 				
@@ -2826,6 +2833,7 @@ void BKE_object_handle_update_ex(Scene *scene, Object *ob,
 			}
 			else if (ob->type == OB_LAMP)
 				lamp_drivers_update(scene, ob->data, ctime);
+			BLI_mutex_unlock(&material_drivers_mutex);
 			
 			/* particles */
 			if (ob->particlesystem.first) {
@@ -43,8 +43,12 @@
 #include "MEM_guardedalloc.h"
 
 #include "DNA_anim_types.h"
+#include "DNA_constraint_types.h"
 #include "DNA_group_types.h"
+#include "DNA_key_types.h"
+#include "DNA_lamp_types.h"
 #include "DNA_linestyle_types.h"
+#include "DNA_material_types.h"
 #include "DNA_node_types.h"
 #include "DNA_object_types.h"
 #include "DNA_rigidbody_types.h"
@@ -56,7 +60,9 @@
 #include "BLI_blenlib.h"
 #include "BLI_utildefines.h"
 #include "BLI_callbacks.h"
+#include "BLI_ghash.h"
 #include "BLI_string.h"
+#include "BLI_task.h"
 #include "BLI_threads.h"
 
 #include "BLF_translation.h"
@@ -72,9 +78,11 @@
 #include "BKE_group.h"
 #include "BKE_idprop.h"
 #include "BKE_image.h"
+#include "BKE_key.h"
 #include "BKE_library.h"
 #include "BKE_main.h"
 #include "BKE_mask.h"
+#include "BKE_material.h"
 #include "BKE_node.h"
 #include "BKE_object.h"
 #include "BKE_paint.h"
@@ -1184,10 +1192,272 @@ static void scene_do_rb_simulation_recursive(Scene *scene, float ctime)
 		BKE_rigidbody_do_simulation(scene, ctime);
 }
 
-static void scene_update_tagged_recursive(Main *bmain, Scene *scene, Scene *scene_parent)
+static void scene_update_object(Scene *scene, Scene *scene_parent, Object *ob)
+{
+	BKE_object_handle_update_ex(scene_parent, ob, scene->rigidbody_world);
+
+	if (ob->dup_group && (ob->transflag & OB_DUPLIGROUP))
+		BKE_group_handle_recalc_and_update(scene_parent, ob, ob->dup_group);
+
+	/* always update layer, so that animating layers works (joshua july 2010) */
+	/* XXX commented out, this has depsgraph issues anyway - and this breaks setting scenes
+	 * (on scene-set, the base-lay is copied to ob-lay (ton nov 2012) */
+	// base->lay = ob->lay;
+}
+
+/* Threaded object update
+ *
+ * Objects are evaluated from the task scheduler as soon as all their parents
+ * in the dependency graph are evaluated. Datablocks which can be modified while
+ * evaluating multiple objects (obdata with multiple users, dupli-groups) get a
+ * mutex, everything else only relies on the dependency graph ordering. */
+
+typedef struct ThreadedObjectUpdateState {
+	Scene *scene;
+	Scene *scene_parent;
+
+	/* ID -> ThreadMutex, for datablocks shared between objects */
+	GHash *id_mutex_hash;
+} ThreadedObjectUpdateState;
+
+static bool animdata_has_python_drivers(AnimData *adt)
+{
+	FCurve *fcu;
+
+	if (adt == NULL)
+		return false;
+
+	for (fcu = adt->drivers.first; fcu; fcu = fcu->next) {
+		if (fcu->driver && fcu->driver->type == DRIVER_TYPE_PYTHON)
+			return true;
+	}
+
+	return false;
+}
+
+static bool nodetree_has_python_drivers(bNodeTree *ntree)
+{
+	bNode *node;
+
+	if (ntree == NULL)
+		return false;
+
+	if (animdata_has_python_drivers(ntree->adt))
+		return true;
+
+	for (node = ntree->nodes.first; node; node = node->next) {
+		if (node->id && node->type == NODE_GROUP && node->id != &ntree->id) {
+			if (nodetree_has_python_drivers((bNodeTree *)node->id))
+				return true;
+		}
+	}
+
+	return false;
+}
+
+static bool constraints_have_python(ListBase *constraints)
+{
+	bConstraint *con;
+
+	for (con = constraints->first; con; con = con->next) {
+		if (con->type == CONSTRAINT_TYPE_PYTHON)
+			return true;
+	}
+
+	return false;
+}
+
+/* python drivers and constraints need the GIL, which the main thread may be holding */
+static bool object_update_runs_python(Object *ob)
+{
+	Key *key;
+	int a;
+
+	if (animdata_has_python_drivers(ob->adt))
+		return true;
+
+	/* obdata drivers, lamp node drivers are evaluated with the materials */
+	if (ob->data && animdata_has_python_drivers(BKE_animdata_from_id(ob->data)))
+		return true;
+	if (ob->type == OB_LAMP && nodetree_has_python_drivers(((Lamp *)ob->data)->nodetree))
+		return true;
+
+	key = BKE_key_from_object(ob);
+	if (key && animdata_has_python_drivers(key->adt))
+		return true;
+
+	for (a = 1; a <= ob->totcol; a++) {
+		Material *ma = give_current_material(ob, a);
+
+		if (ma && (animdata_has_python_drivers(ma->adt) || nodetree_has_python_drivers(ma->nodetree)))
+			return true;
+	}
+
+	if (constraints_have_python(&ob->constraints))
+		return true;
+
+	if (ob->pose) {
+		bPoseChannel *pchan;
+
+		for (pchan = ob->pose->chanbase.first; pchan; pchan = pchan->next) {
+			if (constraints_have_python(&pchan->constraints))
+				return true;
+		}
+	}
+
+	return false;
+}
+
+/* objects which can only be evaluated in the main thread, these are left to
+ * the single threaded pass together with all objects depending on them */
+static bool object_update_needs_main_thread(Object *ob)
+{
+	/* metaballs are polygonized together with the whole metaball family,
+	 * fonts load glyphs lazily into the VFont shared between objects */
+	if (ELEM(ob->type, OB_MBALL, OB_FONT))
+		return true;
+
+	if (object_update_runs_python(ob))
+		return true;
+
+	/* group objects are updated together with the dupli-group object */
+	if (ob->dup_group && (ob->transflag & OB_DUPLIGROUP)) {
+		GroupObject *go;
+
+		for (go = ob->dup_group->gobject.first; go; go = go->next) {
+			if (go->ob && object_update_runs_python(go->ob))
+				return true;
+		}
+	}
+
+	return false;
+}
+
+static void scene_update_id_mutex_ensure(GHash *id_mutex_hash, ID *id)
+{
+	if (!BLI_ghash_haskey(id_mutex_hash, id)) {
+		ThreadMutex *mutex = MEM_mallocN(sizeof(ThreadMutex), "object update id mutex");
+		BLI_mutex_init(mutex);
+		BLI_ghash_insert(id_mutex_hash, id, mutex);
+	}
+}
+
+static void scene_update_id_mutex_free(void *mutex_v)
+{
+	ThreadMutex *mutex = mutex_v;
+
+	BLI_mutex_end(mutex);
+	MEM_freeN(mutex);
+}
+
+static void scene_update_object_locked(ThreadedObjectUpdateState *state, Object *ob)
+{
+	ThreadMutex *data_mutex = NULL, *group_mutex = NULL;
+
+	if (ob->data)
+		data_mutex = BLI_ghash_lookup(state->id_mutex_hash, ob->data);
+
+	if (data_mutex) BLI_mutex_lock(data_mutex);
+	BKE_object_handle_update_ex(state->scene_parent, ob, state->scene->rigidbody_world);
+	if (data_mutex) BLI_mutex_unlock(data_mutex);
+
+	if (ob->dup_group && (ob->transflag & OB_DUPLIGROUP)) {
+		group_mutex = BLI_ghash_lookup(state->id_mutex_hash, ob->dup_group);
+
+		if (group_mutex) BLI_mutex_lock(group_mutex);
+		BKE_group_handle_recalc_and_update(state->scene_parent, ob, ob->dup_group);
+		if (group_mutex) BLI_mutex_unlock(group_mutex);
+	}
+}
+
+static void scene_update_object_add_task(void *node, void *user_data);
+
+static void scene_update_object_func(TaskPool *pool, void *taskdata, int UNUSED(threadid))
 {
+	ThreadedObjectUpdateState *state = (ThreadedObjectUpdateState *) BLI_task_pool_userdata(pool);
+	void *node = taskdata;
+	Object *ob = DAG_threaded_update_node_object(node);
+
+	if (ob) {
+		/* node and its children will be handled by the single threaded pass */
+		if (object_update_needs_main_thread(ob))
+			return;
+
+		scene_update_object_locked(state, ob);
+	}
+
+	/* schedule children which have all of their parents evaluated now */
+	DAG_threaded_update_handle_node_updated(node, scene_update_object_add_task, pool);
+}
+
+static void scene_update_object_add_task(void *node, void *user_data)
+{
+	TaskPool *task_pool = user_data;
+
+	BLI_task_pool_push(task_pool, scene_update_object_func, node, false, TASK_PRIORITY_LOW);
+}
+
+static void scene_update_objects_threaded(Scene *scene, Scene *scene_parent, TaskScheduler *task_scheduler)
+{
+	ThreadedObjectUpdateState state;
+	TaskPool *task_pool;
 	Base *base;
-	
+
+	state.scene = scene;
+	state.scene_parent = scene_parent;
+	state.id_mutex_hash = BLI_ghash_ptr_new("object update id mutex gh");
+
+	/* mutexes are created in advance, the hash is read-only from the threads */
+	for (base = scene->base.first; base; base = base->next) {
+		Object *ob = base->object;
+
+		if (ob->data && ID_REAL_USERS(ob->data) > 1)
+			scene_update_id_mutex_ensure(state.id_mutex_hash, ob->data);
+		if (ob->dup_group && (ob->transflag & OB_DUPLIGROUP))
+			scene_update_id_mutex_ensure(state.id_mutex_hash, &ob->dup_group->id);
+	}
+
+	task_pool = BLI_task_pool_create(task_scheduler, &state);
+
+	DAG_threaded_update_begin(scene, scene_update_object_add_task, task_pool);
+	BLI_task_pool_work_and_wait(task_pool);
+
+	BLI_task_pool_free(task_pool);
+
+	/* single threaded pass for objects in dependency cycles, objects that can't
+	 * be evaluated from threads and everything depending on those. Bases are
+	 * sorted already, so this happens in the same order as without threads. */
+	for (base = scene->base.first; base; base = base->next) {
+		Object *ob = base->object;
+
+		if (!DAG_threaded_update_object_done(scene, ob))
+			scene_update_object(scene, scene_parent, ob);
+	}
+
+	BLI_ghash_free(state.id_mutex_hash, NULL, scene_update_id_mutex_free);
+}
+
+static void scene_update_objects(Scene *scene, Scene *scene_parent)
+{
+	TaskScheduler *task_scheduler = BLI_task_scheduler_get();
+	Base *base;
+
+	/* threads are only used from the main thread, render threads updating
+	 * their scene copy keep using the sorted base order */
+	if (scene->theDag && BLI_thread_is_main() &&
+	    BLI_task_scheduler_num_threads(task_scheduler) > 1 &&
+	    scene->base.first != scene->base.last)
+	{
+		scene_update_objects_threaded(scene, scene_parent, task_scheduler);
+		return;
+	}
+
+	for (base = scene->base.first; base; base = base->next)
+		scene_update_object(scene, scene_parent, base->object);
+}
+
+static void scene_update_tagged_recursive(Main *bmain, Scene *scene, Scene *scene_parent)
+{
 	scene->customdata_mask = scene_parent->customdata_mask;
 
 	/* sets first, we allow per definition current scene to have
@@ -1196,19 +1466,7 @@ static void scene_update_tagged_recursive(Main *bmain, Scene *scene, Scene *scen
 		scene_update_tagged_recursive(bmain, scene->set, scene_parent);
 	
 	/* scene objects */
-	for (base = scene->base.first; base; base = base->next) {
-		Object *ob = base->object;
-		
-		BKE_object_handle_update_ex(scene_parent, ob, scene->rigidbody_world);
-		
-		if (ob->dup_group && (ob->transflag & OB_DUPLIGROUP))
-			BKE_group_handle_recalc_and_update(scene_parent, ob, ob->dup_group);
-			
-		/* always update layer, so that animating layers works (joshua july 2010) */
-		/* XXX commented out, this has depsgraph issues anyway - and this breaks setting scenes
-		 * (on scene-set, the base-lay is copied to ob-lay (ton nov 2012) */
-		// base->lay = ob->lay;
-	}
+	scene_update_objects(scene, scene_parent);
 	
 	/* scene drivers... */
 	scene_update_drivers(bmain, scene);
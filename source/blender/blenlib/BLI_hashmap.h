@@ -0,0 +1,96 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ */
+
+#ifndef __BLI_HASHMAP_H__
+#define __BLI_HASHMAP_H__
+
+/** \file BLI_hashmap.h
+ *  \ingroup bli
+ *  \brief An open addressing (pointer -> pointer) hash table ADT
+ *
+ * Same semantics and callbacks as GHash, but keys and values are stored inline
+ * in one array (Robin Hood linear probing) instead of a mempool allocated entry
+ * per item, so lookups don't need to chase a pointer per bucket. The full key
+ * hashes are kept in a separate compact array, which is what probing scans,
+ * the key compare function is only called on a hash match.
+ *
+ * Use it for maps with many lookups, removing items is supported but slower
+ * than with GHash. Pointers into the map (#BLI_hashmap_lookup_p) are only valid
+ * until the next insert or remove.
+ */
+
+#include "BLI_sys_types.h" /* for bool */
+#include "BLI_compiler_attrs.h"
+#include "BLI_ghash.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct HashMap HashMap;
+
+typedef struct HashMapIterator {
+	HashMap *hm;
+	unsigned int index;
+} HashMapIterator;
+
+HashMap *BLI_hashmap_new_ex(GHashHashFP hashfp, GHashCmpFP cmpfp, const char *info,
+                            const unsigned int nentries_reserve) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+HashMap *BLI_hashmap_new(GHashHashFP hashfp, GHashCmpFP cmpfp, const char *info) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+void   BLI_hashmap_free(HashMap *hm, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp);
+void   BLI_hashmap_insert(HashMap *hm, void *key, void *val);
+bool   BLI_hashmap_reinsert(HashMap *hm, void *key, void *val, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp);
+void  *BLI_hashmap_lookup(HashMap *hm, const void *key) ATTR_WARN_UNUSED_RESULT;
+void **BLI_hashmap_lookup_p(HashMap *hm, const void *key) ATTR_WARN_UNUSED_RESULT;
+bool   BLI_hashmap_remove(HashMap *hm, void *key, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp);
+void  *BLI_hashmap_popkey(HashMap *hm, void *key, GHashKeyFreeFP keyfreefp) ATTR_WARN_UNUSED_RESULT;
+void   BLI_hashmap_clear(HashMap *hm, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp);
+bool   BLI_hashmap_haskey(HashMap *hm, const void *key) ATTR_WARN_UNUSED_RESULT;
+int    BLI_hashmap_size(HashMap *hm) ATTR_WARN_UNUSED_RESULT;
+
+HashMap *BLI_hashmap_ptr_new_ex(const char *info,
+                                const unsigned int nentries_reserve) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+HashMap *BLI_hashmap_ptr_new(const char *info) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+HashMap *BLI_hashmap_str_new_ex(const char *info,
+                                const unsigned int nentries_reserve) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+HashMap *BLI_hashmap_str_new(const char *info) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+HashMap *BLI_hashmap_int_new_ex(const char *info,
+                                const unsigned int nentries_reserve) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+HashMap *BLI_hashmap_int_new(const char *info) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+
+/* *** */
+
+void   BLI_hashmapIterator_init(HashMapIterator *hmi, HashMap *hm);
+void  *BLI_hashmapIterator_getKey(HashMapIterator *hmi) ATTR_WARN_UNUSED_RESULT;
+void  *BLI_hashmapIterator_getValue(HashMapIterator *hmi) ATTR_WARN_UNUSED_RESULT;
+void **BLI_hashmapIterator_getValue_p(HashMapIterator *hmi) ATTR_WARN_UNUSED_RESULT;
+void   BLI_hashmapIterator_step(HashMapIterator *hmi);
+bool   BLI_hashmapIterator_done(HashMapIterator *hmi) ATTR_WARN_UNUSED_RESULT;
+
+#define HASHMAP_ITER(hm_iter_, hashmap_)                                      \
+	for (BLI_hashmapIterator_init(&hm_iter_, hashmap_);                       \
+	     BLI_hashmapIterator_done(&hm_iter_) == false;                        \
+	     BLI_hashmapIterator_step(&hm_iter_))
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BLI_HASHMAP_H__ */
@@ -34,8 +34,10 @@ extern "C" {
 
 /* Task Scheduler
  * 
- * Central scheduler that holds running threads ready to execute tasks. A single
- * queue holds the task from all pools.
+ * Central scheduler that holds running threads ready to execute tasks. Tasks
+ * pushed from worker threads go to a per thread deque, which the owner works
+ * through depth first and other threads steal from when they run out of work.
+ * Tasks pushed from other threads go to a single shared queue.
  *
  * Init/exit must be called before/after any task pools are created/freed, and
  * must be called from the main threads. All other scheduler and pool functions
@@ -100,6 +102,19 @@ ThreadMutex *BLI_task_pool_user_mutex(TaskPool *pool);
 /* number of tasks done, for stats, don't use this to make decisions */
 size_t BLI_task_pool_tasks_done(TaskPool *pool);
 
+/* Parallel range
+ *
+ * Run func for every iteration in [start, stop) using the global task
+ * scheduler, and wait until all are done. The range is split in chunks
+ * automatically, ranges smaller than range_threshold run in the calling
+ * thread. func may be called from any thread, in any order. */
+
+typedef void (*TaskParallelRangeFunc)(void *userdata, int iter);
+
+void BLI_task_parallel_range_ex(int start, int stop, void *userdata,
+                                TaskParallelRangeFunc func, const int range_threshold);
+void BLI_task_parallel_range(int start, int stop, void *userdata, TaskParallelRangeFunc func);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,539 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ */
+
+/** \file blender/blenlib/intern/BLI_hashmap.c
+ *  \ingroup bli
+ *
+ * An open addressing (pointer -> pointer) hash table ADT.
+ *
+ * Uses linear probing with the Robin Hood insertion rule: an entry being
+ * inserted takes the slot of any entry that is closer to its home bucket,
+ * which keeps probe sequences short and lets lookups of missing keys stop
+ * early. Removal uses backward shifting, so no tombstones are needed.
+ *
+ * Hashes are stored in their own array (0 means an empty slot),
+ * the key/value pairs are only touched once the hashes match.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_sys_types.h"
+#include "BLI_utildefines.h"
+#include "BLI_ghash.h"
+#include "BLI_hashmap.h"
+#include "BLI_strict_flags.h"
+
+/* smallest table size, must be a power of two */
+#define HASHMAP_SIZE_MIN 16
+
+/***/
+
+typedef struct HashMapSlot {
+	void *key, *val;
+} HashMapSlot;
+
+struct HashMap {
+	GHashHashFP hashfp;
+	GHashCmpFP cmpfp;
+
+	unsigned int *hashes;
+	HashMapSlot *slots;
+	unsigned int size;  /* power of two */
+	unsigned int nentries;
+	unsigned int nentries_limit;
+};
+
+
+/* -------------------------------------------------------------------- */
+/* HashMap API */
+
+/** \name Internal Utility API
+ * \{ */
+
+/**
+ * Get the stored hash for a key.
+ *
+ * The callback hash is finalized (murmur3 fmix32) since only the low bits select
+ * the home slot, the pointer hash in particular leaves these poorly distributed.
+ * Zero is reserved to tag empty slots.
+ */
+BLI_INLINE unsigned int hashmap_keyhash(HashMap *hm, const void *key)
+{
+	unsigned int h = hm->hashfp(key);
+
+	h ^= h >> 16;
+	h *= 0x85ebca6bu;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35u;
+	h ^= h >> 16;
+
+	return h ? h : 1;
+}
+
+/**
+ * Distance of the entry with \a hash stored at \a index from its home slot.
+ */
+BLI_INLINE unsigned int hashmap_probe_distance(HashMap *hm, const unsigned int hash, const unsigned int index)
+{
+	return (index - hash) & (hm->size - 1);
+}
+
+/**
+ * Keep the load factor under 0.8, probe sequences get long quickly above that.
+ */
+BLI_INLINE unsigned int hashmap_size_limit(const unsigned int size)
+{
+	return size - (size / 5);
+}
+
+BLI_INLINE unsigned int hashmap_size_for_reserve(const unsigned int nentries_reserve)
+{
+	unsigned int size = HASHMAP_SIZE_MIN;
+	while (hashmap_size_limit(size) < nentries_reserve) {
+		size <<= 1;
+	}
+	return size;
+}
+
+static void hashmap_alloc_slots(HashMap *hm, const unsigned int size)
+{
+	BLI_assert((size & (size - 1)) == 0);
+
+	hm->size = size;
+	hm->nentries_limit = hashmap_size_limit(size);
+	hm->hashes = MEM_callocN(size * sizeof(*hm->hashes), "HashMap hashes");
+	hm->slots = MEM_mallocN(size * sizeof(*hm->slots), "HashMap slots");
+}
+
+/**
+ * Internal lookup function.
+ * Takes a hash argument to avoid calling #hashmap_keyhash multiple times.
+ *
+ * \return the slot index, or -1 when the key isn't found.
+ */
+BLI_INLINE int hashmap_lookup_index_ex(HashMap *hm, const void *key, const unsigned int hash)
+{
+	const unsigned int mask = hm->size - 1;
+	unsigned int index = hash & mask;
+	unsigned int dist;
+
+	for (dist = 0; ; dist++) {
+		const unsigned int hash_test = hm->hashes[index];
+
+		/* an empty slot, or an entry closer to home than we are:
+		 * the key would have been placed before it */
+		if (hash_test == 0 || hashmap_probe_distance(hm, hash_test, index) < dist) {
+			return -1;
+		}
+		if (hash_test == hash && UNLIKELY(hm->cmpfp(key, hm->slots[index].key) == 0)) {
+			return (int)index;
+		}
+
+		index = (index + 1) & mask;
+	}
+}
+
+BLI_INLINE int hashmap_lookup_index(HashMap *hm, const void *key)
+{
+	return hashmap_lookup_index_ex(hm, key, hashmap_keyhash(hm, key));
+}
+
+/**
+ * Place an entry which isn't in the table, without checking the size limit.
+ */
+BLI_INLINE void hashmap_insert_slot(HashMap *hm, unsigned int hash, void *key, void *val)
+{
+	const unsigned int mask = hm->size - 1;
+	unsigned int index = hash & mask;
+	unsigned int dist = 0;
+
+	for (;;) {
+		const unsigned int hash_test = hm->hashes[index];
+		unsigned int dist_test;
+
+		if (hash_test == 0) {
+			hm->hashes[index] = hash;
+			hm->slots[index].key = key;
+			hm->slots[index].val = val;
+			return;
+		}
+
+		/* robin hood: take the slot from entries closer to their home slot,
+		 * then continue placing the displaced entry */
+		dist_test = hashmap_probe_distance(hm, hash_test, index);
+		if (dist_test < dist) {
+			HashMapSlot *slot = &hm->slots[index];
+			void *key_swap = slot->key;
+			void *val_swap = slot->val;
+
+			hm->hashes[index] = hash;
+			slot->key = key;
+			slot->val = val;
+
+			hash = hash_test;
+			key = key_swap;
+			val = val_swap;
+			dist = dist_test;
+		}
+
+		index = (index + 1) & mask;
+		dist++;
+	}
+}
+
+static void hashmap_resize(HashMap *hm, const unsigned int size)
+{
+	unsigned int *hashes_old = hm->hashes;
+	HashMapSlot *slots_old = hm->slots;
+	const unsigned int size_old = hm->size;
+	unsigned int i;
+
+	hashmap_alloc_slots(hm, size);
+
+	for (i = 0; i < size_old; i++) {
+		if (hashes_old[i]) {
+			hashmap_insert_slot(hm, hashes_old[i], slots_old[i].key, slots_old[i].val);
+		}
+	}
+
+	MEM_freeN(hashes_old);
+	MEM_freeN(slots_old);
+}
+
+BLI_INLINE void hashmap_insert_ex(HashMap *hm, void *key, void *val, const unsigned int hash)
+{
+	BLI_assert(hashmap_lookup_index_ex(hm, key, hash) == -1);
+
+	if (UNLIKELY(hm->nentries >= hm->nentries_limit)) {
+		hashmap_resize(hm, hm->size << 1);
+	}
+
+	hashmap_insert_slot(hm, hash, key, val);
+	hm->nentries++;
+}
+
+/**
+ * Empty the slot at \a index, shifting the following entries of the cluster back
+ * (tombstone free deletion).
+ */
+static void hashmap_remove_index(HashMap *hm, unsigned int index)
+{
+	const unsigned int mask = hm->size - 1;
+	unsigned int index_next = (index + 1) & mask;
+
+	while (hm->hashes[index_next] &&
+	       hashmap_probe_distance(hm, hm->hashes[index_next], index_next) != 0)
+	{
+		hm->hashes[index] = hm->hashes[index_next];
+		hm->slots[index] = hm->slots[index_next];
+		index = index_next;
+		index_next = (index_next + 1) & mask;
+	}
+
+	hm->hashes[index] = 0;
+	hm->nentries--;
+}
+
+/**
+ * Run free callbacks for freeing entries.
+ */
+static void hashmap_free_cb(HashMap *hm, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp)
+{
+	unsigned int i;
+
+	BLI_assert(keyfreefp || valfreefp);
+
+	for (i = 0; i < hm->size; i++) {
+		if (hm->hashes[i]) {
+			if (keyfreefp) keyfreefp(hm->slots[i].key);
+			if (valfreefp) valfreefp(hm->slots[i].val);
+		}
+	}
+}
+
+/** \} */
+
+
+/** \name Public API
+ * \{ */
+
+/**
+ * Creates a new, empty HashMap.
+ *
+ * \param hashfp  Hash callback.
+ * \param cmpfp  Comparison callback.
+ * \param info  Identifier string for the HashMap.
+ * \param nentries_reserve  Optionally reserve the number of members that the hash will hold.
+ * \return  An empty HashMap.
+ */
+HashMap *BLI_hashmap_new_ex(GHashHashFP hashfp, GHashCmpFP cmpfp, const char *info,
+                            const unsigned int nentries_reserve)
+{
+	HashMap *hm = MEM_mallocN(sizeof(*hm), info);
+
+	hm->hashfp = hashfp;
+	hm->cmpfp = cmpfp;
+	hm->nentries = 0;
+
+	hashmap_alloc_slots(hm, hashmap_size_for_reserve(nentries_reserve));
+
+	return hm;
+}
+
+/**
+ * Wraps #BLI_hashmap_new_ex with zero entries reserved.
+ */
+HashMap *BLI_hashmap_new(GHashHashFP hashfp, GHashCmpFP cmpfp, const char *info)
+{
+	return BLI_hashmap_new_ex(hashfp, cmpfp, info, 0);
+}
+
+/**
+ * \return size of the HashMap.
+ */
+int BLI_hashmap_size(HashMap *hm)
+{
+	return (int)hm->nentries;
+}
+
+/**
+ * Insert a key/value pair into the \a hm.
+ *
+ * \note Duplicates are not checked,
+ * the caller is expected to ensure elements are unique.
+ */
+void BLI_hashmap_insert(HashMap *hm, void *key, void *val)
+{
+	hashmap_insert_ex(hm, key, val, hashmap_keyhash(hm, key));
+}
+
+/**
+ * Inserts a new value to a key that may already be in the map.
+ *
+ * \returns true if a new key has been added.
+ */
+bool BLI_hashmap_reinsert(HashMap *hm, void *key, void *val, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp)
+{
+	const unsigned int hash = hashmap_keyhash(hm, key);
+	const int index = hashmap_lookup_index_ex(hm, key, hash);
+	if (index != -1) {
+		HashMapSlot *slot = &hm->slots[index];
+		if (keyfreefp) keyfreefp(slot->key);
+		if (valfreefp) valfreefp(slot->val);
+		slot->key = key;
+		slot->val = val;
+		return false;
+	}
+	else {
+		hashmap_insert_ex(hm, key, val, hash);
+		return true;
+	}
+}
+
+/**
+ * Lookup the value of \a key in \a hm.
+ *
+ * \returns the value for \a key or NULL.
+ */
+void *BLI_hashmap_lookup(HashMap *hm, const void *key)
+{
+	const int index = hashmap_lookup_index(hm, key);
+	return (index != -1) ? hm->slots[index].val : NULL;
+}
+
+/**
+ * Lookup a pointer to the value of \a key in \a hm.
+ *
+ * \returns the pointer to value for \a key or NULL.
+ *
+ * \note The pointer is only valid until the next insertion or removal.
+ */
+void **BLI_hashmap_lookup_p(HashMap *hm, const void *key)
+{
+	const int index = hashmap_lookup_index(hm, key);
+	return (index != -1) ? &hm->slots[index].val : NULL;
+}
+
+/**
+ * Remove \a key from \a hm, or return false if the key wasn't found.
+ */
+bool BLI_hashmap_remove(HashMap *hm, void *key, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp)
+{
+	const int index = hashmap_lookup_index(hm, key);
+	if (index != -1) {
+		HashMapSlot *slot = &hm->slots[index];
+		if (keyfreefp) keyfreefp(slot->key);
+		if (valfreefp) valfreefp(slot->val);
+		hashmap_remove_index(hm, (unsigned int)index);
+		return true;
+	}
+	else {
+		return false;
+	}
+}
+
+/**
+ * Remove \a key from \a hm, returning the value or NULL if the key wasn't found.
+ */
+void *BLI_hashmap_popkey(HashMap *hm, void *key, GHashKeyFreeFP keyfreefp)
+{
+	const int index = hashmap_lookup_index(hm, key);
+	if (index != -1) {
+		HashMapSlot *slot = &hm->slots[index];
+		void *val = slot->val;
+		if (keyfreefp) keyfreefp(slot->key);
+		hashmap_remove_index(hm, (unsigned int)index);
+		return val;
+	}
+	else {
+		return NULL;
+	}
+}
+
+/**
+ * \return true if the \a key is in \a hm.
+ */
+bool BLI_hashmap_haskey(HashMap *hm, const void *key)
+{
+	return (hashmap_lookup_index(hm, key) != -1);
+}
+
+/**
+ * Reset \a hm clearing all entries, the table keeps its size.
+ */
+void BLI_hashmap_clear(HashMap *hm, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp)
+{
+	if (keyfreefp || valfreefp)
+		hashmap_free_cb(hm, keyfreefp, valfreefp);
+
+	memset(hm->hashes, 0, hm->size * sizeof(*hm->hashes));
+	hm->nentries = 0;
+}
+
+/**
+ * Frees the HashMap and its members.
+ */
+void BLI_hashmap_free(HashMap *hm, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp)
+{
+	if (keyfreefp || valfreefp)
+		hashmap_free_cb(hm, keyfreefp, valfreefp);
+
+	MEM_freeN(hm->hashes);
+	MEM_freeN(hm->slots);
+	MEM_freeN(hm);
+}
+
+/** \} */
+
+
+/** \name Iterator API
+ * \{ */
+
+BLI_INLINE void hashmap_iterator_skip_empty(HashMapIterator *hmi)
+{
+	HashMap *hm = hmi->hm;
+	while (hmi->index < hm->size && hm->hashes[hmi->index] == 0) {
+		hmi->index++;
+	}
+}
+
+/**
+ * Init an already allocated HashMapIterator.
+ *
+ * \note Iteration order is undefined and changes when the map is modified.
+ */
+void BLI_hashmapIterator_init(HashMapIterator *hmi, HashMap *hm)
+{
+	hmi->hm = hm;
+	hmi->index = 0;
+	hashmap_iterator_skip_empty(hmi);
+}
+
+void *BLI_hashmapIterator_getKey(HashMapIterator *hmi)
+{
+	return hmi->hm->slots[hmi->index].key;
+}
+
+void *BLI_hashmapIterator_getValue(HashMapIterator *hmi)
+{
+	return hmi->hm->slots[hmi->index].val;
+}
+
+void **BLI_hashmapIterator_getValue_p(HashMapIterator *hmi)
+{
+	return &hmi->hm->slots[hmi->index].val;
+}
+
+void BLI_hashmapIterator_step(HashMapIterator *hmi)
+{
+	if (hmi->index < hmi->hm->size) {
+		hmi->index++;
+		hashmap_iterator_skip_empty(hmi);
+	}
+}
+
+bool BLI_hashmapIterator_done(HashMapIterator *hmi)
+{
+	return hmi->index >= hmi->hm->size;
+}
+
+/** \} */
+
+
+/** \name Convenience HashMap Creation Functions
+ * \{ */
+
+HashMap *BLI_hashmap_ptr_new_ex(const char *info,
+                                const unsigned int nentries_reserve)
+{
+	return BLI_hashmap_new_ex(BLI_ghashutil_ptrhash, BLI_ghashutil_ptrcmp, info,
+	                          nentries_reserve);
+}
+HashMap *BLI_hashmap_ptr_new(const char *info)
+{
+	return BLI_hashmap_ptr_new_ex(info, 0);
+}
+
+HashMap *BLI_hashmap_str_new_ex(const char *info,
+                                const unsigned int nentries_reserve)
+{
+	return BLI_hashmap_new_ex(BLI_ghashutil_strhash, BLI_ghashutil_strcmp, info,
+	                          nentries_reserve);
+}
+HashMap *BLI_hashmap_str_new(const char *info)
+{
+	return BLI_hashmap_str_new_ex(info, 0);
+}
+
+HashMap *BLI_hashmap_int_new_ex(const char *info,
+                                const unsigned int nentries_reserve)
+{
+	return BLI_hashmap_new_ex(BLI_ghashutil_inthash, BLI_ghashutil_intcmp, info,
+	                          nentries_reserve);
+}
+HashMap *BLI_hashmap_int_new(const char *info)
+{
+	return BLI_hashmap_int_new_ex(info, 0);
+}
+
+/** \} */
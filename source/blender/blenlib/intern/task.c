@@ -23,9 +23,12 @@
 #include "MEM_guardedalloc.h"
 
 #include "BLI_listbase.h"
+#include "BLI_math.h"
 #include "BLI_task.h"
 #include "BLI_threads.h"
 
+#include "atomic_ops.h"
+
 /* Types */
 
 typedef struct Task {
@@ -51,69 +54,181 @@ struct TaskPool {
 	volatile bool do_cancel;
 };
 
+/* Work stealing deque, one per worker thread. The owner thread pushes and pops
+ * tasks at the tail, other threads steal the oldest tasks from the head. */
+typedef struct TaskDeque {
+	ListBase tasks;
+	SpinLock lock;
+} TaskDeque;
+
+typedef struct TaskThread {
+	TaskScheduler *scheduler;
+	int id;
+	TaskDeque deque;
+} TaskThread;
+
 struct TaskScheduler {
 	pthread_t *threads;
 	struct TaskThread *task_threads;
 	int num_threads;
 
+	/* shared queue for tasks pushed by threads other than the workers */
 	ListBase queue;
 	ThreadMutex queue_mutex;
 	ThreadCondition queue_cond;
 
+	/* number of tasks in the shared queue and all deques, never lower than
+	 * the actual number, and number of workers sleeping on queue_cond */
+	size_t num_queued;
+	size_t num_sleeping;
+
+	/* TaskThread of the worker threads, NULL for any other thread */
+	pthread_key_t thread_key;
+
 	volatile bool do_exit;
 };
 
-typedef struct TaskThread {
-	TaskScheduler *scheduler;
-	int id;
-} TaskThread;
-
 /* Task Scheduler */
 
 static void task_pool_num_decrease(TaskPool *pool, size_t done)
 {
-	BLI_mutex_lock(&pool->num_mutex);
-
 	BLI_assert(pool->num >= done);
 
-	pool->num -= done;
-	pool->done += done;
+	atomic_add_z((size_t *)&pool->done, done);
 
-	if (pool->num == 0)
+	/* decrement under the lock, a waiter seeing num == 0 may free the pool
+	 * once it can take the lock, so it must not be taken before notifying */
+	BLI_mutex_lock(&pool->num_mutex);
+	if (atomic_sub_z((size_t *)&pool->num, done) == 0)
 		BLI_condition_notify_all(&pool->num_cond);
-
 	BLI_mutex_unlock(&pool->num_mutex);
 }
 
 static void task_pool_num_increase(TaskPool *pool)
 {
-	BLI_mutex_lock(&pool->num_mutex);
+	atomic_add_z((size_t *)&pool->num, 1);
+}
 
-	pool->num++;
-	BLI_condition_notify_all(&pool->num_cond);
+static void task_free(Task *task)
+{
+	if (task->free_taskdata)
+		MEM_freeN(task->taskdata);
+	MEM_freeN(task);
+}
 
-	BLI_mutex_unlock(&pool->num_mutex);
+static TaskThread *task_scheduler_current_thread(TaskScheduler *scheduler)
+{
+	return (TaskThread *)pthread_getspecific(scheduler->thread_key);
+}
+
+/* pop a task from the tail or head of a task list, if pool is given only tasks
+ * from that pool are considered */
+static Task *task_list_pop(ListBase *tasks, TaskPool *pool, bool from_tail)
+{
+	Task *task;
+
+	if (pool) {
+		if (from_tail) {
+			for (task = tasks->last; task; task = task->prev)
+				if (task->pool == pool)
+					break;
+		}
+		else {
+			for (task = tasks->first; task; task = task->next)
+				if (task->pool == pool)
+					break;
+		}
+	}
+	else
+		task = (from_tail) ? tasks->last : tasks->first;
+
+	if (task)
+		BLI_remlink(tasks, task);
+
+	return task;
+}
+
+static Task *task_deque_pop(TaskDeque *deque, TaskPool *pool, bool from_tail)
+{
+	Task *task;
+
+	/* unlocked check, avoids taking the lock of idle deques when stealing */
+	if (deque->tasks.first == NULL)
+		return NULL;
+
+	BLI_spin_lock(&deque->lock);
+	task = task_list_pop(&deque->tasks, pool, from_tail);
+	BLI_spin_unlock(&deque->lock);
+
+	return task;
 }
 
-static bool task_scheduler_thread_wait_pop(TaskScheduler *scheduler, Task **task)
+static Task *task_queue_pop(TaskScheduler *scheduler, TaskPool *pool)
 {
+	Task *task;
+
+	if (scheduler->queue.first == NULL)
+		return NULL;
+
 	BLI_mutex_lock(&scheduler->queue_mutex);
+	task = task_list_pop(&scheduler->queue, pool, false);
+	BLI_mutex_unlock(&scheduler->queue_mutex);
 
-	while (!scheduler->queue.first && !scheduler->do_exit)
-		BLI_condition_wait(&scheduler->queue_cond, &scheduler->queue_mutex);
+	return task;
+}
 
-	if (!scheduler->queue.first) {
-		BLI_mutex_unlock(&scheduler->queue_mutex);
-		BLI_assert(scheduler->do_exit);
-		return false;
+/* find a task to run: own deque first (most recent task, likely still in cache),
+ * then the shared queue and finally steal the oldest task of another worker */
+static Task *task_scheduler_find_task(TaskScheduler *scheduler, TaskThread *thread, TaskPool *pool)
+{
+	Task *task = NULL;
+
+	if (thread)
+		task = task_deque_pop(&thread->deque, pool, true);
+
+	if (task == NULL)
+		task = task_queue_pop(scheduler, pool);
+
+	if (task == NULL) {
+		int i, offset = (thread) ? thread->id : 0;
+
+		for (i = 0; i < scheduler->num_threads && task == NULL; i++) {
+			TaskThread *victim = &scheduler->task_threads[(offset + i) % scheduler->num_threads];
+
+			if (victim != thread)
+				task = task_deque_pop(&victim->deque, pool, false);
+		}
 	}
-	
-	*task = scheduler->queue.first;
-	BLI_remlink(&scheduler->queue, *task);
 
-	BLI_mutex_unlock(&scheduler->queue_mutex);
+	if (task)
+		atomic_sub_z(&scheduler->num_queued, 1);
 
-	return true;
+	return task;
+}
+
+static bool task_scheduler_thread_wait_pop(TaskScheduler *scheduler, TaskThread *thread, Task **task)
+{
+	while (true) {
+		*task = task_scheduler_find_task(scheduler, thread, NULL);
+
+		if (*task)
+			return true;
+
+		if (scheduler->do_exit)
+			return false;
+
+		/* nothing to do, sleep until new tasks are pushed. pushing increments
+		 * num_queued before checking num_sleeping, so either we see the new
+		 * task here or the pusher sees us sleeping and notifies */
+		BLI_mutex_lock(&scheduler->queue_mutex);
+		atomic_add_z(&scheduler->num_sleeping, 1);
+
+		while (atomic_add_z(&scheduler->num_queued, 0) == 0 && !scheduler->do_exit)
+			BLI_condition_wait(&scheduler->queue_cond, &scheduler->queue_mutex);
+
+		atomic_sub_z(&scheduler->num_sleeping, 1);
+		BLI_mutex_unlock(&scheduler->queue_mutex);
+	}
 }
 
 static void *task_scheduler_thread_run(void *thread_p)
@@ -123,17 +238,17 @@ static void *task_scheduler_thread_run(void *thread_p)
 	int thread_id = thread->id;
 	Task *task;
 
+	pthread_setspecific(scheduler->thread_key, thread);
+
 	/* keep popping off tasks */
-	while (task_scheduler_thread_wait_pop(scheduler, &task)) {
+	while (task_scheduler_thread_wait_pop(scheduler, thread, &task)) {
 		TaskPool *pool = task->pool;
 
 		/* run task */
 		task->run(pool, task->taskdata, thread_id);
 
 		/* delete task */
-		if (task->free_taskdata)
-			MEM_freeN(task->taskdata);
-		MEM_freeN(task);
+		task_free(task);
 
 		/* notify pool task was done */
 		task_pool_num_decrease(pool, 1);
@@ -154,6 +269,10 @@ TaskScheduler *BLI_task_scheduler_create(int num_threads)
 	BLI_mutex_init(&scheduler->queue_mutex);
 	BLI_condition_init(&scheduler->queue_cond);
 
+	scheduler->num_queued = 0;
+	scheduler->num_sleeping = 0;
+	pthread_key_create(&scheduler->thread_key, NULL);
+
 	if (num_threads == 0) {
 		/* automatic number of threads will be main thread + num cores */
 		num_threads = BLI_system_thread_count();
@@ -170,10 +289,16 @@ TaskScheduler *BLI_task_scheduler_create(int num_threads)
 		scheduler->threads = MEM_callocN(sizeof(pthread_t) * num_threads, "TaskScheduler threads");
 		scheduler->task_threads = MEM_callocN(sizeof(TaskThread) * num_threads, "TaskScheduler task threads");
 
+		/* deques must exist before any thread starts stealing */
 		for (i = 0; i < num_threads; i++) {
 			TaskThread *thread = &scheduler->task_threads[i];
 			thread->scheduler = scheduler;
 			thread->id = i + 1;
+			BLI_spin_init(&thread->deque.lock);
+		}
+
+		for (i = 0; i < num_threads; i++) {
+			TaskThread *thread = &scheduler->task_threads[i];
 
 			if (pthread_create(&scheduler->threads[i], NULL, task_scheduler_thread_run, thread) != 0) {
 				fprintf(stderr, "TaskScheduler failed to launch thread %d/%d\n", i, num_threads);
@@ -207,22 +332,32 @@ void BLI_task_scheduler_free(TaskScheduler *scheduler)
 		MEM_freeN(scheduler->threads);
 	}
 
-	/* Delete task thread data */
+	/* Delete task thread data and leftover tasks in the deques */
 	if (scheduler->task_threads) {
+		int i;
+
+		for (i = 0; i < scheduler->num_threads; i++) {
+			TaskDeque *deque = &scheduler->task_threads[i].deque;
+
+			while ((task = BLI_pophead(&deque->tasks)))
+				task_free(task);
+
+			BLI_spin_end(&deque->lock);
+		}
+
 		MEM_freeN(scheduler->task_threads);
 	}
 
 	/* delete leftover tasks */
-	for (task = scheduler->queue.first; task; task = task->next) {
-		if (task->free_taskdata)
-			MEM_freeN(task->taskdata);
-	}
-	BLI_freelistN(&scheduler->queue);
+	while ((task = BLI_pophead(&scheduler->queue)))
+		task_free(task);
 
 	/* delete mutex/condition */
 	BLI_mutex_end(&scheduler->queue_mutex);
 	BLI_condition_end(&scheduler->queue_cond);
 
+	pthread_key_delete(scheduler->thread_key);
+
 	MEM_freeN(scheduler);
 }
 
@@ -233,44 +368,84 @@ int BLI_task_scheduler_num_threads(TaskScheduler *scheduler)
 
 static void task_scheduler_push(TaskScheduler *scheduler, Task *task, TaskPriority priority)
 {
+	TaskThread *thread = task_scheduler_current_thread(scheduler);
+
 	task_pool_num_increase(task->pool);
 
-	/* add task to queue */
-	BLI_mutex_lock(&scheduler->queue_mutex);
+	/* count first, so num_queued is never lower than the actual number of tasks */
+	atomic_add_z(&scheduler->num_queued, 1);
+
+	if (thread) {
+		/* tasks spawned by a worker stay in its own deque, where the owner
+		 * runs them depth first and idle threads can steal them. priority
+		 * only affects the order in the shared queue. */
+		BLI_spin_lock(&thread->deque.lock);
+		BLI_addtail(&thread->deque.tasks, task);
+		BLI_spin_unlock(&thread->deque.lock);
+
+		/* wake up a sleeping worker to steal */
+		if (atomic_add_z(&scheduler->num_sleeping, 0)) {
+			BLI_mutex_lock(&scheduler->queue_mutex);
+			BLI_condition_notify_one(&scheduler->queue_cond);
+			BLI_mutex_unlock(&scheduler->queue_mutex);
+		}
+	}
+	else {
+		/* add task to queue */
+		BLI_mutex_lock(&scheduler->queue_mutex);
 
-	if (priority == TASK_PRIORITY_HIGH)
-		BLI_addhead(&scheduler->queue, task);
-	else
-		BLI_addtail(&scheduler->queue, task);
+		if (priority == TASK_PRIORITY_HIGH)
+			BLI_addhead(&scheduler->queue, task);
+		else
+			BLI_addtail(&scheduler->queue, task);
 
-	BLI_condition_notify_one(&scheduler->queue_cond);
-	BLI_mutex_unlock(&scheduler->queue_mutex);
+		BLI_condition_notify_one(&scheduler->queue_cond);
+		BLI_mutex_unlock(&scheduler->queue_mutex);
+	}
 }
 
-static void task_scheduler_clear(TaskScheduler *scheduler, TaskPool *pool)
+static size_t task_list_clear(ListBase *tasks, TaskPool *pool)
 {
 	Task *task, *nexttask;
 	size_t done = 0;
 
-	BLI_mutex_lock(&scheduler->queue_mutex);
-
-	/* free all tasks from this pool from the queue */
-	for (task = scheduler->queue.first; task; task = nexttask) {
+	for (task = tasks->first; task; task = nexttask) {
 		nexttask = task->next;
 
 		if (task->pool == pool) {
-			if (task->free_taskdata)
-				MEM_freeN(task->taskdata);
-			BLI_freelinkN(&scheduler->queue, task);
+			BLI_remlink(tasks, task);
+			task_free(task);
 
 			done++;
 		}
 	}
 
+	return done;
+}
+
+static void task_scheduler_clear(TaskScheduler *scheduler, TaskPool *pool)
+{
+	size_t done;
+	int i;
+
+	/* free all tasks from this pool from the queue and deques */
+	BLI_mutex_lock(&scheduler->queue_mutex);
+	done = task_list_clear(&scheduler->queue, pool);
 	BLI_mutex_unlock(&scheduler->queue_mutex);
 
+	for (i = 0; i < scheduler->num_threads; i++) {
+		TaskDeque *deque = &scheduler->task_threads[i].deque;
+
+		BLI_spin_lock(&deque->lock);
+		done += task_list_clear(&deque->tasks, pool);
+		BLI_spin_unlock(&deque->lock);
+	}
+
+	atomic_sub_z(&scheduler->num_queued, done);
+
 	/* notify done */
-	task_pool_num_decrease(pool, done);
+	if (done)
+		task_pool_num_decrease(pool, done);
 }
 
 /* Task Pool */
@@ -330,53 +505,36 @@ void BLI_task_pool_push(TaskPool *pool, TaskRunFunction run,
 void BLI_task_pool_work_and_wait(TaskPool *pool)
 {
 	TaskScheduler *scheduler = pool->scheduler;
+	TaskThread *thread = task_scheduler_current_thread(scheduler);
+	int thread_id = (thread) ? thread->id : 0;
 
-	BLI_mutex_lock(&pool->num_mutex);
-
-	while (pool->num != 0) {
-		Task *task, *work_task = NULL;
-		bool found_task = false;
-
-		BLI_mutex_unlock(&pool->num_mutex);
-
-		BLI_mutex_lock(&scheduler->queue_mutex);
-
+	while (atomic_add_z((size_t *)&pool->num, 0) != 0) {
 		/* find task from this pool. if we get a task from another pool,
 		 * we can get into deadlock */
-
-		for (task = scheduler->queue.first; task; task = task->next) {
-			if (task->pool == pool) {
-				work_task = task;
-				found_task = true;
-				BLI_remlink(&scheduler->queue, task);
-				break;
-			}
-		}
-
-		BLI_mutex_unlock(&scheduler->queue_mutex);
+		Task *task = task_scheduler_find_task(scheduler, thread, pool);
 
 		/* if found task, do it, otherwise wait until other tasks are done */
-		if (found_task) {
+		if (task) {
 			/* run task */
-			work_task->run(pool, work_task->taskdata, 0);
+			task->run(pool, task->taskdata, thread_id);
 
 			/* delete task */
-			if (work_task->free_taskdata)
-				MEM_freeN(work_task->taskdata);
-			MEM_freeN(work_task);
+			task_free(task);
 
 			/* notify pool task was done */
 			task_pool_num_decrease(pool, 1);
 		}
-
-		BLI_mutex_lock(&pool->num_mutex);
-		if (pool->num == 0)
-			break;
-
-		if (!found_task)
-			BLI_condition_wait(&pool->num_cond, &pool->num_mutex);
+		else {
+			BLI_mutex_lock(&pool->num_mutex);
+			if (pool->num != 0)
+				BLI_condition_wait(&pool->num_cond, &pool->num_mutex);
+			BLI_mutex_unlock(&pool->num_mutex);
+		}
 	}
 
+	/* the thread finishing the last task may still hold the lock to notify,
+	 * wait for it before the caller can free the pool */
+	BLI_mutex_lock(&pool->num_mutex);
 	BLI_mutex_unlock(&pool->num_mutex);
 }
 
@@ -422,3 +580,87 @@ size_t BLI_task_pool_tasks_done(TaskPool *pool)
 	return pool->done;
 }
 
+/* Parallel range
+ *
+ * Every task grabs chunks of iterations from a shared counter until the range
+ * is exhausted, so threads that finish early take over the remaining work. */
+
+typedef struct ParallelRangeState {
+	int start, stop;
+	void *userdata;
+	TaskParallelRangeFunc func;
+
+	size_t iter;
+	int chunk_size;
+} ParallelRangeState;
+
+static bool parallel_range_next_chunk_get(ParallelRangeState *state, int *r_iter, int *r_count)
+{
+	size_t previter = atomic_add_z(&state->iter, (size_t)state->chunk_size) - (size_t)state->chunk_size;
+	int range = state->stop - state->start;
+
+	if (previter >= (size_t)range)
+		return false;
+
+	*r_iter = state->start + (int)previter;
+	*r_count = min_ii(state->chunk_size, range - (int)previter);
+
+	return true;
+}
+
+static void parallel_range_func(TaskPool *pool, void *UNUSED(taskdata), int UNUSED(threadid))
+{
+	ParallelRangeState *state = (ParallelRangeState *) BLI_task_pool_userdata(pool);
+	int iter, count, i;
+
+	while (parallel_range_next_chunk_get(state, &iter, &count)) {
+		for (i = 0; i < count; i++)
+			state->func(state->userdata, iter + i);
+	}
+}
+
+void BLI_task_parallel_range_ex(int start, int stop, void *userdata,
+                                TaskParallelRangeFunc func, const int range_threshold)
+{
+	TaskScheduler *task_scheduler;
+	TaskPool *task_pool;
+	ParallelRangeState state;
+	int i, num_threads, num_tasks, range = stop - start;
+
+	BLI_assert(start <= stop);
+
+	task_scheduler = BLI_task_scheduler_get();
+	num_threads = BLI_task_scheduler_num_threads(task_scheduler);
+
+	/* small ranges are not worth the overhead of tasks */
+	if (range < range_threshold || num_threads == 1) {
+		for (i = start; i < stop; i++)
+			func(userdata, i);
+		return;
+	}
+
+	state.start = start;
+	state.stop = stop;
+	state.userdata = userdata;
+	state.func = func;
+	state.iter = 0;
+
+	/* several chunks per thread to balance uneven work, but large enough
+	 * that the shared counter isn't touched for every iteration */
+	state.chunk_size = max_ii(1, range / (num_threads * 8));
+
+	num_tasks = min_ii(num_threads, (range + state.chunk_size - 1) / state.chunk_size);
+
+	task_pool = BLI_task_pool_create(task_scheduler, &state);
+
+	for (i = 0; i < num_tasks; i++)
+		BLI_task_pool_push(task_pool, parallel_range_func, NULL, false, TASK_PRIORITY_HIGH);
+
+	BLI_task_pool_work_and_wait(task_pool);
+	BLI_task_pool_free(task_pool);
+}
+
+void BLI_task_parallel_range(int start, int stop, void *userdata, TaskParallelRangeFunc func)
+{
+	BLI_task_parallel_range_ex(start, stop, userdata, func, 64);
+}
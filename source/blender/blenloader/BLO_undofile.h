@@ -36,8 +36,8 @@
 typedef struct {
 	void *next, *prev;
 	
-	char *buf;
-	unsigned int ident, size;
+	char *buf;  /* shared (reference counted) by all chunks with the same content */
+	unsigned int ident, size;  /* ident: buffer was already stored, not new for this memfile */
 	
 } MemFileChunk;
 
@@ -51,7 +51,9 @@ extern void add_memfilechunk(MemFile *compare, MemFile *current, const char *buf
 
 /* exports */
 extern void BLO_free_memfile(MemFile *memfile);
-extern void BLO_merge_memfile(MemFile *first, MemFile *second);
+extern void BLO_merge_memfile(MemFile *first);
+extern void BLO_memfile_size_begin(void);
+extern uintptr_t BLO_memfile_size_add(MemFile *memfile);
 
 #endif
 
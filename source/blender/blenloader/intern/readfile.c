@@ -44,6 +44,7 @@
 #include "BLI_utildefines.h"
 #ifndef WIN32
 #  include <unistd.h> // for read close
+#  include <sys/mman.h> // for mmap
 #else
 #  include <io.h> // for open close read
 #  include "winsock2.h"
@@ -109,6 +110,7 @@
 #include "BLI_edgehash.h"
 #include "BLI_threads.h"
 #include "BLI_mempool.h"
+#include "BLI_task.h"
 
 #include "BLF_translation.h"
 
@@ -175,6 +177,12 @@
 
 #include <errno.h>
 
+/* Map uncompressed files and use their blocks in place (see blo_mmap_index_bheads).
+ * Not on windows, where mmap_win.h can't make private (copy on write) mappings. */
+#ifndef WIN32
+#  define USE_BHEAD_MMAP
+#endif
+
 /*
  * Remark: still a weak point is the newaddress() function, that doesnt solve reading from
  * multiple files at the same time
@@ -234,13 +242,19 @@ typedef struct OldNew {
 typedef struct OldNewMap {
 	OldNew *entries;
 	int nentries, entriessize;
-	int sorted;
 	int lasthit;
+	
+	/* open addressing (linear probing) table of entry indices + 1, keyed by old address,
+	 * zero is an empty slot. Entries are never removed one by one, so entries with the
+	 * same old address are found in insertion order. */
+	int *map;
+	int map_size_exp;
 } OldNewMap;
 
 
 /* local prototypes */
 static void *read_struct(FileData *fd, BHead *bh, const char *blockname);
+static void blo_free_decoded_bheads(FileData *fd);
 static void direct_link_modifiers(FileData *fd, ListBase *lb);
 static void convert_tface_mt(FileData *fd, Main *main);
 
@@ -271,30 +285,56 @@ static void BKE_reportf_wrap(ReportList *reports, ReportType type, const char *f
 	}
 }
 
-static OldNewMap *oldnewmap_new(void) 
+/* the map has twice as many slots as there is room for entries */
+#define OLDNEWMAP_SIZE_DEFAULT_EXP 10
+
+BLI_INLINE unsigned int oldnewmap_hash(OldNewMap *onm, const void *addr)
 {
-	OldNewMap *onm= MEM_callocN(sizeof(*onm), "OldNewMap");
-	
-	onm->entriessize = 1024;
-	onm->entries = MEM_mallocN(sizeof(*onm->entries)*onm->entriessize, "OldNewMap.entries");
-	
-	return onm;
+	/* fibonacci hashing, old addresses mostly differ above their alignment,
+	 * the top bits of the product mix in all of them */
+	const uint64_t key = (uint64_t)(uintptr_t)addr;
+	return (unsigned int)((key * 0x9E3779B97F4A7C15ull) >> (64 - onm->map_size_exp));
 }
 
-static int verg_oldnewmap(const void *v1, const void *v2)
+static void oldnewmap_map_insert(OldNewMap *onm, int index)
 {
-	const struct OldNew *x1=v1, *x2=v2;
+	const unsigned int mask = (1u << onm->map_size_exp) - 1;
+	unsigned int slot = oldnewmap_hash(onm, onm->entries[index].old);
 	
-	if (x1->old > x2->old) return 1;
-	else if (x1->old < x2->old) return -1;
-	return 0;
+	while (onm->map[slot]) {
+		slot = (slot + 1) & mask;
+	}
+	onm->map[slot] = index + 1;
 }
 
+/* index of the first entry for addr, -1 if there is none */
+static int oldnewmap_map_lookup(OldNewMap *onm, const void *addr)
+{
+	const unsigned int mask = (1u << onm->map_size_exp) - 1;
+	unsigned int slot = oldnewmap_hash(onm, addr);
+	int index;
+	
+	while ((index = onm->map[slot])) {
+		if (onm->entries[index - 1].old == addr) {
+			return index - 1;
+		}
+		slot = (slot + 1) & mask;
+	}
+	
+	return -1;
+}
 
-static void oldnewmap_sort(FileData *fd) 
+static OldNewMap *oldnewmap_new(void) 
 {
-	qsort(fd->libmap->entries, fd->libmap->nentries, sizeof(OldNew), verg_oldnewmap);
-	fd->libmap->sorted = 1;
+	OldNewMap *onm= MEM_callocN(sizeof(*onm), "OldNewMap");
+	
+	onm->entriessize = 1 << OLDNEWMAP_SIZE_DEFAULT_EXP;
+	onm->entries = MEM_mallocN(sizeof(*onm->entries)*onm->entriessize, "OldNewMap.entries");
+	
+	onm->map_size_exp = OLDNEWMAP_SIZE_DEFAULT_EXP + 1;
+	onm->map = MEM_callocN(sizeof(*onm->map) << onm->map_size_exp, "OldNewMap.map");
+	
+	return onm;
 }
 
 /* nr is zero for data, and ID code for libdata */
@@ -307,18 +347,30 @@ static void oldnewmap_insert(OldNewMap *onm, void *oldaddr, void *newaddr, int n
 	if (onm->nentries == onm->entriessize) {
 		int osize = onm->entriessize;
 		OldNew *oentries = onm->entries;
+		int i;
 		
 		onm->entriessize *= 2;
 		onm->entries = MEM_mallocN(sizeof(*onm->entries)*onm->entriessize, "OldNewMap.entries");
 		
 		memcpy(onm->entries, oentries, sizeof(*oentries)*osize);
 		MEM_freeN(oentries);
+		
+		/* rebuild the map at the new size, in order */
+		MEM_freeN(onm->map);
+		onm->map_size_exp++;
+		onm->map = MEM_callocN(sizeof(*onm->map) << onm->map_size_exp, "OldNewMap.map");
+		
+		for (i = 0; i < onm->nentries; i++) {
+			oldnewmap_map_insert(onm, i);
+		}
 	}
 
-	entry = &onm->entries[onm->nentries++];
+	entry = &onm->entries[onm->nentries];
 	entry->old = oldaddr;
 	entry->newp = newaddr;
 	entry->nr = nr;
+	
+	oldnewmap_map_insert(onm, onm->nentries++);
 }
 
 void blo_do_versions_oldnewmap_insert(OldNewMap *onm, void *oldaddr, void *newaddr, int nr)
@@ -328,12 +380,14 @@ void blo_do_versions_oldnewmap_insert(OldNewMap *onm, void *oldaddr, void *newad
 
 static void *oldnewmap_lookup_and_inc(OldNewMap *onm, void *addr, bool increase_users) 
 {
+	OldNew *entry;
 	int i;
 	
 	if (addr == NULL) return NULL;
 	
+	/* linking is mostly done in the same sequence as writing */
 	if (onm->lasthit < onm->nentries-1) {
-		OldNew *entry = &onm->entries[++onm->lasthit];
+		entry = &onm->entries[++onm->lasthit];
 		
 		if (entry->old == addr) {
 			if (increase_users)
@@ -342,16 +396,14 @@ static void *oldnewmap_lookup_and_inc(OldNewMap *onm, void *addr, bool increase_
 		}
 	}
 	
-	for (i = 0; i < onm->nentries; i++) {
-		OldNew *entry = &onm->entries[i];
+	i = oldnewmap_map_lookup(onm, addr);
+	if (i != -1) {
+		entry = &onm->entries[i];
+		onm->lasthit = i;
 		
-		if (entry->old == addr) {
-			onm->lasthit = i;
-			
-			if (increase_users)
-				entry->nr++;
-			return entry->newp;
-		}
+		if (increase_users)
+			entry->nr++;
+		return entry->newp;
 	}
 	
 	return NULL;
@@ -360,41 +412,30 @@ static void *oldnewmap_lookup_and_inc(OldNewMap *onm, void *addr, bool increase_
 /* for libdata, nr has ID code, no increment */
 static void *oldnewmap_liblookup(OldNewMap *onm, void *addr, void *lib)
 {
+	const unsigned int mask = (1u << onm->map_size_exp) - 1;
+	unsigned int slot;
+	int index;
+	
 	if (addr == NULL) {
 		return NULL;
 	}
-
-	/* lasthit works fine for non-libdata, linking there is done in same sequence as writing */
-	if (onm->sorted) {
-		OldNew entry_s, *entry;
-
-		entry_s.old = addr;
-
-		entry = bsearch(&entry_s, onm->entries, onm->nentries, sizeof(OldNew), verg_oldnewmap);
-		if (entry) {
+	
+	/* the same address can be in the map for several library files,
+	 * take the first matching one like a linear search would */
+	slot = oldnewmap_hash(onm, addr);
+	while ((index = onm->map[slot])) {
+		OldNew *entry = &onm->entries[index - 1];
+		
+		if (entry->old == addr) {
 			ID *id = entry->newp;
-
+			
 			if (id && (!lib || id->lib)) {
 				return id;
 			}
 		}
+		slot = (slot + 1) & mask;
 	}
-	else {
-		/* note, this can be a bottle neck when loading some files */
-		unsigned int nentries = (unsigned int)onm->nentries;
-		unsigned int i;
-		OldNew *entry;
-
-		for (i = 0, entry = onm->entries; i < nentries; i++, entry++) {
-			if (entry->old == addr) {
-				ID *id = entry->newp;
-				if (id && (!lib || id->lib)) {
-					return id;
-				}
-			}
-		}
-	}
-
+	
 	return NULL;
 }
 
@@ -413,6 +454,27 @@ static void oldnewmap_free_unused(OldNewMap *onm)
 
 static void oldnewmap_clear(OldNewMap *onm) 
 {
+	const unsigned int map_size = 1u << onm->map_size_exp;
+	
+	/* the datamap is cleared for every ID, don't touch the whole map
+	 * when only few slots are used after a large ID */
+	if ((unsigned int)onm->nentries * 8 < map_size) {
+		const unsigned int mask = map_size - 1;
+		int i;
+		
+		for (i = 0; i < onm->nentries; i++) {
+			unsigned int slot = oldnewmap_hash(onm, onm->entries[i].old);
+			
+			while (onm->map[slot] != i + 1) {
+				slot = (slot + 1) & mask;
+			}
+			onm->map[slot] = 0;
+		}
+	}
+	else {
+		memset(onm->map, 0, sizeof(*onm->map) * map_size);
+	}
+	
 	onm->nentries = 0;
 	onm->lasthit = 0;
 }
@@ -420,6 +482,7 @@ static void oldnewmap_clear(OldNewMap *onm)
 static void oldnewmap_free(OldNewMap *onm) 
 {
 	MEM_freeN(onm->entries);
+	MEM_freeN(onm->map);
 	MEM_freeN(onm);
 }
 
@@ -700,6 +763,7 @@ static BHeadN *get_bhead(FileData *fd)
 				new_bhead = MEM_mallocN(sizeof(BHeadN) + bhead.len, "new_bhead");
 				if (new_bhead) {
 					new_bhead->next = new_bhead->prev = NULL;
+					new_bhead->decoded = NULL;
 					new_bhead->bhead = bhead;
 					
 					readsize = fd->read(fd, new_bhead + 1, bhead.len);
@@ -727,11 +791,46 @@ static BHeadN *get_bhead(FileData *fd)
 	return(new_bhead);
 }
 
+#ifdef USE_BHEAD_MMAP
+
+static int mmap_bhead_index(FileData *fd, BHead *bhead)
+{
+	const int index = (int)(bhead - fd->mmap_bheads);
+	
+	BLI_assert(index >= 0 && index < fd->mmap_tot_bheads);
+	return index;
+}
+
+#endif  /* USE_BHEAD_MMAP */
+
+/* where a block decoded ahead of time is kept, see blo_decode_bheads */
+static void **bhead_decoded_p(FileData *fd, BHead *bhead)
+{
+	BHeadN *bheadn;
+	
+#ifdef USE_BHEAD_MMAP
+	if (fd->mmap_bheads) {
+		return &fd->mmap_decoded[mmap_bhead_index(fd, bhead)];
+	}
+#else
+	(void)fd;
+#endif
+	
+	bheadn = (BHeadN *) (((char *) bhead) - offsetof(BHeadN, bhead));
+	return &bheadn->decoded;
+}
+
 BHead *blo_firstbhead(FileData *fd)
 {
 	BHeadN *new_bhead;
 	BHead *bhead = NULL;
 	
+#ifdef USE_BHEAD_MMAP
+	if (fd->mmap_bheads) {
+		return (fd->mmap_tot_bheads) ? &fd->mmap_bheads[0] : NULL;
+	}
+#endif
+	
 	/* Rewind the file
 	 * Read in a new block if necessary
 	 */
@@ -747,10 +846,22 @@ BHead *blo_firstbhead(FileData *fd)
 	return(bhead);
 }
 
-BHead *blo_prevbhead(FileData *UNUSED(fd), BHead *thisblock)
+BHead *blo_prevbhead(FileData *fd, BHead *thisblock)
 {
-	BHeadN *bheadn = (BHeadN *) (((char *) thisblock) - offsetof(BHeadN, bhead));
-	BHeadN *prev = bheadn->prev;
+	BHeadN *bheadn;
+	BHeadN *prev;
+	
+#ifdef USE_BHEAD_MMAP
+	if (fd->mmap_bheads) {
+		const int index = mmap_bhead_index(fd, thisblock);
+		return (index > 0) ? &fd->mmap_bheads[index - 1] : NULL;
+	}
+#else
+	(void)fd;
+#endif
+	
+	bheadn = (BHeadN *) (((char *) thisblock) - offsetof(BHeadN, bhead));
+	prev = bheadn->prev;
 	
 	return (prev) ? &prev->bhead : NULL;
 }
@@ -760,6 +871,17 @@ BHead *blo_nextbhead(FileData *fd, BHead *thisblock)
 	BHeadN *new_bhead = NULL;
 	BHead *bhead = NULL;
 	
+#ifdef USE_BHEAD_MMAP
+	if (fd->mmap_bheads) {
+		if (thisblock) {
+			const int index = mmap_bhead_index(fd, thisblock);
+			if (index + 1 < fd->mmap_tot_bheads)
+				bhead = &fd->mmap_bheads[index + 1];
+		}
+		return bhead;
+	}
+#endif
+	
 	if (thisblock) {
 		/* bhead is actually a sub part of BHeadN
 		 * We calculate the BHeadN pointer from the BHead pointer below */
@@ -831,7 +953,7 @@ static int read_file_dna(FileData *fd)
 		if (bhead->code == DNA1) {
 			const bool do_endian_swap = (fd->flags & FD_FLAGS_SWITCH_ENDIAN) != 0;
 			
-			fd->filesdna = DNA_sdna_from_data(&bhead[1], bhead->len, do_endian_swap);
+			fd->filesdna = DNA_sdna_from_data(bhead_data(fd, bhead), bhead->len, do_endian_swap);
 			if (fd->filesdna) {
 				fd->compflags = DNA_struct_get_compareflags(fd->filesdna, fd->memsdna);
 				/* used to retrieve ID names from (bhead+1) */
@@ -967,7 +1089,9 @@ static FileData *filedata_new(void)
 
 static FileData *blo_decode_and_check(FileData *fd, ReportList *reports)
 {
-	decode_blender_header(fd);
+	/* mapped files have their header decoded already */
+	if (!(fd->flags & FD_FLAGS_FILE_OK))
+		decode_blender_header(fd);
 	
 	if (fd->flags & FD_FLAGS_FILE_OK) {
 		if (!read_file_dna(fd)) {
@@ -985,11 +1109,128 @@ static FileData *blo_decode_and_check(FileData *fd, ReportList *reports)
 	return fd;
 }
 
+#ifdef USE_BHEAD_MMAP
+
+/* Index the blocks of a mapped file, so they can be used in place.
+ * Only possible when the file BHead matches ours (same pointer size and endian),
+ * the block data is then only copied once read_struct asks for it.
+ * Headers are copied, in the file they follow the 12 byte file header and
+ * are not aligned for the 64 bit BHead.old */
+static bool blo_mmap_index_bheads(FileData *fd)
+{
+	char *buf_start = fd->mmap_buffer + SIZEOFBLENDERHEADER;
+	char *buf_end = fd->mmap_buffer + fd->mmap_size;
+	char *buf;
+	int tot, pass;
+	
+	if (fd->flags & (FD_FLAGS_SWITCH_ENDIAN | FD_FLAGS_POINTSIZE_DIFFERS))
+		return false;
+	
+	/* first pass counts, second fills in the index */
+	for (pass = 0; pass < 2; pass++) {
+		tot = 0;
+		buf = buf_start;
+		
+		/* an incomplete last block (a partial ENDB) is left out, like get_bhead does */
+		while ((size_t)(buf_end - buf) >= sizeof(BHead)) {
+			BHead bhead;
+			
+			memcpy(&bhead, buf, sizeof(BHead));
+			
+			if (bhead.len < 0 || (size_t)bhead.len > (size_t)(buf_end - buf) - sizeof(BHead))
+				break;
+			
+			if (pass == 1) {
+				fd->mmap_bheads[tot] = bhead;
+				fd->mmap_data[tot] = buf + sizeof(BHead);
+			}
+			tot++;
+			
+			if (bhead.code == ENDB)
+				break;
+			
+			buf += sizeof(BHead) + bhead.len;
+		}
+		
+		if (pass == 0) {
+			fd->mmap_bheads = MEM_mallocN(sizeof(*fd->mmap_bheads) * max_ii(tot, 1), "FileData.mmap_bheads");
+			fd->mmap_data = MEM_mallocN(sizeof(*fd->mmap_data) * max_ii(tot, 1), "FileData.mmap_data");
+			fd->mmap_decoded = MEM_callocN(sizeof(*fd->mmap_decoded) * max_ii(tot, 1), "FileData.mmap_decoded");
+		}
+	}
+	
+	fd->mmap_tot_bheads = tot;
+	
+	return true;
+}
+
+/* Map uncompressed files instead of reading them, returns NULL when the
+ * file can't be used in place, the regular reading code is used then. */
+static FileData *blo_openblenderfile_mmap(const char *filepath)
+{
+	FileData *fd;
+	unsigned char magic[2];
+	size_t size;
+	void *mem;
+	int file;
+	
+	file = BLI_open(filepath, O_BINARY | O_RDONLY, 0);
+	if (file == -1)
+		return NULL;
+	
+	size = BLI_file_descriptor_size(file);
+	
+	/* gzip compressed */
+	if (size < SIZEOFBLENDERHEADER || read(file, magic, 2) != 2 || (magic[0] == 0x1f && magic[1] == 0x8b)) {
+		close(file);
+		return NULL;
+	}
+	
+	/* private and writable, block data is never written but nothing is written back either */
+	mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+	close(file);
+	
+	if (mem == MAP_FAILED)
+		return NULL;
+	
+	fd = filedata_new();
+	fd->mmap_buffer = mem;
+	fd->mmap_size = size;
+	
+	/* only the header is read through fd->read */
+	fd->buffer = mem;
+	fd->buffersize = SIZEOFBLENDERHEADER;
+	fd->read = fd_read_from_memory;
+	fd->flags |= FD_FLAGS_NOT_MY_BUFFER;
+	
+	decode_blender_header(fd);
+	
+	if (!(fd->flags & FD_FLAGS_FILE_OK) || !blo_mmap_index_bheads(fd)) {
+		blo_freefiledata(fd);
+		return NULL;
+	}
+	
+	/* needed for library_append and read_libraries */
+	BLI_strncpy(fd->relabase, filepath, sizeof(fd->relabase));
+	
+	return fd;
+}
+
+#endif  /* USE_BHEAD_MMAP */
+
 /* cannot be called with relative paths anymore! */
 /* on each new library added, it now checks for the current FileData and expands relativeness */
 FileData *blo_openblenderfile(const char *filepath, ReportList *reports)
 {
 	gzFile gzfile;
+	
+#ifdef USE_BHEAD_MMAP
+	FileData *fd_mmap = blo_openblenderfile_mmap(filepath);
+	if (fd_mmap) {
+		return blo_decode_and_check(fd_mmap, reports);
+	}
+#endif
+	
 	errno = 0;
 	gzfile = BLI_gzopen(filepath, "rb");
 	
@@ -1018,12 +1259,26 @@ static int fd_read_gzip_from_memory(FileData *filedata, void *buffer, unsigned i
 	filedata->strm.avail_out = size;
 
 	// Inflate another chunk.
-	err = inflate (&filedata->strm, Z_SYNC_FLUSH);
-
-	if (err == Z_STREAM_END) {
-		return 0;
+	while ((err = inflate (&filedata->strm, Z_SYNC_FLUSH)) == Z_STREAM_END) {
+		/* compressed files are written as a sequence of gzip members (see writefile.c),
+		 * continue with the next one when there is one */
+		if (filedata->strm.avail_in < 2 ||
+		    filedata->strm.next_in[0] != 0x1f || filedata->strm.next_in[1] != 0x8b)
+		{
+			return 0;
+		}
+		
+		if (inflateReset(&filedata->strm) != Z_OK) {
+			printf("fd_read_gzip_from_memory: zlib error\n");
+			return 0;
+		}
+		
+		if (filedata->strm.avail_out == 0) {
+			break;
+		}
 	}
-	else if (err != Z_OK) {
+	
+	if (err != Z_OK && err != Z_STREAM_END) {
 		printf("fd_read_gzip_from_memory: zlib error\n");
 		return 0;
 	}
@@ -1120,8 +1375,21 @@ void blo_freefiledata(FileData *fd)
 		}
 		
 		// Free all BHeadN data blocks
+		blo_free_decoded_bheads(fd);
 		BLI_freelistN(&fd->listbase);
 		
+#ifdef USE_BHEAD_MMAP
+		if (fd->mmap_buffer) {
+			if (fd->mmap_bheads) {
+				MEM_freeN(fd->mmap_bheads);
+				MEM_freeN(fd->mmap_data);
+				MEM_freeN(fd->mmap_decoded);
+			}
+			if (munmap(fd->mmap_buffer, fd->mmap_size))
+				printf("%s: couldn't unmap file %s\n", __func__, fd->relabase);
+		}
+#endif
+		
 		if (fd->memsdna)
 			DNA_sdna_free(fd->memsdna);
 		if (fd->filesdna)
@@ -1537,12 +1805,10 @@ void blo_add_library_pointer_map(ListBase *mainlist, FileData *fd)
 /* ********** END OLD POINTERS ****************** */
 /* ********** READ FILE ****************** */
 
-static void switch_endian_structs(struct SDNA *filesdna, BHead *bhead)
+static void switch_endian_structs(struct SDNA *filesdna, BHead *bhead, char *data)
 {
 	int blocksize, nblocks;
-	char *data;
 	
-	data = (char *)(bhead+1);
 	blocksize = filesdna->typelens[ filesdna->structs[bhead->SDNAnr][0] ];
 	
 	nblocks = bhead->nr;
@@ -1553,22 +1819,33 @@ static void switch_endian_structs(struct SDNA *filesdna, BHead *bhead)
 	}
 }
 
-static void *read_struct(FileData *fd, BHead *bh, const char *blockname)
+static void *read_struct_decode(FileData *fd, BHead *bh, const char *blockname)
 {
 	void *temp = NULL;
 	
 	if (bh->len) {
+		char *data = bhead_data(fd, bh);
+		
 		/* switch is based on file dna */
 		if (bh->SDNAnr && (fd->flags & FD_FLAGS_SWITCH_ENDIAN))
-			switch_endian_structs(fd->filesdna, bh);
+			switch_endian_structs(fd->filesdna, bh, data);
 		
 		if (fd->compflags[bh->SDNAnr]) {	/* flag==0: doesn't exist anymore */
 			if (fd->compflags[bh->SDNAnr] == 2) {
-				temp = DNA_struct_reconstruct(fd->memsdna, fd->filesdna, fd->compflags, bh->SDNAnr, bh->nr, (bh+1));
+				/* data in a mapped file is not aligned, reconstruction reads its members directly */
+				if ((uintptr_t)data % sizeof(void *)) {
+					char *aligned = MEM_mallocN(bh->len, "read_struct_aligned");
+					memcpy(aligned, data, bh->len);
+					temp = DNA_struct_reconstruct(fd->memsdna, fd->filesdna, fd->compflags, bh->SDNAnr, bh->nr, aligned);
+					MEM_freeN(aligned);
+				}
+				else {
+					temp = DNA_struct_reconstruct(fd->memsdna, fd->filesdna, fd->compflags, bh->SDNAnr, bh->nr, data);
+				}
 			}
 			else {
 				temp = MEM_mallocN(bh->len, blockname);
-				memcpy(temp, (bh+1), bh->len);
+				memcpy(temp, data, bh->len);
 			}
 		}
 	}
@@ -1576,6 +1853,125 @@ static void *read_struct(FileData *fd, BHead *bh, const char *blockname)
 	return temp;
 }
 
+static void *read_struct(FileData *fd, BHead *bh, const char *blockname)
+{
+	void **decoded_p = bhead_decoded_p(fd, bh);
+	
+	/* already decoded by blo_decode_bheads, hand over ownership */
+	if (*decoded_p) {
+		void *temp = *decoded_p;
+		*decoded_p = NULL;
+		return temp;
+	}
+	
+	return read_struct_decode(fd, bh, blockname);
+}
+
+/* ************ PARALLEL DECODE ***************** */
+
+/* Reading is split in two stages: all blocks are read from the file first,
+ * then the endian switching and DNA reconstruction (or plain copy) of every ID
+ * and DATA block runs in parallel, since each block only depends on the SDNA.
+ * Linking stays serial, it shares the old->new address maps. */
+
+typedef struct DecodeBHeadsState {
+	FileData *fd;
+	BHead **bheads;
+} DecodeBHeadsState;
+
+static bool bhead_is_decodable(FileData *fd, BHead *bhead)
+{
+	switch (bhead->code) {
+		case DNA1:
+		case TEST:
+		case REND:
+		case GLOB:
+		case USER:
+		case ENDB:
+			/* read raw or more than once, keep these lazy */
+			return false;
+		default:
+			return (bhead->len != 0) && (fd->compflags[bhead->SDNAnr] != 0);
+	}
+}
+
+static void decode_bhead_func(void *userdata, int index)
+{
+	DecodeBHeadsState *state = userdata;
+	BHead *bhead = state->bheads[index];
+	
+	/* block names must outlive the file data, the SDNA type names are freed with it */
+	*bhead_decoded_p(state->fd, bhead) = read_struct_decode(state->fd, bhead, "read_struct");
+}
+
+/* reads the remaining blocks of the file, returns the number of decoded blocks */
+static int blo_decode_bheads(FileData *fd, double *r_time_read)
+{
+	DecodeBHeadsState state;
+	BHead *bhead;
+	double time_start = PIL_check_seconds_timer();
+	int tot = 0;
+	
+	/* stage 1: I/O, get_bhead keeps all blocks in fd->listbase */
+	for (bhead = blo_firstbhead(fd); bhead; bhead = blo_nextbhead(fd, bhead)) {
+		if (bhead_is_decodable(fd, bhead))
+			tot++;
+	}
+	
+	*r_time_read = PIL_check_seconds_timer() - time_start;
+	
+	if (tot == 0)
+		return 0;
+	
+	/* stage 2: decode, the lazily created scheduler is only safe to get from the main thread */
+	state.fd = fd;
+	state.bheads = MEM_mallocN(sizeof(*state.bheads) * tot, "DecodeBHeadsState.bheads");
+	
+	tot = 0;
+	for (bhead = blo_firstbhead(fd); bhead; bhead = blo_nextbhead(fd, bhead)) {
+		if (bhead_is_decodable(fd, bhead))
+			state.bheads[tot++] = bhead;
+	}
+	
+	if (BLI_thread_is_main()) {
+		BLI_task_parallel_range_ex(0, tot, &state, decode_bhead_func, 256);
+	}
+	else {
+		int i;
+		for (i = 0; i < tot; i++)
+			decode_bhead_func(&state, i);
+	}
+	
+	MEM_freeN(state.bheads);
+	
+	return tot;
+}
+
+/* blocks decoded ahead of time which were never read (skipped ID's) */
+static void blo_free_decoded_bheads(FileData *fd)
+{
+	BHeadN *bheadn;
+	
+#ifdef USE_BHEAD_MMAP
+	if (fd->mmap_bheads) {
+		int i;
+		for (i = 0; i < fd->mmap_tot_bheads; i++) {
+			if (fd->mmap_decoded[i]) {
+				MEM_freeN(fd->mmap_decoded[i]);
+				fd->mmap_decoded[i] = NULL;
+			}
+		}
+	}
+#endif
+	
+	for (bheadn = fd->listbase.first; bheadn; bheadn = bheadn->next) {
+		if (bheadn->decoded) {
+			MEM_freeN(bheadn->decoded);
+			bheadn->decoded = NULL;
+		}
+	}
+}
+
 static void link_list(FileData *fd, ListBase *lb)		/* only direct data */
 {
 	Link *ln, *prev;
@@ -9850,8 +10246,6 @@ static void do_versions_after_linking(FileData *fd, Library *lib, Main *main)
 
 static void lib_link_all(FileData *fd, Main *main)
 {
-	oldnewmap_sort(fd);
-	
 	/* No load UI for undo memfiles */
 	if (fd->memfile == NULL) {
 		lib_link_windowmanager(fd, main);
@@ -9964,11 +10358,72 @@ static BHead *read_userdef(BlendFileData *bfd, FileData *fd, BHead *bhead)
 	return bhead;
 }
 
+/* load time per ID type, printed with --debug */
+#define READ_TIMING_MAX_IDTYPES 64
+
+typedef struct ReadTimingIDType {
+	int code;
+	int tot;
+	double time;
+} ReadTimingIDType;
+
+typedef struct ReadTimings {
+	double time_read, time_decode, time_link, time_total;
+	int tot_decoded;
+	ReadTimingIDType idtypes[READ_TIMING_MAX_IDTYPES];
+	int tot_idtypes;
+} ReadTimings;
+
+static void read_timings_add_idtype(ReadTimings *timings, int code, double time)
+{
+	ReadTimingIDType *idtime;
+	int i;
+	
+	for (i = 0; i < timings->tot_idtypes; i++) {
+		if (timings->idtypes[i].code == code)
+			break;
+	}
+	
+	if (i == timings->tot_idtypes) {
+		if (i == READ_TIMING_MAX_IDTYPES)
+			return;
+		timings->tot_idtypes++;
+		timings->idtypes[i].code = code;
+		timings->idtypes[i].tot = 0;
+		timings->idtypes[i].time = 0.0;
+	}
+	
+	idtime = &timings->idtypes[i];
+	idtime->tot++;
+	idtime->time += time;
+}
+
+static void read_timings_print(ReadTimings *timings, const char *filepath)
+{
+	int i;
+	
+	printf("read blend: %s (%.3f sec)\n", filepath, timings->time_total);
+	printf("  read blocks: %.3f sec, decode %d blocks: %.3f sec, read ID's: %.3f sec\n",
+	       timings->time_read, timings->tot_decoded, timings->time_decode, timings->time_link);
+	
+	for (i = 0; i < timings->tot_idtypes; i++) {
+		ReadTimingIDType *idtime = &timings->idtypes[i];
+		printf("    %-16s %6d  %.4f sec\n", BKE_idcode_to_name(idtime->code), idtime->tot, idtime->time);
+	}
+}
+
 BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
 {
-	BHead *bhead = blo_firstbhead(fd);
+	BHead *bhead;
 	BlendFileData *bfd;
 	ListBase mainlist = {NULL, NULL};
+	ReadTimings timings = {0};
+	double time_start = PIL_check_seconds_timer(), time_block;
+	
+	timings.tot_decoded = blo_decode_bheads(fd, &timings.time_read);
+	timings.time_decode = PIL_check_seconds_timer() - time_start - timings.time_read;
+	
+	bhead = blo_firstbhead(fd);
 	
 	bfd = MEM_callocN(sizeof(BlendFileData), "blendfiledata");
 	bfd->main = MEM_callocN(sizeof(Main), "readfile_Main");
@@ -9980,7 +10435,12 @@ BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
 	bfd->type = BLENFILETYPE_BLEND;
 	BLI_strncpy(bfd->main->name, filepath, sizeof(bfd->main->name));
 
+	time_block = PIL_check_seconds_timer();
+	
 	while (bhead) {
+		const int code = bhead->code;
+		double time_id = PIL_check_seconds_timer();
+		
 		switch (bhead->code) {
 		case DATA:
 		case DNA1:
@@ -10027,8 +10487,15 @@ BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
 		default:
 			bhead = read_libblock(fd, bfd->main, bhead, LIB_LOCAL, NULL);
 		}
+		
+		if (BKE_idcode_is_valid(code)) {
+			read_timings_add_idtype(&timings, (code == ID_SCRN) ? ID_SCR : code,
+			                        PIL_check_seconds_timer() - time_id);
+		}
 	}
 	
+	timings.time_link = PIL_check_seconds_timer() - time_block;
+	
 	/* do before read_libraries, but skip undo case */
 	if (fd->memfile==NULL)
 		do_versions(fd, NULL, bfd->main);
@@ -10046,6 +10513,11 @@ BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
 	
 	link_global(fd, bfd);	/* as last */
 	
+	if (G.debug & G_DEBUG) {
+		timings.time_total = PIL_check_seconds_timer() - time_start;
+		read_timings_print(&timings, filepath);
+	}
+	
 	return bfd;
 }
 
@@ -10130,9 +10602,22 @@ static BHead *find_bhead(FileData *fd, void *old)
 	return NULL;
 }
 
+char *bhead_data(FileData *fd, BHead *bhead)
+{
+#ifdef USE_BHEAD_MMAP
+	if (fd->mmap_bheads) {
+		return fd->mmap_data[mmap_bhead_index(fd, bhead)];
+	}
+#else
+	(void)fd;
+#endif
+	
+	return (char *)(bhead + 1);
+}
+
 char *bhead_id_name(FileData *fd, BHead *bhead)
 {
-	return ((char *)(bhead+1)) + fd->id_name_offs;
+	return bhead_data(fd, bhead) + fd->id_name_offs;
 }
 
 static ID *is_yet_read(FileData *fd, Main *mainvar, BHead *bhead)
@@ -62,6 +62,15 @@ typedef struct FileData {
 	int filedes;
 	gzFile gzfiledes;
 
+	// variables needed for reading from a memory mapped file,
+	// block data is used in place instead of being copied into BHeadN's
+	char *mmap_buffer;
+	size_t mmap_size;
+	struct BHead *mmap_bheads;   /* aligned copies of all block headers, in file order */
+	char **mmap_data;            /* block data in the mapping, per mmap_bheads item */
+	void **mmap_decoded;         /* same as BHeadN.decoded, per mmap_bheads item */
+	int mmap_tot_bheads;
+
 	// now only in use for library appending
 	char relabase[FILE_MAX];
 	
@@ -102,7 +111,8 @@ typedef struct FileData {
 
 typedef struct BHeadN {
 	struct BHeadN *next, *prev;
-	struct BHead bhead;
+	void *decoded;  /* result of read_struct when decoded ahead of linking, owned until read */
+	struct BHead bhead;  /* must be last, the block data follows */
 } BHeadN;
 
 
@@ -142,6 +152,7 @@ BHead *blo_nextbhead(FileData *fd, BHead *thisblock);
 BHead *blo_prevbhead(FileData *fd, BHead *thisblock);
 
 char *bhead_id_name(FileData *fd, BHead *bhead);
+char *bhead_data(FileData *fd, BHead *bhead);
 
 /* do versions stuff */
 
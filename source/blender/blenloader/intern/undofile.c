@@ -41,58 +41,154 @@
 
 #include "BLI_blenlib.h"
 #include "BLI_linklist.h"
+#include "BLI_hashmap.h"
 
 #include "BLO_undofile.h"
 
 /* **************** support for memory-write, for undo buffers *************** */
 
+/* Chunk buffers are shared by content across all memfiles (the whole undo stack),
+ * so data that moved in the file (an ID added or removed before it) is still
+ * only stored once. Buffers are reference counted, the header is stored in front
+ * of the chunk data. */
+
+typedef struct MemFileChunkKey {
+	unsigned int hash, size;
+	const char *buf;
+} MemFileChunkKey;
+
+typedef struct MemFileChunkData {
+	MemFileChunkKey key;
+	unsigned int users;
+	unsigned int size_tag;  /* last BLO_memfile_size_begin pass that counted this buffer */
+	/* chunk data follows */
+} MemFileChunkData;
+
+#define MEMFILE_CHUNK_DATA(buf) (((MemFileChunkData *)(buf)) - 1)
+
+/* all stored chunk buffers, by content */
+static HashMap *memfile_chunk_store = NULL;
+
+/* current pass of BLO_memfile_size_begin/BLO_memfile_size_add */
+static unsigned int memfile_size_tag = 0;
+
+static unsigned int memfile_chunk_key_hash(const void *key)
+{
+	return ((const MemFileChunkKey *)key)->hash;
+}
+
+static int memfile_chunk_key_cmp(const void *a, const void *b)
+{
+	const MemFileChunkKey *key_a = a, *key_b = b;
+	
+	if (key_a->hash != key_b->hash || key_a->size != key_b->size)
+		return 1;
+	return memcmp(key_a->buf, key_b->buf, key_a->size);
+}
+
+/* murmur3 body over 4 byte words */
+static unsigned int memfile_chunk_hash(const char *buf, unsigned int size)
+{
+	unsigned int h = size, i;
+	
+	for (i = 0; i + 4 <= size; i += 4) {
+		unsigned int k;
+		memcpy(&k, buf + i, 4);
+		k *= 0xcc9e2d51;
+		k = (k << 15) | (k >> 17);
+		k *= 0x1b873593;
+		h ^= k;
+		h = (h << 13) | (h >> 19);
+		h = h * 5 + 0xe6546b64;
+	}
+	for (; i < size; i++) {
+		h = h * 31 + (unsigned char)buf[i];
+	}
+	
+	return h;
+}
+
+static char *memfile_chunk_buf_add(const char *buf, unsigned int size, unsigned int hash)
+{
+	MemFileChunkData *data = MEM_mallocN(sizeof(MemFileChunkData) + size, "Chunk buffer");
+	char *data_buf = (char *)(data + 1);
+	
+	memcpy(data_buf, buf, size);
+	data->key.hash = hash;
+	data->key.size = size;
+	data->key.buf = data_buf;
+	data->users = 1;
+	data->size_tag = memfile_size_tag;
+	
+	if (memfile_chunk_store == NULL) {
+		memfile_chunk_store = BLI_hashmap_new(memfile_chunk_key_hash, memfile_chunk_key_cmp, "memfile chunk store");
+	}
+	BLI_hashmap_insert(memfile_chunk_store, &data->key, data);
+	
+	return data_buf;
+}
+
+static void memfile_chunk_buf_release(char *buf)
+{
+	MemFileChunkData *data = MEMFILE_CHUNK_DATA(buf);
+	
+	BLI_assert(data->users > 0);
+	
+	if (--data->users == 0) {
+		BLI_hashmap_remove(memfile_chunk_store, &data->key, NULL, NULL);
+		MEM_freeN(data);
+		
+		if (BLI_hashmap_size(memfile_chunk_store) == 0) {
+			BLI_hashmap_free(memfile_chunk_store, NULL, NULL);
+			memfile_chunk_store = NULL;
+		}
+	}
+}
+
 /* not memfile itself */
 void BLO_free_memfile(MemFile *memfile)
 {
 	MemFileChunk *chunk;
 	
 	while ((chunk = BLI_pophead(&memfile->chunks))) {
-		if (chunk->ident == 0)
-			MEM_freeN(chunk->buf);
+		memfile_chunk_buf_release(chunk->buf);
 		MEM_freeN(chunk);
 	}
 	memfile->size = 0;
 }
 
 /* to keep list of memfiles consistent, 'first' is always first in list */
-/* result is that 'first' is being freed */
-void BLO_merge_memfile(MemFile *first, MemFile *second)
+/* result is that 'first' is being freed, buffers still used by the next memfile stay */
+void BLO_merge_memfile(MemFile *first)
 {
-	MemFileChunk *fc, *sc;
-	
-	fc = first->chunks.first;
-	sc = second->chunks.first;
-	while (fc || sc) {
-		if (fc && sc) {
-			if (sc->ident) {
-				sc->ident = 0;
-				fc->ident = 1;
-			}
-		}
-		if (fc) fc = fc->next;
-		if (sc) sc = sc->next;
-	}
-	
 	BLO_free_memfile(first);
 }
 
-static int my_memcmp(const int *mem1, const int *mem2, const int len)
+/* memory of several memfiles, counting buffers they share only once.
+ * call BLO_memfile_size_begin, then BLO_memfile_size_add for each memfile,
+ * which returns the size of the buffers not counted yet in this pass */
+void BLO_memfile_size_begin(void)
+{
+	memfile_size_tag++;
+}
+
+uintptr_t BLO_memfile_size_add(MemFile *memfile)
 {
-	register int a = len;
-	register const int *mema = mem1;
-	register const int *memb = mem2;
-	
-	while (a--) {
-		if (*mema != *memb) return 1;
-		mema++;
-		memb++;
+	MemFileChunk *chunk;
+	uintptr_t size = 0;
+	
+	for (chunk = memfile->chunks.first; chunk; chunk = chunk->next) {
+		MemFileChunkData *data = MEMFILE_CHUNK_DATA(chunk->buf);
+		
+		size += sizeof(MemFileChunk);
+		
+		if (data->size_tag != memfile_size_tag) {
+			data->size_tag = memfile_size_tag;
+			size += sizeof(MemFileChunkData) + chunk->size;
+		}
 	}
-	return 0;
+	
+	return size;
 }
 
 void add_memfilechunk(MemFile *compare, MemFile *current, const char *buf, unsigned int size)
@@ -116,22 +212,38 @@ void add_memfilechunk(MemFile *compare, MemFile *current, const char *buf, unsig
 	curchunk->ident = 0;
 	BLI_addtail(&current->chunks, curchunk);
 	
-	/* we compare compchunk with buf */
+	/* we compare compchunk with buf, most chunks are unchanged and in the same place */
 	if (compchunk) {
 		if (compchunk->size == curchunk->size) {
-			if (my_memcmp((int *)compchunk->buf, (const int *)buf, size / 4) == 0) {
+			if (memcmp(compchunk->buf, buf, size) == 0) {
 				curchunk->buf = compchunk->buf;
-				curchunk->ident = 1;
 			}
 		}
 		compchunk = compchunk->next;
 	}
 	
-	/* not equal... */
+	/* otherwise look for the same content anywhere in the undo stack */
 	if (curchunk->buf == NULL) {
-		curchunk->buf = MEM_mallocN(size, "Chunk buffer");
-		memcpy(curchunk->buf, buf, size);
-		current->size += size;
+		MemFileChunkKey key;
+		MemFileChunkData *data;
+		
+		key.hash = memfile_chunk_hash(buf, size);
+		key.size = size;
+		key.buf = buf;
+		
+		data = memfile_chunk_store ? BLI_hashmap_lookup(memfile_chunk_store, &key) : NULL;
+		
+		if (data) {
+			curchunk->buf = (char *)data->key.buf;
+		}
+		else {
+			/* not equal... */
+			curchunk->buf = memfile_chunk_buf_add(buf, size, key.hash);
+			current->size += size;
+			return;
+		}
 	}
+	
+	MEMFILE_CHUNK_DATA(curchunk->buf)->users++;
+	curchunk->ident = 1;
 }
-
@@ -147,6 +147,8 @@
 #include "BLI_math.h"
 #include "BLI_utildefines.h"
 #include "BLI_mempool.h"
+#include "BLI_threads.h"
+#include "BLI_task.h"
 
 #include "BKE_action.h"
 #include "BKE_blender.h"
@@ -187,6 +189,8 @@
 #define MYWRITE_BUFFER_SIZE	100000
 #define MYWRITE_MAX_CHUNK	32768
 
+struct WriteCompress;
+
 typedef struct {
 	struct SDNA *sdna;
 
@@ -196,6 +200,8 @@ typedef struct {
 	
 	int tot, count, error, memsize;
 
+	struct WriteCompress *compress;  /* for compressed files, see write_compress_begin */
+
 #ifdef USE_BMESH_SAVE_AS_COMPAT
 	char use_mesh_compat; /* option to save with older mesh format */
 #endif
@@ -220,6 +226,199 @@ static WriteData *writedata_new(int file)
 	return wd;
 }
 
+/* ********* compressed writing ************ */
+
+/* Compressed files are written as a sequence of independent gzip members, one per
+ * block. This is valid gzip (gzread reads it as one stream), and lets blocks be
+ * compressed on other threads while the file is still being written.
+ * Blocks are written in order, at most max_blocks are kept in flight. */
+
+#define WRITE_COMPRESS_BLOCK_SIZE	(1 << 20)
+
+typedef struct WriteCompressBlock {
+	struct WriteCompressBlock *next, *prev;
+	unsigned char *in, *out;
+	int in_len, out_len;
+	bool done, error;
+} WriteCompressBlock;
+
+typedef struct WriteCompress {
+	TaskPool *pool;  /* NULL when compressing on the writing thread */
+	ThreadMutex mutex;
+	ThreadCondition cond;
+
+	ListBase blocks;  /* submitted blocks, in file order */
+	int tot_blocks, max_blocks;
+	WriteCompressBlock *block;  /* block being filled */
+} WriteCompress;
+
+static void write_compress_block(WriteCompressBlock *block)
+{
+	z_stream strm = {NULL};
+	int out_size;
+
+	/* level 1 is very close to 3 (the default) in terms of file size,
+	 * but about twice as fast, best use for speedy saving - campbell */
+	if (deflateInit2(&strm, 1, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+		block->error = true;
+		return;
+	}
+
+	/* gzip header and trailer aren't included in the bound */
+	out_size = (int)deflateBound(&strm, (uLong)block->in_len) + 32;
+	block->out = MEM_mallocN(out_size, "WriteCompressBlock.out");
+
+	strm.next_in = block->in;
+	strm.avail_in = (uInt)block->in_len;
+	strm.next_out = block->out;
+	strm.avail_out = (uInt)out_size;
+
+	if (deflate(&strm, Z_FINISH) == Z_STREAM_END) {
+		block->out_len = (int)strm.total_out;
+	}
+	else {
+		block->error = true;
+	}
+
+	deflateEnd(&strm);
+
+	MEM_freeN(block->in);
+	block->in = NULL;
+}
+
+static void write_compress_task(TaskPool *pool, void *taskdata, int UNUSED(threadid))
+{
+	WriteCompress *compress = BLI_task_pool_userdata(pool);
+	WriteCompressBlock *block = taskdata;
+
+	write_compress_block(block);
+
+	BLI_mutex_lock(&compress->mutex);
+	block->done = true;
+	BLI_condition_notify_all(&compress->cond);
+	BLI_mutex_unlock(&compress->mutex);
+}
+
+static void write_compress_begin(WriteData *wd)
+{
+	WriteCompress *compress = MEM_callocN(sizeof(*compress), "WriteCompress");
+
+	/* the global scheduler is created on first use, only safe from the main thread */
+	if (BLI_thread_is_main()) {
+		TaskScheduler *scheduler = BLI_task_scheduler_get();
+
+		if (BLI_task_scheduler_num_threads(scheduler) > 1) {
+			compress->pool = BLI_task_pool_create(scheduler, compress);
+			compress->max_blocks = BLI_task_scheduler_num_threads(scheduler) * 2;
+		}
+	}
+
+	BLI_mutex_init(&compress->mutex);
+	BLI_condition_init(&compress->cond);
+
+	wd->compress = compress;
+}
+
+/* write out finished blocks until no more than max_blocks are left in flight */
+static void write_compress_flush(WriteData *wd, int max_blocks)
+{
+	WriteCompress *compress = wd->compress;
+
+	while (compress->tot_blocks > max_blocks) {
+		WriteCompressBlock *block = compress->blocks.first;
+
+		BLI_mutex_lock(&compress->mutex);
+		while (!block->done) {
+			BLI_condition_wait(&compress->cond, &compress->mutex);
+		}
+		BLI_mutex_unlock(&compress->mutex);
+
+		if (block->error) {
+			wd->error = 1;
+		}
+		else if (!wd->error && write(wd->file, block->out, block->out_len) != block->out_len) {
+			wd->error = 1;
+		}
+
+		BLI_remlink(&compress->blocks, block);
+		compress->tot_blocks--;
+
+		if (block->in) MEM_freeN(block->in);
+		if (block->out) MEM_freeN(block->out);
+		MEM_freeN(block);
+	}
+}
+
+static void write_compress_submit(WriteData *wd)
+{
+	WriteCompress *compress = wd->compress;
+	WriteCompressBlock *block = compress->block;
+
+	compress->block = NULL;
+
+	BLI_addtail(&compress->blocks, block);
+	compress->tot_blocks++;
+
+	if (compress->pool) {
+		BLI_task_pool_push(compress->pool, write_compress_task, block, false, TASK_PRIORITY_LOW);
+	}
+	else {
+		write_compress_block(block);
+		block->done = true;
+	}
+
+	write_compress_flush(wd, compress->max_blocks);
+}
+
+static void write_compress_append(WriteData *wd, const unsigned char *mem, int memlen)
+{
+	WriteCompress *compress = wd->compress;
+
+	while (memlen > 0) {
+		WriteCompressBlock *block = compress->block;
+		int len;
+
+		if (block == NULL) {
+			block = compress->block = MEM_callocN(sizeof(*block), "WriteCompressBlock");
+			block->in = MEM_mallocN(WRITE_COMPRESS_BLOCK_SIZE, "WriteCompressBlock.in");
+		}
+
+		len = MIN2(memlen, WRITE_COMPRESS_BLOCK_SIZE - block->in_len);
+		memcpy(block->in + block->in_len, mem, len);
+		block->in_len += len;
+		mem += len;
+		memlen -= len;
+
+		if (block->in_len == WRITE_COMPRESS_BLOCK_SIZE) {
+			write_compress_submit(wd);
+		}
+	}
+}
+
+static void write_compress_end(WriteData *wd)
+{
+	WriteCompress *compress = wd->compress;
+
+	if (compress->block) {
+		write_compress_submit(wd);
+	}
+	write_compress_flush(wd, 0);
+
+	if (compress->pool) {
+		/* the flush only waits for the blocks, tasks may still be finishing */
+		BLI_task_pool_work_and_wait(compress->pool);
+		BLI_task_pool_free(compress->pool);
+	}
+
+	BLI_mutex_end(&compress->mutex);
+	BLI_condition_end(&compress->cond);
+
+	MEM_freeN(compress);
+	wd->compress = NULL;
+}
+
+/* ********* buffered writing ************ */
+
 static void writedata_do_write(WriteData *wd, const void *mem, int memlen)
 {
 	if ((wd == NULL) || wd->error || (mem == NULL) || memlen < 1) return;
@@ -229,6 +428,9 @@ static void writedata_do_write(WriteData *wd, const void *mem, int memlen)
 	if (wd->current) {
 		add_memfilechunk(NULL, wd->current, mem, memlen);
 	}
+	else if (wd->compress) {
+		write_compress_append(wd, mem, memlen);
+	}
 	else {
 		if (write(wd->file, mem, memlen) != memlen)
 			wd->error= 1;
@@ -335,6 +537,10 @@ static int endwrite(WriteData *wd)
 		wd->count= 0;
 	}
 	
+	if (wd->compress) {
+		write_compress_end(wd);
+	}
+	
 	err= wd->error;
 	writedata_free(wd);
 
@@ -3320,6 +3526,11 @@ static int write_file_handle(Main *mainvar, int handle, MemFile *compare, MemFil
 
 	wd= bgnwrite(handle, compare, current);
 
+	/* compress while writing, not for undo */
+	if ((write_flags & G_FILE_COMPRESS) && !current) {
+		write_compress_begin(wd);
+	}
+
 #ifdef USE_BMESH_SAVE_AS_COMPAT
 	wd->use_mesh_compat = (write_flags & G_FILE_MESH_COMPAT) != 0;
 #endif
@@ -3518,34 +3729,9 @@ int BLO_write_file(Main *mainvar, const char *filepath, int write_flags, ReportL
 		}
 	}
 
-	if (write_flags & G_FILE_COMPRESS) {
-		/* compressed files have the same ending as regular files... only from 2.4!!! */
-		char gzname[FILE_MAX+4];
-		int ret;
-
-		/* first write compressed to separate @.gz */
-		BLI_snprintf(gzname, sizeof(gzname), "%s@.gz", filepath);
-		ret = BLI_file_gzip(tempname, gzname);
-		
-		if (0==ret) {
-			/* now rename to real file name, and delete temp @ file too */
-			if (BLI_rename(gzname, filepath) != 0) {
-				BKE_report(reports, RPT_ERROR, "Cannot change old file (file saved with @)");
-				return 0;
-			}
-
-			BLI_delete(tempname, false, false);
-		}
-		else if (-1==ret) {
-			BKE_report(reports, RPT_ERROR, "Failed opening .gz file");
-			return 0;
-		}
-		else if (-2==ret) {
-			BKE_report(reports, RPT_ERROR, "Failed opening .blend file for compression");
-			return 0;
-		}
-	}
-	else if (BLI_rename(tempname, filepath) != 0) {
+	/* compressed files were compressed while writing (see write_compress_begin),
+	 * they have the same ending as regular files... only from 2.4!!! */
+	if (BLI_rename(tempname, filepath) != 0) {
 		BKE_report(reports, RPT_ERROR, "Cannot change old file (file saved with @)");
 		return 0;
 	}
@@ -328,7 +328,12 @@ void COM_deinitialize(void);
  * @brief Clear all compositor caches. (Compositor system will still remain available). 
  * To deinitialize the compositor use the COM_deinitialize method.
  */
-// void COM_clearCaches(void); // NOT YET WRITTEN
+void COM_clearCaches(void);
+
+/**
+ * @brief Tag buffers that depend on render results as changed, called when rendering starts.
+ */
+void COM_tagRender(void);
 
 /**
  * @brief Return a list of highlighted bnodes pointers.
@@ -107,6 +107,31 @@ typedef enum OrderOfChunks {
 
 #define COM_NUMBER_OF_CHANNELS 4
 
+/**
+ * @brief maximum number of pixels calculated by a single executeSpan call
+ * operations keep input spans on the stack, so this should stay small
+ * @see SocketReader.executeSpan
+ */
+#define COM_SPAN_SIZE 64
+
 #define COM_BLUR_BOKEH_PIXELS 512
 
+/**
+ * @brief radius above which gaussian and box blurs use recursive filters, their cost does not depend on the radius
+ * @see BlurBaseOperation.useRecursiveFilter
+ */
+#define COM_BLUR_RECURSIVE_RADIUS 32
+
+/**
+ * @brief radius above which the bokeh blurs convolve the whole image at once using the fast hartley transform
+ * @see BokehBlurOperation, GaussianBokehBlurOperation
+ */
+#define COM_BLUR_CONVOLUTION_RADIUS 32
+
+/**
+ * @brief maximum size in bytes of the buffers kept between executions
+ * @see BufferCache
+ */
+#define COM_BUFFER_CACHE_LIMIT ((size_t)1024 * 1024 * 1024)
+
 #endif  /* __COM_DEFINES_H__ */
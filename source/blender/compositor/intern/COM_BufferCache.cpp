@@ -0,0 +1,217 @@
+/*
+ * Copyright 2013, Blender Foundation.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <map>
+
+#include "COM_BufferCache.h"
+#include "COM_CompositorContext.h"
+#include "COM_MemoryBuffer.h"
+#include "COM_defines.h"
+
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+	#include "BLI_threads.h"
+	#include "DNA_ID.h"
+	#include "BKE_node.h"
+}
+
+typedef struct BufferCacheEntry {
+	MemoryBuffer *buffer;
+	vector<bool> executedChunks;
+	size_t size;
+	unsigned int stamp;
+} BufferCacheEntry;
+
+static map<BufferCacheKey, BufferCacheEntry> g_entries;
+static size_t g_size = 0;
+static unsigned int g_stamp = 0;
+static unsigned int g_renderGeneration = 0;
+static ThreadMutex g_mutex = BLI_MUTEX_INITIALIZER;
+
+/* FNV-1a */
+#define COM_BUFFER_CACHE_SEED 14695981039346656037ULL
+#define COM_BUFFER_CACHE_PRIME 1099511628211ULL
+
+static void cache_free_entry(map<BufferCacheKey, BufferCacheEntry>::iterator it)
+{
+	g_size -= it->second.size;
+	delete it->second.buffer;
+	g_entries.erase(it);
+}
+
+MemoryBuffer *BufferCache::acquire(BufferCacheKey key, vector<bool> *executedChunks)
+{
+	MemoryBuffer *buffer = NULL;
+
+	BLI_mutex_lock(&g_mutex);
+	map<BufferCacheKey, BufferCacheEntry>::iterator it = g_entries.find(key);
+	if (it != g_entries.end()) {
+		buffer = it->second.buffer;
+		*executedChunks = it->second.executedChunks;
+		g_size -= it->second.size;
+		g_entries.erase(it);
+	}
+	BLI_mutex_unlock(&g_mutex);
+
+	return buffer;
+}
+
+void BufferCache::release(BufferCacheKey key, MemoryBuffer *buffer, const vector<bool> &executedChunks)
+{
+	BufferCacheEntry entry;
+	entry.buffer = buffer;
+	entry.executedChunks = executedChunks;
+	entry.size = buffer->getMemorySize();
+
+	if (entry.size > COM_BUFFER_CACHE_LIMIT) {
+		delete buffer;
+		return;
+	}
+
+	BLI_mutex_lock(&g_mutex);
+
+	/* same subtree used twice in the tree */
+	map<BufferCacheKey, BufferCacheEntry>::iterator it = g_entries.find(key);
+	if (it != g_entries.end()) {
+		cache_free_entry(it);
+	}
+
+	/* free least recently stored buffers */
+	while (g_size + entry.size > COM_BUFFER_CACHE_LIMIT) {
+		map<BufferCacheKey, BufferCacheEntry>::iterator oldest = g_entries.begin();
+		for (it = g_entries.begin(); it != g_entries.end(); ++it) {
+			if (it->second.stamp < oldest->second.stamp) {
+				oldest = it;
+			}
+		}
+		cache_free_entry(oldest);
+	}
+
+	entry.stamp = g_stamp++;
+	g_entries[key] = entry;
+	g_size += entry.size;
+
+	BLI_mutex_unlock(&g_mutex);
+}
+
+void BufferCache::clear()
+{
+	BLI_mutex_lock(&g_mutex);
+	while (!g_entries.empty()) {
+		cache_free_entry(g_entries.begin());
+	}
+	BLI_mutex_unlock(&g_mutex);
+}
+
+void BufferCache::tagRender()
+{
+	BLI_mutex_lock(&g_mutex);
+	g_renderGeneration++;
+	BLI_mutex_unlock(&g_mutex);
+}
+
+BufferCacheKey BufferCache::hash(const void *data, size_t size, BufferCacheKey key)
+{
+	const unsigned char *bytes = (const unsigned char *)data;
+	for (size_t index = 0; index < size; index++) {
+		key ^= bytes[index];
+		key *= COM_BUFFER_CACHE_PRIME;
+	}
+	return key;
+}
+
+BufferCacheKey BufferCache::hashContext(CompositorContext &context)
+{
+	BufferCacheKey key = COM_BUFFER_CACHE_SEED;
+	const int quality = context.getQuality();
+	const int chunksize = context.getChunksize();
+	const bool rendering = context.isRendering();
+	const bool fastCalculation = context.isFastCalculation();
+	const bool openCL = context.getHasActiveOpenCLDevices();
+	const bool halfFloat = context.isHalfFloatBuffersEnabled();
+
+	key = hash(&quality, sizeof(quality), key);
+	key = hash(&chunksize, sizeof(chunksize), key);
+	key = hash(&rendering, sizeof(rendering), key);
+	key = hash(&fastCalculation, sizeof(fastCalculation), key);
+	key = hash(&openCL, sizeof(openCL), key);
+	key = hash(&halfFloat, sizeof(halfFloat), key);
+
+	/* render size and such, the frame only matters for nodes that read data, see hashNode */
+	RenderData rd = *context.getRenderData();
+	rd.cfra = 0;
+	rd.subframe = 0.0f;
+	key = hash(&rd, sizeof(rd), key);
+
+	return key;
+}
+
+BufferCacheKey BufferCache::hashNode(const bNode *node, const RenderData *rd)
+{
+	BufferCacheKey key = COM_BUFFER_CACHE_SEED;
+
+	/* reads the scene camera, which is not part of the key */
+	if (node->type == CMP_NODE_DEFOCUS) {
+		return 0;
+	}
+
+	key = hash(&node->type, sizeof(node->type), key);
+	key = hash(&node->custom1, sizeof(node->custom1), key);
+	key = hash(&node->custom2, sizeof(node->custom2), key);
+	key = hash(&node->custom3, sizeof(node->custom3), key);
+	key = hash(&node->custom4, sizeof(node->custom4), key);
+
+	/* storage is hashed as is, storage that refers to other data like curve mappings
+	 * also contains a timestamp of the last change */
+	if (node->storage) {
+		key = hash(node->storage, MEM_allocN_len(node->storage), key);
+	}
+
+	for (bNodeSocket *socket = (bNodeSocket *)node->inputs.first; socket; socket = socket->next) {
+		if (socket->default_value) {
+			key = hash(socket->default_value, MEM_allocN_len(socket->default_value), key);
+		}
+	}
+
+	if (node->id) {
+		switch (GS(node->id->name)) {
+			case ID_NT:
+				/* nodes inside of node groups are converted and hashed themselves */
+				return hash(&node->id, sizeof(node->id), key);
+			case ID_SCE:
+				/* render layers, changed by rendering */
+				BLI_mutex_lock(&g_mutex);
+				key = hash(&g_renderGeneration, sizeof(g_renderGeneration), key);
+				BLI_mutex_unlock(&g_mutex);
+				break;
+			default:
+				/* images are reloaded, painted or regenerated and masks, movie clips and
+				 * textures are edited outside of the node tree, without a way to tell
+				 * that their content changed */
+				return 0;
+		}
+		key = hash(&node->id, sizeof(node->id), key);
+		key = hash(&rd->cfra, sizeof(rd->cfra), key);
+	}
+	else if (node->type == CMP_NODE_TIME) {
+		key = hash(&rd->cfra, sizeof(rd->cfra), key);
+	}
+
+	return key;
+}
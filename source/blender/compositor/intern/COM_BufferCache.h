@@ -0,0 +1,96 @@
+/*
+ * Copyright 2013, Blender Foundation.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+class BufferCache;
+
+#ifndef _COM_BufferCache_h_
+#define _COM_BufferCache_h_
+
+#include <vector>
+
+extern "C" {
+	#include "BLI_sys_types.h"
+	#include "DNA_node_types.h"
+	#include "DNA_scene_types.h"
+}
+
+using namespace std;
+
+class CompositorContext;
+class MemoryBuffer;
+
+/**
+ * @brief hash of everything a buffer depends on, zero when the buffer can not be cached
+ */
+typedef uint64_t BufferCacheKey;
+
+/**
+ * @brief Keeps MemoryProxy buffers between executions of the compositor.
+ *
+ * The buffer of a WriteBufferOperation is stored after execution, with the chunks that were
+ * calculated, under a key that hashes the operations, node settings and input values it depends on.
+ * The next execution with the same key continues with that buffer, so when a node is changed
+ * only the branches downstream of it are calculated again.
+ *
+ * Buffers are owned by the cache between executions and by the MemoryProxy during execution.
+ * Least recently stored buffers are freed when the cache grows beyond COM_BUFFER_CACHE_LIMIT.
+ * @ingroup Memory
+ */
+class BufferCache {
+public:
+	/**
+	 * @brief take the buffer stored for a key out of the cache
+	 * @param executedChunks is filled with the chunks of the buffer that were calculated
+	 * @return the buffer or NULL when the key is not in the cache
+	 */
+	static MemoryBuffer *acquire(BufferCacheKey key, vector<bool> *executedChunks);
+
+	/**
+	 * @brief store a buffer in the cache, the cache becomes owner of the buffer
+	 * @param executedChunks the chunks of the buffer that were calculated
+	 */
+	static void release(BufferCacheKey key, MemoryBuffer *buffer, const vector<bool> &executedChunks);
+
+	/**
+	 * @brief free all buffers in the cache
+	 */
+	static void clear();
+
+	/**
+	 * @brief invalidate buffers that depend on render results, called when a new render starts
+	 */
+	static void tagRender();
+
+	/**
+	 * @brief add data to a key
+	 */
+	static BufferCacheKey hash(const void *data, size_t size, BufferCacheKey key);
+
+	/**
+	 * @brief key of the execution context, settings that change the result of all operations
+	 */
+	static BufferCacheKey hashContext(CompositorContext &context);
+
+	/**
+	 * @brief key of a node, its settings and input values
+	 * @return zero when the node reads data that can change without the node tree changing
+	 */
+	static BufferCacheKey hashNode(const bNode *node, const RenderData *rd);
+};
+
+#endif
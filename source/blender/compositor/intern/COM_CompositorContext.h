@@ -181,6 +181,8 @@ public:
 	void setFastCalculation(bool fastCalculation) {this->m_fastCalculation = fastCalculation;}
 	bool isFastCalculation() {return this->m_fastCalculation;}
 	inline bool isGroupnodeBufferEnabled() {return this->getbNodeTree()->flag & NTREE_COM_GROUPNODE_BUFFER;}
+	inline bool isBufferCacheEnabled() {return (this->getbNodeTree()->flag & NTREE_COM_BUFFER_CACHE) != 0;}
+	inline bool isHalfFloatBuffersEnabled() {return (this->getbNodeTree()->flag & NTREE_COM_HALF_BUFFERS) != 0;}
 };
 
 
@@ -64,6 +64,8 @@ ExecutionGroup::ExecutionGroup()
 	this->m_singleThreaded = false;
 	this->m_chunksFinished = 0;
 	BLI_rcti_init(&this->m_viewerBorder, 0, 0, 0, 0);
+	BLI_rcti_init(&this->m_viewRegion, 0, 0, 0, 0);
+	this->m_numberOfViewChunks = 0;
 	this->m_executionStartTime = 0;
 }
 
@@ -183,6 +185,26 @@ void ExecutionGroup::initExecution()
 
 }
 
+void ExecutionGroup::getExecutedChunks(vector<bool> *executedChunks) const
+{
+	executedChunks->resize(this->m_numberOfChunks);
+	for (unsigned int index = 0; index < this->m_numberOfChunks; index++) {
+		(*executedChunks)[index] = (this->m_chunkExecutionStates[index] == COM_ES_EXECUTED);
+	}
+}
+
+void ExecutionGroup::setExecutedChunks(const vector<bool> &executedChunks)
+{
+	if (executedChunks.size() != this->m_numberOfChunks) {
+		return;
+	}
+	for (unsigned int index = 0; index < this->m_numberOfChunks; index++) {
+		if (executedChunks[index]) {
+			this->m_chunkExecutionStates[index] = COM_ES_EXECUTED;
+		}
+	}
+}
+
 void ExecutionGroup::deinitExecution()
 {
 	if (this->m_chunkExecutionStates != NULL) {
@@ -202,6 +224,7 @@ void ExecutionGroup::determineResolution(unsigned int resolution[2])
 	resolution[1] = operation->getHeight();
 	this->setResolution(resolution);
 	BLI_rcti_init(&this->m_viewerBorder, 0, this->m_width, 0, this->m_height);
+	BLI_rcti_init(&this->m_viewRegion, 0, this->m_width, 0, this->m_height);
 }
 
 void ExecutionGroup::determineNumberOfChunks()
@@ -344,6 +367,17 @@ void ExecutionGroup::execute(ExecutionSystem *graph)
 			break;
 	}
 
+	/* only chunks in the view region are executed, chunks of other groups are scheduled
+	 * for the area of interest of these chunks only */
+	rcti chunkRect;
+	this->m_numberOfViewChunks = 0;
+	for (index = 0; index < this->m_numberOfChunks; index++) {
+		determineChunkRect(&chunkRect, chunkOrder[index]);
+		if (BLI_rcti_isect(&chunkRect, &this->m_viewRegion, NULL)) {
+			chunkOrder[this->m_numberOfViewChunks++] = chunkOrder[index];
+		}
+	}
+
 	DebugInfo::execution_group_started(this);
 	DebugInfo::graphviz(graph);
 
@@ -357,7 +391,7 @@ void ExecutionGroup::execute(ExecutionSystem *graph)
 		finished = true;
 		int numberEvaluated = 0;
 
-		for (index = startIndex; index < this->m_numberOfChunks && numberEvaluated < maxNumberEvaluated; index++) {
+		for (index = startIndex; index < this->m_numberOfViewChunks && numberEvaluated < maxNumberEvaluated; index++) {
 			chunkNumber = chunkOrder[index];
 			int yChunk = chunkNumber / this->m_numberOfXChunks;
 			int xChunk = chunkNumber - (yChunk * this->m_numberOfXChunks);
@@ -471,7 +505,7 @@ void ExecutionGroup::finalizeChunkExecution(int chunkNumber, MemoryBuffer **memo
 	if (this->m_bTree) {
 		// status report is only performed for top level Execution Groups.
 		float progress = this->m_chunksFinished;
-		progress /= this->m_numberOfChunks;
+		progress /= this->m_numberOfViewChunks;
 		this->m_bTree->progress(this->m_bTree->prh, progress);
 
 		if (G.background)
@@ -642,6 +676,16 @@ void ExecutionGroup::setViewerBorder(float xmin, float xmax, float ymin, float y
 	}
 }
 
+void ExecutionGroup::setViewRegion(float xmin, float xmax, float ymin, float ymax)
+{
+	NodeOperation *operation = this->getOutputNodeOperation();
+
+	if (operation->isViewerOperation()) {
+		BLI_rcti_init(&this->m_viewRegion, floorf(xmin * this->m_width), ceilf(xmax * this->m_width),
+		              floorf(ymin * this->m_height), ceilf(ymax * this->m_height));
+	}
+}
+
 void ExecutionGroup::setRenderBorder(float xmin, float xmax, float ymin, float ymax)
 {
 	NodeOperation *operation = this->getOutputNodeOperation();
@@ -168,6 +168,17 @@ private:
 	 */
 	rcti m_viewerBorder;
 
+	/**
+	 * @brief region of a viewer operation that is visible in the editor, only chunks intersecting it are executed
+	 * @note measured in pixel space
+	 */
+	rcti m_viewRegion;
+
+	/**
+	 * @brief total number of chunks that are executed, the chunks intersecting the view region
+	 */
+	unsigned int m_numberOfViewChunks;
+
 	/**
 	 * @brief start time of execution
 	 */
@@ -322,6 +333,18 @@ public:
 	 * @note The implementation will calculate the chunkSize of this execution group.
 	 */
 	void initExecution();
+
+	/**
+	 * @brief get the chunks that are executed
+	 * @see BufferCache
+	 */
+	void getExecutedChunks(vector<bool> *executedChunks) const;
+
+	/**
+	 * @brief mark chunks as executed, when the output buffer was taken from the BufferCache
+	 * @note only applied when the number of chunks matches
+	 */
+	void setExecutedChunks(const vector<bool> &executedChunks);
 	
 	/**
 	 * @brief get all inputbuffers needed to calculate an chunk
@@ -419,6 +442,12 @@ public:
 
 	void setRenderBorder(float xmin, float xmax, float ymin, float ymax);
 
+	/**
+	 * @brief set the region of a viewer operation that is visible in the editor
+	 * @note all the coordinates are assumed to be in normalized space
+	 */
+	void setViewRegion(float xmin, float xmax, float ymin, float ymax);
+
 #ifdef WITH_CXX_GUARDEDALLOC
 	MEM_CXX_CLASS_ALLOC_FUNCS("COM:ExecutionGroup")
 #endif
@@ -22,6 +22,8 @@
 
 #include "COM_ExecutionSystem.h"
 
+#include <set>
+
 #include "PIL_time.h"
 #include "BLI_utildefines.h"
 extern "C" {
@@ -39,6 +41,7 @@ extern "C" {
 #include "COM_ReadBufferOperation.h"
 #include "COM_ExecutionSystemHelper.h"
 #include "COM_Debug.h"
+#include "COM_BufferCache.h"
 
 #include "BKE_global.h"
 
@@ -78,6 +81,12 @@ ExecutionSystem::ExecutionSystem(RenderData *rd, bNodeTree *editingtree, bool re
 	                         viewer_border->xmin < viewer_border->xmax &&
 	                         viewer_border->ymin < viewer_border->ymax;
 
+	/* part of the viewer image visible in the node editor, set when the backdrop is moved or zoomed */
+	rctf *view_region = &editingtree->view_region;
+	bool use_view_region = !rendering && (editingtree->flag & NTREE_VIEW_REGION) &&
+	                       view_region->xmin < view_region->xmax &&
+	                       view_region->ymin < view_region->ymax;
+
 	for (index = 0; index < this->m_groups.size(); index++) {
 		resolution[0] = 0;
 		resolution[1] = 0;
@@ -98,6 +107,17 @@ ExecutionSystem::ExecutionSystem(RenderData *rd, bNodeTree *editingtree, bool re
 			executionGroup->setViewerBorder(viewer_border->xmin, viewer_border->xmax,
 			                                viewer_border->ymin, viewer_border->ymax);
 		}
+
+		if (use_view_region) {
+			executionGroup->setViewRegion(view_region->xmin, view_region->xmax,
+			                              view_region->ymin, view_region->ymax);
+		}
+	}
+
+	this->determineMemoryProxyStorage();
+
+	if (this->m_context.isBufferCacheEnabled()) {
+		this->determineCacheKeys();
 	}
 
 //	DebugInfo::graphviz(this);
@@ -144,6 +164,10 @@ void ExecutionSystem::execute()
 	}
 	unsigned int index;
 
+	/* buffers from the cache are set before the write buffers allocate theirs */
+	map<ExecutionGroup *, vector<bool> > executedChunks;
+	this->acquireCachedBuffers(&executedChunks);
+
 	for (index = 0; index < this->m_operations.size(); index++) {
 		NodeOperation *operation = this->m_operations[index];
 		operation->setbNodeTree(this->m_context.getbNodeTree());
@@ -161,6 +185,9 @@ void ExecutionSystem::execute()
 		executionGroup->setChunksize(this->m_context.getChunksize());
 		executionGroup->initExecution();
 	}
+	for (map<ExecutionGroup *, vector<bool> >::iterator iter = executedChunks.begin(); iter != executedChunks.end(); ++iter) {
+		iter->first->setExecutedChunks(iter->second);
+	}
 
 	WorkScheduler::start(this->m_context);
 
@@ -173,6 +200,8 @@ void ExecutionSystem::execute()
 	WorkScheduler::finish();
 	WorkScheduler::stop();
 
+	this->releaseCachedBuffers();
+
 	for (index = 0; index < this->m_operations.size(); index++) {
 		NodeOperation *operation = this->m_operations[index];
 		operation->deinitExecution();
@@ -287,10 +316,19 @@ void ExecutionSystem::convertToOperations()
 
 	for (index = 0; index < this->m_nodes.size(); index++) {
 		Node *node = (Node *)this->m_nodes[index];
+		unsigned int firstOperation = this->m_operations.size();
 		DebugInfo::node_to_operations(node);
 		node->convertToOperations(this, &this->m_context);
 
 		debug_check_node_connections(node);
+
+		/* remember which node the operations come from, for their BufferCache keys */
+		if (this->m_context.isBufferCacheEnabled() && node->getbNode()) {
+			BufferCacheKey key = BufferCache::hashNode(node->getbNode(), this->m_context.getRenderData());
+			for (unsigned int operationIndex = firstOperation; operationIndex < this->m_operations.size(); operationIndex++) {
+				this->m_operationNodeKeys[this->m_operations[operationIndex]] = key;
+			}
+		}
 	}
 
 	for (index = 0; index < this->m_connections.size(); index++) {
@@ -392,3 +430,186 @@ void ExecutionSystem::findOutputExecutionGroup(vector<ExecutionGroup *> *result)
 		}
 	}
 }
+
+void ExecutionSystem::determineMemoryProxyStorage()
+{
+	unsigned int index;
+
+	/* complex and OpenCL operations use the float RGBA data of their input buffers directly */
+	set<MemoryProxy *> fullProxies;
+	for (index = 0; index < this->m_operations.size(); index++) {
+		NodeOperation *operation = this->m_operations[index];
+		if (operation->isReadBufferOperation()) {
+			ReadBufferOperation *readOperation = (ReadBufferOperation *)operation;
+			OutputSocket *outputSocket = readOperation->getOutputSocket();
+			for (int connectionIndex = 0; connectionIndex < outputSocket->getNumberOfConnections(); connectionIndex++) {
+				NodeOperation *reader = (NodeOperation *)outputSocket->getConnection(connectionIndex)->getToNode();
+				if (reader->isComplex() || reader->isOpenCL()) {
+					fullProxies.insert(readOperation->getMemoryProxy());
+				}
+			}
+		}
+	}
+
+	const bool halfFloat = this->m_context.isHalfFloatBuffersEnabled();
+	for (index = 0; index < this->m_operations.size(); index++) {
+		NodeOperation *operation = this->m_operations[index];
+		if (operation->isWriteBufferOperation()) {
+			WriteBufferOperation *writeOperation = (WriteBufferOperation *)operation;
+			MemoryProxy *memoryProxy = writeOperation->getMemoryProxy();
+			InputSocket *inputSocket = writeOperation->getInputSocket(0);
+			if (fullProxies.find(memoryProxy) != fullProxies.end() || !inputSocket->isConnected()) {
+				continue;
+			}
+
+			memoryProxy->setDataType(inputSocket->getConnection()->getFromSocket()->getDataType());
+			memoryProxy->setHalfFloat(halfFloat);
+		}
+	}
+}
+
+void ExecutionSystem::determineCacheKeys()
+{
+	map<NodeOperation *, BufferCacheKey> keys;
+	BufferCacheKey contextKey = BufferCache::hashContext(this->m_context);
+
+	for (unsigned int index = 0; index < this->m_operations.size(); index++) {
+		NodeOperation *operation = this->m_operations[index];
+		if (operation->isWriteBufferOperation()) {
+			WriteBufferOperation *writeOperation = (WriteBufferOperation *)operation;
+			BufferCacheKey key = this->determineCacheKey(writeOperation, contextKey, keys);
+			writeOperation->getMemoryProxy()->setCacheKey(key);
+		}
+	}
+
+	this->m_operationNodeKeys.clear();
+}
+
+BufferCacheKey ExecutionSystem::determineCacheKey(NodeOperation *operation, BufferCacheKey contextKey,
+                                                  map<NodeOperation *, BufferCacheKey> &keys)
+{
+	map<NodeOperation *, BufferCacheKey>::iterator found = keys.find(operation);
+	if (found != keys.end()) {
+		return found->second;
+	}
+
+	/* the type of operation, with the settings of the node it was converted from */
+	const char *name = typeid(*operation).name();
+	BufferCacheKey key = BufferCache::hash(name, strlen(name), contextKey);
+
+	map<NodeOperation *, BufferCacheKey>::iterator nodeKey = this->m_operationNodeKeys.find(operation);
+	if (nodeKey != this->m_operationNodeKeys.end()) {
+		if (nodeKey->second == 0) {
+			keys[operation] = 0;
+			return 0;
+		}
+		key = BufferCache::hash(&nodeKey->second, sizeof(BufferCacheKey), key);
+	}
+
+	/* values of unconnected inputs */
+	if (operation->isSetOperation()) {
+		float value[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+		operation->read(value, 0.0f, 0.0f, COM_PS_NEAREST);
+		key = BufferCache::hash(value, sizeof(value), key);
+	}
+
+	const unsigned int resolution[2] = {operation->getWidth(), operation->getHeight()};
+	key = BufferCache::hash(resolution, sizeof(resolution), key);
+
+	/* inputs, read buffers continue with the operations writing the buffer */
+	if (operation->isReadBufferOperation()) {
+		ReadBufferOperation *readOperation = (ReadBufferOperation *)operation;
+		WriteBufferOperation *writeOperation = readOperation->getMemoryProxy()->getWriteBufferOperation();
+		BufferCacheKey inputKey = this->determineCacheKey(writeOperation, contextKey, keys);
+		if (inputKey == 0) {
+			keys[operation] = 0;
+			return 0;
+		}
+		key = BufferCache::hash(&inputKey, sizeof(inputKey), key);
+	}
+
+	for (unsigned int index = 0; index < operation->getNumberOfInputSockets(); index++) {
+		InputSocket *inputSocket = operation->getInputSocket(index);
+		const InputSocketResizeMode resizeMode = inputSocket->getResizeMode();
+		BufferCacheKey inputKey = 0;
+
+		if (inputSocket->isConnected()) {
+			NodeOperation *input = (NodeOperation *)inputSocket->getConnection()->getFromNode();
+			inputKey = this->determineCacheKey(input, contextKey, keys);
+			if (inputKey == 0) {
+				keys[operation] = 0;
+				return 0;
+			}
+		}
+
+		key = BufferCache::hash(&resizeMode, sizeof(resizeMode), key);
+		key = BufferCache::hash(&inputKey, sizeof(inputKey), key);
+	}
+
+	/* zero is reserved for operations that can not be cached */
+	if (key == 0) {
+		key = 1;
+	}
+
+	keys[operation] = key;
+	return key;
+}
+
+void ExecutionSystem::acquireCachedBuffers(map<ExecutionGroup *, vector<bool> > *executedChunks)
+{
+	if (!this->m_context.isBufferCacheEnabled()) {
+		return;
+	}
+
+	for (unsigned int index = 0; index < this->m_operations.size(); index++) {
+		NodeOperation *operation = this->m_operations[index];
+		if (operation->isWriteBufferOperation()) {
+			MemoryProxy *memoryProxy = ((WriteBufferOperation *)operation)->getMemoryProxy();
+			if (memoryProxy->getCacheKey() == 0 || memoryProxy->getExecutor() == NULL) {
+				continue;
+			}
+
+			vector<bool> chunks;
+			MemoryBuffer *buffer = BufferCache::acquire(memoryProxy->getCacheKey(), &chunks);
+			if (buffer && (buffer->getDataType() != memoryProxy->getDataType() ||
+			               buffer->isHalfFloat() != memoryProxy->isHalfFloat()))
+			{
+				/* buffer was stored for readers that needed other data */
+				delete buffer;
+				buffer = NULL;
+			}
+			if (buffer) {
+				memoryProxy->setBuffer(buffer);
+				(*executedChunks)[memoryProxy->getExecutor()] = chunks;
+			}
+		}
+	}
+}
+
+void ExecutionSystem::releaseCachedBuffers()
+{
+	if (!this->m_context.isBufferCacheEnabled()) {
+		return;
+	}
+
+	/* chunks of a cancelled execution can be incomplete */
+	const bNodeTree *bTree = this->m_context.getbNodeTree();
+	if (bTree->test_break && bTree->test_break(bTree->tbh)) {
+		return;
+	}
+
+	for (unsigned int index = 0; index < this->m_operations.size(); index++) {
+		NodeOperation *operation = this->m_operations[index];
+		if (operation->isWriteBufferOperation()) {
+			MemoryProxy *memoryProxy = ((WriteBufferOperation *)operation)->getMemoryProxy();
+			ExecutionGroup *group = memoryProxy->getExecutor();
+			if (memoryProxy->getCacheKey() == 0 || group == NULL || memoryProxy->getBuffer() == NULL) {
+				continue;
+			}
+
+			vector<bool> chunks;
+			group->getExecutedChunks(&chunks);
+			BufferCache::release(memoryProxy->getCacheKey(), memoryProxy->takeBuffer(), chunks);
+		}
+	}
+}
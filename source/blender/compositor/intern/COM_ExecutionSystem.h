@@ -27,12 +27,14 @@ class ExecutionGroup;
 
 #include "DNA_color_types.h"
 #include "DNA_node_types.h"
+#include <map>
 #include <vector>
 #include "COM_Node.h"
 #include "COM_SocketConnection.h"
 #include "BKE_text.h"
 #include "COM_ExecutionGroup.h"
 #include "COM_NodeOperation.h"
+#include "COM_BufferCache.h"
 
 using namespace std;
 
@@ -141,6 +143,11 @@ private:
 	 */
 	vector<SocketConnection *> m_connections;
 
+	/**
+	 * @brief BufferCache keys of the nodes the operations were converted from
+	 */
+	map<NodeOperation *, BufferCacheKey> m_operationNodeKeys;
+
 private: //methods
 	/**
 	 * @brief add ReadBufferOperation and WriteBufferOperation around an operation
@@ -159,6 +166,37 @@ private: //methods
 	 */
 	void findOutputExecutionGroup(vector<ExecutionGroup *> *result) const;
 
+	/**
+	 * @brief determine the DataType and precision the buffers of the MemoryProxy's are stored in
+	 * @note buffers read by complex or OpenCL operations stay float RGBA
+	 */
+	void determineMemoryProxyStorage();
+
+	/**
+	 * @brief determine the BufferCache keys of all MemoryProxy's
+	 * @see BufferCache
+	 */
+	void determineCacheKeys();
+
+	/**
+	 * @brief determine the key of an operation, hashing the operation, the node it was converted from and its inputs
+	 * @param keys keys of operations that were already determined
+	 * @return zero when the operation depends on an operation that can not be cached
+	 */
+	BufferCacheKey determineCacheKey(NodeOperation *operation, BufferCacheKey contextKey,
+	                                 map<NodeOperation *, BufferCacheKey> &keys);
+
+	/**
+	 * @brief take buffers of the MemoryProxy's out of the BufferCache before execution
+	 * @param executedChunks the chunks that were already calculated, per ExecutionGroup
+	 */
+	void acquireCachedBuffers(map<ExecutionGroup *, vector<bool> > *executedChunks);
+
+	/**
+	 * @brief store buffers of the MemoryProxy's in the BufferCache after execution
+	 */
+	void releaseCachedBuffers();
+
 public:
 	/**
 	 * @brief Create a new ExecutionSystem and initialize it with the
@@ -43,9 +43,8 @@ MemoryBuffer::MemoryBuffer(MemoryProxy *memoryProxy, unsigned int chunkNumber, r
 	BLI_rcti_init(&this->m_rect, rect->xmin, rect->xmax, rect->ymin, rect->ymax);
 	this->m_memoryProxy = memoryProxy;
 	this->m_chunkNumber = chunkNumber;
-	this->m_buffer = (float *)MEM_mallocN(sizeof(float) * determineBufferSize() * COM_NUMBER_OF_CHANNELS, "COM_MemoryBuffer");
+	this->allocate(memoryProxy->getDataType(), memoryProxy->isHalfFloat());
 	this->m_state = COM_MB_ALLOCATED;
-	this->m_datatype = COM_DT_COLOR;
 	this->m_chunkWidth = this->m_rect.xmax - this->m_rect.xmin;
 }
 
@@ -54,20 +53,65 @@ MemoryBuffer::MemoryBuffer(MemoryProxy *memoryProxy, rcti *rect)
 	BLI_rcti_init(&this->m_rect, rect->xmin, rect->xmax, rect->ymin, rect->ymax);
 	this->m_memoryProxy = memoryProxy;
 	this->m_chunkNumber = -1;
-	this->m_buffer = (float *)MEM_mallocN(sizeof(float) * determineBufferSize() * COM_NUMBER_OF_CHANNELS, "COM_MemoryBuffer");
+	this->allocate(COM_DT_COLOR, false);
 	this->m_state = COM_MB_TEMPORARILY;
-	this->m_datatype = COM_DT_COLOR;
 	this->m_chunkWidth = this->m_rect.xmax - this->m_rect.xmin;
 }
+
+void MemoryBuffer::allocate(DataType datatype, bool halfFloat)
+{
+	this->m_datatype = datatype;
+	switch (datatype) {
+		case COM_DT_VALUE:
+			this->m_numChannels = 1;
+			break;
+		case COM_DT_VECTOR:
+			this->m_numChannels = 3;
+			break;
+		default:
+			this->m_numChannels = COM_NUMBER_OF_CHANNELS;
+			break;
+	}
+	this->m_compact = (halfFloat || this->m_numChannels != COM_NUMBER_OF_CHANNELS);
+
+	const size_t channelSize = (halfFloat) ? sizeof(unsigned short) : sizeof(float);
+	const size_t size = channelSize * this->m_numChannels * getWidth() * getHeight();
+
+	if (halfFloat) {
+		this->m_buffer = NULL;
+		this->m_halfBuffer = (unsigned short *)MEM_mallocN(size, "COM_MemoryBuffer half");
+	}
+	else {
+		this->m_buffer = (float *)MEM_mallocN(size, "COM_MemoryBuffer");
+		this->m_halfBuffer = NULL;
+	}
+}
+
+size_t MemoryBuffer::getMemorySize() const
+{
+	const size_t channelSize = (this->m_halfBuffer) ? sizeof(unsigned short) : sizeof(float);
+	return channelSize * this->m_numChannels * getWidth() * getHeight();
+}
+
 MemoryBuffer *MemoryBuffer::duplicate()
 {
 	MemoryBuffer *result = new MemoryBuffer(this->m_memoryProxy, &this->m_rect);
-	memcpy(result->m_buffer, this->m_buffer, this->determineBufferSize() * COM_NUMBER_OF_CHANNELS * sizeof(float));
+	if (this->m_compact) {
+		result->copyContentFrom(this);
+	}
+	else {
+		memcpy(result->m_buffer, this->m_buffer, this->determineBufferSize() * COM_NUMBER_OF_CHANNELS * sizeof(float));
+	}
 	return result;
 }
 void MemoryBuffer::clear()
 {
-	memset(this->m_buffer, 0, this->determineBufferSize() * COM_NUMBER_OF_CHANNELS * sizeof(float));
+	if (this->m_halfBuffer) {
+		memset(this->m_halfBuffer, 0, getMemorySize());
+	}
+	else {
+		memset(this->m_buffer, 0, getMemorySize());
+	}
 }
 
 float *MemoryBuffer::convertToValueBuffer()
@@ -77,6 +121,15 @@ float *MemoryBuffer::convertToValueBuffer()
 
 	float *result = (float *)MEM_mallocN(sizeof(float) * size, __func__);
 
+	if (this->m_compact) {
+		float color[4];
+		for (i = 0; i < size; i++) {
+			readCompact(color, i);
+			result[i] = color[0];
+		}
+		return result;
+	}
+
 	const float *fp_src = this->m_buffer;
 	float       *fp_dst = result;
 
@@ -89,6 +142,17 @@ float *MemoryBuffer::convertToValueBuffer()
 
 float MemoryBuffer::getMaximumValue()
 {
+	if (this->m_compact) {
+		float *values = convertToValueBuffer();
+		const unsigned int size = this->determineBufferSize();
+		float result = values[0];
+		for (unsigned int i = 1; i < size; i++) {
+			result = max(result, values[i]);
+		}
+		MEM_freeN(values);
+		return result;
+	}
+
 	float result = this->m_buffer[0];
 	const unsigned int size = this->determineBufferSize();
 	unsigned int i;
@@ -131,6 +195,10 @@ MemoryBuffer::~MemoryBuffer()
 		MEM_freeN(this->m_buffer);
 		this->m_buffer = NULL;
 	}
+	if (this->m_halfBuffer) {
+		MEM_freeN(this->m_halfBuffer);
+		this->m_halfBuffer = NULL;
+	}
 }
 
 void MemoryBuffer::copyContentFrom(MemoryBuffer *otherBuffer)
@@ -147,6 +215,17 @@ void MemoryBuffer::copyContentFrom(MemoryBuffer *otherBuffer)
 	int offset;
 	int otherOffset;
 
+	if (this->m_compact || otherBuffer->m_compact) {
+		/* convert pixel by pixel */
+		float color[4];
+		for (otherY = minY; otherY < maxY; otherY++) {
+			for (unsigned int otherX = minX; otherX < maxX; otherX++) {
+				otherBuffer->readNoCheck(color, otherX, otherY);
+				this->writePixel(otherX, otherY, color);
+			}
+		}
+		return;
+	}
 
 	for (otherY = minY; otherY < maxY; otherY++) {
 		otherOffset = ((otherY - otherBuffer->m_rect.ymin) * otherBuffer->m_chunkWidth + minX - otherBuffer->m_rect.xmin) * COM_NUMBER_OF_CHANNELS;
@@ -160,8 +239,13 @@ void MemoryBuffer::writePixel(int x, int y, const float color[4])
 	if (x >= this->m_rect.xmin && x < this->m_rect.xmax &&
 	    y >= this->m_rect.ymin && y < this->m_rect.ymax)
 	{
-		const int offset = (this->m_chunkWidth * (y - this->m_rect.ymin) + x - this->m_rect.xmin) * COM_NUMBER_OF_CHANNELS;
-		copy_v4_v4(&this->m_buffer[offset], color);
+		const int index = this->m_chunkWidth * (y - this->m_rect.ymin) + x - this->m_rect.xmin;
+		if (this->m_compact) {
+			writeCompact(index, color);
+		}
+		else {
+			copy_v4_v4(&this->m_buffer[index * COM_NUMBER_OF_CHANNELS], color);
+		}
 	}
 }
 
@@ -170,8 +254,49 @@ void MemoryBuffer::addPixel(int x, int y, const float color[4])
 	if (x >= this->m_rect.xmin && x < this->m_rect.xmax &&
 	    y >= this->m_rect.ymin && y < this->m_rect.ymax)
 	{
-		const int offset = (this->m_chunkWidth * (y - this->m_rect.ymin) + x - this->m_rect.xmin) * COM_NUMBER_OF_CHANNELS;
-		add_v4_v4(&this->m_buffer[offset], color);
+		const int index = this->m_chunkWidth * (y - this->m_rect.ymin) + x - this->m_rect.xmin;
+		if (this->m_compact) {
+			float sum[4];
+			readCompact(sum, index);
+			add_v4_v4(sum, color);
+			writeCompact(index, sum);
+		}
+		else {
+			add_v4_v4(&this->m_buffer[index * COM_NUMBER_OF_CHANNELS], color);
+		}
+	}
+}
+
+void MemoryBuffer::writeSpan(const float *colors, int x, int y, int length)
+{
+	BLI_assert(y >= this->m_rect.ymin && y < this->m_rect.ymax);
+	BLI_assert(x >= this->m_rect.xmin && x + length <= this->m_rect.xmax);
+
+	const int index = this->m_chunkWidth * (y - this->m_rect.ymin) + x - this->m_rect.xmin;
+	if (this->m_compact) {
+		for (int i = 0; i < length; i++) {
+			writeCompact(index + i, &colors[i * COM_NUMBER_OF_CHANNELS]);
+		}
+	}
+	else {
+		memcpy(&this->m_buffer[index * COM_NUMBER_OF_CHANNELS], colors, sizeof(float) * COM_NUMBER_OF_CHANNELS * length);
+	}
+}
+
+void MemoryBuffer::writeCompact(int index, const float color[4])
+{
+	const int offset = index * this->m_numChannels;
+	unsigned int channel;
+
+	if (this->m_halfBuffer) {
+		for (channel = 0; channel < this->m_numChannels; channel++) {
+			this->m_halfBuffer[offset + channel] = float_to_half(color[channel]);
+		}
+	}
+	else {
+		for (channel = 0; channel < this->m_numChannels; channel++) {
+			this->m_buffer[offset + channel] = color[channel];
+		}
 	}
 }
 
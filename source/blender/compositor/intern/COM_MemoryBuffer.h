@@ -28,6 +28,8 @@ class MemoryBuffer;
 #include "COM_ExecutionGroup.h"
 #include "COM_MemoryProxy.h"
 
+#include <string.h>
+
 extern "C" {
 	#include "BLI_math.h"
 	#include "BLI_rect.h"
@@ -54,8 +56,73 @@ typedef enum MemoryBufferExtend {
 
 class MemoryProxy;
 
+/* half float conversion, for buffers stored as half float */
+static inline unsigned short float_to_half(float f)
+{
+	union { float f; unsigned int i; } u;
+	u.f = f;
+	const unsigned int sign = (u.i >> 16) & 0x8000;
+	const int exponent = (int)((u.i >> 23) & 0xff) - 127 + 15;
+	unsigned int mantissa = u.i & 0x7fffff;
+	unsigned int half;
+
+	if (((u.i >> 23) & 0xff) == 0xff) {
+		/* infinity and nan */
+		return sign | 0x7c00 | (mantissa ? 0x200 : 0);
+	}
+	else if (exponent >= 31) {
+		/* too large, infinity */
+		return sign | 0x7c00;
+	}
+	else if (exponent <= 0) {
+		/* too small, zero or denormal */
+		if (exponent < -10) {
+			return sign;
+		}
+		mantissa |= 0x800000;
+		const int shift = 14 - exponent;
+		half = mantissa >> shift;
+		if ((mantissa >> (shift - 1)) & 1) {
+			half++;
+		}
+		return sign | half;
+	}
+
+	half = sign | (exponent << 10) | (mantissa >> 13);
+	/* round to nearest, a carry correctly moves into the exponent */
+	if (mantissa & 0x1000) {
+		half++;
+	}
+	return half;
+}
+
+static inline float half_to_float(unsigned short h)
+{
+	union { float f; unsigned int i; } u;
+	const unsigned int sign = (h & 0x8000) << 16;
+	const unsigned int exponent = (h >> 10) & 0x1f;
+	const unsigned int mantissa = h & 0x3ff;
+
+	if (exponent == 0) {
+		/* zero and denormals */
+		u.f = mantissa * (1.0f / 16777216.0f);
+		u.i |= sign;
+	}
+	else if (exponent == 31) {
+		u.i = sign | 0x7f800000 | (mantissa << 13);
+	}
+	else {
+		u.i = sign | ((exponent + 112) << 23) | (mantissa << 13);
+	}
+	return u.f;
+}
+
 /**
  * @brief a MemoryBuffer contains access to the data of a chunk
+ *
+ * Buffers used by operations store COM_NUMBER_OF_CHANNELS floats per pixel. The buffers of a
+ * MemoryProxy can be stored compact, with only the channels of their DataType and optionally as
+ * half float. Compact buffers are only accessed with the read and write methods, not with getBuffer.
  */
 class MemoryBuffer {
 private:
@@ -96,9 +163,63 @@ private:
 	 */
 	float *m_buffer;
 
+	/**
+	 * @brief the half float data of buffers stored as half float, m_buffer is NULL for these
+	 */
+	unsigned short *m_halfBuffer;
+
+	/**
+	 * @brief number of channels stored per pixel, depends on m_datatype
+	 */
+	unsigned int m_numChannels;
+
+	/**
+	 * @brief stored with less channels or as half float
+	 */
+	bool m_compact;
+
+	/**
+	 * @brief read a pixel of a compact buffer, missing channels are filled in
+	 * @param index index of the pixel in the buffer
+	 */
+	inline void readCompact(float result[4], int index)
+	{
+		const int offset = index * this->m_numChannels;
+		unsigned int channel;
+
+		if (this->m_halfBuffer) {
+			for (channel = 0; channel < this->m_numChannels; channel++) {
+				result[channel] = half_to_float(this->m_halfBuffer[offset + channel]);
+			}
+		}
+		else {
+			for (channel = 0; channel < this->m_numChannels; channel++) {
+				result[channel] = this->m_buffer[offset + channel];
+			}
+		}
+
+		if (this->m_numChannels == 1) {
+			result[1] = result[2] = result[3] = result[0];
+		}
+		else if (this->m_numChannels == 3) {
+			result[3] = 0.0f;
+		}
+	}
+
+	/**
+	 * @brief write a pixel of a compact buffer
+	 * @param index index of the pixel in the buffer
+	 */
+	void writeCompact(int index, const float color[4]);
+
+	/**
+	 * @brief allocate the data for the size of m_rect
+	 */
+	void allocate(DataType datatype, bool halfFloat);
+
 public:
 	/**
-	 * @brief construct new MemoryBuffer for a chunk
+	 * @brief construct new MemoryBuffer for a chunk, stored in the DataType of the MemoryProxy
 	 */
 	MemoryBuffer(MemoryProxy *memoryProxy, unsigned int chunkNumber, rcti *rect);
 	
@@ -116,12 +237,38 @@ public:
 	 * @brief read the ChunkNumber of this MemoryBuffer
 	 */
 	unsigned int getChunkNumber() { return this->m_chunkNumber; }
+
+	/**
+	 * @brief set the MemoryProxy a buffer from the BufferCache is used by
+	 */
+	void setMemoryProxy(MemoryProxy *memoryProxy) { this->m_memoryProxy = memoryProxy; }
 	
 	/**
 	 * @brief get the data of this MemoryBuffer
 	 * @note buffer should already be available in memory
+	 * @note not available for compact buffers
+	 */
+	float *getBuffer() { BLI_assert(!this->m_compact); return this->m_buffer; }
+
+	/**
+	 * @brief is the buffer stored with less channels or as half float
+	 */
+	inline const bool isCompact() const { return this->m_compact; }
+
+	/**
+	 * @brief the type of the buffer, determines the number of channels stored
 	 */
-	float *getBuffer() { return this->m_buffer; }
+	DataType getDataType() const { return this->m_datatype; }
+
+	/**
+	 * @brief is the buffer stored as half float
+	 */
+	bool isHalfFloat() const { return this->m_halfBuffer != NULL; }
+
+	/**
+	 * @brief size of the data in bytes
+	 */
+	size_t getMemorySize() const;
 	
 	/**
 	 * @brief after execution the state will be set to available by calling this method
@@ -175,8 +322,13 @@ public:
 		}
 		else {
 			wrap_pixel(x, y, extend_x, extend_y);
-			const int offset = (this->m_chunkWidth * y + x) * COM_NUMBER_OF_CHANNELS;
-			copy_v4_v4(result, &this->m_buffer[offset]);
+			if (this->m_compact) {
+				readCompact(result, this->m_chunkWidth * y + x);
+			}
+			else {
+				const int offset = (this->m_chunkWidth * y + x) * COM_NUMBER_OF_CHANNELS;
+				copy_v4_v4(result, &this->m_buffer[offset]);
+			}
 		}
 	}
 
@@ -198,11 +350,55 @@ public:
 		           (int)(this->determineBufferSize() * COM_NUMBER_OF_CHANNELS));
 #endif
 
-		copy_v4_v4(result, &this->m_buffer[offset]);
+		if (this->m_compact) {
+			readCompact(result, offset / COM_NUMBER_OF_CHANNELS);
+		}
+		else {
+			copy_v4_v4(result, &this->m_buffer[offset]);
+		}
+	}
+
+	/**
+	 * @brief read a horizontal span of pixels, pixels outside the buffer are zero
+	 * @see SocketReader.executeSpan
+	 */
+	inline void readSpan(float *result, int x, int y, int length)
+	{
+		int start = 0;
+		int end = 0;
+		if (y >= m_rect.ymin && y < m_rect.ymax) {
+			start = min_ii(max_ii(m_rect.xmin - x, 0), length);
+			end = max_ii(min_ii(m_rect.xmax - x, length), start);
+		}
+
+		if (start > 0) {
+			memset(result, 0, sizeof(float) * COM_NUMBER_OF_CHANNELS * start);
+		}
+		if (end > start) {
+			const int index = this->m_chunkWidth * (y - m_rect.ymin) + (x + start - m_rect.xmin);
+			if (this->m_compact) {
+				for (int i = start; i < end; i++) {
+					readCompact(result + i * COM_NUMBER_OF_CHANNELS, index + i - start);
+				}
+			}
+			else {
+				memcpy(result + start * COM_NUMBER_OF_CHANNELS, &this->m_buffer[index * COM_NUMBER_OF_CHANNELS],
+				       sizeof(float) * COM_NUMBER_OF_CHANNELS * (end - start));
+			}
+		}
+		if (end < length) {
+			memset(result + end * COM_NUMBER_OF_CHANNELS, 0, sizeof(float) * COM_NUMBER_OF_CHANNELS * (length - end));
+		}
 	}
 	
 	void writePixel(int x, int y, const float color[4]);
 	void addPixel(int x, int y, const float color[4]);
+
+	/**
+	 * @brief write a horizontal span of pixels inside the buffer
+	 * @see readSpan
+	 */
+	void writeSpan(const float *colors, int x, int y, int length);
 	inline void readBilinear(float result[4], float x, float y,
 	                         MemoryBufferExtend extend_x = COM_MB_CLIP,
 	                         MemoryBufferExtend extend_y = COM_MB_CLIP)
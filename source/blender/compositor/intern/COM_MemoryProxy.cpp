@@ -27,6 +27,10 @@ MemoryProxy::MemoryProxy()
 {
 	this->m_writeBufferOperation = NULL;
 	this->m_executor = NULL;
+	this->m_buffer = NULL;
+	this->m_cacheKey = 0;
+	this->m_datatype = COM_DT_COLOR;
+	this->m_halfFloat = false;
 }
 
 void MemoryProxy::allocate(unsigned int width, unsigned int height)
@@ -40,6 +44,20 @@ void MemoryProxy::allocate(unsigned int width, unsigned int height)
 	this->m_buffer = new MemoryBuffer(this, 1, &result);
 }
 
+void MemoryProxy::setBuffer(MemoryBuffer *buffer)
+{
+	this->free();
+	this->m_buffer = buffer;
+	buffer->setMemoryProxy(this);
+}
+
+MemoryBuffer *MemoryProxy::takeBuffer()
+{
+	MemoryBuffer *buffer = this->m_buffer;
+	this->m_buffer = NULL;
+	return buffer;
+}
+
 void MemoryProxy::free()
 {
 	if (this->m_buffer) {
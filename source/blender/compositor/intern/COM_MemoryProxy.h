@@ -26,6 +26,7 @@ class MemoryProxy;
 #ifndef _COM_MemoryProxy_h_
 #define _COM_MemoryProxy_h_
 #include "COM_ExecutionGroup.h"
+#include "COM_BufferCache.h"
 
 class ExecutionGroup;
 
@@ -48,9 +49,14 @@ private:
 	ExecutionGroup *m_executor;
 	
 	/**
-	 * @brief datatype of this MemoryProxy
+	 * @brief datatype of this MemoryProxy, buffers only store the channels of the datatype
 	 */
-	/* DataType m_datatype; */ /* UNUSED */
+	DataType m_datatype;
+
+	/**
+	 * @brief buffers of this MemoryProxy are stored as half float
+	 */
+	bool m_halfFloat;
 	
 	/**
 	 * @brief channel information of this buffer
@@ -62,6 +68,11 @@ private:
 	 */
 	MemoryBuffer *m_buffer;
 
+	/**
+	 * @brief key of the buffer in the BufferCache, zero when the buffer is not cached
+	 */
+	BufferCacheKey m_cacheKey;
+
 public:
 	MemoryProxy();
 	
@@ -103,6 +114,30 @@ public:
 	 */
 	inline MemoryBuffer *getBuffer() { return this->m_buffer; }
 
+	/**
+	 * @brief use an existing buffer, the MemoryProxy becomes owner of the buffer
+	 */
+	void setBuffer(MemoryBuffer *buffer);
+
+	/**
+	 * @brief give up ownership of the buffer
+	 */
+	MemoryBuffer *takeBuffer();
+
+	/**
+	 * @brief set the storage of the buffers of this MemoryProxy
+	 * @note only for buffers that are not read by complex or OpenCL operations,
+	 * these use the float RGBA data of the buffer directly
+	 * @see ExecutionSystem.determineMemoryProxyStorage
+	 */
+	void setDataType(DataType datatype) { this->m_datatype = datatype; }
+	DataType getDataType() const { return this->m_datatype; }
+	void setHalfFloat(bool halfFloat) { this->m_halfFloat = halfFloat; }
+	bool isHalfFloat() const { return this->m_halfFloat; }
+
+	void setCacheKey(BufferCacheKey key) { this->m_cacheKey = key; }
+	BufferCacheKey getCacheKey() const { return this->m_cacheKey; }
+
 #ifdef WITH_CXX_GUARDEDALLOC
 	MEM_CXX_CLASS_ALLOC_FUNCS("COM:MemoryProxy")
 #endif
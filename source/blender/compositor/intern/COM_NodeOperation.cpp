@@ -36,6 +36,7 @@ NodeOperation::NodeOperation() : NodeBase()
 	this->m_height = 0;
 	this->m_isResolutionSet = false;
 	this->m_openCL = false;
+	this->m_spans = false;
 	this->m_btree = NULL;
 }
 
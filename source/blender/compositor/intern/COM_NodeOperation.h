@@ -65,6 +65,12 @@ private:
 	 */
 	bool m_openCL;
 
+	/**
+	 * @brief can this operation calculate a span of pixels at once
+	 * @see SocketReader.executeSpan
+	 */
+	bool m_spans;
+
 	/**
 	 * @brief mutex reference for very special node initializations
 	 * @note only use when you really know what you are doing.
@@ -245,6 +251,12 @@ public:
 	 * @see ExecutionGroup.addOperation
 	 */
 	bool isOpenCL() { return this->m_openCL; }
+
+	/**
+	 * @brief does this NodeOperation implement executeSpan
+	 * @see WriteBufferOperation.executeRegion
+	 */
+	bool isSpans() const { return this->m_spans; }
 	
 	virtual bool isViewerOperation() { return false; }
 	virtual bool isPreviewOperation() { return false; }
@@ -285,6 +297,11 @@ protected:
 	 */
 	void setOpenCL(bool openCL) { this->m_openCL = openCL; }
 
+	/**
+	 * @brief set if this NodeOperation implements executeSpan
+	 */
+	void setSpans(bool spans) { this->m_spans = spans; }
+
 #ifdef WITH_CXX_GUARDEDALLOC
 	MEM_CXX_CLASS_ALLOC_FUNCS("COM:NodeOperation")
 #endif
@@ -90,6 +90,24 @@ protected:
 	 */
 	virtual void executePixel(float output[4], float x, float y, float dx, float dy, PixelSampler sampler) {}
 
+	/**
+	 * @brief calculate a horizontal span of pixels
+	 * @note this method is called for non-complex, pixels are sampled with COM_PS_NEAREST
+	 * @param output is a float array of length * COM_NUMBER_OF_CHANNELS to store the result,
+	 * pixels are stored interleaved like in a MemoryBuffer
+	 * @param x the x-coordinate of the first pixel to calculate in image space
+	 * @param y the y-coordinate of the pixels to calculate in image space
+	 * @param length the number of pixels to calculate, at most COM_SPAN_SIZE
+	 *
+	 * The default implementation calls executePixel for every pixel, operations that
+	 * can process a whole span at once override this and call NodeOperation.setSpans.
+	 */
+	virtual void executeSpan(float *output, int x, int y, int length) {
+		for (int i = 0; i < length; i++) {
+			executePixel(output + i * COM_NUMBER_OF_CHANNELS, (float)(x + i), (float)y, COM_PS_NEAREST);
+		}
+	}
+
 public:
 	inline void read(float result[4], float x, float y, PixelSampler sampler) {
 		executePixel(result, x, y, sampler);
@@ -100,6 +118,9 @@ public:
 	inline void read(float result[4], float x, float y, float dx, float dy, PixelSampler sampler) {
 		executePixel(result, x, y, dx, dy, sampler);
 	}
+	inline void readSpan(float *result, int x, int y, int length) {
+		executeSpan(result, x, y, length);
+	}
 
 	virtual void *initializeTileData(rcti *rect) { return 0; }
 	virtual void deinitializeTileData(rcti *rect, void *data) {
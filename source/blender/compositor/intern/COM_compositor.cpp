@@ -33,6 +33,7 @@ extern "C" {
 #include "COM_WorkScheduler.h"
 #include "OCL_opencl.h"
 #include "COM_MovieDistortionOperation.h"
+#include "COM_BufferCache.h"
 
 static ThreadMutex s_compositorMutex;
 static char is_compositorMutex_init = FALSE;
@@ -40,6 +41,7 @@ static char is_compositorMutex_init = FALSE;
 static void intern_freeCompositorCaches()
 {
 	deintializeDistortionCache();
+	BufferCache::clear();
 }
 
 void COM_execute(RenderData *rd, bNodeTree *editingtree, int rendering,
@@ -77,6 +79,11 @@ void COM_execute(RenderData *rd, bNodeTree *editingtree, int rendering,
 	/* set progress bar to 0% and status to init compositing */
 	editingtree->progress(editingtree->prh, 0.0);
 
+	/* buffers cached while the option was enabled are of no use anymore */
+	if ((editingtree->flag & NTREE_COM_BUFFER_CACHE) == 0) {
+		BufferCache::clear();
+	}
+
 	bool twopass = (editingtree->flag & NTREE_TWO_PASS) > 0 && !rendering;
 	/* initialize execution system */
 	if (twopass) {
@@ -100,7 +107,7 @@ void COM_execute(RenderData *rd, bNodeTree *editingtree, int rendering,
 	BLI_mutex_unlock(&s_compositorMutex);
 }
 
-static void UNUSED_FUNCTION(COM_freeCaches)()
+void COM_clearCaches()
 {
 	if (is_compositorMutex_init) {
 		BLI_mutex_lock(&s_compositorMutex);
@@ -109,6 +116,11 @@ static void UNUSED_FUNCTION(COM_freeCaches)()
 	}
 }
 
+void COM_tagRender()
+{
+	BufferCache::tagRender();
+}
+
 void COM_deinitialize()
 {
 	if (is_compositorMutex_init) {
@@ -21,6 +21,7 @@
  */
 
 #include "COM_BlurBaseOperation.h"
+#include "COM_FastGaussianBlurOperation.h"
 #include "BLI_math.h"
 #include "MEM_guardedalloc.h"
 
@@ -157,3 +158,104 @@ void BlurBaseOperation::updateSize()
 		this->m_sizeavailable = true;
 	}
 }
+
+bool BlurBaseOperation::useRecursiveFilter(int rad) const
+{
+	return (rad > COM_BLUR_RECURSIVE_RADIUS &&
+	        ELEM3(this->m_data->filtertype, R_FILTER_BOX, R_FILTER_TENT, R_FILTER_GAUSS));
+}
+
+MemoryBuffer *BlurBaseOperation::createRecursiveTile(MemoryBuffer *input, rcti *rect, int rad, unsigned int xy)
+{
+	rcti tileRect = *rect;
+	if (xy & 1) {
+		tileRect.xmin -= rad;
+		tileRect.xmax += rad;
+	}
+	if (xy & 2) {
+		tileRect.ymin -= rad;
+		tileRect.ymax += rad;
+	}
+	BLI_rcti_isect(&tileRect, input->getRect(), &tileRect);
+
+	MemoryBuffer *tile = new MemoryBuffer(NULL, &tileRect);
+	tile->copyContentFrom(input);
+
+	switch (this->m_data->filtertype) {
+		case R_FILTER_BOX:
+			box_blur(tile, rad, xy);
+			break;
+		case R_FILTER_TENT:
+			/* tent is the convolution of two boxes of half its width */
+			box_blur(tile, rad / 2, xy);
+			box_blur(tile, rad - rad / 2, xy);
+			break;
+		case R_FILTER_GAUSS:
+		{
+			/* the weights of make_gausstab are exp(-(1.6 * i / rad)^2) */
+			const float sigma = rad / (1.6f * (float)M_SQRT2);
+			for (int c = 0; c < COM_NUMBER_OF_CHANNELS; c++) {
+				FastGaussianBlurOperation::IIR_gauss(tile, sigma, c, xy);
+			}
+			break;
+		}
+	}
+
+	return tile;
+}
+
+static void box_blur_line(float *data, int length, int stride, float *line, int rad)
+{
+	/* double sums, the sliding window adds and subtracts many values */
+	double sum[4] = {0.0, 0.0, 0.0, 0.0};
+	int i, c;
+
+	/* copy the line, the result is written in place */
+	for (i = 0; i < length; i++) {
+		copy_v4_v4(&line[i * 4], &data[i * stride]);
+	}
+
+	for (i = 0; i < rad && i < length; i++) {
+		for (c = 0; c < 4; c++) sum[c] += line[i * 4 + c];
+	}
+
+	for (i = 0; i < length; i++) {
+		const int first = i - rad;
+		const int last = i + rad;
+		const double count = min(last, length - 1) - max(first, 0) + 1;
+
+		if (last < length) {
+			for (c = 0; c < 4; c++) sum[c] += line[last * 4 + c];
+		}
+		for (c = 0; c < 4; c++) data[i * stride + c] = sum[c] / count;
+		if (first >= 0) {
+			for (c = 0; c < 4; c++) sum[c] -= line[first * 4 + c];
+		}
+	}
+}
+
+void BlurBaseOperation::box_blur(MemoryBuffer *src, int rad, unsigned int xy)
+{
+	const int width = src->getWidth();
+	const int height = src->getHeight();
+	float *buffer = src->getBuffer();
+	float *line;
+	int x, y;
+
+	if (rad < 1) return;
+
+	line = (float *)MEM_mallocN(sizeof(float) * COM_NUMBER_OF_CHANNELS * max(width, height), __func__);
+
+	if (xy & 1) {
+		for (y = 0; y < height; y++) {
+			box_blur_line(&buffer[y * width * COM_NUMBER_OF_CHANNELS], width, COM_NUMBER_OF_CHANNELS, line, rad);
+		}
+	}
+	if (xy & 2) {
+		for (x = 0; x < width; x++) {
+			box_blur_line(&buffer[x * COM_NUMBER_OF_CHANNELS], height, width * COM_NUMBER_OF_CHANNELS, line, rad);
+		}
+	}
+
+	MEM_freeN(line);
+}
@@ -38,6 +38,21 @@ protected:
 
 	void updateSize();
 
+	/**
+	 * @brief check if a blur of this radius is calculated with a recursive filter
+	 * only gaussian, box and tent filters have recursive versions
+	 */
+	bool useRecursiveFilter(int rad) const;
+
+	/**
+	 * @brief blur the area around rect in one direction with a recursive filter
+	 * the tile is padded by rad on both sides, so the cost per pixel is constant in the radius
+	 * but grows with the ratio of the radius to the chunk size, (chunksize + 2 * rad) / chunksize
+	 * @param xy 1 for horizontal, 2 for vertical
+	 * @return tile with the blurred pixels of rect, to be deleted by the caller
+	 */
+	MemoryBuffer *createRecursiveTile(MemoryBuffer *input, rcti *rect, int rad, unsigned int xy);
+
 	/**
 	 * Cached reference to the inputProgram
 	 */
@@ -65,5 +80,11 @@ public:
 	void deleteDataWhenFinished() { this->m_deleteData = true; }
 
 	void setSize(float size) { this->m_size = size; this->m_sizeavailable = true; }
+
+	/**
+	 * @brief box blur using a running sum, clipped at the borders of src like the convolution
+	 * @param xy 1 for horizontal, 2 for vertical, 3 for both
+	 */
+	static void box_blur(MemoryBuffer *src, int rad, unsigned int xy);
 };
 #endif
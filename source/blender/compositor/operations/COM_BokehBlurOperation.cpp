@@ -21,6 +21,7 @@
  */
 
 #include "COM_BokehBlurOperation.h"
+#include "COM_GlareFogGlowOperation.h"
 #include "BLI_math.h"
 #include "COM_OpenCLDevice.h"
 
@@ -43,6 +44,8 @@ BokehBlurOperation::BokehBlurOperation() : NodeOperation()
 	this->m_inputProgram = NULL;
 	this->m_inputBokehProgram = NULL;
 	this->m_inputBoundingBoxReader = NULL;
+	this->m_useConvolution = false;
+	this->m_convolved = NULL;
 }
 
 void *BokehBlurOperation::initializeTileData(rcti *rect)
@@ -52,10 +55,43 @@ void *BokehBlurOperation::initializeTileData(rcti *rect)
 		updateSize();
 	}
 	void *buffer = getInputOperation(0)->initializeTileData(NULL);
+	if (this->m_useConvolution && this->m_convolved == NULL) {
+		this->m_convolved = createConvolvedBuffer((MemoryBuffer *)buffer);
+	}
 	unlockMutex();
 	return buffer;
 }
 
+MemoryBuffer *BokehBlurOperation::createConvolvedBuffer(MemoryBuffer *input)
+{
+	const float max_dim = max(this->getWidth(), this->getHeight());
+	const int pixelSize = this->m_size * max_dim / 100.0f;
+	const float m = this->m_bokehDimension / pixelSize;
+	float bokeh[4];
+	int x, y;
+
+	/* same samples as executePixel, centered in the kernel */
+	rcti kernelRect;
+	BLI_rcti_init(&kernelRect, 0, 2 * pixelSize + 1, 0, 2 * pixelSize + 1);
+	MemoryBuffer *kernel = new MemoryBuffer(NULL, &kernelRect);
+	for (y = -pixelSize; y <= pixelSize; y++) {
+		for (x = -pixelSize; x <= pixelSize; x++) {
+			if (x == -pixelSize || y == -pixelSize) {
+				zero_v4(bokeh);
+			}
+			else {
+				this->m_inputBokehProgram->read(bokeh, this->m_bokehMidX + x * m, this->m_bokehMidY + y * m, COM_PS_NEAREST);
+			}
+			kernel->writePixel(x + pixelSize, y + pixelSize, bokeh);
+		}
+	}
+
+	/* normalized at the borders like executePixel */
+	MemoryBuffer *result = GlareFogGlowOperation::convolveNormalized(input, kernel);
+	delete kernel;
+	return result;
+}
+
 void BokehBlurOperation::initExecution()
 {
 	initMutex();
@@ -72,6 +108,11 @@ void BokehBlurOperation::initExecution()
 	this->m_bokehMidY = height / 2.0f;
 	this->m_bokehDimension = dimension / 2.0f;
 	QualityStepHelper::initExecution(COM_QH_INCREASE);
+
+	/* the size has to be known here, the area of interest depends on it */
+	const float max_dim = max(this->getWidth(), this->getHeight());
+	this->m_useConvolution = (this->m_sizeavailable &&
+	                          (int)(this->m_size * max_dim / 100.0f) > COM_BLUR_CONVOLUTION_RADIUS);
 }
 
 void BokehBlurOperation::executePixel(float output[4], int x, int y, void *data)
@@ -81,7 +122,10 @@ void BokehBlurOperation::executePixel(float output[4], int x, int y, void *data)
 	float bokeh[4];
 
 	this->m_inputBoundingBoxReader->read(tempBoundingBox, x, y, COM_PS_NEAREST);
-	if (tempBoundingBox[0] > 0.0f) {
+	if (tempBoundingBox[0] > 0.0f && this->m_convolved) {
+		this->m_convolved->read(output, x, y);
+	}
+	else if (tempBoundingBox[0] > 0.0f) {
 		float multiplier_accum[4] = {0.0f, 0.0f, 0.0f, 0.0f};
 		MemoryBuffer *inputBuffer = (MemoryBuffer *)data;
 		float *buffer = inputBuffer->getBuffer();
@@ -136,6 +180,10 @@ void BokehBlurOperation::executePixel(float output[4], int x, int y, void *data)
 
 void BokehBlurOperation::deinitExecution()
 {
+	if (this->m_convolved) {
+		delete this->m_convolved;
+		this->m_convolved = NULL;
+	}
 	deinitMutex();
 	this->m_inputProgram = NULL;
 	this->m_inputBokehProgram = NULL;
@@ -148,7 +196,13 @@ bool BokehBlurOperation::determineDependingAreaOfInterest(rcti *input, ReadBuffe
 	rcti bokehInput;
 	const float max_dim = max(this->getWidth(), this->getHeight());
 
-	if (this->m_sizeavailable) {
+	if (this->m_useConvolution) {
+		newInput.xmax = this->getWidth();
+		newInput.xmin = 0;
+		newInput.ymax = this->getHeight();
+		newInput.ymin = 0;
+	}
+	else if (this->m_sizeavailable) {
 		newInput.xmax = input->xmax + (this->m_size * max_dim / 100.0f);
 		newInput.xmin = input->xmin - (this->m_size * max_dim / 100.0f);
 		newInput.ymax = input->ymax + (this->m_size * max_dim / 100.0f);
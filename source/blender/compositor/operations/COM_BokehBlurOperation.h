@@ -37,6 +37,14 @@ private:
 	float m_bokehMidX;
 	float m_bokehMidY;
 	float m_bokehDimension;
+
+	/**
+	 * @brief large sizes are convolved once for the whole image
+	 * @see COM_BLUR_CONVOLUTION_RADIUS
+	 */
+	bool m_useConvolution;
+	MemoryBuffer *m_convolved;
+	MemoryBuffer *createConvolvedBuffer(MemoryBuffer *input);
 public:
 	BokehBlurOperation();
 
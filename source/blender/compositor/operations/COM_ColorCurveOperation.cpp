@@ -45,6 +45,7 @@ ColorCurveOperation::ColorCurveOperation() : CurveBaseOperation()
 	this->m_inputWhiteProgram = NULL;
 
 	this->setResolutionInputSocketIndex(1);
+	this->setSpans(true);
 }
 void ColorCurveOperation::initExecution()
 {
@@ -96,6 +97,41 @@ void ColorCurveOperation::executePixel(float output[4], float x, float y, PixelS
 	output[3] = image[3];
 }
 
+void ColorCurveOperation::executeSpan(float *output, int x, int y, int length)
+{
+	CurveMapping *cumap = this->m_curveMapping;
+
+	float fac[COM_SPAN_SIZE * COM_NUMBER_OF_CHANNELS];
+	float black[COM_SPAN_SIZE * COM_NUMBER_OF_CHANNELS];
+	float white[COM_SPAN_SIZE * COM_NUMBER_OF_CHANNELS];
+
+	/* image is read into output, its alpha is kept */
+	this->m_inputFacProgram->readSpan(fac, x, y, length);
+	this->m_inputImageProgram->readSpan(output, x, y, length);
+	this->m_inputBlackProgram->readSpan(black, x, y, length);
+	this->m_inputWhiteProgram->readSpan(white, x, y, length);
+
+	for (int i = 0; i < length * COM_NUMBER_OF_CHANNELS; i += COM_NUMBER_OF_CHANNELS) {
+		float *image = &output[i];
+		float bwmul[3];
+
+		if (fac[i] <= 0.0f) {
+			continue;
+		}
+
+		curvemapping_set_black_white_ex(&black[i], &white[i], bwmul);
+
+		if (fac[i] >= 1.0f) {
+			curvemapping_evaluate_premulRGBF_ex(cumap, image, image, &black[i], bwmul);
+		}
+		else {
+			float col[4];
+			curvemapping_evaluate_premulRGBF_ex(cumap, col, image, &black[i], bwmul);
+			interp_v3_v3v3(image, image, col, fac[i]);
+		}
+	}
+}
+
 void ColorCurveOperation::deinitExecution()
 {
 	CurveBaseOperation::deinitExecution();
@@ -118,6 +154,7 @@ ConstantLevelColorCurveOperation::ConstantLevelColorCurveOperation() : CurveBase
 	this->m_inputImageProgram = NULL;
 
 	this->setResolutionInputSocketIndex(1);
+	this->setSpans(true);
 }
 void ConstantLevelColorCurveOperation::initExecution()
 {
@@ -152,6 +189,28 @@ void ConstantLevelColorCurveOperation::executePixel(float output[4], float x, fl
 	output[3] = image[3];
 }
 
+void ConstantLevelColorCurveOperation::executeSpan(float *output, int x, int y, int length)
+{
+	float fac[COM_SPAN_SIZE * COM_NUMBER_OF_CHANNELS];
+
+	/* image is read into output, its alpha is kept */
+	this->m_inputFacProgram->readSpan(fac, x, y, length);
+	this->m_inputImageProgram->readSpan(output, x, y, length);
+
+	for (int i = 0; i < length * COM_NUMBER_OF_CHANNELS; i += COM_NUMBER_OF_CHANNELS) {
+		float *image = &output[i];
+
+		if (fac[i] >= 1.0f) {
+			curvemapping_evaluate_premulRGBF(this->m_curveMapping, image, image);
+		}
+		else if (fac[i] > 0.0f) {
+			float col[4];
+			curvemapping_evaluate_premulRGBF(this->m_curveMapping, col, image);
+			interp_v3_v3v3(image, image, col, fac[i]);
+		}
+	}
+}
+
 void ConstantLevelColorCurveOperation::deinitExecution()
 {
 	CurveBaseOperation::deinitExecution();
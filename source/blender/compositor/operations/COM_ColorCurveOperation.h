@@ -42,6 +42,11 @@ public:
 	 * the inner loop of this program
 	 */
 	void executePixel(float output[4], float x, float y, PixelSampler sampler);
+
+	/**
+	 * span version of executePixel
+	 */
+	void executeSpan(float *output, int x, int y, int length);
 	
 	/**
 	 * Initialize the execution
@@ -71,6 +76,11 @@ public:
 	 * the inner loop of this program
 	 */
 	void executePixel(float output[4], float x, float y, PixelSampler sampler);
+
+	/**
+	 * span version of executePixel
+	 */
+	void executeSpan(float *output, int x, int y, int length);
 	
 	/**
 	 * Initialize the execution
@@ -45,6 +45,7 @@ ConvertValueToColorOperation::ConvertValueToColorOperation() : ConvertBaseOperat
 {
 	this->addInputSocket(COM_DT_VALUE);
 	this->addOutputSocket(COM_DT_COLOR);
+	this->setSpans(true);
 }
 
 void ConvertValueToColorOperation::executePixel(float output[4], float x, float y, PixelSampler sampler)
@@ -55,6 +56,16 @@ void ConvertValueToColorOperation::executePixel(float output[4], float x, float
 	output[3] = 1.0f;
 }
 
+void ConvertValueToColorOperation::executeSpan(float *output, int x, int y, int length)
+{
+	this->m_inputOperation->readSpan(output, x, y, length);
+
+	for (int i = 0; i < length * COM_NUMBER_OF_CHANNELS; i += COM_NUMBER_OF_CHANNELS) {
+		output[i + 1] = output[i + 2] = output[i];
+		output[i + 3] = 1.0f;
+	}
+}
+
 
 /* ******** Color to Value ******** */
 
@@ -62,6 +73,7 @@ ConvertColorToValueOperation::ConvertColorToValueOperation() : ConvertBaseOperat
 {
 	this->addInputSocket(COM_DT_COLOR);
 	this->addOutputSocket(COM_DT_VALUE);
+	this->setSpans(true);
 }
 
 void ConvertColorToValueOperation::executePixel(float output[4], float x, float y, PixelSampler sampler)
@@ -71,6 +83,15 @@ void ConvertColorToValueOperation::executePixel(float output[4], float x, float
 	output[0] = (inputColor[0] + inputColor[1] + inputColor[2]) / 3.0f;
 }
 
+void ConvertColorToValueOperation::executeSpan(float *output, int x, int y, int length)
+{
+	this->m_inputOperation->readSpan(output, x, y, length);
+
+	for (int i = 0; i < length * COM_NUMBER_OF_CHANNELS; i += COM_NUMBER_OF_CHANNELS) {
+		output[i] = (output[i] + output[i + 1] + output[i + 2]) / 3.0f;
+	}
+}
+
 
 /* ******** Color to BW ******** */
 
@@ -78,6 +99,7 @@ ConvertColorToBWOperation::ConvertColorToBWOperation() : ConvertBaseOperation()
 {
 	this->addInputSocket(COM_DT_COLOR);
 	this->addOutputSocket(COM_DT_VALUE);
+	this->setSpans(true);
 }
 
 void ConvertColorToBWOperation::executePixel(float output[4], float x, float y, PixelSampler sampler)
@@ -87,6 +109,15 @@ void ConvertColorToBWOperation::executePixel(float output[4], float x, float y,
 	output[0] = rgb_to_bw(inputColor);
 }
 
+void ConvertColorToBWOperation::executeSpan(float *output, int x, int y, int length)
+{
+	this->m_inputOperation->readSpan(output, x, y, length);
+
+	for (int i = 0; i < length * COM_NUMBER_OF_CHANNELS; i += COM_NUMBER_OF_CHANNELS) {
+		output[i] = rgb_to_bw(&output[i]);
+	}
+}
+
 
 /* ******** Color to Vector ******** */
 
@@ -94,6 +125,7 @@ ConvertColorToVectorOperation::ConvertColorToVectorOperation() : ConvertBaseOper
 {
 	this->addInputSocket(COM_DT_COLOR);
 	this->addOutputSocket(COM_DT_VECTOR);
+	this->setSpans(true);
 }
 
 void ConvertColorToVectorOperation::executePixel(float output[4], float x, float y, PixelSampler sampler)
@@ -101,6 +133,11 @@ void ConvertColorToVectorOperation::executePixel(float output[4], float x, float
 	this->m_inputOperation->read(output, x, y, sampler);
 }
 
+void ConvertColorToVectorOperation::executeSpan(float *output, int x, int y, int length)
+{
+	this->m_inputOperation->readSpan(output, x, y, length);
+}
+
 
 /* ******** Value to Vector ******** */
 
@@ -108,6 +145,7 @@ ConvertValueToVectorOperation::ConvertValueToVectorOperation() : ConvertBaseOper
 {
 	this->addInputSocket(COM_DT_VALUE);
 	this->addOutputSocket(COM_DT_VECTOR);
+	this->setSpans(true);
 }
 
 void ConvertValueToVectorOperation::executePixel(float output[4], float x, float y, PixelSampler sampler)
@@ -120,6 +158,16 @@ void ConvertValueToVectorOperation::executePixel(float output[4], float x, float
 	output[3] = 0.0f;
 }
 
+void ConvertValueToVectorOperation::executeSpan(float *output, int x, int y, int length)
+{
+	this->m_inputOperation->readSpan(output, x, y, length);
+
+	for (int i = 0; i < length * COM_NUMBER_OF_CHANNELS; i += COM_NUMBER_OF_CHANNELS) {
+		output[i + 1] = output[i + 2] = output[i];
+		output[i + 3] = 0.0f;
+	}
+}
+
 
 /* ******** Vector to Color ******** */
 
@@ -127,6 +175,7 @@ ConvertVectorToColorOperation::ConvertVectorToColorOperation() : ConvertBaseOper
 {
 	this->addInputSocket(COM_DT_VECTOR);
 	this->addOutputSocket(COM_DT_COLOR);
+	this->setSpans(true);
 }
 
 void ConvertVectorToColorOperation::executePixel(float output[4], float x, float y, PixelSampler sampler)
@@ -135,6 +184,15 @@ void ConvertVectorToColorOperation::executePixel(float output[4], float x, float
 	output[3] = 1.0f;
 }
 
+void ConvertVectorToColorOperation::executeSpan(float *output, int x, int y, int length)
+{
+	this->m_inputOperation->readSpan(output, x, y, length);
+
+	for (int i = 0; i < length * COM_NUMBER_OF_CHANNELS; i += COM_NUMBER_OF_CHANNELS) {
+		output[i + 3] = 1.0f;
+	}
+}
+
 
 /* ******** Vector to Value ******** */
 
@@ -142,6 +200,7 @@ ConvertVectorToValueOperation::ConvertVectorToValueOperation() : ConvertBaseOper
 {
 	this->addInputSocket(COM_DT_VECTOR);
 	this->addOutputSocket(COM_DT_VALUE);
+	this->setSpans(true);
 }
 
 void ConvertVectorToValueOperation::executePixel(float output[4], float x, float y, PixelSampler sampler)
@@ -151,6 +210,15 @@ void ConvertVectorToValueOperation::executePixel(float output[4], float x, float
 	output[0] = (input[0] + input[1] + input[2]) / 3.0f;
 }
 
+void ConvertVectorToValueOperation::executeSpan(float *output, int x, int y, int length)
+{
+	this->m_inputOperation->readSpan(output, x, y, length);
+
+	for (int i = 0; i < length * COM_NUMBER_OF_CHANNELS; i += COM_NUMBER_OF_CHANNELS) {
+		output[i] = (output[i] + output[i + 1] + output[i + 2]) / 3.0f;
+	}
+}
+
 
 /* ******** RGB to YCC ******** */
 
@@ -43,6 +43,7 @@ public:
 	ConvertValueToColorOperation();
 	
 	void executePixel(float output[4], float x, float y, PixelSampler sampler);
+	void executeSpan(float *output, int x, int y, int length);
 };
 
 
@@ -51,6 +52,7 @@ public:
 	ConvertColorToValueOperation();
 	
 	void executePixel(float output[4], float x, float y, PixelSampler sampler);
+	void executeSpan(float *output, int x, int y, int length);
 };
 
 
@@ -59,6 +61,7 @@ public:
 	ConvertColorToBWOperation();
 	
 	void executePixel(float output[4], float x, float y, PixelSampler sampler);
+	void executeSpan(float *output, int x, int y, int length);
 };
 
 
@@ -67,6 +70,7 @@ public:
 	ConvertColorToVectorOperation();
 	
 	void executePixel(float output[4], float x, float y, PixelSampler sampler);
+	void executeSpan(float *output, int x, int y, int length);
 };
 
 
@@ -75,6 +79,7 @@ public:
 	ConvertValueToVectorOperation();
 	
 	void executePixel(float output[4], float x, float y, PixelSampler sampler);
+	void executeSpan(float *output, int x, int y, int length);
 };
 
 
@@ -83,6 +88,7 @@ public:
 	ConvertVectorToColorOperation();
 	
 	void executePixel(float output[4], float x, float y, PixelSampler sampler);
+	void executeSpan(float *output, int x, int y, int length);
 };
 
 
@@ -91,6 +97,7 @@ public:
 	ConvertVectorToValueOperation();
 	
 	void executePixel(float output[4], float x, float y, PixelSampler sampler);
+	void executeSpan(float *output, int x, int y, int length);
 };
 
 
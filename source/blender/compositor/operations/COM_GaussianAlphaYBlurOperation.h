@@ -26,6 +26,11 @@
 #include "COM_NodeOperation.h"
 #include "COM_BlurBaseOperation.h"
 
+/**
+ * Feather of the dilate/erode node, blends a gaussian blur with a maximum weighted by distance.
+ * Unlike the other blurs it has no recursive or convolution version for large radii, the weighted
+ * maximum is not a linear filter, and the max of van Herk/Gil-Werman only works with flat weights.
+ */
 class GaussianAlphaYBlurOperation : public BlurBaseOperation {
 private:
 	float *m_gausstab;
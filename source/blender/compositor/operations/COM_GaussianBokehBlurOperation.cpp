@@ -21,6 +21,7 @@
  */
 
 #include "COM_GaussianBokehBlurOperation.h"
+#include "COM_GlareFogGlowOperation.h"
 #include "BLI_math.h"
 #include "MEM_guardedalloc.h"
 extern "C" {
@@ -30,6 +31,8 @@ extern "C" {
 GaussianBokehBlurOperation::GaussianBokehBlurOperation() : BlurBaseOperation(COM_DT_COLOR)
 {
 	this->m_gausstab = NULL;
+	this->m_useConvolution = false;
+	this->m_convolved = NULL;
 }
 
 void *GaussianBokehBlurOperation::initializeTileData(rcti *rect)
@@ -39,10 +42,35 @@ void *GaussianBokehBlurOperation::initializeTileData(rcti *rect)
 		updateGauss();
 	}
 	void *buffer = getInputOperation(0)->initializeTileData(NULL);
+	if (this->m_useConvolution && this->m_convolved == NULL) {
+		this->m_convolved = createConvolvedBuffer((MemoryBuffer *)buffer);
+	}
 	unlockMutex();
 	return buffer;
 }
 
+MemoryBuffer *GaussianBokehBlurOperation::createConvolvedBuffer(MemoryBuffer *input)
+{
+	const int ddwidth = 2 * this->m_radx + 1;
+	float weight[4];
+	int x, y;
+
+	/* same weights as executePixel, in all channels */
+	rcti kernelRect;
+	BLI_rcti_init(&kernelRect, 0, ddwidth, 0, 2 * this->m_rady + 1);
+	MemoryBuffer *kernel = new MemoryBuffer(NULL, &kernelRect);
+	for (y = 0; y < 2 * this->m_rady + 1; y++) {
+		for (x = 0; x < ddwidth; x++) {
+			copy_v4_fl(weight, this->m_gausstab[y * ddwidth + x]);
+			kernel->writePixel(x, y, weight);
+		}
+	}
+
+	MemoryBuffer *result = GlareFogGlowOperation::convolveNormalized(input, kernel);
+	delete kernel;
+	return result;
+}
+
 void GaussianBokehBlurOperation::initExecution()
 {
 	BlurBaseOperation::initExecution();
@@ -52,6 +80,10 @@ void GaussianBokehBlurOperation::initExecution()
 	if (this->m_sizeavailable) {
 		updateGauss();
 	}
+
+	/* the size has to be known here, the area of interest depends on it */
+	this->m_useConvolution = (this->m_sizeavailable &&
+	                          max(this->m_radx, this->m_rady) > COM_BLUR_CONVOLUTION_RADIUS);
 }
 
 void GaussianBokehBlurOperation::updateGauss()
@@ -119,6 +151,11 @@ void GaussianBokehBlurOperation::updateGauss()
 
 void GaussianBokehBlurOperation::executePixel(float output[4], int x, int y, void *data)
 {
+	if (this->m_convolved) {
+		this->m_convolved->read(output, x, y);
+		return;
+	}
+
 	float tempColor[4];
 	tempColor[0] = 0;
 	tempColor[1] = 0;
@@ -162,6 +199,10 @@ void GaussianBokehBlurOperation::executePixel(float output[4], int x, int y, voi
 
 void GaussianBokehBlurOperation::deinitExecution()
 {
+	if (this->m_convolved) {
+		delete this->m_convolved;
+		this->m_convolved = NULL;
+	}
 	BlurBaseOperation::deinitExecution();
 	MEM_freeN(this->m_gausstab);
 	this->m_gausstab = NULL;
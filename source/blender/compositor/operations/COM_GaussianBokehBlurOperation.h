@@ -32,6 +32,14 @@ private:
 	int m_radx, m_rady;
 	void updateGauss();
 
+	/**
+	 * @brief large radii are convolved once for the whole image
+	 * @see COM_BLUR_CONVOLUTION_RADIUS
+	 */
+	bool m_useConvolution;
+	MemoryBuffer *m_convolved;
+	MemoryBuffer *createConvolvedBuffer(MemoryBuffer *input);
+
 public:
 	GaussianBokehBlurOperation();
 	void initExecution();
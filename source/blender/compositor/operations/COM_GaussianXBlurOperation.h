@@ -49,6 +49,7 @@ public:
 	void deinitExecution();
 	
 	void *initializeTileData(rcti *rect);
+	void deinitializeTileData(rcti *rect, void *data);
 	bool determineDependingAreaOfInterest(rcti *input, ReadBufferOperation *readOperation, rcti *output);
 };
 #endif
@@ -40,11 +40,22 @@ void *GaussianYBlurOperation::initializeTileData(rcti *rect)
 	if (!this->m_sizeavailable) {
 		updateGauss();
 	}
-	void *buffer = getInputOperation(0)->initializeTileData(NULL);
+	MemoryBuffer *buffer = (MemoryBuffer *)getInputOperation(0)->initializeTileData(NULL);
 	unlockMutex();
+
+	if (useRecursiveFilter(this->m_rad)) {
+		return createRecursiveTile(buffer, rect, this->m_rad, 2);
+	}
 	return buffer;
 }
 
+void GaussianYBlurOperation::deinitializeTileData(rcti *rect, void *data)
+{
+	if (useRecursiveFilter(this->m_rad)) {
+		delete (MemoryBuffer *)data;
+	}
+}
+
 void GaussianYBlurOperation::initExecution()
 {
 	BlurBaseOperation::initExecution();
@@ -74,6 +85,12 @@ void GaussianYBlurOperation::updateGauss()
 
 void GaussianYBlurOperation::executePixel(float output[4], int x, int y, void *data)
 {
+	if (useRecursiveFilter(this->m_rad)) {
+		/* large radius, already blurred by the recursive filter */
+		((MemoryBuffer *)data)->read(output, x, y);
+		return;
+	}
+
 	float color_accum[4] = {0.0f, 0.0f, 0.0f, 0.0f};
 	float multiplier_accum = 0.0f;
 	MemoryBuffer *inputBuffer = (MemoryBuffer *)data;
@@ -244,12 +244,39 @@ static void fht_convolve(fREAL *d1, fREAL *d2, unsigned int M, unsigned int N)
 }
 //------------------------------------------------------------------------------
 
-static void convolve(float *dst, MemoryBuffer *in1, MemoryBuffer *in2)
+MemoryBuffer *GlareFogGlowOperation::convolveNormalized(MemoryBuffer *input, MemoryBuffer *kernel)
+{
+	MemoryBuffer *result = new MemoryBuffer(NULL, input->getRect());
+	convolve(result->getBuffer(), input, kernel, COM_NUMBER_OF_CHANNELS);
+
+	/* weights of the samples inside the image, borders are darkened by the convolution otherwise */
+	MemoryBuffer *weights = new MemoryBuffer(NULL, input->getRect());
+	const int size = result->getWidth() * result->getHeight() * COM_NUMBER_OF_CHANNELS;
+	float *weightsBuffer = weights->getBuffer();
+	float *resultBuffer = result->getBuffer();
+	int index;
+
+	for (index = 0; index < size; index++) {
+		weightsBuffer[index] = 1.0f;
+	}
+	convolve(weightsBuffer, weights, kernel, COM_NUMBER_OF_CHANNELS);
+	for (index = 0; index < size; index++) {
+		if (weightsBuffer[index] > 0.0f) {
+			resultBuffer[index] /= weightsBuffer[index];
+		}
+	}
+
+	delete weights;
+	return result;
+}
+
+void GlareFogGlowOperation::convolve(float *dst, MemoryBuffer *in1, MemoryBuffer *in2, unsigned int channels)
 {
 	fREAL *data1, *data2, *fp;
 	unsigned int w2, h2, hw, hh, log2_w, log2_h;
 	fRGB wt, *colp;
-	int x, y, ch;
+	int x, y;
+	unsigned int ch;
 	int xbl, ybl, nxb, nyb, xbsz, ybsz;
 	int in2done = FALSE;
 	const unsigned int kernelWidth = in2->getWidth();
@@ -270,23 +297,24 @@ static void convolve(float *dst, MemoryBuffer *in1, MemoryBuffer *in2)
 	h2 = nextPow2(h2, &log2_h);
 
 	// alloc space
-	data1 = (fREAL *)MEM_callocN(3 * w2 * h2 * sizeof(fREAL), "convolve_fast FHT data1");
+	data1 = (fREAL *)MEM_callocN(channels * w2 * h2 * sizeof(fREAL), "convolve_fast FHT data1");
 	data2 = (fREAL *)MEM_callocN(w2 * h2 * sizeof(fREAL), "convolve_fast FHT data2");
 
 	// normalize convolutor
-	wt[0] = wt[1] = wt[2] = 0.f;
+	zero_v4(wt);
 	for (y = 0; y < kernelHeight; y++) {
 		colp = (fRGB *)&kernelBuffer[y * kernelWidth * COM_NUMBER_OF_CHANNELS];
 		for (x = 0; x < kernelWidth; x++)
-			add_v3_v3(wt, colp[x]);
+			for (ch = 0; ch < channels; ch++)
+				wt[ch] += colp[x][ch];
 	}
-	if (wt[0] != 0.f) wt[0] = 1.f / wt[0];
-	if (wt[1] != 0.f) wt[1] = 1.f / wt[1];
-	if (wt[2] != 0.f) wt[2] = 1.f / wt[2];
+	for (ch = 0; ch < channels; ch++)
+		if (wt[ch] != 0.f) wt[ch] = 1.f / wt[ch];
 	for (y = 0; y < kernelHeight; y++) {
 		colp = (fRGB *)&kernelBuffer[y * kernelWidth * COM_NUMBER_OF_CHANNELS];
 		for (x = 0; x < kernelWidth; x++)
-			mul_v3_v3(colp[x], wt);
+			for (ch = 0; ch < channels; ch++)
+				colp[x][ch] *= wt[ch];
 	}
 
 	// copy image data, unpacking interleaved RGBA into separate channels
@@ -305,7 +333,7 @@ static void convolve(float *dst, MemoryBuffer *in1, MemoryBuffer *in2)
 		for (xbl = 0; xbl < nxb; xbl++) {
 
 			// each channel one by one
-			for (ch = 0; ch < 3; ch++) {
+			for (ch = 0; ch < channels; ch++) {
 				fREAL *data1ch = &data1[ch * w2 * h2];
 
 				// only need to calc fht data from in2 once, can re-use for every block
@@ -401,6 +429,6 @@ void GlareFogGlowOperation::generateGlare(float *data, MemoryBuffer *inputTile,
 		}
 	}
 
-	convolve(data, inputTile, ckrn);
+	convolve(data, inputTile, ckrn, 3);
 	delete ckrn;
 }
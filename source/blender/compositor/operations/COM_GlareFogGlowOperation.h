@@ -29,6 +29,20 @@
 class GlareFogGlowOperation : public GlareBaseOperation {
 public:
 	GlareFogGlowOperation() : GlareBaseOperation() {}
+
+	/**
+	 * @brief convolve an image with a kernel using the fast hartley transform
+	 * the kernel is normalized and centered, its size does not change the cost per pixel much
+	 * @param dst result, the size of in1
+	 * @param channels number of channels to convolve, remaining channels are zero
+	 */
+	static void convolve(float *dst, MemoryBuffer *in1, MemoryBuffer *in2, unsigned int channels);
+
+	/**
+	 * @brief convolve all channels of an image, normalized at the borders by the kernel weights inside the image
+	 * @return new buffer the size of input, to be deleted by the caller
+	 */
+	static MemoryBuffer *convolveNormalized(MemoryBuffer *input, MemoryBuffer *kernel);
 protected:
 	void generateGlare(float *data, MemoryBuffer *inputTile, NodeGlare *settings);
 };
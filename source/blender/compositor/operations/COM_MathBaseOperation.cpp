@@ -72,6 +72,21 @@ void MathBaseOperation::clampIfNeeded(float *color)
 	}
 }
 
+void MathBaseOperation::clampSpanIfNeeded(float *output, int length)
+{
+	if (this->m_useClamp) {
+		for (int i = 0; i < length * COM_NUMBER_OF_CHANNELS; i += COM_NUMBER_OF_CHANNELS) {
+			CLAMP(output[i], 0.0f, 1.0f);
+		}
+	}
+}
+
+void MathBaseOperation::readInputSpans(float *value1, float *value2, int x, int y, int length)
+{
+	this->m_inputValue1Operation->readSpan(value1, x, y, length);
+	this->m_inputValue2Operation->readSpan(value2, x, y, length);
+}
+
 void MathAddOperation::executePixel(float output[4], float x, float y, PixelSampler sampler)
 {
 	float inputValue1[4];
@@ -85,6 +100,20 @@ void MathAddOperation::executePixel(float output[4], float x, float y, PixelSamp
 	clampIfNeeded(output);
 }
 
+void MathAddOperation::executeSpan(float *output, int x, int y, int length)
+{
+	float inputValue2[COM_SPAN_SIZE * COM_NUMBER_OF_CHANNELS];
+
+	/* first value is read into output */
+	readInputSpans(output, inputValue2, x, y, length);
+
+	for (int i = 0; i < length * COM_NUMBER_OF_CHANNELS; i += COM_NUMBER_OF_CHANNELS) {
+		output[i] += inputValue2[i];
+	}
+
+	clampSpanIfNeeded(output, length);
+}
+
 void MathSubtractOperation::executePixel(float output[4], float x, float y, PixelSampler sampler)
 {
 	float inputValue1[4];
@@ -98,6 +127,20 @@ void MathSubtractOperation::executePixel(float output[4], float x, float y, Pixe
 	clampIfNeeded(output);
 }
 
+void MathSubtractOperation::executeSpan(float *output, int x, int y, int length)
+{
+	float inputValue2[COM_SPAN_SIZE * COM_NUMBER_OF_CHANNELS];
+
+	/* first value is read into output */
+	readInputSpans(output, inputValue2, x, y, length);
+
+	for (int i = 0; i < length * COM_NUMBER_OF_CHANNELS; i += COM_NUMBER_OF_CHANNELS) {
+		output[i] -= inputValue2[i];
+	}
+
+	clampSpanIfNeeded(output, length);
+}
+
 void MathMultiplyOperation::executePixel(float output[4], float x, float y, PixelSampler sampler)
 {
 	float inputValue1[4];
@@ -111,6 +154,20 @@ void MathMultiplyOperation::executePixel(float output[4], float x, float y, Pixe
 	clampIfNeeded(output);
 }
 
+void MathMultiplyOperation::executeSpan(float *output, int x, int y, int length)
+{
+	float inputValue2[COM_SPAN_SIZE * COM_NUMBER_OF_CHANNELS];
+
+	/* first value is read into output */
+	readInputSpans(output, inputValue2, x, y, length);
+
+	for (int i = 0; i < length * COM_NUMBER_OF_CHANNELS; i += COM_NUMBER_OF_CHANNELS) {
+		output[i] *= inputValue2[i];
+	}
+
+	clampSpanIfNeeded(output, length);
+}
+
 void MathDivideOperation::executePixel(float output[4], float x, float y, PixelSampler sampler)
 {
 	float inputValue1[4];
@@ -127,6 +184,21 @@ void MathDivideOperation::executePixel(float output[4], float x, float y, PixelS
 	clampIfNeeded(output);
 }
 
+void MathDivideOperation::executeSpan(float *output, int x, int y, int length)
+{
+	float inputValue2[COM_SPAN_SIZE * COM_NUMBER_OF_CHANNELS];
+
+	/* first value is read into output */
+	readInputSpans(output, inputValue2, x, y, length);
+
+	for (int i = 0; i < length * COM_NUMBER_OF_CHANNELS; i += COM_NUMBER_OF_CHANNELS) {
+		/* We don't want to divide by zero. */
+		output[i] = (inputValue2[i] == 0.0f) ? 0.0f : output[i] / inputValue2[i];
+	}
+
+	clampSpanIfNeeded(output, length);
+}
+
 void MathSineOperation::executePixel(float output[4], float x, float y, PixelSampler sampler)
 {
 	float inputValue1[4];
@@ -265,6 +337,20 @@ void MathMinimumOperation::executePixel(float output[4], float x, float y, Pixel
 	clampIfNeeded(output);
 }
 
+void MathMinimumOperation::executeSpan(float *output, int x, int y, int length)
+{
+	float inputValue2[COM_SPAN_SIZE * COM_NUMBER_OF_CHANNELS];
+
+	/* first value is read into output */
+	readInputSpans(output, inputValue2, x, y, length);
+
+	for (int i = 0; i < length * COM_NUMBER_OF_CHANNELS; i += COM_NUMBER_OF_CHANNELS) {
+		output[i] = min_ff(output[i], inputValue2[i]);
+	}
+
+	clampSpanIfNeeded(output, length);
+}
+
 void MathMaximumOperation::executePixel(float output[4], float x, float y, PixelSampler sampler)
 {
 	float inputValue1[4];
@@ -278,6 +364,20 @@ void MathMaximumOperation::executePixel(float output[4], float x, float y, Pixel
 	clampIfNeeded(output);
 }
 
+void MathMaximumOperation::executeSpan(float *output, int x, int y, int length)
+{
+	float inputValue2[COM_SPAN_SIZE * COM_NUMBER_OF_CHANNELS];
+
+	/* first value is read into output */
+	readInputSpans(output, inputValue2, x, y, length);
+
+	for (int i = 0; i < length * COM_NUMBER_OF_CHANNELS; i += COM_NUMBER_OF_CHANNELS) {
+		output[i] = max_ff(output[i], inputValue2[i]);
+	}
+
+	clampSpanIfNeeded(output, length);
+}
+
 void MathRoundOperation::executePixel(float output[4], float x, float y, PixelSampler sampler)
 {
 	float inputValue1[4];
@@ -46,6 +46,12 @@ protected:
 	MathBaseOperation();
 
 	void clampIfNeeded(float color[4]);
+	void clampSpanIfNeeded(float *output, int length);
+
+	/**
+	 * read spans of both inputs, for operations implementing executeSpan
+	 */
+	void readInputSpans(float *value1, float *value2, int x, int y, int length);
 public:
 	/**
 	 * the inner loop of this program
@@ -72,23 +78,27 @@ public:
 
 class MathAddOperation : public MathBaseOperation {
 public:
-	MathAddOperation() : MathBaseOperation() {}
+	MathAddOperation() : MathBaseOperation() { this->setSpans(true); }
 	void executePixel(float output[4], float x, float y, PixelSampler sampler);
+	void executeSpan(float *output, int x, int y, int length);
 };
 class MathSubtractOperation : public MathBaseOperation {
 public:
-	MathSubtractOperation() : MathBaseOperation() {}
+	MathSubtractOperation() : MathBaseOperation() { this->setSpans(true); }
 	void executePixel(float output[4], float x, float y, PixelSampler sampler);
+	void executeSpan(float *output, int x, int y, int length);
 };
 class MathMultiplyOperation : public MathBaseOperation {
 public:
-	MathMultiplyOperation() : MathBaseOperation() {}
+	MathMultiplyOperation() : MathBaseOperation() { this->setSpans(true); }
 	void executePixel(float output[4], float x, float y, PixelSampler sampler);
+	void executeSpan(float *output, int x, int y, int length);
 };
 class MathDivideOperation : public MathBaseOperation {
 public:
-	MathDivideOperation() : MathBaseOperation() {}
+	MathDivideOperation() : MathBaseOperation() { this->setSpans(true); }
 	void executePixel(float output[4], float x, float y, PixelSampler sampler);
+	void executeSpan(float *output, int x, int y, int length);
 };
 class MathSineOperation : public MathBaseOperation {
 public:
@@ -133,13 +143,15 @@ public:
 };
 class MathMinimumOperation : public MathBaseOperation {
 public:
-	MathMinimumOperation() : MathBaseOperation() {}
+	MathMinimumOperation() : MathBaseOperation() { this->setSpans(true); }
 	void executePixel(float output[4], float x, float y, PixelSampler sampler);
+	void executeSpan(float *output, int x, int y, int length);
 };
 class MathMaximumOperation : public MathBaseOperation {
 public:
-	MathMaximumOperation() : MathBaseOperation() {}
+	MathMaximumOperation() : MathBaseOperation() { this->setSpans(true); }
 	void executePixel(float output[4], float x, float y, PixelSampler sampler);
+	void executeSpan(float *output, int x, int y, int length);
 };
 class MathRoundOperation : public MathBaseOperation {
 public:
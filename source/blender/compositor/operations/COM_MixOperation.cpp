@@ -69,6 +69,19 @@ void MixBaseOperation::executePixel(float output[4], float x, float y, PixelSamp
 	output[3] = inputColor1[3];
 }
 
+void MixBaseOperation::readInputSpans(float *value, float *color1, float *color2, int x, int y, int length)
+{
+	this->m_inputValueOperation->readSpan(value, x, y, length);
+	this->m_inputColor1Operation->readSpan(color1, x, y, length);
+	this->m_inputColor2Operation->readSpan(color2, x, y, length);
+
+	if (this->useValueAlphaMultiply()) {
+		for (int i = 0; i < length * COM_NUMBER_OF_CHANNELS; i += COM_NUMBER_OF_CHANNELS) {
+			value[i] *= color2[i + 3];
+		}
+	}
+}
+
 void MixBaseOperation::determineResolution(unsigned int resolution[2], unsigned int preferredResolution[2])
 {
 	InputSocket *socket;
@@ -104,7 +117,7 @@ void MixBaseOperation::deinitExecution()
 
 MixAddOperation::MixAddOperation() : MixBaseOperation()
 {
-	/* pass */
+	this->setSpans(true);
 }
 
 void MixAddOperation::executePixel(float output[4], float x, float y, PixelSampler sampler)
@@ -129,11 +142,29 @@ void MixAddOperation::executePixel(float output[4], float x, float y, PixelSampl
 	clampIfNeeded(output);
 }
 
+void MixAddOperation::executeSpan(float *output, int x, int y, int length)
+{
+	float inputValue[COM_SPAN_SIZE * COM_NUMBER_OF_CHANNELS];
+	float inputColor2[COM_SPAN_SIZE * COM_NUMBER_OF_CHANNELS];
+
+	/* first color is read into output, its alpha is kept */
+	readInputSpans(inputValue, output, inputColor2, x, y, length);
+
+	for (int i = 0; i < length * COM_NUMBER_OF_CHANNELS; i += COM_NUMBER_OF_CHANNELS) {
+		const float value = inputValue[i];
+		output[i + 0] += value * inputColor2[i + 0];
+		output[i + 1] += value * inputColor2[i + 1];
+		output[i + 2] += value * inputColor2[i + 2];
+	}
+
+	clampSpanIfNeeded(output, length);
+}
+
 /* ******** Mix Blend Operation ******** */
 
 MixBlendOperation::MixBlendOperation() : MixBaseOperation()
 {
-	/* pass */
+	this->setSpans(true);
 }
 
 void MixBlendOperation::executePixel(float output[4], float x, float y, PixelSampler sampler)
@@ -160,6 +191,25 @@ void MixBlendOperation::executePixel(float output[4], float x, float y, PixelSam
 	clampIfNeeded(output);
 }
 
+void MixBlendOperation::executeSpan(float *output, int x, int y, int length)
+{
+	float inputValue[COM_SPAN_SIZE * COM_NUMBER_OF_CHANNELS];
+	float inputColor2[COM_SPAN_SIZE * COM_NUMBER_OF_CHANNELS];
+
+	/* first color is read into output, its alpha is kept */
+	readInputSpans(inputValue, output, inputColor2, x, y, length);
+
+	for (int i = 0; i < length * COM_NUMBER_OF_CHANNELS; i += COM_NUMBER_OF_CHANNELS) {
+		const float value = inputValue[i];
+		const float valuem = 1.0f - value;
+		output[i + 0] = valuem * output[i + 0] + value * inputColor2[i + 0];
+		output[i + 1] = valuem * output[i + 1] + value * inputColor2[i + 1];
+		output[i + 2] = valuem * output[i + 2] + value * inputColor2[i + 2];
+	}
+
+	clampSpanIfNeeded(output, length);
+}
+
 /* ******** Mix Burn Operation ******** */
 
 MixBurnOperation::MixBurnOperation() : MixBaseOperation()
@@ -274,7 +324,7 @@ void MixColorOperation::executePixel(float output[4], float x, float y, PixelSam
 
 MixDarkenOperation::MixDarkenOperation() : MixBaseOperation()
 {
-	/* pass */
+	this->setSpans(true);
 }
 
 void MixDarkenOperation::executePixel(float output[4], float x, float y, PixelSampler sampler)
@@ -308,11 +358,30 @@ void MixDarkenOperation::executePixel(float output[4], float x, float y, PixelSa
 	clampIfNeeded(output);
 }
 
+void MixDarkenOperation::executeSpan(float *output, int x, int y, int length)
+{
+	float inputValue[COM_SPAN_SIZE * COM_NUMBER_OF_CHANNELS];
+	float inputColor2[COM_SPAN_SIZE * COM_NUMBER_OF_CHANNELS];
+
+	/* first color is read into output, its alpha is kept */
+	readInputSpans(inputValue, output, inputColor2, x, y, length);
+
+	for (int i = 0; i < length * COM_NUMBER_OF_CHANNELS; i += COM_NUMBER_OF_CHANNELS) {
+		const float value = inputValue[i];
+		const float valuem = 1.0f - value;
+		output[i + 0] = min_ff(output[i + 0], inputColor2[i + 0] + (1.0f - inputColor2[i + 0]) * valuem);
+		output[i + 1] = min_ff(output[i + 1], inputColor2[i + 1] + (1.0f - inputColor2[i + 1]) * valuem);
+		output[i + 2] = min_ff(output[i + 2], inputColor2[i + 2] + (1.0f - inputColor2[i + 2]) * valuem);
+	}
+
+	clampSpanIfNeeded(output, length);
+}
+
 /* ******** Mix Difference Operation ******** */
 
 MixDifferenceOperation::MixDifferenceOperation() : MixBaseOperation()
 {
-	/* pass */
+	this->setSpans(true);
 }
 
 void MixDifferenceOperation::executePixel(float output[4], float x, float y, PixelSampler sampler)
@@ -338,6 +407,25 @@ void MixDifferenceOperation::executePixel(float output[4], float x, float y, Pix
 	clampIfNeeded(output);
 }
 
+void MixDifferenceOperation::executeSpan(float *output, int x, int y, int length)
+{
+	float inputValue[COM_SPAN_SIZE * COM_NUMBER_OF_CHANNELS];
+	float inputColor2[COM_SPAN_SIZE * COM_NUMBER_OF_CHANNELS];
+
+	/* first color is read into output, its alpha is kept */
+	readInputSpans(inputValue, output, inputColor2, x, y, length);
+
+	for (int i = 0; i < length * COM_NUMBER_OF_CHANNELS; i += COM_NUMBER_OF_CHANNELS) {
+		const float value = inputValue[i];
+		const float valuem = 1.0f - value;
+		output[i + 0] = valuem * output[i + 0] + value * fabsf(output[i + 0] - inputColor2[i + 0]);
+		output[i + 1] = valuem * output[i + 1] + value * fabsf(output[i + 1] - inputColor2[i + 1]);
+		output[i + 2] = valuem * output[i + 2] + value * fabsf(output[i + 2] - inputColor2[i + 2]);
+	}
+
+	clampSpanIfNeeded(output, length);
+}
+
 /* ******** Mix Difference Operation ******** */
 
 MixDivideOperation::MixDivideOperation() : MixBaseOperation()
@@ -530,7 +618,7 @@ void MixHueOperation::executePixel(float output[4], float x, float y, PixelSampl
 
 MixLightenOperation::MixLightenOperation() : MixBaseOperation()
 {
-	/* pass */
+	this->setSpans(true);
 }
 
 void MixLightenOperation::executePixel(float output[4], float x, float y, PixelSampler sampler)
@@ -562,6 +650,24 @@ void MixLightenOperation::executePixel(float output[4], float x, float y, PixelS
 	clampIfNeeded(output);
 }
 
+void MixLightenOperation::executeSpan(float *output, int x, int y, int length)
+{
+	float inputValue[COM_SPAN_SIZE * COM_NUMBER_OF_CHANNELS];
+	float inputColor2[COM_SPAN_SIZE * COM_NUMBER_OF_CHANNELS];
+
+	/* first color is read into output, its alpha is kept */
+	readInputSpans(inputValue, output, inputColor2, x, y, length);
+
+	for (int i = 0; i < length * COM_NUMBER_OF_CHANNELS; i += COM_NUMBER_OF_CHANNELS) {
+		const float value = inputValue[i];
+		output[i + 0] = max_ff(output[i + 0], value * inputColor2[i + 0]);
+		output[i + 1] = max_ff(output[i + 1], value * inputColor2[i + 1]);
+		output[i + 2] = max_ff(output[i + 2], value * inputColor2[i + 2]);
+	}
+
+	clampSpanIfNeeded(output, length);
+}
+
 /* ******** Mix Linear Light Operation ******** */
 
 MixLinearLightOperation::MixLinearLightOperation() : MixBaseOperation()
@@ -605,7 +711,7 @@ void MixLinearLightOperation::executePixel(float output[4], float x, float y, Pi
 
 MixMultiplyOperation::MixMultiplyOperation() : MixBaseOperation()
 {
-	/* pass */
+	this->setSpans(true);
 }
 
 void MixMultiplyOperation::executePixel(float output[4], float x, float y, PixelSampler sampler)
@@ -631,6 +737,25 @@ void MixMultiplyOperation::executePixel(float output[4], float x, float y, Pixel
 	clampIfNeeded(output);
 }
 
+void MixMultiplyOperation::executeSpan(float *output, int x, int y, int length)
+{
+	float inputValue[COM_SPAN_SIZE * COM_NUMBER_OF_CHANNELS];
+	float inputColor2[COM_SPAN_SIZE * COM_NUMBER_OF_CHANNELS];
+
+	/* first color is read into output, its alpha is kept */
+	readInputSpans(inputValue, output, inputColor2, x, y, length);
+
+	for (int i = 0; i < length * COM_NUMBER_OF_CHANNELS; i += COM_NUMBER_OF_CHANNELS) {
+		const float value = inputValue[i];
+		const float valuem = 1.0f - value;
+		output[i + 0] *= valuem + value * inputColor2[i + 0];
+		output[i + 1] *= valuem + value * inputColor2[i + 1];
+		output[i + 2] *= valuem + value * inputColor2[i + 2];
+	}
+
+	clampSpanIfNeeded(output, length);
+}
+
 /* ******** Mix Ovelray Operation ******** */
 
 MixOverlayOperation::MixOverlayOperation() : MixBaseOperation()
@@ -721,7 +846,7 @@ void MixSaturationOperation::executePixel(float output[4], float x, float y, Pix
 
 MixScreenOperation::MixScreenOperation() : MixBaseOperation()
 {
-	/* pass */
+	this->setSpans(true);
 }
 
 void MixScreenOperation::executePixel(float output[4], float x, float y, PixelSampler sampler)
@@ -748,6 +873,25 @@ void MixScreenOperation::executePixel(float output[4], float x, float y, PixelSa
 	clampIfNeeded(output);
 }
 
+void MixScreenOperation::executeSpan(float *output, int x, int y, int length)
+{
+	float inputValue[COM_SPAN_SIZE * COM_NUMBER_OF_CHANNELS];
+	float inputColor2[COM_SPAN_SIZE * COM_NUMBER_OF_CHANNELS];
+
+	/* first color is read into output, its alpha is kept */
+	readInputSpans(inputValue, output, inputColor2, x, y, length);
+
+	for (int i = 0; i < length * COM_NUMBER_OF_CHANNELS; i += COM_NUMBER_OF_CHANNELS) {
+		const float value = inputValue[i];
+		const float valuem = 1.0f - value;
+		output[i + 0] = 1.0f - (valuem + value * (1.0f - inputColor2[i + 0])) * (1.0f - output[i + 0]);
+		output[i + 1] = 1.0f - (valuem + value * (1.0f - inputColor2[i + 1])) * (1.0f - output[i + 1]);
+		output[i + 2] = 1.0f - (valuem + value * (1.0f - inputColor2[i + 2])) * (1.0f - output[i + 2]);
+	}
+
+	clampSpanIfNeeded(output, length);
+}
+
 /* ******** Mix Soft Light Operation ******** */
 
 MixSoftLightOperation::MixSoftLightOperation() : MixBaseOperation()
@@ -789,7 +933,7 @@ void MixSoftLightOperation::executePixel(float output[4], float x, float y, Pixe
 
 MixSubtractOperation::MixSubtractOperation() : MixBaseOperation()
 {
-	/* pass */
+	this->setSpans(true);
 }
 
 void MixSubtractOperation::executePixel(float output[4], float x, float y, PixelSampler sampler)
@@ -814,6 +958,24 @@ void MixSubtractOperation::executePixel(float output[4], float x, float y, Pixel
 	clampIfNeeded(output);
 }
 
+void MixSubtractOperation::executeSpan(float *output, int x, int y, int length)
+{
+	float inputValue[COM_SPAN_SIZE * COM_NUMBER_OF_CHANNELS];
+	float inputColor2[COM_SPAN_SIZE * COM_NUMBER_OF_CHANNELS];
+
+	/* first color is read into output, its alpha is kept */
+	readInputSpans(inputValue, output, inputColor2, x, y, length);
+
+	for (int i = 0; i < length * COM_NUMBER_OF_CHANNELS; i += COM_NUMBER_OF_CHANNELS) {
+		const float value = inputValue[i];
+		output[i + 0] -= value * inputColor2[i + 0];
+		output[i + 1] -= value * inputColor2[i + 1];
+		output[i + 2] -= value * inputColor2[i + 2];
+	}
+
+	clampSpanIfNeeded(output, length);
+}
+
 /* ******** Mix Value Operation ******** */
 
 MixValueOperation::MixValueOperation() : MixBaseOperation()
@@ -50,6 +50,20 @@ protected:
 			CLAMP(color[3], 0.0f, 1.0f);
 		}
 	}
+
+	inline void clampSpanIfNeeded(float *output, int length)
+	{
+		if (m_useClamp) {
+			for (int i = 0; i < length * COM_NUMBER_OF_CHANNELS; i++) {
+				CLAMP(output[i], 0.0f, 1.0f);
+			}
+		}
+	}
+
+	/**
+	 * read spans of all inputs, with the value multiplied by the alpha of the second color if needed
+	 */
+	void readInputSpans(float *value, float *color1, float *color2, int x, int y, int length);
 	
 public:
 	/**
@@ -84,12 +98,14 @@ class MixAddOperation : public MixBaseOperation {
 public:
 	MixAddOperation();
 	void executePixel(float output[4], float x, float y, PixelSampler sampler);
+	void executeSpan(float *output, int x, int y, int length);
 };
 
 class MixBlendOperation : public MixBaseOperation {
 public:
 	MixBlendOperation();
 	void executePixel(float output[4], float x, float y, PixelSampler sampler);
+	void executeSpan(float *output, int x, int y, int length);
 };
 
 class MixBurnOperation : public MixBaseOperation {
@@ -108,12 +124,14 @@ class MixDarkenOperation : public MixBaseOperation {
 public:
 	MixDarkenOperation();
 	void executePixel(float output[4], float x, float y, PixelSampler sampler);
+	void executeSpan(float *output, int x, int y, int length);
 };
 
 class MixDifferenceOperation : public MixBaseOperation {
 public:
 	MixDifferenceOperation();
 	void executePixel(float output[4], float x, float y, PixelSampler sampler);
+	void executeSpan(float *output, int x, int y, int length);
 };
 
 class MixDivideOperation : public MixBaseOperation {
@@ -144,6 +162,7 @@ class MixLightenOperation : public MixBaseOperation {
 public:
 	MixLightenOperation();
 	void executePixel(float output[4], float x, float y, PixelSampler sampler);
+	void executeSpan(float *output, int x, int y, int length);
 };
 
 class MixLinearLightOperation : public MixBaseOperation {
@@ -156,6 +175,7 @@ class MixMultiplyOperation : public MixBaseOperation {
 public:
 	MixMultiplyOperation();
 	void executePixel(float output[4], float x, float y, PixelSampler sampler);
+	void executeSpan(float *output, int x, int y, int length);
 };
 
 class MixOverlayOperation : public MixBaseOperation {
@@ -174,6 +194,7 @@ class MixScreenOperation : public MixBaseOperation {
 public:
 	MixScreenOperation();
 	void executePixel(float output[4], float x, float y, PixelSampler sampler);
+	void executeSpan(float *output, int x, int y, int length);
 };
 
 class MixSoftLightOperation : public MixBaseOperation {
@@ -186,6 +207,7 @@ class MixSubtractOperation : public MixBaseOperation {
 public:
 	MixSubtractOperation();
 	void executePixel(float output[4], float x, float y, PixelSampler sampler);
+	void executeSpan(float *output, int x, int y, int length);
 };
 
 class MixValueOperation : public MixBaseOperation {
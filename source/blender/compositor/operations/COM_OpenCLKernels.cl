@@ -104,6 +104,13 @@ __kernel void defocusKernel(__read_only image2d_t inputImage, __read_only image2
 		color_accum = read_imagef(inputImage, SAMPLER_NEAREST, inputCoordinate);
 		readColor = color_accum;
 
+		/* samples are only used within the size of this pixel */
+		const int radius = (int)size_center + 1;
+		minx = max(minx, realCoordinate.s0 - radius);
+		miny = max(miny, realCoordinate.s1 - radius);
+		maxx = min(maxx, realCoordinate.s0 + radius);
+		maxy = min(maxy, realCoordinate.s1 + radius);
+
 		if (size_center > threshold) {
 			for (int ny = miny; ny < maxy; ny += step) {
 				inputCoordinate.s1 = ny - offsetInput.s1;
@@ -30,6 +30,7 @@ ReadBufferOperation::ReadBufferOperation() : NodeOperation()
 	this->m_single_value = false;
 	this->m_offset = 0;
 	this->m_buffer = NULL;
+	this->setSpans(true);
 }
 
 void *ReadBufferOperation::initializeTileData(rcti *rect)
@@ -66,6 +67,20 @@ void ReadBufferOperation::executePixel(float output[4], float x, float y, PixelS
 	}
 }
 
+void ReadBufferOperation::executeSpan(float *output, int x, int y, int length)
+{
+	if (m_single_value) {
+		/* write buffer has a single value stored at (0,0) */
+		m_buffer->read(output, 0, 0);
+		for (int i = 1; i < length; i++) {
+			copy_v4_v4(output + i * COM_NUMBER_OF_CHANNELS, output);
+		}
+	}
+	else {
+		m_buffer->readSpan(output, x, y, length);
+	}
+}
+
 void ReadBufferOperation::executePixelExtend(float output[4], float x, float y, PixelSampler sampler,
                                              MemoryBufferExtend extend_x, MemoryBufferExtend extend_y)
 {
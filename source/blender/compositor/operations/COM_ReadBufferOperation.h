@@ -41,6 +41,7 @@ public:
 	
 	void *initializeTileData(rcti *rect);
 	void executePixel(float output[4], float x, float y, PixelSampler sampler);
+	void executeSpan(float *output, int x, int y, int length);
 	void executePixelExtend(float output[4], float x, float y, PixelSampler sampler,
 	                        MemoryBufferExtend extend_x, MemoryBufferExtend extend_y);
 	void executePixel(float output[4], float x, float y, float dx, float dy, PixelSampler sampler);
@@ -56,6 +56,7 @@ public:
 	 * the inner loop of this program
 	 */
 	void executePixel(float output[4], float x, float y, PixelSampler sampler);
+	void executeSpan(float *output, int x, int y, int length);
 
 	void determineResolution(unsigned int resolution[2], unsigned int preferredResolution[2]);
 	bool isSetOperation() const { return true; }
@@ -136,6 +136,14 @@ void VariableSizeBokehBlurOperation::executePixel(float output[4], int x, int y,
 		copy_v4_v4(color_accum, readColor);
 		copy_v4_fl(multiplier_accum, 1.0f);
 		float size_center = tempSize[0] * scalar;
+
+		/* samples are only used within the size of this pixel, see the size test below,
+		 * for a large maximum blur most pixels only need a small part of the area */
+		const int radius = (int)size_center + 1;
+		minx = max(minx, x - radius);
+		miny = max(miny, y - radius);
+		maxx = min(maxx, x + radius);
+		maxy = min(maxy, y + radius);
 		
 		const int addXStep = QualityStepHelper::getStep() * COM_NUMBER_OF_CHANNELS;
 		
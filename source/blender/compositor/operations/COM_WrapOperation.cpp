@@ -26,6 +26,7 @@
 WrapOperation::WrapOperation() : ReadBufferOperation()
 {
 	this->m_wrappingType = CMP_NODE_WRAP_NONE;
+	this->setSpans(false);
 }
 
 inline float WrapOperation::getWrappedOriginalXPos(float x)
@@ -32,6 +32,8 @@ public:
 	WrapOperation();
 	bool determineDependingAreaOfInterest(rcti *input, ReadBufferOperation *readOperation, rcti *output);
 	void executePixel(float output[4], float x, float y, PixelSampler sampler);
+	/* wrapped reads are not contiguous, fall back to reading pixel by pixel */
+	void executeSpan(float *output, int x, int y, int length) { NodeOperation::executeSpan(output, x, y, length); }
 
 	void setWrapping(int wrapping_type);
 	float getWrappedOriginalXPos(float x);
@@ -48,7 +48,10 @@ void WriteBufferOperation::executePixel(float output[4], float x, float y, Pixel
 void WriteBufferOperation::initExecution()
 {
 	this->m_input = this->getInputOperation(0);
-	this->m_memoryProxy->allocate(this->m_width, this->m_height);
+	/* buffer can already be set from the BufferCache */
+	if (this->m_memoryProxy->getBuffer() == NULL) {
+		this->m_memoryProxy->allocate(this->m_width, this->m_height);
+	}
 }
 
 void WriteBufferOperation::deinitExecution()
@@ -60,6 +63,10 @@ void WriteBufferOperation::deinitExecution()
 void WriteBufferOperation::executeRegion(rcti *rect, unsigned int tileNumber)
 {
 	MemoryBuffer *memoryBuffer = this->m_memoryProxy->getBuffer();
+	if (memoryBuffer->isCompact()) {
+		executeCompactRegion(memoryBuffer, rect);
+		return;
+	}
 	float *buffer = memoryBuffer->getBuffer();
 	if (this->m_input->isComplex()) {
 		void *data = this->m_input->initializeTileData(rect);
@@ -95,11 +102,22 @@ void WriteBufferOperation::executeRegion(rcti *rect, unsigned int tileNumber)
 		int x;
 		int y;
 		bool breaked = false;
+		const bool spans = this->m_input->isSpans();
 		for (y = y1; y < y2 && (!breaked); y++) {
 			int offset4 = (y * memoryBuffer->getWidth() + x1) * COM_NUMBER_OF_CHANNELS;
-			for (x = x1; x < x2; x++) {
-				this->m_input->read(&(buffer[offset4]), x, y, COM_PS_NEAREST);
-				offset4 += COM_NUMBER_OF_CHANNELS;
+			if (spans) {
+				/* calculate the row in spans, the input reads its own inputs span-wise too */
+				for (x = x1; x < x2; x += COM_SPAN_SIZE) {
+					int length = min(x2 - x, COM_SPAN_SIZE);
+					this->m_input->readSpan(&(buffer[offset4]), x, y, length);
+					offset4 += length * COM_NUMBER_OF_CHANNELS;
+				}
+			}
+			else {
+				for (x = x1; x < x2; x++) {
+					this->m_input->read(&(buffer[offset4]), x, y, COM_PS_NEAREST);
+					offset4 += COM_NUMBER_OF_CHANNELS;
+				}
 			}
 			if (isBreaked()) {
 				breaked = true;
@@ -109,6 +127,48 @@ void WriteBufferOperation::executeRegion(rcti *rect, unsigned int tileNumber)
 	memoryBuffer->setCreatedState();
 }
 
+void WriteBufferOperation::executeCompactRegion(MemoryBuffer *memoryBuffer, rcti *rect)
+{
+	/* calculate spans of RGBA pixels and let the buffer pack them */
+	float span[COM_SPAN_SIZE * COM_NUMBER_OF_CHANNELS];
+	const bool complex = this->m_input->isComplex();
+	const bool spans = this->m_input->isSpans();
+	void *data = NULL;
+	int x, y, i;
+
+	if (complex) {
+		data = this->m_input->initializeTileData(rect);
+	}
+
+	for (y = rect->ymin; y < rect->ymax; y++) {
+		for (x = rect->xmin; x < rect->xmax; x += COM_SPAN_SIZE) {
+			int length = min(rect->xmax - x, COM_SPAN_SIZE);
+			if (complex) {
+				for (i = 0; i < length; i++) {
+					this->m_input->read(&span[i * COM_NUMBER_OF_CHANNELS], x + i, y, data);
+				}
+			}
+			else if (spans) {
+				this->m_input->readSpan(span, x, y, length);
+			}
+			else {
+				for (i = 0; i < length; i++) {
+					this->m_input->read(&span[i * COM_NUMBER_OF_CHANNELS], x + i, y, COM_PS_NEAREST);
+				}
+			}
+			memoryBuffer->writeSpan(span, x, y, length);
+		}
+		if (isBreaked()) {
+			break;
+		}
+	}
+
+	if (data) {
+		this->m_input->deinitializeTileData(rect, data);
+	}
+	memoryBuffer->setCreatedState();
+}
+
 void WriteBufferOperation::executeOpenCLRegion(OpenCLDevice *device, rcti *rect, unsigned int chunkNumber,
                                                MemoryBuffer **inputMemoryBuffers, MemoryBuffer *outputBuffer)
 {
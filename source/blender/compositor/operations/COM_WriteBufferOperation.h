@@ -44,6 +44,7 @@ public:
 	bool isSingleValue() const { return m_single_value; }
 	
 	void executeRegion(rcti *rect, unsigned int tileNumber);
+	void executeCompactRegion(MemoryBuffer *memoryBuffer, rcti *rect);
 	void initExecution();
 	void deinitExecution();
 	void executeOpenCLRegion(OpenCLDevice *device, rcti *rect, unsigned int chunkNumber, MemoryBuffer **memoryBuffers, MemoryBuffer *outputBuffer);
@@ -543,39 +543,27 @@ typedef struct ThreadedMaskRasterizeState {
 	int width, height;
 } ThreadedMaskRasterizeState;
 
-typedef struct ThreadedMaskRasterizeData {
-	int start_scanline;
-	int num_scanlines;
-} ThreadedMaskRasterizeData;
-
-static void mask_rasterize_func(TaskPool *pool, void *taskdata, int UNUSED(threadid))
+static void mask_rasterize_func(void *userdata, int y)
 {
-	ThreadedMaskRasterizeState *state = (ThreadedMaskRasterizeState *) BLI_task_pool_userdata(pool);
-	ThreadedMaskRasterizeData *data = (ThreadedMaskRasterizeData *) taskdata;
-	int scanline;
+	ThreadedMaskRasterizeState *state = (ThreadedMaskRasterizeState *) userdata;
+	int x;
 
-	for (scanline = 0; scanline < data->num_scanlines; scanline++) {
-		int x, y = data->start_scanline + scanline;
-		for (x = 0; x < state->width; x++) {
-			int index = y * state->width + x;
-			float xy[2];
+	for (x = 0; x < state->width; x++) {
+		int index = y * state->width + x;
+		float xy[2];
 
-			xy[0] = (float) x / state->width;
-			xy[1] = (float) y / state->height;
+		xy[0] = (float) x / state->width;
+		xy[1] = (float) y / state->height;
 
-			state->buffer[index] = BKE_maskrasterize_handle_sample(state->handle, xy);
-		}
+		state->buffer[index] = BKE_maskrasterize_handle_sample(state->handle, xy);
 	}
 }
 
 static float *threaded_mask_rasterize(Mask *mask, const int width, const int height)
 {
-	TaskScheduler *task_scheduler = BLI_task_scheduler_get();
-	TaskPool *task_pool;
 	MaskRasterHandle *handle;
 	ThreadedMaskRasterizeState state;
 	float *buffer;
-	int i, num_threads = BLI_task_scheduler_num_threads(task_scheduler), scanlines_per_thread;
 
 	buffer = MEM_mallocN(sizeof(float) * height * width, "rasterized mask buffer");
 
@@ -588,33 +576,10 @@ static float *threaded_mask_rasterize(Mask *mask, const int width, const int hei
 	state.width = width;
 	state.height = height;
 
-	task_pool = BLI_task_pool_create(task_scheduler, &state);
-
-	BLI_begin_threaded_malloc();
-
-	scanlines_per_thread = height / num_threads;
-	for (i = 0; i < num_threads; i++) {
-		ThreadedMaskRasterizeData *data = MEM_mallocN(sizeof(ThreadedMaskRasterizeData),
-		                                                "threaded mask rasterize data");
-
-		data->start_scanline = i * scanlines_per_thread;
-
-		if (i < num_threads - 1) {
-			data->num_scanlines = scanlines_per_thread;
-		}
-		else {
-			data->num_scanlines = height - data->start_scanline;
-		}
-
-		BLI_task_pool_push(task_pool, mask_rasterize_func, data, true, TASK_PRIORITY_LOW);
-	}
-
-	/* work and wait until tasks are done */
-	BLI_task_pool_work_and_wait(task_pool);
+	/* one iteration per scanline, chunked by the task scheduler */
+	BLI_task_parallel_range(0, height, &state, mask_rasterize_func);
 
 	/* Free memory. */
-	BLI_task_pool_free(task_pool);
-	BLI_end_threaded_malloc();
 	BKE_maskrasterize_handle_free(handle);
 
 	return buffer;
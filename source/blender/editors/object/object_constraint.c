@@ -1155,7 +1155,7 @@ void ED_object_constraint_dependency_update(Main *bmain, Object *ob)
 	ED_object_constraint_update(ob);
 
 	if (ob->pose) ob->pose->flag |= POSE_RECALC;    // checks & sorts pose channels
-	DAG_relations_tag_update(bmain);
+	DAG_id_relations_tag_update(bmain, &ob->id);
 }
 
 static int constraint_poll(bContext *C)
@@ -1325,7 +1325,7 @@ static int pose_constraints_clear_exec(bContext *C, wmOperator *UNUSED(op))
 	CTX_DATA_END;
 	
 	/* force depsgraph to get recalculated since relationships removed */
-	DAG_relations_tag_update(bmain);
+	DAG_id_relations_tag_update(bmain, &ob->id);
 	
 	/* note, calling BIK_clear_data() isn't needed here */
 
@@ -1358,12 +1358,12 @@ static int object_constraints_clear_exec(bContext *C, wmOperator *UNUSED(op))
 	{
 		BKE_free_constraints(&ob->constraints);
 		DAG_id_tag_update(&ob->id, OB_RECALC_OB);
+
+		/* force depsgraph to get recalculated since relationships removed */
+		DAG_id_relations_tag_update(bmain, &ob->id);
 	}
 	CTX_DATA_END;
 	
-	/* force depsgraph to get recalculated since relationships removed */
-	DAG_relations_tag_update(bmain);
-	
 	/* do updates */
 	WM_event_add_notifier(C, NC_OBJECT | ND_CONSTRAINT | NA_REMOVED, NULL);
 	
@@ -1442,13 +1442,13 @@ static int object_constraint_copy_exec(bContext *C, wmOperator *UNUSED(op))
 		if (obact != ob) {
 			BKE_copy_constraints(&ob->constraints, &obact->constraints, TRUE);
 			DAG_id_tag_update(&ob->id, OB_RECALC_DATA);
+
+			/* force depsgraph to get recalculated since new relationships added */
+			DAG_id_relations_tag_update(bmain, &ob->id);
 		}
 	}
 	CTX_DATA_END;
 	
-	/* force depsgraph to get recalculated since new relationships added */
-	DAG_relations_tag_update(bmain);
-	
 	/* notifiers for updates */
 	WM_event_add_notifier(C, NC_OBJECT | ND_CONSTRAINT | NA_ADDED, NULL);
 	
@@ -1709,7 +1709,7 @@ static int constraint_add_exec(bContext *C, wmOperator *op, Object *ob, ListBase
 
 
 	/* force depsgraph to get recalculated since new relationships added */
-	DAG_relations_tag_update(bmain);
+	DAG_id_relations_tag_update(bmain, &ob->id);
 	
 	if ((ob->type == OB_ARMATURE) && (pchan)) {
 		ob->pose->flag |= POSE_RECALC;  /* sort pose channels */
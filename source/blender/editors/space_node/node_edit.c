@@ -2430,9 +2430,9 @@ void NODE_OT_shader_script_update(wmOperatorType *ot)
 
 /* ********************** Viewer border ******************/
 
-static void viewer_border_corner_to_backdrop(SpaceNode *snode, ARegion *ar, int x, int y,
-                                             int backdrop_width, int backdrop_height,
-                                             float *fx, float *fy)
+void viewer_border_corner_to_backdrop(SpaceNode *snode, ARegion *ar, int x, int y,
+                                      int backdrop_width, int backdrop_height,
+                                      float *fx, float *fy)
 {
 	float bufx, bufy;
 
@@ -134,6 +134,8 @@ void NODE_OT_backimage_zoom(struct wmOperatorType *ot);
 void NODE_OT_backimage_fit(struct wmOperatorType *ot);
 void NODE_OT_backimage_sample(struct wmOperatorType *ot);
 
+void snode_bg_update_view_region(struct bContext *C, struct SpaceNode *snode, struct ARegion *ar);
+
 /* drawnode.c */
 void node_draw_link(struct View2D *v2d, struct SpaceNode *snode, struct bNodeLink *link);
 void node_draw_link_bezier(struct View2D *v2d, struct SpaceNode *snode, struct bNodeLink *link, int th_col1, int do_shaded, int th_col2, int do_triple, int th_col3);
@@ -216,6 +218,9 @@ void NODE_OT_tree_socket_move(struct wmOperatorType *ot);
 
 void NODE_OT_shader_script_update(struct wmOperatorType *ot);
 
+void viewer_border_corner_to_backdrop(struct SpaceNode *snode, struct ARegion *ar, int x, int y,
+                                      int backdrop_width, int backdrop_height,
+                                      float *fx, float *fy);
 void NODE_OT_viewer_border(struct wmOperatorType *ot);
 
 extern const char *node_context_dir[];
@@ -196,6 +196,56 @@ void NODE_OT_view_selected(wmOperatorType *ot)
 
 /* **************** Backround Image Operators ************** */
 
+/* store the part of the backdrop image that is visible, the compositor only calculates
+ * that part of viewer nodes. when more of the image became visible it is composited again,
+ * buffers of unchanged nodes are reused so only the new part is calculated.
+ * called by the backdrop operators and when drawing, which covers resizing the region.
+ * the region is stored in the node tree, with several editors showing the backdrop of the
+ * same tree the last one moved or drawn wins, and the others may show uncalculated parts
+ * until they are drawn again */
+void snode_bg_update_view_region(bContext *C, SpaceNode *snode, ARegion *ar)
+{
+	bNodeTree *ntree = snode->nodetree;
+	Image *ima;
+	ImBuf *ibuf;
+	void *lock;
+	rctf rectf;
+	bool grown;
+
+	if (ntree == NULL || !(ntree->flag & NTREE_VIEW_REGION) || !(snode->flag & SNODE_BACKDRAW))
+		return;
+
+	ima = BKE_image_verify_viewer(IMA_TYPE_COMPOSITE, "Viewer Node");
+	ibuf = BKE_image_acquire_ibuf(ima, NULL, &lock);
+
+	if (ibuf == NULL) {
+		BKE_image_release_ibuf(ima, ibuf, lock);
+		return;
+	}
+
+	viewer_border_corner_to_backdrop(snode, ar, 0, 0, ibuf->x, ibuf->y, &rectf.xmin, &rectf.ymin);
+	viewer_border_corner_to_backdrop(snode, ar, ar->winx, ar->winy, ibuf->x, ibuf->y, &rectf.xmax, &rectf.ymax);
+
+	BKE_image_release_ibuf(ima, ibuf, lock);
+
+	rectf.xmin = max_ff(rectf.xmin, 0.0f);
+	rectf.ymin = max_ff(rectf.ymin, 0.0f);
+	rectf.xmax = min_ff(rectf.xmax, 1.0f);
+	rectf.ymax = min_ff(rectf.ymax, 1.0f);
+
+	if (rectf.xmin >= rectf.xmax || rectf.ymin >= rectf.ymax)
+		return;
+
+	grown = (ntree->view_region.xmin >= ntree->view_region.xmax ||
+	         ntree->view_region.ymin >= ntree->view_region.ymax ||
+	         !BLI_rctf_inside_rctf(&ntree->view_region, &rectf));
+
+	ntree->view_region = rectf;
+
+	if (grown)
+		snode_notify(C, snode);
+}
+
 typedef struct NodeViewMove {
 	int mvalo[2];
 	int xmin, ymin, xmax, ymax;
@@ -231,6 +281,8 @@ static int snode_bg_viewmove_modal(bContext *C, wmOperator *op, const wmEvent *e
 			MEM_freeN(nvm);
 			op->customdata = NULL;
 
+			snode_bg_update_view_region(C, snode, ar);
+
 			return OPERATOR_FINISHED;
 	}
 
@@ -307,6 +359,8 @@ static int backimage_zoom_exec(bContext *C, wmOperator *op)
 	ED_region_tag_redraw(ar);
 	WM_main_add_notifier(NC_NODE | ND_DISPLAY, NULL);
 
+	snode_bg_update_view_region(C, snode, ar);
+
 	return OPERATOR_FINISHED;
 }
 
@@ -365,6 +419,8 @@ static int backimage_fit_exec(bContext *C, wmOperator *UNUSED(op))
 	ED_region_tag_redraw(ar);
 	WM_main_add_notifier(NC_NODE | ND_DISPLAY, NULL);
 
+	snode_bg_update_view_region(C, snode, ar);
+
 	return OPERATOR_FINISHED;
 }
 
@@ -637,6 +637,9 @@ static void node_main_area_init(wmWindowManager *wm, ARegion *ar)
 
 static void node_main_area_draw(const bContext *C, ARegion *ar)
 {
+	/* resizing the region can show more of the backdrop */
+	snode_bg_update_view_region((bContext *)C, CTX_wm_space_node(C), ar);
+
 	drawnodespace(C, ar);
 }
 
@@ -41,6 +41,7 @@
 #include "MEM_guardedalloc.h"
 
 #include "BLI_utildefines.h"
+#include "BLI_task.h"
 #include "BLI_threads.h"
 #include "BLI_listbase.h"
 #include "BLI_math.h"
@@ -284,6 +285,22 @@ void nearest_interpolation(ImBuf *in, ImBuf *out, float x, float y, int xout, in
 
 /*********************** Threaded image processing *************************/
 
+typedef struct ProcessorApplyThreadedData {
+	void *handles;
+	int handle_size;
+	void *(*do_thread) (void *);
+} ProcessorApplyThreadedData;
+
+static void processor_apply_handle_func(void *userdata, int iter)
+{
+	ProcessorApplyThreadedData *data = (ProcessorApplyThreadedData *) userdata;
+
+	data->do_thread(((char *) data->handles) + data->handle_size * iter);
+}
+
+/* from the main thread handles are run on the global task scheduler. the scheduler is
+ * created on first use, which is only safe from the main thread, render and sequencer
+ * threads start their own threads */
 void IMB_processor_apply_threaded(int buffer_lines, int handle_size, void *init_customdata,
                                   void (init_handle) (void *handle, int start_line, int tot_line,
                                                       void *customdata),
@@ -292,12 +309,18 @@ void IMB_processor_apply_threaded(int buffer_lines, int handle_size, void *init_
 	void *handles;
 	ListBase threads;
 
-	int i, tot_thread = BLI_system_thread_count();
+	const bool use_tasks = BLI_thread_is_main();
+	int i, tot_thread;
 	int start_line, tot_line;
 
+	if (use_tasks)
+		tot_thread = BLI_task_scheduler_num_threads(BLI_task_scheduler_get());
+	else
+		tot_thread = BLI_system_thread_count();
+
 	handles = MEM_callocN(handle_size * tot_thread, "processor apply threaded handles");
 
-	if (tot_thread > 1)
+	if (!use_tasks && tot_thread > 1)
 		BLI_init_threads(&threads, do_thread, tot_thread);
 
 	start_line = 0;
@@ -314,13 +337,22 @@ void IMB_processor_apply_threaded(int buffer_lines, int handle_size, void *init_
 
 		init_handle(handle, start_line, cur_tot_line, init_customdata);
 
-		if (tot_thread > 1)
+		if (!use_tasks && tot_thread > 1)
 			BLI_insert_thread(&threads, handle);
 
 		start_line += tot_line;
 	}
 
-	if (tot_thread > 1)
+	if (use_tasks) {
+		ProcessorApplyThreadedData data;
+
+		data.handles = handles;
+		data.handle_size = handle_size;
+		data.do_thread = do_thread;
+
+		BLI_task_parallel_range_ex(0, tot_thread, &data, processor_apply_handle_func, 2);
+	}
+	else if (tot_thread > 1)
 		BLI_end_threads(&threads);
 	else
 		do_thread(handles);
@@ -352,6 +352,7 @@ typedef struct bNodeTree {
 	int chunksize;					/* tile size for compositor engine */
 	
 	rctf viewer_border;
+	rctf view_region;				/* part of the viewer image visible in the node editor backdrop, last editor wins */
 	
 	/* Lists of bNodeSocket to hold default values and own_index.
 	 * Warning! Don't make links to these sockets, input/output nodes are used for that.
@@ -403,6 +404,9 @@ typedef struct bNodeTree {
 #define NTREE_COM_GROUPNODE_BUFFER	8	/* use groupnode buffers */
 #define NTREE_VIEWER_BORDER			16	/* use a border for viewer nodes */
 #define NTREE_IS_LOCALIZED			32	/* tree is localized copy, free when deleting node groups */
+#define NTREE_COM_BUFFER_CACHE		64	/* keep buffers of unchanged nodes between executions */
+#define NTREE_COM_HALF_BUFFERS		128	/* store buffers between nodes as half float */
+#define NTREE_VIEW_REGION			256	/* only calculate the visible part of viewer nodes */
 
 /* XXX not nice, but needed as a temporary flags
  * for group updates after library linking.
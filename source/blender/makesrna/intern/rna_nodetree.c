@@ -7497,6 +7497,26 @@ static void rna_def_composite_nodetree(BlenderRNA *brna)
 	RNA_def_property_boolean_sdna(prop, NULL, "flag", NTREE_VIEWER_BORDER);
 	RNA_def_property_ui_text(prop, "Viewer Border", "Use boundaries for viewer nodes and composite backdrop");
 	RNA_def_property_update(prop, NC_NODE | ND_DISPLAY, "rna_NodeTree_update");
+
+	prop = RNA_def_property(srna, "use_view_region", PROP_BOOLEAN, PROP_NONE);
+	RNA_def_property_boolean_sdna(prop, NULL, "flag", NTREE_VIEW_REGION);
+	RNA_def_property_ui_text(prop, "View Region",
+	                         "Only calculate the part of viewer nodes visible in the backdrop, "
+	                         "the rest is calculated when the backdrop is moved or zoomed");
+	RNA_def_property_update(prop, NC_NODE | ND_DISPLAY, "rna_NodeTree_update");
+
+	prop = RNA_def_property(srna, "use_buffer_cache", PROP_BOOLEAN, PROP_NONE);
+	RNA_def_property_boolean_sdna(prop, NULL, "flag", NTREE_COM_BUFFER_CACHE);
+	RNA_def_property_ui_text(prop, "Buffer Cache",
+	                         "Keep buffers of unchanged nodes between executions, so only nodes that changed "
+	                         "are calculated again");
+	RNA_def_property_update(prop, NC_NODE | ND_DISPLAY, "rna_NodeTree_update");
+
+	prop = RNA_def_property(srna, "use_half_buffers", PROP_BOOLEAN, PROP_NONE);
+	RNA_def_property_boolean_sdna(prop, NULL, "flag", NTREE_COM_HALF_BUFFERS);
+	RNA_def_property_ui_text(prop, "Half Float Buffers",
+	                         "Store buffers between nodes as half float, using less memory at reduced precision");
+	RNA_def_property_update(prop, NC_NODE | ND_DISPLAY, "rna_NodeTree_update");
 }
 
 static void rna_def_shader_nodetree(BlenderRNA *brna)
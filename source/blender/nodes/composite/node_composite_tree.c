@@ -260,6 +260,14 @@ void ntreeCompositExecTree(bNodeTree *ntree, RenderData *rd, int rendering, int
 	(void)do_preview;
 }
 
+/* free buffers cached between executions, they may belong to a tree or file that is gone */
+void ntreeCompositClearCaches(void)
+{
+#ifdef WITH_COMPOSITOR
+	COM_clearCaches();
+#endif
+}
+
 /* *********************************************** */
 
 /* based on rules, force sockets hidden always */
@@ -303,6 +311,11 @@ void ntreeCompositTagRender(Scene *curscene)
 			}
 		}
 	}
+
+#ifdef WITH_COMPOSITOR
+	/* cached buffers of render layers are outdated */
+	COM_tagRender();
+#endif
 }
 
 static int node_animation_properties(bNodeTree *ntree, bNode *node)
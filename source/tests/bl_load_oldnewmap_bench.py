@@ -0,0 +1,96 @@
+# ##### BEGIN GPL LICENSE BLOCK #####
+#
+#  This program is free software; you can redistribute it and/or
+#  modify it under the terms of the GNU General Public License
+#  as published by the Free Software Foundation; either version 2
+#  of the License, or (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, write to the Free Software Foundation,
+#  Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+#
+# ##### END GPL LICENSE BLOCK #####
+
+# <pep8 compliant>
+
+# Load time benchmark for files with many old pointers (readfile.c OldNewMap).
+#
+# Writes synthetic files and times opening them, each text line is written
+# as two blocks (the TextLine and its string), each object adds an ID to the
+# library map, so the number of old pointers is known up front.
+#
+# Run with:
+#   blender --background --factory-startup \
+#       --python source/tests/bl_load_oldnewmap_bench.py -- \
+#       [--pointers 1000000,10000000,50000000] [--objects 10000] [--dir /tmp]
+
+import bpy
+
+import os
+import sys
+import time
+
+
+def parse_args():
+    import argparse
+
+    argv = sys.argv[sys.argv.index("--") + 1:] if "--" in sys.argv else []
+
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--pointers", default="1000000,5000000,10000000,50000000",
+                        help="comma separated number of data pointers per file")
+    parser.add_argument("--objects", type=int, default=10000,
+                        help="number of objects per file")
+    parser.add_argument("--dir", default=bpy.app.tempdir,
+                        help="directory to write the files to")
+    return parser.parse_args(argv)
+
+
+def write_file(filepath, pointers, objects):
+    bpy.ops.wm.read_factory_settings()
+    scene = bpy.context.scene
+
+    text = bpy.data.texts.new("oldnewmap_bench")
+    text.from_string("x\n" * (pointers // 2))
+
+    for i in range(objects):
+        ob = bpy.data.objects.new("Empty.%d" % i, None)
+        scene.objects.link(ob)
+
+    bpy.ops.wm.save_as_mainfile(filepath=filepath, compress=False)
+
+
+def time_load(filepath):
+    time_start = time.time()
+    bpy.ops.wm.open_mainfile(filepath=filepath, load_ui=False)
+    return time.time() - time_start
+
+
+def main():
+    args = parse_args()
+
+    for pointers in [int(p) for p in args.pointers.split(",")]:
+        filepath = os.path.join(args.dir, "oldnewmap_bench_%d.blend" % pointers)
+
+        write_file(filepath, pointers, args.objects)
+        size = os.path.getsize(filepath)
+
+        print("%10d pointers %8d objects %8.1f MB: load %.3f sec" %
+              (pointers, args.objects, size / (1024.0 * 1024.0), time_load(filepath)))
+
+        os.remove(filepath)
+
+
+if __name__ == "__main__":
+    # So a python error exits(1)
+    try:
+        main()
+    except:
+        import traceback
+        traceback.print_exc()
+        sys.exit(1)